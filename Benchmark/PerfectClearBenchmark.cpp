@@ -0,0 +1,199 @@
+/*
+ * Copyright (C) 2016 Daniel Becker <beckerdaniel.dani@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+// Runs the perfect-clear solver on a corpus of positions on a 10 wide board
+// and checks the answers, replaying every solution that is found.
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "BasicBlock.h"
+#include "BasicBoard.h"
+#include "DefaultGameBoard.h"
+#include "PerfectClearSolver.h"
+#include "TetrominoI.h"
+#include "TetrominoJ.h"
+#include "TetrominoL.h"
+#include "TetrominoO.h"
+#include "TetrominoS.h"
+#include "TetrominoT.h"
+#include "TetrominoZ.h"
+
+using namespace std;
+using namespace tetris;
+
+namespace {
+
+const int height = 24;
+const int width = 10;
+
+struct Position
+{
+  string name;
+  int rows; // The height of the field to clear.
+  vector<string> field; // The bottom rows of the board, '#' being filled.
+  string queue;
+  bool expected;
+};
+
+const vector<Position> corpus {
+  {"empty, I pieces", 4, {}, "IIIIIIIIII", true},
+  {"empty, O pieces", 4, {}, "OOOOOOOOOO", true},
+  {"empty, S pieces", 4, {}, "SSSSSSSSSSS", false},
+  {"empty, first bag", 4, {}, "IJLOSTZIJLO", true},
+  {"empty, second bag", 4, {}, "TZSOJLITZSO", true},
+  {"empty, no hold needed", 4, {}, "IIIIIIIIIIO", true},
+  {"empty, early clear", 4, {}, "TOSZOOZJIZS", true},
+  {"empty, early clear, many Z", 4, {}, "TZSSZSZIZIJ", true},
+  {"two rows, square well", 2,
+   {"########..",
+    "########.."}, "IO", true},
+  {"two rows, middle gap", 2,
+   {"###....###",
+    "###....###"}, "IIOO", true},
+  {"two rows, odd gap", 2,
+   {"###.....##",
+    "###....###"}, "IIOOTT", false},
+  {"three rows, hold for the slot", 3,
+   {"######....",
+    "#######...",
+    "#########."}, "TZL", true},
+  {"three rows, wrong pieces", 3,
+   {"######....",
+    "#######...",
+    "#########."}, "OOIT", false},
+  {"four rows, left side built", 4,
+   {"..........",
+    "..........",
+    "####......",
+    "####......"}, "TSZOJLITS", true},
+  {"four rows, late in the bag", 4,
+   {"..........",
+    "####......",
+    "####......",
+    "####......"}, "JLSZTOIJ", true},
+  {"four rows, buried hole", 4,
+   {"..........",
+    "..........",
+    "#######...",
+    "#.########"}, "IJLOSTZIJ", false},
+};
+
+shared_ptr<const Shape> makeShape(char kind, shared_ptr<Block> block) {
+  switch (kind) {
+  case 'I': return make_shared<TetrominoI>(block);
+  case 'J': return make_shared<TetrominoJ>(block);
+  case 'L': return make_shared<TetrominoL>(block);
+  case 'O': return make_shared<TetrominoO>(block);
+  case 'S': return make_shared<TetrominoS>(block);
+  case 'T': return make_shared<TetrominoT>(block);
+  default: return make_shared<TetrominoZ>(block);
+  }
+}
+
+// Plays the solution on the board and tells whether it ends up empty.
+bool replay(shared_ptr<BasicBoard> board,
+            const vector<shared_ptr<const Shape>>& queue,
+            const vector<PerfectClearStep>& solution) {
+  DefaultGameBoard game_board(board);
+  int index = 0;
+  int hold = -1;
+  for (const PerfectClearStep& step : solution) {
+    int piece = index;
+    if (!step.hold) {
+      ++index;
+    } else if (hold < 0) {
+      piece = index + 1;
+      hold = index;
+      index += 2;
+    } else {
+      piece = hold;
+      hold = index;
+      ++index;
+    }
+
+    shared_ptr<Shape> shape = queue[piece]->clone();
+    for (int r = 0; r < step.rotation; ++r) {
+      shape->rotateRight();
+    }
+    game_board.setCurrentShape(shape);
+    game_board.setCurrentShapePosition(step.position);
+    if (!game_board.isAtValidPos()
+        || game_board.whereWouldLand() != step.position) {
+      return false;
+    }
+    game_board.lock();
+    game_board.removeFilledRows();
+  }
+
+  for (int v = 0; v < height; ++v) {
+    for (int h = 0; h < width; ++h) {
+      if (board->isFilled(v, h)) { return false; }
+    }
+  }
+  return true;
+}
+
+} // namespace.
+
+int main()
+{
+  shared_ptr<Block> block = make_shared<BasicBlock>();
+  int correct = 0;
+  double total_ms = 0.0;
+  for (const Position& position : corpus) {
+    shared_ptr<BasicBoard> board = make_shared<BasicBoard>(height, width);
+    int first_row = height - position.field.size();
+    for (size_t r = 0; r < position.field.size(); ++r) {
+      for (int h = 0; h < width; ++h) {
+        if (position.field[r][h] == '#') {
+          board->set(first_row + r, h, block);
+        }
+      }
+    }
+    vector<shared_ptr<const Shape>> queue;
+    for (char kind : position.queue) {
+      queue.push_back(makeShape(kind, block));
+    }
+
+    PerfectClearSolver solver(position.rows);
+    vector<PerfectClearStep> solution;
+    auto start = chrono::steady_clock::now();
+    bool found = solver.solve(*board, queue, solution);
+    auto end = chrono::steady_clock::now();
+    double ms = chrono::duration<double, milli>(end - start).count();
+    total_ms += ms;
+
+    bool valid = !found || replay(board, queue, solution);
+    bool ok = valid && found == position.expected;
+    correct += ok;
+    cout << left << setw(32) << position.name
+         << (found ? "found    " : "no clear ")
+         << right << setw(3) << solution.size() << " pieces  "
+         << setw(8) << solver.getVisitedCount() << " states  "
+         << fixed << setprecision(3) << setw(9) << ms << " ms"
+         << (ok ? "" : valid ? "  UNEXPECTED" : "  INVALID SOLUTION")
+         << "\n";
+  }
+  cout << correct << "/" << corpus.size() << " as expected in "
+       << fixed << setprecision(3) << total_ms << " ms\n";
+  return correct == static_cast<int>(corpus.size()) ? 0 : 1;
+}
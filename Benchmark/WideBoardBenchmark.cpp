@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2016 Daniel Becker <beckerdaniel.dani@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Compares BasicBoard with the dense and sparse BitsetBoard on a 1000x1000
+// board: filling cells, reading them back and removing rows.
+
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+
+#include "BasicBlock.h"
+#include "BasicBoard.h"
+#include "BitsetBoard.h"
+
+using namespace std;
+using namespace tetris;
+
+namespace {
+
+const int size = 1000;
+
+double measure_ms(function<void()> func) {
+  auto start = chrono::steady_clock::now();
+  func();
+  auto end = chrono::steady_clock::now();
+  return chrono::duration<double, milli>(end - start).count();
+}
+
+void run(const string& name, function<shared_ptr<Board>()> make_board,
+         double density) {
+  shared_ptr<Block> block = make_shared<BasicBlock>();
+  shared_ptr<Board> board;
+  double construct = measure_ms([&]() { board = make_board(); });
+
+  mt19937 engine(42);
+  uniform_real_distribution<double> dist(0.0, 1.0);
+  double fill = measure_ms([&]() {
+    for (int v = 0; v < size; ++v) {
+      for (int h = 0; h < size; ++h) {
+        if (dist(engine) < density) { board->set(v, h, block); }
+      }
+    }
+  });
+
+  long filled = 0;
+  double read = measure_ms([&]() {
+    for (int v = 0; v < size; ++v) {
+      for (int h = 0; h < size; ++h) {
+        filled += board->get(v, h) != nullptr;
+      }
+    }
+  });
+
+  uniform_int_distribution<int> row_dist(0, size - 1);
+  const int removals = 10000;
+  double remove = measure_ms([&]() {
+    for (int i = 0; i < removals; ++i) {
+      board->removeRow(row_dist(engine));
+    }
+  });
+
+  cout << left << setw(22) << name << fixed << setprecision(2)
+       << " density " << density
+       << "  construct " << setw(9) << construct << " ms"
+       << "  fill " << setw(9) << fill << " ms"
+       << "  read " << setw(9) << read << " ms"
+       << "  " << removals << " x removeRow " << setw(9) << remove << " ms"
+       << "  (" << filled << " filled)\n";
+}
+
+} // namespace.
+
+int main()
+{
+  for (double density : {0.5, 0.01}) {
+    run("BasicBoard", []() {
+          return make_shared<BasicBoard>(size, size);
+        }, density);
+    run("BitsetBoard (dense)", []() {
+          return make_shared<BitsetBoard>(size, size);
+        }, density);
+    run("BitsetBoard (sparse)", []() {
+          return make_shared<BitsetBoard>(size, size,
+                                          BitsetBoard::Storage::SPARSE);
+        }, density);
+  }
+  return 0;
+}
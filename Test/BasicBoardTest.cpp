@@ -16,6 +16,8 @@
 
 #include "UnitTest++.h"
 
+#include <stdexcept>
+
 #include "BasicBlock.h"
 #include "BasicBoard.h"
 
@@ -105,6 +107,39 @@ SUITE(get)
   }
 }
 
+SUITE(peek)
+{
+  TEST(peek0)
+  {
+    // Valid position.
+    const int height = 18;
+    const int width = 10;
+    shared_ptr<BasicBoard> bb = make_shared<BasicBoard>(height, width);
+
+    int vertical = 4;
+    int horizontal = 8;
+    shared_ptr<Block> block = make_shared<BasicBlock>();
+    bb->set(vertical, horizontal, block);
+
+    const Block* res = bb->peek(vertical, horizontal);
+    CHECK_EQUAL(block.get(), res);
+    CHECK_EQUAL(true, bb->isFilled(vertical, horizontal));
+    CHECK_EQUAL(false, bb->isFilled(vertical, horizontal - 1));
+  }
+
+  TEST(peek1)
+  {
+    // Invalid position.
+    const int height = 18;
+    const int width = 10;
+    shared_ptr<BasicBoard> bb = make_shared<BasicBoard>(height, width);
+
+    const Block* exp_res = nullptr;
+    const Block* res = bb->peek(-10, 0);
+    CHECK_EQUAL(exp_res, res);
+  }
+}
+
 SUITE(set)
 {
   TEST(set0)
@@ -161,4 +196,36 @@ SUITE(removeRow)
 
 }
 
+SUITE(insertRowsAtBottom)
+{
+  TEST(insertRowsAtBottomShiftsRowsUp)
+  {
+    const int height = 6;
+    const int width = 4;
+    BasicBoard bb(height, width);
+    shared_ptr<Block> block = make_shared<BasicBlock>();
+    bb.set(height - 1, 1, block);
+    bb.set(0, 2, block);
+
+    vector<shared_ptr<Block>> pattern {block, nullptr, block, block};
+    bb.insertRowsAtBottom(2, pattern);
+
+    // The top row was pushed out, the bottom row moved up by two.
+    CHECK_EQUAL(false, bb.isFilled(0, 2));
+    CHECK_EQUAL(true, bb.isFilled(height - 3, 1));
+    for (int v = height - 2; v < height; ++v) {
+      for (int h = 0; h < width; ++h) {
+        CHECK_EQUAL(pattern[h] != nullptr, bb.isFilled(v, h));
+      }
+    }
+  }
+
+  TEST(insertRowsAtBottomWrongPattern)
+  {
+    BasicBoard bb(6, 4);
+    vector<shared_ptr<Block>> pattern(3);
+    CHECK_THROW(bb.insertRowsAtBottom(1, pattern), invalid_argument);
+  }
+}
+
 }
@@ -150,6 +150,45 @@ SUITE(get)
     bool res = not_null && correct_class;
     CHECK_EQUAL(exp_res, res);
   }
+
+  TEST_FIXTURE(BasicShapeFixture, get3)
+  {
+    // Every block is found at its position after turning the shape.
+    vector<shared_ptr<Block>> blocks = bsh->getBlocks();
+    for (int turn = 0; turn < 4; ++turn) {
+      vector<Coords> positions = bsh->getBlockPositions();
+      int found = 0;
+      for (int v = 0; v < bbox_size; ++v) {
+        for (int h = 0; h < bbox_size; ++h) {
+          if (bsh->get(v, h) != nullptr) { ++found; }
+        }
+      }
+      CHECK_EQUAL(4, found);
+      for (size_t i = 0; i < positions.size(); ++i) {
+        CHECK(bsh->get(positions[i]) == blocks[i]);
+        CHECK(bsh->peek(positions[i].getVertical(),
+                        positions[i].getHorizontal()) == blocks[i].get());
+      }
+      bsh->rotateRight();
+    }
+  }
+
+  TEST(get4)
+  {
+    // A shape with a large bounding box.
+    const int large_size = 40;
+    vector<Coords> coords;
+    vector<shared_ptr<Block>> blocks;
+    for (int h = 0; h < large_size; ++h) {
+      coords.push_back(Coords(h % 7, h));
+      blocks.push_back(bblock->clone());
+    }
+    BasicShape shape(large_size, coords, blocks);
+    shape.rotateLeft();
+    CHECK(shape.get(large_size - 1, 0) == blocks[0]);
+    CHECK(shape.get(large_size - 1 - 20, 20 % 7) == blocks[20]);
+    CHECK(shape.get(0, 0) == nullptr);
+  }
 }
 
 SUITE(getBlocks)
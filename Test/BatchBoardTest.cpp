@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2016 Daniel Becker <beckerdaniel.dani@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "UnitTest++.h"
+
+#include "BasicBlock.h"
+#include "BatchBoard.h"
+#include "BatchBoardView.h"
+#include "DefaultGameBoard.h"
+#include "TetrominoO.h"
+
+using namespace std;
+using namespace tetris;
+
+namespace {
+
+SUITE(BatchBoard)
+{
+  typedef BatchBoard::Row Row;
+  const int count = 3;
+  const int height = 6;
+  const int width = 4;
+
+  class BatchBoardFixture {
+  public:
+    shared_ptr<BatchBoard> batch = make_shared<BatchBoard>(count, height,
+                                                           width);
+  };
+
+  TEST_FIXTURE(BatchBoardFixture, setFilled)
+  {
+    batch->setFilled(1, 2, 3, true);
+    CHECK_EQUAL(true, batch->isFilled(1, 2, 3));
+    CHECK_EQUAL(false, batch->isFilled(0, 2, 3));
+    CHECK_EQUAL(false, batch->isFilled(2, 2, 3));
+
+    batch->setFilled(1, 2, 3, false);
+    CHECK_EQUAL(false, batch->isFilled(1, 2, 3));
+  }
+
+  TEST_FIXTURE(BatchBoardFixture, insertRowsAtBottom)
+  {
+    BatchBoardView view(batch, 1);
+    view.set(height - 1, 0, make_shared<BasicBlock>());
+    vector<shared_ptr<Block>> pattern {make_shared<BasicBlock>(), nullptr,
+                                       nullptr, make_shared<BasicBlock>()};
+    view.insertRowsAtBottom(2, pattern);
+
+    CHECK_EQUAL(Row(1), batch->getRow(1, height - 3));
+    CHECK_EQUAL(Row(9), batch->getRow(1, height - 2));
+    CHECK_EQUAL(Row(9), batch->getRow(1, height - 1));
+    CHECK_EQUAL(Row(0), batch->getRow(0, height - 1));
+    CHECK_EQUAL(Row(0), batch->getRow(2, height - 1));
+  }
+
+  TEST_FIXTURE(BatchBoardFixture, testCollisions)
+  {
+    // An O piece in the two leftmost columns in every game.
+    Row masks[count * BatchBoard::MASK_ROWS] = {
+      3, 3, 0, 0,
+      3, 3, 0, 0,
+      // Sticking out on the right.
+      Row(3) << 3, Row(3) << 3, 0, 0
+    };
+    int tops[count] = {height - 2, height - 1, -1};
+    uint8_t results[count];
+
+    batch->setFilled(0, height - 1, 2, true);
+    batch->testCollisions(masks, tops, results);
+
+    CHECK_EQUAL(0, results[0]);
+    CHECK_EQUAL(1, results[1]); // Below the bottom.
+    CHECK_EQUAL(1, results[2]); // Outside the right wall.
+
+    batch->setFilled(0, height - 1, 1, true);
+    batch->testCollisions(masks, tops, results);
+    CHECK_EQUAL(1, results[0]);
+  }
+
+  TEST_FIXTURE(BatchBoardFixture, lockAndRemoveFilledRows)
+  {
+    for (int g = 0; g < count; ++g) {
+      batch->setRow(g, height - 1, 0xC);
+      batch->setRow(g, height - 2, 0x4);
+    }
+    Row masks[count * BatchBoard::MASK_ROWS] = {
+      3, 3, 0, 0,
+      3, 0, 0, 0,
+      0, 0, 0, 0
+    };
+    int tops[count] = {height - 2, height - 1, 0};
+    batch->lock(masks, tops);
+
+    int removed[count];
+    batch->removeFilledRows(removed);
+
+    CHECK_EQUAL(1, removed[0]);
+    CHECK_EQUAL(1, removed[1]);
+    CHECK_EQUAL(0, removed[2]);
+
+    // Game 0: the bottom row was full, the row above it moved down.
+    CHECK_EQUAL(Row(0x7), batch->getRow(0, height - 1));
+    CHECK_EQUAL(Row(0), batch->getRow(0, height - 2));
+    // Game 1.
+    CHECK_EQUAL(Row(0x4), batch->getRow(1, height - 1));
+    // Game 2 is unchanged.
+    CHECK_EQUAL(Row(0xC), batch->getRow(2, height - 1));
+    CHECK_EQUAL(Row(0x4), batch->getRow(2, height - 2));
+  }
+
+  TEST_FIXTURE(BatchBoardFixture, viewWithDefaultGameBoard)
+  {
+    shared_ptr<Board> view = make_shared<BatchBoardView>(batch, 2);
+    shared_ptr<DefaultGameBoard> dgb = make_shared<DefaultGameBoard>(view);
+    dgb->setCurrentShape(make_shared<TetrominoO>(make_shared<BasicBlock>()));
+    dgb->setCurrentShapePosition(Coords(0, 0));
+
+    dgb->setCurrentShapePosition(dgb->whereWouldLand());
+    dgb->lock();
+
+    CHECK_EQUAL(Row(0x3), batch->getRow(2, height - 1));
+    CHECK_EQUAL(Row(0x3), batch->getRow(2, height - 2));
+    CHECK_EQUAL(Row(0), batch->getRow(1, height - 1));
+    CHECK_EQUAL(true, view->get(height - 1, 0) != nullptr);
+    CHECK_EQUAL(true, view->get(height - 1, 2) == nullptr);
+  }
+}
+
+}
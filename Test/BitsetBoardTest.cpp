@@ -0,0 +1,160 @@
+/*
+ * Copyright (C) 2016 Daniel Becker <beckerdaniel.dani@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "UnitTest++.h"
+
+#include "BasicBlock.h"
+#include "BasicBoard.h"
+#include "BitsetBoard.h"
+
+using namespace std;
+using namespace tetris;
+
+namespace {
+
+// Checks whether two boards have the same cells filled.
+bool same_occupancy(const Board& lhs, const Board& rhs) {
+  for (int v = 0; v < lhs.getHeight(); ++v) {
+    for (int h = 0; h < lhs.getWidth(); ++h) {
+      if ((lhs.get(v, h) == nullptr) != (rhs.get(v, h) == nullptr)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+SUITE(BitsetBoard)
+{
+  const shared_ptr<Block> bblock = make_shared<BasicBlock>();
+
+  TEST(getSetWide)
+  {
+    BitsetBoard board(5, 150);
+    CHECK_EQUAL(3, board.getWordsPerRow());
+
+    board.set(2, 130, bblock);
+    CHECK_EQUAL(true, board.get(2, 130) != nullptr);
+    CHECK_EQUAL(true, board.get(2, 129) == nullptr);
+    CHECK_EQUAL(true, board.get(3, 130) == nullptr);
+
+    board.set(2, 130, nullptr);
+    CHECK_EQUAL(true, board.get(2, 130) == nullptr);
+  }
+
+  TEST(isFilled)
+  {
+    BitsetBoard board(4, 4);
+    board.set(1, 1, bblock);
+    CHECK_EQUAL(true, board.isFilled(Coords(1, 1)));
+    CHECK_EQUAL(false, board.isFilled(1, 2));
+    CHECK_EQUAL(false, board.isFilled(Coords(5, 1)));
+  }
+
+  TEST(isRowFull)
+  {
+    BitsetBoard board(4, 70);
+    for (int h = 0; h < 70; ++h) {
+      board.set(3, h, bblock);
+    }
+    CHECK_EQUAL(true, board.isRowFull(3));
+    CHECK_EQUAL(false, board.isRowFull(2));
+  }
+
+  TEST(removeRowMatchesBasicBoard)
+  {
+    for (BitsetBoard::Storage storage : {BitsetBoard::Storage::DENSE,
+                                         BitsetBoard::Storage::SPARSE}) {
+      const int height = 9;
+      const int width = 7;
+      BasicBoard basic(height, width);
+      BitsetBoard bitset(height, width, storage);
+
+      for (int v = 0; v < height; ++v) {
+        for (int h = 0; h < width; ++h) {
+          if ((v * 5 + h * 3) % 4 == 0) {
+            basic.set(v, h, bblock);
+            bitset.set(v, h, bblock);
+          }
+        }
+      }
+
+      // Rows from both halves of the board, so that the ring is turned in
+      // both directions.
+      for (int row : {7, 1, 4, 8, 0, 5, 5, 2}) {
+        basic.removeRow(row);
+        bitset.removeRow(row);
+        CHECK_EQUAL(true, same_occupancy(basic, bitset));
+      }
+    }
+  }
+
+  TEST(insertRowsAtBottomMatchesBasicBoard)
+  {
+    for (BitsetBoard::Storage storage : {BitsetBoard::Storage::DENSE,
+                                         BitsetBoard::Storage::SPARSE}) {
+      const int height = 9;
+      const int width = 70;
+      BasicBoard basic(height, width);
+      BitsetBoard bitset(height, width, storage);
+      basic.set(0, 3, bblock);
+      bitset.set(0, 3, bblock);
+
+      vector<shared_ptr<Block>> garbage(width, bblock);
+      garbage[65] = nullptr;
+      vector<shared_ptr<Block>> empty(width);
+
+      // Interleaved with removals, so that the ring is turned both ways.
+      basic.insertRowsAtBottom(2, garbage);
+      bitset.insertRowsAtBottom(2, garbage);
+      CHECK_EQUAL(true, same_occupancy(basic, bitset));
+      CHECK_EQUAL(false, bitset.isRowFull(height - 1));
+
+      basic.removeRow(height - 1);
+      bitset.removeRow(height - 1);
+      basic.insertRowsAtBottom(3, empty);
+      bitset.insertRowsAtBottom(3, empty);
+      CHECK_EQUAL(true, same_occupancy(basic, bitset));
+
+      basic.insertRowsAtBottom(height + 1, garbage);
+      bitset.insertRowsAtBottom(height + 1, garbage);
+      CHECK_EQUAL(true, same_occupancy(basic, bitset));
+    }
+
+    BitsetBoard sparse(10, 5, BitsetBoard::Storage::SPARSE);
+    sparse.insertRowsAtBottom(4, vector<shared_ptr<Block>>(5));
+    CHECK_EQUAL(0, sparse.getAllocatedRows());
+  }
+
+  TEST(sparseAllocatesOnlyFilledRows)
+  {
+    BitsetBoard board(1000, 1000, BitsetBoard::Storage::SPARSE);
+    CHECK_EQUAL(0, board.getAllocatedRows());
+
+    board.set(10, 999, bblock);
+    board.set(500, 0, bblock);
+    CHECK_EQUAL(2, board.getAllocatedRows());
+    CHECK_EQUAL(true, board.getRowWords(11) == nullptr);
+
+    board.set(10, 999, nullptr);
+    CHECK_EQUAL(1, board.getAllocatedRows());
+
+    board.removeRow(500);
+    CHECK_EQUAL(0, board.getAllocatedRows());
+  }
+}
+
+}
@@ -0,0 +1,140 @@
+/*
+ * Copyright (C) 2016 Daniel Becker <beckerdaniel.dani@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "UnitTest++.h"
+
+#include <random>
+
+#include "BasicBlock.h"
+#include "BasicBoard.h"
+#include "BatchBoard.h"
+#include "BatchBoardView.h"
+#include "BitsetBoard.h"
+#include "CollisionMask.h"
+#include "TetrominoI.h"
+#include "TetrominoT.h"
+
+using namespace std;
+using namespace tetris;
+
+namespace {
+
+// Checks the blocks one by one, the way the masks must agree with.
+bool collidesSlow(const Board& board, int hidden_rows, const Shape& shape,
+                  Coords pos) {
+  for (const Coords& rel : shape.getBlockPositions()) {
+    Coords c = pos + rel;
+    if (!board.isValid(c) && !board.isValid(c + Coords(hidden_rows, 0))) {
+      return true;
+    }
+    if (board.isFilled(c)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void fillRandomly(Board& board, unsigned int seed) {
+  mt19937 random_engine(seed);
+  for (int v = 0; v < board.getHeight(); ++v) {
+    for (int h = 0; h < board.getWidth(); ++h) {
+      if (random_engine() % 4 == 0) {
+        board.set(v, h, make_shared<BasicBlock>());
+      }
+    }
+  }
+}
+
+SUITE(construction)
+{
+  TEST(maskOfT)
+  {
+    TetrominoT t(make_shared<BasicBlock>());
+    CollisionMask mask(t);
+    CHECK_EQUAL(1, mask.getTop());
+    CHECK_EQUAL(0, mask.getLeft());
+    CHECK_EQUAL(2, mask.getHeight());
+    CHECK_EQUAL(7u, mask.getRow(0));
+    CHECK_EQUAL(2u, mask.getRow(1));
+  }
+
+  TEST(emptyMaskNeverCollides)
+  {
+    BasicBoard board(4, 4);
+    CollisionMask mask;
+    CHECK_EQUAL(0, mask.getHeight());
+    CHECK_EQUAL(false, mask.collides(board, 0, PackedCoords(-10, -10)));
+  }
+
+  TEST(tooTall)
+  {
+    PackedCoords positions[] = {PackedCoords(0, 0),
+                                PackedCoords(CollisionMask::MAX_ROWS, 0)};
+    CHECK_EQUAL(false, CollisionMask::isRepresentable(positions, 2));
+    CHECK_THROW(CollisionMask(positions, 2), invalid_argument);
+  }
+}
+
+SUITE(collides)
+{
+  template <typename B>
+  void checkAgainstSlow(B& board, int hidden_rows) {
+    fillRandomly(board, 42u);
+    TetrominoT t(make_shared<BasicBlock>());
+    TetrominoI i(make_shared<BasicBlock>());
+    for (Shape* shape : {static_cast<Shape*>(&t), static_cast<Shape*>(&i)}) {
+      for (int rotation = 0; rotation < 4; ++rotation) {
+        CollisionMask mask(*shape);
+        for (int v = -hidden_rows - 4; v < board.getHeight() + 2; ++v) {
+          for (int h = -5; h < board.getWidth() + 2; ++h) {
+            bool exp_res = collidesSlow(board, hidden_rows, *shape,
+                                        Coords(v, h));
+            bool res = mask.collides(board, hidden_rows, PackedCoords(v, h));
+            CHECK_EQUAL(exp_res, res);
+          }
+        }
+        shape->rotateRight();
+      }
+    }
+  }
+
+  TEST(basicBoard)
+  {
+    BasicBoard board(12, 10);
+    checkAgainstSlow(board, 3);
+  }
+
+  TEST(bitsetBoard)
+  {
+    BitsetBoard board(12, 10);
+    checkAgainstSlow(board, 3);
+  }
+
+  TEST(batchBoardView)
+  {
+    BatchBoardView board(make_shared<BatchBoard>(3, 12, 10), 1);
+    checkAgainstSlow(board, 3);
+  }
+
+  TEST(wideBitsetBoard)
+  {
+    // The mask crosses the boundaries of the words of the rows.
+    BitsetBoard board(6, 150, BitsetBoard::Storage::SPARSE);
+    checkAgainstSlow(board, 2);
+  }
+}
+
+}
@@ -17,6 +17,7 @@
 #include "UnitTest++.h"
 
 #include "Coords.h"
+#include "PackedCoords.h"
 
 using namespace std;
 using namespace tetris;
@@ -141,4 +142,31 @@ SUITE(operators)
 }
 
 
+SUITE(packed)
+{
+  TEST(packedFromCoords)
+  {
+    PackedCoords packed = Coords(2, -4);
+    CHECK_EQUAL(2, packed.getVertical());
+    CHECK_EQUAL(-4, packed.getHorizontal());
+  }
+
+  TEST(packedToCoords)
+  {
+    Coords c = PackedCoords(-7, 3);
+    bool exp_res = true;
+    bool res = (c == Coords(-7, 3));
+    CHECK_EQUAL(exp_res, res);
+  }
+
+  TEST(packedOperators)
+  {
+    constexpr PackedCoords sum = PackedCoords(2, -4) + PackedCoords(6, 4);
+    constexpr PackedCoords diff = PackedCoords(2, -4) - PackedCoords(6, 14);
+    CHECK_EQUAL(true, sum == PackedCoords(8, 0));
+    CHECK_EQUAL(true, diff == PackedCoords(-4, -18));
+    CHECK_EQUAL(true, sum != diff);
+  }
+}
+
 }
@@ -17,10 +17,18 @@
 #include "UnitTest++.h"
 #include "TestHelpers.h"
 
+#include <stdexcept>
+
 #include "DefaultGameBoard.h"
 #include "BasicBlock.h"
 #include "BasicBoard.h"
 #include "BasicShape.h"
+#include "BatchBoard.h"
+#include "BatchBoardView.h"
+#include "DefaultGame.h"
+#include "GameEvents.h"
+#include "TetrominoI.h"
+#include "TetrominoT.h"
 
 using namespace std;
 using namespace tetris;
@@ -270,4 +278,363 @@ SUITE(whereWouldLand)
   }
 }
 
+SUITE(wallKicks)
+{
+  class DefaultGameBoardFixture {
+  public:
+    shared_ptr<Board> board = make_shared<BasicBoard>(18, 10);
+    shared_ptr<DefaultGameBoard>  dgb = make_shared<DefaultGameBoard>(board);
+    shared_ptr<BasicBlock> block = make_shared<BasicBlock>();
+  };
+
+  TEST_FIXTURE(DefaultGameBoardFixture, simpleRejectsAtWall)
+  {
+    // The I is standing in the second column of its bounding box, so it is
+    // against the left wall.
+    dgb->setCurrentShape(make_shared<TetrominoI>(block));
+    dgb->setCurrentShapePosition(Coords(5, -1));
+    vector<Coords> orig_positions = dgb->getAbsolutePositions();
+    dgb->rotateRight();
+    CHECK_EQUAL(true, same_elements(orig_positions,
+                                    dgb->getAbsolutePositions()));
+  }
+
+  TEST_FIXTURE(DefaultGameBoardFixture, superKicksOffWall)
+  {
+    dgb->setRotationMode(RotationMode::SUPER);
+    dgb->setCurrentShape(make_shared<TetrominoI>(block));
+    dgb->setCurrentShapePosition(Coords(5, -1));
+    dgb->rotateRight();
+    vector<Coords> exp_res {Coords(6, 0), Coords(6, 1), Coords(6, 2),
+                            Coords(6, 3)};
+    CHECK_EQUAL(true, same_elements(exp_res, dgb->getAbsolutePositions()));
+    CHECK_EQUAL(Coords(5, 0), dgb->getCurrentShapePosition());
+  }
+
+  TEST_FIXTURE(DefaultGameBoardFixture, superTriesLaterKicks)
+  {
+    // The T points down and rotating it to the right in place would overlap
+    // the block above it, so it is kicked to the right.
+    dgb->setRotationMode(RotationMode::SUPER);
+    dgb->setCurrentShape(make_shared<TetrominoT>(block));
+    dgb->setCurrentShapePosition(Coords(10, 3));
+    board->set(10, 4, make_shared<BasicBlock>());
+    dgb->rotateRight();
+    CHECK_EQUAL(true, dgb->isAtValidPos());
+    CHECK_EQUAL(Coords(10, 4), dgb->getCurrentShapePosition());
+  }
+
+  TEST_FIXTURE(DefaultGameBoardFixture, superRejectsIfNoKickFits)
+  {
+    dgb->setRotationMode(RotationMode::SUPER);
+    dgb->setCurrentShape(make_shared<TetrominoI>(block));
+    dgb->setCurrentShapePosition(Coords(5, 0));
+    for (int h = 0; h < board->getWidth(); ++h) {
+      for (int v = 0; v < board->getHeight(); ++v) {
+        if (h != 1) {
+          board->set(v, h, make_shared<BasicBlock>());
+        }
+      }
+    }
+    vector<Coords> orig_positions = dgb->getAbsolutePositions();
+    dgb->rotateRight();
+    CHECK_EQUAL(true, same_elements(orig_positions,
+                                    dgb->getAbsolutePositions()));
+    CHECK_EQUAL(Coords(5, 0), dgb->getCurrentShapePosition());
+  }
+}
+
+SUITE(journal)
+{
+  // The state of a game board that undo and redo have to restore.
+  struct Snapshot {
+    vector<bool> cells;
+    vector<Coords> shape_positions;
+    Coords shape_pos;
+
+    bool operator==(const Snapshot& other) const {
+      return cells == other.cells
+          && same_elements(shape_positions, other.shape_positions)
+          && shape_pos == other.shape_pos;
+    }
+  };
+
+  Snapshot takeSnapshot(const GameBoard& game_board) {
+    Snapshot res;
+    const Board& board = *game_board.getBoard();
+    for (int v = 0; v < board.getHeight(); ++v) {
+      for (int h = 0; h < board.getWidth(); ++h) {
+        res.cells.push_back(board.isFilled(v, h));
+      }
+    }
+    res.shape_positions = game_board.getAbsolutePositions();
+    res.shape_pos = game_board.getCurrentShapePosition();
+    return res;
+  }
+
+  class DefaultGameBoardFixture {
+  public:
+    shared_ptr<Board> board = make_shared<BasicBoard>(18, 10);
+    shared_ptr<DefaultGameBoard>  dgb = make_shared<DefaultGameBoard>(board);
+    shared_ptr<BasicBlock> block = make_shared<BasicBlock>();
+  };
+
+  TEST_FIXTURE(DefaultGameBoardFixture, disabledByDefault)
+  {
+    dgb->setCurrentShape(make_shared<TetrominoT>(block));
+    dgb->moveDown();
+    CHECK_EQUAL(false, dgb->isJournalEnabled());
+    CHECK_EQUAL(false, dgb->canUndo());
+    CHECK_EQUAL(false, dgb->undo());
+  }
+
+  TEST_FIXTURE(DefaultGameBoardFixture, undoRedoMoveAndRotate)
+  {
+    dgb->setJournalEnabled(true);
+    dgb->setCurrentShape(make_shared<TetrominoT>(block));
+    Snapshot start = takeSnapshot(*dgb);
+    dgb->moveDown();
+    dgb->moveRight();
+    dgb->rotateRight();
+    Snapshot end = takeSnapshot(*dgb);
+
+    for (int i = 0; i < 3; ++i) {
+      CHECK_EQUAL(true, dgb->undo());
+    }
+    CHECK_EQUAL(true, takeSnapshot(*dgb) == start);
+
+    while (dgb->redo()) {}
+    CHECK_EQUAL(true, takeSnapshot(*dgb) == end);
+  }
+
+  TEST_FIXTURE(DefaultGameBoardFixture, undoRedoKeepsRotation)
+  {
+    dgb->setJournalEnabled(true);
+    shared_ptr<Shape> shape = make_shared<TetrominoT>(block);
+    dgb->setCurrentShape(shape);
+    dgb->rotateRight();
+    dgb->rotateRight();
+    dgb->lock();
+
+    CHECK_EQUAL(true, dgb->undo());
+    CHECK_EQUAL(2, dgb->getCurrentShapeRotation());
+    CHECK_EQUAL(true, dgb->redo());
+    CHECK_EQUAL(true, dgb->undo());
+    CHECK_EQUAL(2, dgb->getCurrentShapeRotation());
+
+    // A shape replaced after a turn comes back with that turn, and the
+    // masks still match its orientation.
+    dgb->setCurrentShape(make_shared<TetrominoI>(block));
+    CHECK_EQUAL(0, dgb->getCurrentShapeRotation());
+    CHECK_EQUAL(true, dgb->undo());
+    CHECK_EQUAL(shape, dgb->getCurrentShape());
+    CHECK_EQUAL(2, dgb->getCurrentShapeRotation());
+    CHECK_EQUAL(true, dgb->redo());
+    CHECK_EQUAL(0, dgb->getCurrentShapeRotation());
+    CHECK_EQUAL(true, dgb->undo());
+    dgb->rotateRight();
+    dgb->rotateRight();
+    CHECK_EQUAL(0, dgb->getCurrentShapeRotation());
+    CHECK_EQUAL(0, shape->getRotation());
+  }
+
+  TEST_FIXTURE(DefaultGameBoardFixture, rejectedMoveIsNotRecorded)
+  {
+    dgb->setJournalEnabled(true);
+    dgb->setCurrentShape(make_shared<TetrominoT>(block));
+    dgb->setCurrentShapePosition(Coords(0, 0));
+    dgb->moveLeft();
+    CHECK_EQUAL(true, dgb->undo());
+    CHECK_EQUAL(true, dgb->undo());
+    CHECK_EQUAL(false, dgb->undo());
+  }
+
+  TEST_FIXTURE(DefaultGameBoardFixture, newChangeDiscardsRedo)
+  {
+    dgb->setJournalEnabled(true);
+    dgb->setCurrentShape(make_shared<TetrominoT>(block));
+    dgb->moveDown();
+    dgb->undo();
+    CHECK_EQUAL(true, dgb->canRedo());
+    dgb->moveRight();
+    CHECK_EQUAL(false, dgb->canRedo());
+  }
+
+  // Counts the locks that are reported.
+  class LockCounter : public GameEventListener
+  {
+  public:
+    int locks = 0;
+
+    void onShapeLocked(const PackedCoords*, size_t) override { ++locks; }
+  };
+
+  TEST_FIXTURE(DefaultGameBoardFixture, redoDoesNotReportLocks)
+  {
+    shared_ptr<LockCounter> counter = make_shared<LockCounter>();
+    dgb->addEventListener(counter);
+    dgb->setJournalEnabled(true);
+    dgb->setCurrentShape(make_shared<TetrominoT>(block));
+    dgb->lock();
+    CHECK_EQUAL(1, counter->locks);
+
+    CHECK_EQUAL(true, dgb->undo());
+    CHECK_EQUAL(true, dgb->redo());
+    CHECK_EQUAL(1, counter->locks);
+    CHECK(dgb->getCurrentShape() == nullptr);
+  }
+
+  TEST(undoRedoWholeGame)
+  {
+    shared_ptr<Board> board = make_shared<BasicBoard>(12, 4);
+    shared_ptr<DefaultGameBoard> dgb = make_shared<DefaultGameBoard>(board);
+    shared_ptr<Block> block = make_shared<BasicBlock>();
+    DefaultGame game(dgb, {make_shared<TetrominoI>(block)}, 3u);
+    game.newGame();
+    dgb->setJournalEnabled(true);
+
+    // The I pieces are either horizontal and fill a row on their own or get
+    // stacked, so rows are cleared along the way.
+    vector<Snapshot> snapshots {takeSnapshot(*dgb)};
+    int removed_rows = 0;
+    for (int i = 0; i < 6 && !game.isGameOver(); ++i) {
+      removed_rows += game.drop();
+      snapshots.push_back(takeSnapshot(*dgb));
+    }
+    CHECK_EQUAL(true, removed_rows > 0);
+
+    for (int i = snapshots.size() - 1; i > 0; --i) {
+      CHECK_EQUAL(true, takeSnapshot(*dgb) == snapshots[i]);
+      // Undoing until the state after the previous drop.
+      while (!(takeSnapshot(*dgb) == snapshots[i - 1]) && dgb->undo()) {}
+      CHECK_EQUAL(true, takeSnapshot(*dgb) == snapshots[i - 1]);
+    }
+    CHECK_EQUAL(false, dgb->canUndo());
+
+    while (dgb->redo()) {}
+    CHECK_EQUAL(true, takeSnapshot(*dgb) == snapshots.back());
+  }
+}
+
+SUITE(landingCache)
+{
+  class DefaultGameBoardFixture {
+  public:
+    shared_ptr<Board> board = make_shared<BasicBoard>(18, 10);
+    shared_ptr<DefaultGameBoard>  dgb = make_shared<DefaultGameBoard>(board);
+    shared_ptr<BasicBlock> block = make_shared<BasicBlock>();
+
+    DefaultGameBoardFixture() {
+      dgb->setCurrentShape(make_shared<TetrominoT>(block));
+      dgb->setCurrentShapePosition(Coords(0, 3));
+    }
+  };
+
+  TEST_FIXTURE(DefaultGameBoardFixture, verticalMovesKeepVersion)
+  {
+    Coords landing = dgb->whereWouldLand();
+    uint64_t version = dgb->getLandingVersion();
+    dgb->moveDown();
+    dgb->moveDown();
+    dgb->moveUp();
+    CHECK_EQUAL(version, dgb->getLandingVersion());
+    CHECK_EQUAL(landing, dgb->whereWouldLand());
+  }
+
+  TEST_FIXTURE(DefaultGameBoardFixture, rejectsPositionsBeyond16Bits)
+  {
+    dgb->setCurrentShapePosition(Coords(-32768, 32767));
+    CHECK_EQUAL(Coords(-32768, 32767), dgb->getCurrentShapePosition());
+
+    CHECK_THROW(dgb->setCurrentShapePosition(Coords(32768, 0)),
+                invalid_argument);
+    CHECK_THROW(dgb->setCurrentShapePosition(Coords(0, -32769)),
+                invalid_argument);
+    CHECK_EQUAL(Coords(-32768, 32767), dgb->getCurrentShapePosition());
+  }
+
+  TEST_FIXTURE(DefaultGameBoardFixture, undoingVerticalMovesKeepsVersion)
+  {
+    dgb->setJournalEnabled(true);
+    Coords landing = dgb->whereWouldLand();
+    uint64_t version = dgb->getLandingVersion();
+    dgb->moveDown();
+    dgb->moveDown();
+    CHECK_EQUAL(true, dgb->undo());
+    CHECK_EQUAL(true, dgb->undo());
+    CHECK_EQUAL(true, dgb->redo());
+    CHECK_EQUAL(version, dgb->getLandingVersion());
+    CHECK_EQUAL(landing, dgb->whereWouldLand());
+  }
+
+  TEST_FIXTURE(DefaultGameBoardFixture, movingAboveTheLandingChangesVersion)
+  {
+    dgb->moveDown();
+    dgb->whereWouldLand();
+    uint64_t version = dgb->getLandingVersion();
+    dgb->moveUp();
+    CHECK_EQUAL(true, version != dgb->getLandingVersion());
+    CHECK_EQUAL(Coords(15, 3), dgb->whereWouldLand());
+  }
+
+  TEST_FIXTURE(DefaultGameBoardFixture, sidewaysMoveChangesVersion)
+  {
+    uint64_t version = dgb->getLandingVersion();
+    dgb->moveRight();
+    CHECK_EQUAL(true, version != dgb->getLandingVersion());
+    CHECK_EQUAL(Coords(15, 4), dgb->whereWouldLand());
+  }
+
+  TEST_FIXTURE(DefaultGameBoardFixture, rotationChangesVersion)
+  {
+    uint64_t version = dgb->getLandingVersion();
+    dgb->rotateRight();
+    CHECK_EQUAL(true, version != dgb->getLandingVersion());
+  }
+
+  TEST_FIXTURE(DefaultGameBoardFixture, boardChangeInvalidates)
+  {
+    CHECK_EQUAL(Coords(15, 3), dgb->whereWouldLand());
+    uint64_t version = dgb->getLandingVersion();
+    board->set(10, 4, make_shared<BasicBlock>());
+    CHECK_EQUAL(true, version != dgb->getLandingVersion());
+    CHECK_EQUAL(Coords(7, 3), dgb->whereWouldLand());
+  }
+
+  TEST_FIXTURE(DefaultGameBoardFixture, movingUnderOverhangInvalidates)
+  {
+    for (int h = 3; h < 6; ++h) {
+      board->set(8, h, make_shared<BasicBlock>());
+    }
+    CHECK_EQUAL(Coords(5, 3), dgb->whereWouldLand());
+
+    // Around the overhang and back under it, in the same column and
+    // rotation as before.
+    for (int i = 0; i < 3; ++i) { dgb->moveLeft(); }
+    for (int i = 0; i < 10; ++i) { dgb->moveDown(); }
+    for (int i = 0; i < 3; ++i) { dgb->moveRight(); }
+    CHECK_EQUAL(Coords(10, 3), dgb->getCurrentShapePosition());
+    CHECK_EQUAL(Coords(15, 3), dgb->whereWouldLand());
+  }
+
+  TEST(batchKernelsInvalidate)
+  {
+    shared_ptr<BatchBoard> batch = make_shared<BatchBoard>(1, 18, 10);
+    DefaultGameBoard dgb(make_shared<BatchBoardView>(batch, 0));
+    dgb.setCurrentShape(make_shared<TetrominoT>(make_shared<BasicBlock>()));
+    dgb.setCurrentShapePosition(Coords(0, 3));
+    CHECK_EQUAL(Coords(15, 3), dgb.whereWouldLand());
+
+    BatchBoard::Row masks[BatchBoard::MASK_ROWS] = {0x3F0};
+    int tops[1] = {10};
+    batch->lock(masks, tops);
+    CHECK_EQUAL(Coords(7, 3), dgb.whereWouldLand());
+
+    int removed[1] = {0};
+    batch->removeFilledRows(removed);
+    batch->clear(0);
+    CHECK_EQUAL(Coords(15, 3), dgb.whereWouldLand());
+  }
+}
+
 }
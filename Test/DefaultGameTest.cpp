@@ -0,0 +1,343 @@
+/*
+ * Copyright (C) 2016 Daniel Becker <beckerdaniel.dani@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "UnitTest++.h"
+
+#include <stdexcept>
+
+#include "BasicBlock.h"
+#include "BasicBoard.h"
+#include "DefaultGame.h"
+#include "DefaultGameBoard.h"
+#include "PoolAllocator.h"
+#include "TetrominoI.h"
+#include "TetrominoJ.h"
+#include "TetrominoL.h"
+#include "TetrominoO.h"
+#include "TetrominoS.h"
+#include "TetrominoT.h"
+#include "TetrominoZ.h"
+
+using namespace std;
+using namespace tetris;
+
+namespace {
+
+vector<shared_ptr<Shape>> tetrominoes() {
+  shared_ptr<Block> block = make_shared<BasicBlock>();
+  return {make_shared<TetrominoI>(block), make_shared<TetrominoJ>(block),
+          make_shared<TetrominoL>(block), make_shared<TetrominoO>(block),
+          make_shared<TetrominoS>(block), make_shared<TetrominoT>(block),
+          make_shared<TetrominoZ>(block)};
+}
+
+vector<bool> cells(const Game& game) {
+  const Board& board = *game.getGameBoard()->getBoard();
+  vector<bool> res;
+  for (int v = 0; v < board.getHeight(); ++v) {
+    for (int h = 0; h < board.getWidth(); ++h) {
+      res.push_back(board.isFilled(v, h));
+    }
+  }
+  return res;
+}
+
+SUITE(drop)
+{
+  TEST(dropMatchesAdvancing)
+  {
+    // The hard drop must end up exactly where advancing row by row does.
+    shared_ptr<GameBoard> gb1 = make_shared<DefaultGameBoard>(
+                                              make_shared<BasicBoard>(20, 8));
+    shared_ptr<GameBoard> gb2 = make_shared<DefaultGameBoard>(
+                                              make_shared<BasicBoard>(20, 8));
+    DefaultGame dropped(gb1, tetrominoes(), 5u);
+    DefaultGame advanced(gb2, tetrominoes(), 5u);
+    dropped.newGame();
+    advanced.newGame();
+
+    for (int i = 0; i < 200 && !dropped.isGameOver(); ++i) {
+      // Moving the shapes around so that rows get cleared.
+      for (int j = 0; j < i % 7; ++j) {
+        dropped.moveRight();
+        advanced.moveRight();
+      }
+      if (i % 3 == 0) {
+        dropped.rotateRight();
+        advanced.rotateRight();
+      }
+
+      int exp_res = 0;
+      while (!gb2->hasLanded()) {
+        advanced.advance();
+      }
+      exp_res = advanced.advance();
+
+      int res = dropped.drop();
+      CHECK_EQUAL(exp_res, res);
+      CHECK_EQUAL(advanced.isGameOver(), dropped.isGameOver());
+      CHECK_EQUAL(true, cells(advanced) == cells(dropped));
+      CHECK_EQUAL(advanced.getGameBoard()->getCurrentShapePosition(),
+                  dropped.getGameBoard()->getCurrentShapePosition());
+    }
+    CHECK_EQUAL(true, dropped.isGameOver());
+  }
+
+  TEST(dropAfterGameOver)
+  {
+    shared_ptr<GameBoard> gb = make_shared<DefaultGameBoard>(
+                                              make_shared<BasicBoard>(6, 4));
+    DefaultGame game(gb, tetrominoes(), 1u);
+    game.newGame();
+    for (int i = 0; i < 100 && !game.isGameOver(); ++i) {
+      game.drop();
+    }
+    CHECK_EQUAL(true, game.isGameOver());
+    CHECK_EQUAL(0, game.drop());
+  }
+}
+
+SUITE(preview)
+{
+  // The block positions of the shape that spawns from the preview entry.
+  vector<Coords> spawnedFrom(const DefaultGame& game, int index) {
+    shared_ptr<Shape> shape = game.getPreview(index)->clone();
+    for (int r = 0; r < game.getPreviewRotation(index); ++r) {
+      shape->rotateRight();
+    }
+    return shape->getBlockPositions();
+  }
+
+  TEST(previewShowsTheUpcomingShapes)
+  {
+    shared_ptr<GameBoard> gb = make_shared<DefaultGameBoard>(
+                                              make_shared<BasicBoard>(20, 8));
+    DefaultGame game(gb, tetrominoes(), 3u);
+    game.setPreviewCount(5);
+    CHECK_EQUAL(5, game.getPreviewCount());
+    game.newGame();
+
+    for (int i = 0; i < 100 && !game.isGameOver(); ++i) {
+      vector<vector<Coords>> upcoming;
+      for (int p = 0; p < game.getPreviewCount(); ++p) {
+        upcoming.push_back(spawnedFrom(game, p));
+      }
+
+      game.drop();
+      if (game.isGameOver()) { break; }
+      CHECK(gb->getCurrentShape()->getBlockPositions() == upcoming[0]);
+      for (int p = 0; p + 1 < game.getPreviewCount(); ++p) {
+        CHECK(spawnedFrom(game, p) == upcoming[p + 1]);
+      }
+    }
+  }
+
+  TEST(countDoesNotChangeTheSequence)
+  {
+    shared_ptr<GameBoard> gb1 = make_shared<DefaultGameBoard>(
+                                              make_shared<BasicBoard>(20, 8));
+    shared_ptr<GameBoard> gb2 = make_shared<DefaultGameBoard>(
+                                              make_shared<BasicBoard>(20, 8));
+    DefaultGame short_preview(gb1, tetrominoes(), 7u);
+    DefaultGame long_preview(gb2, tetrominoes(), 7u);
+    long_preview.setPreviewCount(DefaultGame::MAX_PREVIEW);
+    short_preview.newGame();
+    long_preview.newGame();
+
+    for (int i = 0; i < 150; ++i) {
+      CHECK_EQUAL(long_preview.getPreviewIndex(0),
+                  short_preview.getPreviewIndex(0));
+      CHECK_EQUAL(long_preview.getPreviewRotation(0),
+                  short_preview.getPreviewRotation(0));
+      CHECK(gb1->getCurrentShape()->getBlockPositions()
+            == gb2->getCurrentShape()->getBlockPositions());
+
+      // Starting over keeps the sequence going.
+      short_preview.newGame();
+      long_preview.newGame();
+    }
+  }
+
+  TEST(reseedingRepeatsTheSequence)
+  {
+    shared_ptr<GameBoard> gb = make_shared<DefaultGameBoard>(
+                                              make_shared<BasicBoard>(20, 8));
+    DefaultGame game(gb, tetrominoes(), 11u);
+    game.setPreviewCount(8);
+    game.newGame(11u);
+    vector<int> first;
+    for (int p = 0; p < 8; ++p) {
+      first.push_back(game.getPreviewIndex(p) * 4
+                      + game.getPreviewRotation(p));
+    }
+    game.drop();
+    game.drop();
+
+    game.newGame(11u);
+    for (int p = 0; p < 8; ++p) {
+      CHECK_EQUAL(first[p], game.getPreviewIndex(p) * 4
+                            + game.getPreviewRotation(p));
+    }
+  }
+
+  TEST(previewShapesAreThePrototypes)
+  {
+    shared_ptr<GameBoard> gb = make_shared<DefaultGameBoard>(
+                                              make_shared<BasicBoard>(20, 8));
+    vector<shared_ptr<Shape>> shapes = tetrominoes();
+    DefaultGame game(gb, shapes, 2u);
+    game.setPreviewCount(6);
+    game.newGame();
+
+    vector<shared_ptr<const Shape>> preview;
+    game.getPreviewShapes(preview);
+    CHECK_EQUAL(6u, preview.size());
+    for (int p = 0; p < 6; ++p) {
+      CHECK(preview[p] == shapes[game.getPreviewIndex(p)]);
+      CHECK(preview[p] == game.getPreview(p));
+    }
+  }
+
+  TEST(invalidPreviewArguments)
+  {
+    shared_ptr<GameBoard> gb = make_shared<DefaultGameBoard>(
+                                              make_shared<BasicBoard>(20, 8));
+    DefaultGame game(gb, tetrominoes(), 1u);
+    CHECK_THROW(game.setPreviewCount(0), invalid_argument);
+    CHECK_THROW(game.setPreviewCount(DefaultGame::MAX_PREVIEW + 1),
+                invalid_argument);
+
+    game.setPreviewCount(3);
+    game.newGame();
+    CHECK_THROW(game.getPreview(-1), invalid_argument);
+    CHECK_THROW(game.getPreview(3), invalid_argument);
+    CHECK_THROW(game.getPreviewRotation(3), invalid_argument);
+  }
+}
+
+SUITE(hold)
+{
+  class HoldFixture {
+  public:
+    shared_ptr<PoolResource> pool = make_shared<PoolResource>();
+    shared_ptr<DefaultGameBoard> gb = make_shared<DefaultGameBoard>(
+                                              make_shared<BasicBoard>(20, 8));
+    vector<shared_ptr<Shape>> shapes = tetrominoes();
+    DefaultGame game {gb, shapes, 9u};
+
+    HoldFixture() {
+      game.setAllocationPool(pool);
+      game.setPreviewCount(3);
+      game.newGame();
+    }
+
+    // The block positions of the prototype turned to the right.
+    vector<Coords> turned(int index, int turns) const {
+      shared_ptr<Shape> shape = shapes[index]->clone();
+      for (int r = 0; r < turns; ++r) {
+        shape->rotateRight();
+      }
+      return shape->getBlockPositions();
+    }
+  };
+
+  TEST_FIXTURE(HoldFixture, firstHoldSpawnsTheNextShape)
+  {
+    CHECK_EQUAL(-1, game.getHeldIndex());
+    CHECK(game.getHeldShape() == nullptr);
+
+    shared_ptr<const Shape> current = gb->getCurrentShape();
+    int next = game.getPreviewIndex(0);
+    int next_turns = game.getPreviewRotation(0);
+    CHECK(game.hold());
+
+    CHECK(game.getHeldShape() == current);
+    CHECK(gb->getCurrentShape()->getBlockPositions()
+          == turned(next, next_turns));
+  }
+
+  TEST_FIXTURE(HoldFixture, holdSwapsWithoutCloning)
+  {
+    shared_ptr<const Shape> first = gb->getCurrentShape();
+    CHECK(game.hold());
+    game.drop();
+    shared_ptr<const Shape> second = gb->getCurrentShape();
+
+    size_t live = pool->getLiveAllocations();
+    int next = game.getPreviewIndex(0);
+    CHECK(game.hold());
+    CHECK_EQUAL(live, pool->getLiveAllocations());
+    CHECK(gb->getCurrentShape() == first);
+    CHECK(game.getHeldShape() == second);
+
+    // The preview was not touched by the swap.
+    CHECK_EQUAL(next, game.getPreviewIndex(0));
+  }
+
+  TEST_FIXTURE(HoldFixture, holdOncePerShape)
+  {
+    CHECK(game.canHold());
+    CHECK(game.hold());
+    CHECK(!game.canHold());
+    shared_ptr<const Shape> current = gb->getCurrentShape();
+    CHECK(!game.hold());
+    CHECK(gb->getCurrentShape() == current);
+
+    game.drop();
+    CHECK(game.canHold());
+  }
+
+  TEST_FIXTURE(HoldFixture, heldShapeIsTurnedBack)
+  {
+    // Turning the shape in the middle of the board, where it fits.
+    gb->setCurrentShapePosition(Coords(5, 2));
+    int index = -1;
+    for (size_t i = 0; i < shapes.size(); ++i) {
+      if (gb->getCurrentShape()->getBlockPositions() == turned(i, 0)
+          || gb->getCurrentShape()->getBlockPositions() == turned(i, 1)
+          || gb->getCurrentShape()->getBlockPositions() == turned(i, 2)
+          || gb->getCurrentShape()->getBlockPositions() == turned(i, 3)) {
+        index = i;
+        break;
+      }
+    }
+    vector<Coords> spawned = gb->getCurrentShape()->getBlockPositions();
+    game.rotateRight();
+    game.rotateRight();
+    game.rotateLeft();
+    CHECK_EQUAL(1, gb->getCurrentShapeRotation());
+
+    CHECK(game.hold());
+    CHECK_EQUAL(index, game.getHeldIndex());
+    CHECK(game.getHeldShape()->getBlockPositions() == spawned);
+
+    game.drop();
+    CHECK(game.hold());
+    CHECK(gb->getCurrentShape()->getBlockPositions() == spawned);
+    CHECK_EQUAL(0, gb->getCurrentShapeRotation());
+  }
+
+  TEST_FIXTURE(HoldFixture, newGameEmptiesTheHold)
+  {
+    CHECK(game.hold());
+    game.newGame();
+    CHECK(game.getHeldShape() == nullptr);
+    CHECK_EQUAL(-1, game.getHeldIndex());
+    CHECK(game.canHold());
+  }
+}
+
+}
@@ -0,0 +1,205 @@
+/*
+ * Copyright (C) 2016 Daniel Becker <beckerdaniel.dani@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "UnitTest++.h"
+
+#include "BasicBlock.h"
+#include "BasicBoard.h"
+#include "DefaultGame.h"
+#include "DefaultGameBoard.h"
+#include "GameEvents.h"
+#include "TetrominoI.h"
+#include "TetrominoT.h"
+
+using namespace std;
+using namespace tetris;
+
+namespace {
+
+class RecordingListener : public GameEventListener
+{
+public:
+  virtual void onShapeSpawned(const Shape&, PackedCoords) override {
+    ++spawned;
+  }
+
+  virtual void onShapeMoved(PackedCoords from, PackedCoords to) override {
+    ++moved;
+    last_from = from;
+    last_to = to;
+  }
+
+  virtual void onShapeRotated(bool clockwise, PackedCoords) override {
+    ++rotated;
+    last_clockwise = clockwise;
+  }
+
+  virtual void onShapeLocked(const PackedCoords* positions,
+                             size_t count) override {
+    ++locked;
+    locked_positions.assign(positions, positions + count);
+  }
+
+  virtual void onRowsCleared(const int* rows, size_t count) override {
+    cleared_rows.insert(cleared_rows.end(), rows, rows + count);
+  }
+
+  virtual void onGameOver() override {
+    ++game_over;
+  }
+
+  int spawned = 0;
+  int moved = 0;
+  int rotated = 0;
+  int locked = 0;
+  int game_over = 0;
+  bool last_clockwise = false;
+  PackedCoords last_from;
+  PackedCoords last_to;
+  vector<PackedCoords> locked_positions;
+  vector<int> cleared_rows;
+};
+
+// Removes itself and another listener and adds a third one when it is
+// notified of a move.
+class ReshufflingListener : public GameEventListener
+{
+public:
+  ReshufflingListener(GameEventSource& source) : source(source) {}
+
+  virtual void onShapeMoved(PackedCoords, PackedCoords) override {
+    ++moved;
+    source.removeEventListener(self.lock());
+    source.removeEventListener(removed);
+    source.addEventListener(added);
+  }
+
+  GameEventSource& source;
+  weak_ptr<GameEventListener> self;
+  shared_ptr<GameEventListener> removed;
+  shared_ptr<GameEventListener> added;
+  int moved = 0;
+};
+
+SUITE(gameBoardEvents)
+{
+  class DefaultGameBoardFixture {
+  public:
+    shared_ptr<Board> board = make_shared<BasicBoard>(6, 4);
+    shared_ptr<DefaultGameBoard> dgb = make_shared<DefaultGameBoard>(board);
+    shared_ptr<RecordingListener> listener = make_shared<RecordingListener>();
+
+    DefaultGameBoardFixture() {
+      dgb->addEventListener(listener);
+      dgb->setCurrentShape(make_shared<TetrominoT>(make_shared<BasicBlock>()));
+      dgb->setCurrentShapePosition(Coords(0, 0));
+    }
+  };
+
+  TEST_FIXTURE(DefaultGameBoardFixture, movedAndRotated)
+  {
+    dgb->moveRight();
+    CHECK_EQUAL(1, listener->moved);
+    CHECK_EQUAL(true, listener->last_from == PackedCoords(0, 0));
+    CHECK_EQUAL(true, listener->last_to == PackedCoords(0, 1));
+
+    // Rejected moves are not reported.
+    dgb->moveRight();
+    CHECK_EQUAL(1, listener->moved);
+
+    dgb->rotateLeft();
+    CHECK_EQUAL(1, listener->rotated);
+    CHECK_EQUAL(false, listener->last_clockwise);
+  }
+
+  TEST_FIXTURE(DefaultGameBoardFixture, lockedAndCleared)
+  {
+    // Filling the bottom row except under the stem of the T.
+    for (int h = 0; h < 4; ++h) {
+      if (h != 1) {
+        board->set(5, h, make_shared<BasicBlock>());
+      }
+    }
+    dgb->setCurrentShapePosition(Coords(3, 0));
+    dgb->lock();
+    CHECK_EQUAL(1, listener->locked);
+    CHECK_EQUAL(4u, listener->locked_positions.size());
+    CHECK_EQUAL(true, listener->locked_positions.back() == PackedCoords(5, 1));
+
+    CHECK_EQUAL(1, dgb->removeFilledRows());
+    CHECK_EQUAL(1u, listener->cleared_rows.size());
+    CHECK_EQUAL(5, listener->cleared_rows.front());
+  }
+
+  TEST_FIXTURE(DefaultGameBoardFixture, removedListener)
+  {
+    dgb->removeEventListener(listener);
+    dgb->moveRight();
+    CHECK_EQUAL(0, listener->moved);
+  }
+
+  TEST_FIXTURE(DefaultGameBoardFixture, listenersChangedDuringEvent)
+  {
+    // The fixture listener is notified after the reshuffling one.
+    dgb->removeEventListener(listener);
+    shared_ptr<ReshufflingListener> reshuffling =
+                                      make_shared<ReshufflingListener>(*dgb);
+    shared_ptr<RecordingListener> added = make_shared<RecordingListener>();
+    reshuffling->self = reshuffling;
+    reshuffling->removed = listener;
+    reshuffling->added = added;
+    dgb->addEventListener(reshuffling);
+    dgb->addEventListener(listener);
+
+    dgb->moveRight();
+    CHECK_EQUAL(1, reshuffling->moved);
+    CHECK_EQUAL(0, listener->moved);
+    CHECK_EQUAL(0, added->moved);
+
+    dgb->moveLeft();
+    CHECK_EQUAL(1, reshuffling->moved);
+    CHECK_EQUAL(0, listener->moved);
+    CHECK_EQUAL(1, added->moved);
+  }
+}
+
+SUITE(gameEvents)
+{
+  TEST(wholeGame)
+  {
+    shared_ptr<GameBoard> gb = make_shared<DefaultGameBoard>(
+                                              make_shared<BasicBoard>(12, 4));
+    DefaultGame game(gb, {make_shared<TetrominoI>(make_shared<BasicBlock>())},
+                     7u);
+    shared_ptr<RecordingListener> listener = make_shared<RecordingListener>();
+    game.addEventListener(listener);
+    game.newGame();
+
+    int removed_rows = 0;
+    int drops = 0;
+    while (!game.isGameOver()) {
+      removed_rows += game.drop();
+      ++drops;
+    }
+
+    CHECK_EQUAL(drops, listener->locked);
+    CHECK_EQUAL(drops, listener->spawned);
+    CHECK_EQUAL(1, listener->game_over);
+    CHECK_EQUAL(removed_rows, static_cast<int>(listener->cleared_rows.size()));
+  }
+}
+
+}
@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2016 Daniel Becker <beckerdaniel.dani@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "UnitTest++.h"
+
+#include "BasicBlock.h"
+#include "KickTable.h"
+#include "TetrominoI.h"
+#include "TetrominoT.h"
+
+using namespace std;
+using namespace tetris;
+
+namespace {
+
+int orientation(const Shape& shape) {
+  vector<PackedCoords> positions(shape.getBlockCount());
+  shape.getPackedBlockPositions(positions.data());
+  return KickTable::getOrientation(positions.data(), positions.size(),
+                                   shape.getBBoxSize());
+}
+
+SUITE(kicks)
+{
+  TEST(firstKickIsZero)
+  {
+    for (int bbox_size = 1; bbox_size <= 5; ++bbox_size) {
+      const KickTable& table = KickTable::forBBoxSize(bbox_size);
+      for (int from = 0; from < 4; ++from) {
+        CHECK_EQUAL(true, table.getKicks(from, true)[0] == PackedCoords(0, 0));
+        CHECK_EQUAL(true, table.getKicks(from, false)[0] == PackedCoords(0, 0));
+      }
+    }
+  }
+
+  TEST(onlyTetrominoesAreKicked)
+  {
+    CHECK_EQUAL(1, KickTable::forBBoxSize(2).getKickCount());
+    CHECK_EQUAL(KickTable::MAX_KICKS, KickTable::forBBoxSize(3).getKickCount());
+    CHECK_EQUAL(KickTable::MAX_KICKS, KickTable::forBBoxSize(4).getKickCount());
+    CHECK_EQUAL(1, KickTable::forBBoxSize(5).getKickCount());
+  }
+
+  TEST(reverseRotationKicksBack)
+  {
+    for (int bbox_size = 3; bbox_size <= 4; ++bbox_size) {
+      const KickTable& table = KickTable::forBBoxSize(bbox_size);
+      for (int from = 0; from < 4; ++from) {
+        const PackedCoords* there = table.getKicks(from, true);
+        const PackedCoords* back = table.getKicks((from + 1) % 4, false);
+        for (int i = 0; i < table.getKickCount(); ++i) {
+          CHECK_EQUAL(true, there[i] + back[i] == PackedCoords(0, 0));
+        }
+      }
+    }
+  }
+}
+
+SUITE(orientation)
+{
+  TEST(orientationFollowsRotations)
+  {
+    // The T is defined pointing down, which is orientation 2.
+    TetrominoT t(make_shared<BasicBlock>());
+    CHECK_EQUAL(2, orientation(t));
+    t.rotateRight();
+    CHECK_EQUAL(3, orientation(t));
+    t.rotateRight();
+    CHECK_EQUAL(0, orientation(t));
+    t.rotateLeft();
+    t.rotateLeft();
+    t.rotateLeft();
+    CHECK_EQUAL(1, orientation(t));
+  }
+
+  TEST(orientationOfI)
+  {
+    // The I is defined standing in the second column, which is orientation 3.
+    TetrominoI i(make_shared<BasicBlock>());
+    CHECK_EQUAL(3, orientation(i));
+    i.rotateRight();
+    CHECK_EQUAL(0, orientation(i));
+  }
+}
+
+}
@@ -0,0 +1,252 @@
+/*
+ * Copyright (C) 2016 Daniel Becker <beckerdaniel.dani@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "UnitTest++.h"
+
+#include <cstring>
+#include <stdexcept>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "BasicBlock.h"
+#include "MatchProtocol.h"
+#include "MatchServer.h"
+#include "SpectatorStream.h"
+#include "TetrominoO.h"
+
+using namespace std;
+using namespace tetris;
+
+namespace {
+
+// A blocking client on the loopback interface. The server is driven from the
+// same thread, so reading polls it until the expected message has arrived.
+class TestClient {
+public:
+  explicit TestClient(uint16_t port) : fd(socket(AF_INET, SOCK_STREAM, 0)) {
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+  }
+
+  ~TestClient() {
+    disconnect();
+  }
+
+  void write(const vector<uint8_t>& data) {
+    ::send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+  }
+
+  void disconnect() {
+    if (fd >= 0) {
+      close(fd);
+      fd = -1;
+    }
+  }
+
+  // Reads messages until one of the given type arrives.
+  bool receive(MatchServer& server, MessageType expected,
+               vector<uint8_t>& payload) {
+    MessageType type;
+    for (int i = 0; i < 1000; ++i) {
+      while (reader.next(type, payload)) {
+        if (type == expected) { return true; }
+      }
+      server.poll(10);
+      uint8_t buffer[4096];
+      ssize_t received = recv(fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+      if (received > 0) {
+        reader.append(buffer, received);
+      }
+    }
+    return false;
+  }
+
+  int fd;
+  FrameReader reader {};
+};
+
+SUITE(MatchServer)
+{
+  const int height = 10;
+  const int width = 6;
+
+  class MatchServerFixture {
+  public:
+    MatchServer server {height, width,
+                        {make_shared<TetrominoO>(make_shared<BasicBlock>())},
+                        7u};
+    vector<uint8_t> payload {};
+
+    vector<uint8_t> join() {
+      vector<uint8_t> res;
+      encodeJoin(res);
+      return res;
+    }
+
+    vector<uint8_t> input(Action action) {
+      vector<uint8_t> res;
+      encodeInput(res, action);
+      return res;
+    }
+  };
+
+  TEST_FIXTURE(MatchServerFixture, pairsClients)
+  {
+    TestClient first(server.getPort());
+    TestClient second(server.getPort());
+    first.write(join());
+    second.write(join());
+
+    CHECK(first.receive(server, MessageType::MATCH_START, payload));
+    vector<uint8_t> first_start = payload;
+    CHECK(second.receive(server, MessageType::MATCH_START, payload));
+    vector<uint8_t> second_start = payload;
+    CHECK_EQUAL(9u, first_start.size());
+    CHECK_EQUAL(9u, second_start.size());
+    CHECK(equal(first_start.begin(), first_start.begin() + 4,
+                second_start.begin()));
+    CHECK_EQUAL(0, first_start[4]);
+    CHECK_EQUAL(1, second_start[4]);
+
+    CHECK(first.receive(server, MessageType::STATE, payload));
+    MatchState state;
+    CHECK(decodeState(payload, state));
+    CHECK_EQUAL(height, state.height);
+    CHECK_EQUAL(width, state.width);
+    CHECK_EQUAL(4u, state.shape.size());
+
+    CHECK_EQUAL(2, server.getClientCount());
+    CHECK_EQUAL(1, server.getMatchCount());
+  }
+
+  TEST_FIXTURE(MatchServerFixture, toppingOutEndsTheMatch)
+  {
+    TestClient first(server.getPort());
+    TestClient second(server.getPort());
+    first.write(join());
+    second.write(join());
+    CHECK(first.receive(server, MessageType::MATCH_START, payload));
+
+    for (int i = 0; i < height; ++i) {
+      first.write(input(Action::DROP));
+    }
+
+    CHECK(second.receive(server, MessageType::MATCH_END, payload));
+    CHECK_EQUAL(1u, payload.size());
+    CHECK_EQUAL(1, payload[0]);
+    CHECK_EQUAL(0, server.getMatchCount());
+  }
+
+  TEST_FIXTURE(MatchServerFixture, disconnectForfeits)
+  {
+    TestClient first(server.getPort());
+    TestClient second(server.getPort());
+    first.write(join());
+    second.write(join());
+    CHECK(second.receive(server, MessageType::MATCH_START, payload));
+
+    first.disconnect();
+
+    CHECK(second.receive(server, MessageType::MATCH_END, payload));
+    CHECK_EQUAL(1u, payload.size());
+    CHECK_EQUAL(1, payload[0]);
+    CHECK_EQUAL(1, server.getClientCount());
+    CHECK_EQUAL(0, server.getMatchCount());
+  }
+
+  TEST(rejectsBoardsWhoseStateDoesNotFitInAFrame)
+  {
+    vector<shared_ptr<Shape>> shapes
+      {make_shared<TetrominoO>(make_shared<BasicBlock>())};
+    CHECK_THROW(MatchServer(1024, 1024, shapes, 7u), invalid_argument);
+    CHECK(getMaxStateFrameLength(1024, 1024, 4) > MAX_FRAME_LENGTH);
+  }
+
+  TEST(frameReaderRejectsLongFrames)
+  {
+    vector<uint8_t> frame;
+    size_t start = beginFrame(frame, MessageType::SPECTATE);
+    frame.resize(frame.size() + 4);
+    endFrame(frame, start);
+
+    FrameReader reader(4);
+    MessageType type;
+    vector<uint8_t> payload;
+    // Only the length is needed to reject the frame.
+    reader.append(frame.data(), FrameReader::HEADER_SIZE);
+    CHECK_THROW(reader.next(type, payload), invalid_argument);
+  }
+
+  TEST_FIXTURE(MatchServerFixture, longClientFrameDropsTheClient)
+  {
+    TestClient client(server.getPort());
+    for (int i = 0; i < 100 && server.getClientCount() != 1; ++i) {
+      server.poll(10);
+    }
+    CHECK_EQUAL(1, server.getClientCount());
+
+    vector<uint8_t> frame;
+    size_t start = beginFrame(frame, MessageType::JOIN);
+    frame.resize(frame.size() + 1000);
+    endFrame(frame, start);
+    client.write(frame);
+
+    for (int i = 0; i < 100 && server.getClientCount() != 0; ++i) {
+      server.poll(10);
+    }
+    CHECK_EQUAL(0, server.getClientCount());
+  }
+
+  TEST_FIXTURE(MatchServerFixture, spectatorFollowsTheMatch)
+  {
+    TestClient first(server.getPort());
+    TestClient second(server.getPort());
+    TestClient spectator(server.getPort());
+    first.write(join());
+    second.write(join());
+    CHECK(first.receive(server, MessageType::MATCH_START, payload));
+
+    vector<uint8_t> request;
+    size_t start = beginFrame(request, MessageType::SPECTATE);
+    request.insert(request.end(), payload.begin(), payload.begin() + 4);
+    endFrame(request, start);
+    spectator.write(request);
+
+    SpectatorDecoder decoders[2];
+    for (int i = 0; i < 2; ++i) {
+      CHECK(spectator.receive(server, MessageType::KEYFRAME, payload));
+      CHECK(decoders[payload[0]].apply(MessageType::KEYFRAME, payload));
+    }
+
+    first.write(input(Action::MOVE_LEFT));
+    CHECK(spectator.receive(server, MessageType::DELTA, payload));
+    CHECK(decoders[payload[0]].apply(MessageType::DELTA, payload));
+    CHECK_EQUAL(true, decoders[payload[0]].hasState());
+
+    second.disconnect();
+    CHECK(spectator.receive(server, MessageType::MATCH_END, payload));
+    CHECK_EQUAL(0, payload[0]);
+  }
+}
+
+}
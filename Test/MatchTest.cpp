@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2016 Daniel Becker <beckerdaniel.dani@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "UnitTest++.h"
+
+#include "BasicBlock.h"
+#include "Board.h"
+#include "DefaultGame.h"
+#include "GameBoard.h"
+#include "Match.h"
+#include "TetrominoO.h"
+
+using namespace std;
+using namespace tetris;
+
+namespace {
+
+SUITE(Match)
+{
+  const int height = 12;
+  const int width = 6;
+
+  class MatchFixture {
+  public:
+    vector<shared_ptr<Shape>> shapes {
+      make_shared<TetrominoO>(make_shared<BasicBlock>())
+    };
+  };
+
+  TEST(garbageLines)
+  {
+    CHECK_EQUAL(0, Match::getGarbageLines(0));
+    CHECK_EQUAL(0, Match::getGarbageLines(1));
+    CHECK_EQUAL(1, Match::getGarbageLines(2));
+    CHECK_EQUAL(2, Match::getGarbageLines(3));
+    CHECK_EQUAL(4, Match::getGarbageLines(4));
+  }
+
+  TEST_FIXTURE(MatchFixture, addGarbageLeavesOneHole)
+  {
+    Match match(height, width, shapes, 3u);
+    match.addGarbage(1, 2);
+
+    const Board& board = *match.getGameBoard(1).getBoard();
+    for (int v = height - 2; v < height; ++v) {
+      int holes = 0;
+      for (int h = 0; h < width; ++h) {
+        holes += board.isFilled(v, h) ? 0 : 1;
+      }
+      CHECK_EQUAL(1, holes);
+    }
+    CHECK_EQUAL(false, board.isFilled(height - 3, 0));
+    CHECK_EQUAL(false, match.isOver());
+
+    // The other player is not affected.
+    const Board& other = *match.getGameBoard(0).getBoard();
+    for (int h = 0; h < width; ++h) {
+      CHECK_EQUAL(false, other.isFilled(height - 1, h));
+    }
+  }
+
+  TEST_FIXTURE(MatchFixture, toppingOutLoses)
+  {
+    Match match(height, width, shapes, 3u);
+    while (!match.isOver()) {
+      match.apply(0, Action::DROP);
+    }
+
+    CHECK_EQUAL(true, match.hasLost(0));
+    CHECK_EQUAL(false, match.hasLost(1));
+    CHECK_EQUAL(1, match.getWinner());
+  }
+
+  TEST_FIXTURE(MatchFixture, garbageTopsOut)
+  {
+    Match match(height, width, shapes, 3u);
+    match.addGarbage(0, height);
+    CHECK_EQUAL(false, match.hasLost(0));
+
+    // The top row is filled now, so one more line pushes it off the board.
+    match.addGarbage(0, 1);
+    CHECK_EQUAL(true, match.hasLost(0));
+    CHECK_EQUAL(1, match.getWinner());
+  }
+}
+
+}
@@ -0,0 +1,185 @@
+/*
+ * Copyright (C) 2016 Daniel Becker <beckerdaniel.dani@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "UnitTest++.h"
+
+#include <stdexcept>
+
+#include "BasicBlock.h"
+#include "BasicBoard.h"
+#include "DefaultGame.h"
+#include "DefaultGameBoard.h"
+#include "MonteCarloSearch.h"
+#include "TetrominoI.h"
+#include "TetrominoJ.h"
+#include "TetrominoL.h"
+#include "TetrominoO.h"
+#include "TetrominoS.h"
+#include "TetrominoT.h"
+#include "TetrominoZ.h"
+
+using namespace std;
+using namespace tetris;
+
+namespace {
+
+SUITE(MonteCarloSearch)
+{
+  const int height = 12;
+  const int width = 4;
+  const chrono::microseconds budget = chrono::seconds(10);
+
+  class SearchFixture {
+  public:
+    shared_ptr<Block> block = make_shared<BasicBlock>();
+    shared_ptr<BasicBoard> board = make_shared<BasicBoard>(height, width);
+    DefaultGameBoard game_board {board};
+    vector<shared_ptr<Shape>> shapes {
+      make_shared<TetrominoI>(block), make_shared<TetrominoJ>(block),
+      make_shared<TetrominoL>(block), make_shared<TetrominoO>(block),
+      make_shared<TetrominoS>(block), make_shared<TetrominoT>(block),
+      make_shared<TetrominoZ>(block)
+    };
+
+    MonteCarloConfig makeConfig(unsigned int threads, unsigned int trees) {
+      MonteCarloConfig config;
+      config.threads = threads;
+      config.trees = trees;
+      config.max_nodes = 1u << 16;
+      return config;
+    }
+
+    void spawn(shared_ptr<Shape> shape) {
+      game_board.setCurrentShape(shape);
+      game_board.setCurrentShapePosition(Coords(0, 0));
+    }
+
+    void fillBottomLeft(int rows) {
+      for (int v = height - rows; v < height; ++v) {
+        board->set(v, 0, block);
+        board->set(v, 1, block);
+      }
+    }
+  };
+
+  TEST_FIXTURE(SearchFixture, invalidSettings)
+  {
+    MonteCarloConfig config = makeConfig(1, 1);
+    config.max_nodes = 100;
+    CHECK_THROW(MonteCarloSearch(shapes, config), invalid_argument);
+    CHECK_THROW(MonteCarloSearch({}, makeConfig(1, 1)), invalid_argument);
+
+    MonteCarloSearch search(shapes, makeConfig(1, 1));
+    CHECK_THROW(search.search(game_board, {}, budget, 10), invalid_argument);
+  }
+
+  TEST_FIXTURE(SearchFixture, completesLines)
+  {
+    fillBottomLeft(2);
+    spawn(make_shared<TetrominoO>(block));
+
+    MonteCarloSearch search(shapes, makeConfig(1, 1));
+    Placement placement = search.search(game_board, {}, budget, 500);
+    CHECK_EQUAL(500u, search.getRolloutCount());
+    CHECK_EQUAL(true, placement.valid);
+    CHECK_EQUAL(2, placement.horizontal);
+  }
+
+  TEST_FIXTURE(SearchFixture, answersWithoutRollouts)
+  {
+    fillBottomLeft(2);
+    spawn(make_shared<TetrominoO>(block));
+
+    MonteCarloSearch search(shapes, makeConfig(1, 1));
+    Placement placement = search.search(game_board, {},
+                                        chrono::microseconds(0));
+    CHECK_EQUAL(0u, search.getRolloutCount());
+    CHECK_EQUAL(true, placement.valid);
+    CHECK_EQUAL(2, placement.horizontal);
+  }
+
+  TEST_FIXTURE(SearchFixture, fewRolloutsFollowTheRating)
+  {
+    fillBottomLeft(2);
+    spawn(make_shared<TetrominoO>(block));
+
+    MonteCarloSearch search(shapes, makeConfig(1, 1));
+    for (size_t rollouts : {1u, 5u, 20u}) {
+      Placement placement = search.search(game_board, {}, budget, rollouts);
+      CHECK_EQUAL(rollouts, search.getRolloutCount());
+      CHECK_EQUAL(true, placement.valid);
+      CHECK_EQUAL(2, placement.horizontal);
+    }
+  }
+
+  TEST_FIXTURE(SearchFixture, deterministicOnOneThread)
+  {
+    fillBottomLeft(1);
+    spawn(make_shared<TetrominoT>(block));
+    vector<shared_ptr<const Shape>> preview {make_shared<TetrominoI>(block)};
+
+    MonteCarloSearch search1(shapes, makeConfig(1, 1));
+    MonteCarloSearch search2(shapes, makeConfig(1, 1));
+    Placement placement1 = search1.search(game_board, preview, budget, 300);
+    Placement placement2 = search2.search(game_board, preview, budget, 300);
+    CHECK_EQUAL(placement1.rotation, placement2.rotation);
+    CHECK_EQUAL(placement1.horizontal, placement2.horizontal);
+    CHECK_EQUAL(placement1.value, placement2.value);
+    CHECK_EQUAL(search1.getNodeCount(), search2.getNodeCount());
+  }
+
+  TEST_FIXTURE(SearchFixture, rootAndTreeParallelism)
+  {
+    fillBottomLeft(2);
+    spawn(make_shared<TetrominoO>(block));
+
+    MonteCarloSearch search(shapes, makeConfig(4, 2));
+    Placement placement = search.search(game_board, {}, budget, 2000);
+    CHECK_EQUAL(2000u, search.getRolloutCount());
+    CHECK_EQUAL(true, placement.valid);
+    CHECK_EQUAL(2, placement.horizontal);
+    CHECK(search.getNodeCount() <= (1u << 16));
+  }
+
+  TEST_FIXTURE(SearchFixture, fullArena)
+  {
+    MonteCarloConfig config = makeConfig(2, 1);
+    config.max_nodes = 1024;
+    spawn(make_shared<TetrominoL>(block));
+
+    MonteCarloSearch search(shapes, config);
+    Placement placement = search.search(game_board, {}, budget, 3000);
+    CHECK_EQUAL(true, placement.valid);
+    CHECK_EQUAL(3000u, search.getRolloutCount());
+    CHECK(search.getNodeCount() <= 1024u);
+  }
+
+  TEST_FIXTURE(SearchFixture, playsDefaultGame)
+  {
+    shared_ptr<DefaultGameBoard> game_board2 =
+                  make_shared<DefaultGameBoard>(make_shared<BasicBoard>(20, 10));
+    DefaultGame game(game_board2, shapes, 3u);
+    game.newGame();
+
+    MonteCarloSearch search(shapes, makeConfig(1, 1));
+    for (int piece = 0; piece < 40; ++piece) {
+      CHECK_EQUAL(true, search.play(game, budget, 300));
+    }
+    CHECK_EQUAL(false, game.isGameOver());
+  }
+}
+
+}
@@ -0,0 +1,239 @@
+/*
+ * Copyright (C) 2016 Daniel Becker <beckerdaniel.dani@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "UnitTest++.h"
+
+#include <stdexcept>
+
+#include "BasicBlock.h"
+#include "BasicBoard.h"
+#include "DefaultGameBoard.h"
+#include "PerfectClearSolver.h"
+#include "TetrominoI.h"
+#include "TetrominoJ.h"
+#include "TetrominoL.h"
+#include "TetrominoO.h"
+#include "TetrominoS.h"
+#include "TetrominoT.h"
+#include "TetrominoZ.h"
+
+using namespace std;
+using namespace tetris;
+
+namespace {
+
+SUITE(PerfectClearSolver)
+{
+  const int height = 8;
+  const int width = 4;
+
+  class SolverFixture {
+  public:
+    explicit SolverFixture(int board_width = width)
+      : board(make_shared<BasicBoard>(height, board_width)) {}
+
+    shared_ptr<Block> block = make_shared<BasicBlock>();
+    shared_ptr<BasicBoard> board;
+    DefaultGameBoard game_board {board};
+    vector<shared_ptr<const Shape>> queue {};
+    vector<PerfectClearStep> solution {};
+
+    // Queues the pieces named by their letters.
+    void enqueue(const string& kinds) {
+      for (char kind : kinds) {
+        switch (kind) {
+          case 'I': queue.push_back(make_shared<TetrominoI>(block)); break;
+          case 'J': queue.push_back(make_shared<TetrominoJ>(block)); break;
+          case 'L': queue.push_back(make_shared<TetrominoL>(block)); break;
+          case 'O': queue.push_back(make_shared<TetrominoO>(block)); break;
+          case 'S': queue.push_back(make_shared<TetrominoS>(block)); break;
+          case 'T': queue.push_back(make_shared<TetrominoT>(block)); break;
+          case 'Z': queue.push_back(make_shared<TetrominoZ>(block)); break;
+        }
+      }
+    }
+
+    // Fills the given columns of the row.
+    void fill(int row, vector<int> columns) {
+      for (int h : columns) {
+        board->set(row, h, block);
+      }
+    }
+
+    // Plays the solution on the board, checking that every step is a
+    // place where the piece lands.
+    void replay() {
+      int index = 0;
+      int hold = -1;
+      for (const PerfectClearStep& step : solution) {
+        int piece = index;
+        if (!step.hold) {
+          ++index;
+        } else if (hold < 0) {
+          piece = index + 1;
+          hold = index;
+          index += 2;
+        } else {
+          piece = hold;
+          hold = index;
+          ++index;
+        }
+
+        shared_ptr<Shape> shape = queue.at(piece)->clone();
+        for (int r = 0; r < step.rotation; ++r) {
+          shape->rotateRight();
+        }
+        game_board.setCurrentShape(shape);
+        game_board.setCurrentShapePosition(step.position);
+        CHECK(game_board.isAtValidPos());
+        CHECK(game_board.whereWouldLand() == step.position);
+        game_board.lock();
+        game_board.removeFilledRows();
+      }
+    }
+
+    bool isEmpty() const {
+      for (int v = 0; v < height; ++v) {
+        for (int h = 0; h < board->getWidth(); ++h) {
+          if (board->isFilled(v, h)) { return false; }
+        }
+      }
+      return true;
+    }
+  };
+
+  class WideFixture : public SolverFixture {
+  public:
+    WideFixture() : SolverFixture(10) {}
+  };
+
+  TEST_FIXTURE(SolverFixture, fillsAWell) {
+    for (int v = height - 4; v < height; ++v) {
+      fill(v, {0, 1, 2});
+    }
+    queue.push_back(make_shared<TetrominoI>(block));
+
+    PerfectClearSolver solver;
+    CHECK(solver.solve(*board, queue, solution));
+    CHECK_EQUAL(1u, solution.size());
+    replay();
+    CHECK(isEmpty());
+  }
+
+  TEST_FIXTURE(SolverFixture, clearsTwoRowsWithSquares) {
+    queue.assign(2, make_shared<TetrominoO>(block));
+
+    PerfectClearSolver solver(2);
+    CHECK(solver.solve(*board, queue, solution));
+    CHECK_EQUAL(2u, solution.size());
+    replay();
+    CHECK(isEmpty());
+  }
+
+  TEST_FIXTURE(SolverFixture, clearsAnEmptyField) {
+    queue.push_back(make_shared<TetrominoL>(block));
+    queue.push_back(make_shared<TetrominoT>(block));
+    queue.push_back(make_shared<TetrominoO>(block));
+    queue.push_back(make_shared<TetrominoL>(block));
+    queue.push_back(make_shared<TetrominoI>(block));
+    queue.push_back(make_shared<TetrominoT>(block));
+
+    PerfectClearSolver solver(4);
+    CHECK(solver.solve(*board, queue, solution));
+    CHECK(solution.size() == 4u);
+    replay();
+    CHECK(isEmpty());
+  }
+
+  // The rows above a row that is cleared before the last piece move down,
+  // so the solutions need pieces that no colouring of the cells allows.
+  TEST_FIXTURE(SolverFixture, clearsRowsBeforeTheLastPiece) {
+    enqueue("TIJII");
+
+    PerfectClearSolver solver(4);
+    CHECK(solver.solve(*board, queue, solution));
+    replay();
+    CHECK(isEmpty());
+  }
+
+  TEST_FIXTURE(WideFixture, clearsRowsBeforeTheLastPieceOfABag) {
+    for (const char* kinds : {"TOSZOOZJIZS", "TZSSZSZIZIJ"}) {
+      queue.clear();
+      enqueue(kinds);
+
+      PerfectClearSolver solver(4);
+      CHECK(solver.solve(*board, queue, solution));
+      replay();
+      CHECK(isEmpty());
+    }
+  }
+
+  TEST_FIXTURE(SolverFixture, failsOnAnOddNumberOfCells) {
+    fill(height - 1, {0});
+    queue.assign(10, make_shared<TetrominoT>(block));
+
+    PerfectClearSolver solver(4);
+    CHECK(!solver.solve(*board, queue, solution));
+
+    // The parity alone rules the field out.
+    CHECK_EQUAL(0u, solver.getVisitedCount());
+  }
+
+  TEST_FIXTURE(SolverFixture, usesTheHold) {
+    for (int v = height - 4; v < height; ++v) {
+      fill(v, {0, 1, 2});
+    }
+    queue.push_back(make_shared<TetrominoO>(block));
+    queue.push_back(make_shared<TetrominoI>(block));
+
+    PerfectClearSolver without_hold(4, false);
+    CHECK(!without_hold.solve(*board, queue, solution));
+
+    PerfectClearSolver solver(4, true);
+    CHECK(solver.solve(*board, queue, solution));
+    CHECK_EQUAL(1u, solution.size());
+    CHECK(solution[0].hold);
+    replay();
+    CHECK(isEmpty());
+  }
+
+  TEST_FIXTURE(SolverFixture, failsWithCellsAboveTheField) {
+    fill(height - 3, {0});
+    queue.assign(4, make_shared<TetrominoI>(block));
+
+    PerfectClearSolver solver(2);
+    CHECK(!solver.solve(*board, queue, solution));
+  }
+
+  TEST_FIXTURE(SolverFixture, throwsOnInvalidArguments) {
+    CHECK_THROW(PerfectClearSolver(0), invalid_argument);
+
+    PerfectClearSolver too_high(height + 1);
+    CHECK_THROW(too_high.solve(*board, queue, solution), invalid_argument);
+
+    BasicBoard wide(height, 40);
+    PerfectClearSolver solver(2);
+    CHECK_THROW(solver.solve(wide, queue, solution), invalid_argument);
+
+    queue.push_back(nullptr);
+    CHECK_THROW(solver.solve(*board, queue, solution), invalid_argument);
+
+    queue.assign(33, make_shared<TetrominoO>(block));
+    CHECK_THROW(solver.solve(*board, queue, solution), invalid_argument);
+  }
+}
+
+}
@@ -0,0 +1,243 @@
+/*
+ * Copyright (C) 2016 Daniel Becker <beckerdaniel.dani@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "UnitTest++.h"
+
+#include <stdexcept>
+
+#include "BasicBlock.h"
+#include "BasicBoard.h"
+#include "DefaultGame.h"
+#include "DefaultGameBoard.h"
+#include "PlacementSearch.h"
+#include "TetrominoI.h"
+#include "TetrominoL.h"
+#include "TetrominoO.h"
+#include "TetrominoT.h"
+#include "TranspositionTable.h"
+
+using namespace std;
+using namespace tetris;
+
+namespace {
+
+SUITE(PlacementSearch)
+{
+  const int height = 12;
+  const int width = 4;
+  const chrono::microseconds budget(50000);
+
+  class SearchFixture {
+  public:
+    shared_ptr<Block> block = make_shared<BasicBlock>();
+    shared_ptr<BasicBoard> board = make_shared<BasicBoard>(height, width);
+    DefaultGameBoard game_board {board};
+    PlacementSearch search {};
+
+    void spawn(shared_ptr<Shape> shape) {
+      game_board.setCurrentShape(shape);
+      game_board.setCurrentShapePosition(Coords(0, 0));
+    }
+
+    // Plays the placement the way a bot would.
+    void play(const Placement& placement) {
+      if (placement.rotation == 3) {
+        game_board.rotateLeft();
+      }
+      for (int r = 0; r < placement.rotation % 3; ++r) {
+        game_board.rotateRight();
+      }
+      while (game_board.getCurrentShapePosition().getHorizontal()
+             < placement.horizontal) {
+        game_board.moveRight();
+      }
+      while (game_board.getCurrentShapePosition().getHorizontal()
+             > placement.horizontal) {
+        game_board.moveLeft();
+      }
+      game_board.setCurrentShapePosition(game_board.whereWouldLand());
+      game_board.lock();
+      game_board.removeFilledRows();
+    }
+
+    bool isEmpty() const {
+      for (int v = 0; v < height; ++v) {
+        for (int h = 0; h < width; ++h) {
+          if (board->isFilled(v, h)) { return false; }
+        }
+      }
+      return true;
+    }
+  };
+
+  TEST_FIXTURE(SearchFixture, completesLines)
+  {
+    for (int v = height - 2; v < height; ++v) {
+      board->set(v, 0, block);
+      board->set(v, 1, block);
+    }
+    spawn(make_shared<TetrominoO>(block));
+
+    Placement placement = search.search(game_board, {}, nullptr, budget);
+    CHECK_EQUAL(true, placement.valid);
+    CHECK_EQUAL(false, placement.hold);
+    play(placement);
+    CHECK_EQUAL(true, isEmpty());
+  }
+
+  TEST_FIXTURE(SearchFixture, usesHold)
+  {
+    for (int v = height - 4; v < height; ++v) {
+      for (int h = 1; h < width; ++h) {
+        board->set(v, h, block);
+      }
+    }
+    spawn(make_shared<TetrominoO>(block));
+    shared_ptr<Shape> hold = make_shared<TetrominoI>(block);
+
+    Placement placement = search.search(game_board, {}, hold, budget);
+    CHECK_EQUAL(true, placement.valid);
+    CHECK_EQUAL(true, placement.hold);
+
+    spawn(hold);
+    play(placement);
+    CHECK_EQUAL(true, isEmpty());
+  }
+
+  TEST_FIXTURE(SearchFixture, turnsLeftPastABlockedRotation)
+  {
+    // The first turn to the right is blocked, so the only placement that
+    // clears the line needs the turn to the left.
+    board->set(2, 0, block);
+    board->set(height - 1, 0, block);
+    spawn(make_shared<TetrominoL>(block));
+
+    Placement placement = search.search(game_board, {}, nullptr, budget);
+    CHECK_EQUAL(true, placement.valid);
+    CHECK_EQUAL(3, placement.rotation);
+    CHECK_EQUAL(1, placement.horizontal);
+
+    play(placement);
+    CHECK_EQUAL(true, board->isFilled(3, 0));
+    CHECK_EQUAL(true, board->isFilled(height - 1, 3));
+    CHECK_EQUAL(false, board->isFilled(height - 1, 0));
+  }
+
+  TEST(playPlacementStopsWhenBlocked)
+  {
+    shared_ptr<Block> block = make_shared<BasicBlock>();
+    shared_ptr<BasicBoard> board = make_shared<BasicBoard>(height, width);
+    DefaultGame game(make_shared<DefaultGameBoard>(board),
+                     vector<shared_ptr<Shape>> {
+                       make_shared<TetrominoO>(block)},
+                     3u);
+    game.newGame();
+
+    Placement placement;
+    placement.valid = true;
+    placement.horizontal = width;
+    CHECK_EQUAL(-1, playPlacement(game, placement));
+    for (int h = 0; h < width; ++h) {
+      CHECK_EQUAL(false, board->isFilled(height - 1, h));
+    }
+
+    placement.horizontal = 0;
+    CHECK_EQUAL(0, playPlacement(game, placement));
+    CHECK_EQUAL(true, board->isFilled(height - 1, 0));
+  }
+
+  TEST_FIXTURE(SearchFixture, deepensAndReusesTheTree)
+  {
+    vector<shared_ptr<const Shape>> preview {
+      make_shared<TetrominoT>(block), make_shared<TetrominoL>(block),
+      make_shared<TetrominoO>(block)
+    };
+    spawn(make_shared<TetrominoI>(block));
+
+    Placement placement = search.search(game_board, preview, nullptr,
+                                        chrono::seconds(10));
+    CHECK_EQUAL(4, search.getCompletedDepth());
+    CHECK_EQUAL(false, search.wasTreeReused());
+
+    // The shape has fallen a row; the search goes on from the same tree.
+    game_board.moveDown();
+    search.search(game_board, preview, nullptr, chrono::seconds(10));
+    CHECK_EQUAL(true, search.wasTreeReused());
+
+    // The placement is played and the next shape comes from the preview.
+    play(placement);
+    spawn(make_shared<TetrominoT>(block));
+    preview.erase(preview.begin());
+    preview.push_back(make_shared<TetrominoI>(block));
+    search.search(game_board, preview, nullptr, chrono::seconds(10));
+    CHECK_EQUAL(true, search.wasTreeReused());
+    CHECK_EQUAL(4, search.getCompletedDepth());
+    CHECK(search.getNodeCount() > 1u);
+  }
+
+  TEST_FIXTURE(SearchFixture, answersWithoutBudget)
+  {
+    vector<shared_ptr<const Shape>> preview(5, make_shared<TetrominoT>(block));
+    spawn(make_shared<TetrominoL>(block));
+
+    CHECK_EQUAL(0, search.getLatencyPercentile(50.0));
+    Placement placement = search.search(game_board, preview, nullptr,
+                                        chrono::microseconds(0));
+    CHECK_EQUAL(true, placement.valid);
+    CHECK_EQUAL(1, search.getCompletedDepth());
+    CHECK(search.getLatencyPercentile(50.0)
+          <= search.getLatencyPercentile(100.0));
+  }
+
+  TEST_FIXTURE(SearchFixture, sharesATranspositionTable)
+  {
+    vector<shared_ptr<const Shape>> preview {
+      make_shared<TetrominoT>(block), make_shared<TetrominoO>(block),
+      make_shared<TetrominoL>(block)
+    };
+    spawn(make_shared<TetrominoI>(block));
+    Placement expected = search.search(game_board, preview, nullptr,
+                                       chrono::seconds(10));
+
+    shared_ptr<TranspositionTable> table = make_shared<TranspositionTable>();
+    PlacementSearch search1;
+    PlacementSearch search2;
+    search1.setTranspositionTable(table);
+    search2.setTranspositionTable(table);
+
+    Placement placement = search1.search(game_board, preview, nullptr,
+                                         chrono::seconds(10));
+    CHECK_EQUAL(expected.rotation, placement.rotation);
+    CHECK_EQUAL(expected.horizontal, placement.horizontal);
+    CHECK(table->getStats().stores > 0u);
+
+    // The second search finds what the first one has already searched.
+    uint64_t hits = table->getStats().hits;
+    placement = search2.search(game_board, preview, nullptr,
+                               chrono::seconds(10));
+    CHECK_EQUAL(expected.rotation, placement.rotation);
+    CHECK_EQUAL(expected.horizontal, placement.horizontal);
+    CHECK(table->getStats().hits > hits);
+  }
+
+  TEST_FIXTURE(SearchFixture, noCurrentShape)
+  {
+    CHECK_THROW(search.search(game_board, {}, nullptr, budget),
+                invalid_argument);
+  }
+}
+
+}
@@ -0,0 +1,221 @@
+/*
+ * Copyright (C) 2016 Daniel Becker <beckerdaniel.dani@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <algorithm>
+#include <cstdio>
+#include <set>
+
+#include "UnitTest++.h"
+#include "TestHelpers.h"
+
+#include "BasicBlock.h"
+#include "PolyominoCatalog.h"
+#include "ShapeCatalog.h"
+
+using namespace std;
+using namespace tetris;
+
+namespace {
+
+// Tests.
+SUITE(PolyominoCatalog)
+{
+  TEST(PieceCounts)
+  {
+    const size_t free_counts[] = {1, 1, 2, 5, 12, 35, 108};
+    const size_t one_sided_counts[] = {1, 1, 2, 7, 18, 60, 196};
+    const size_t fixed_counts[] = {1, 2, 6, 19, 63, 216, 760};
+    for (int order = 1; order <= 7; ++order) {
+      CHECK_EQUAL(free_counts[order - 1],
+                  PolyominoCatalog(order, PolyominoSet::FREE).getPieceCount());
+      CHECK_EQUAL(one_sided_counts[order - 1],
+                  PolyominoCatalog(order, PolyominoSet::ONE_SIDED)
+                                                            .getPieceCount());
+      CHECK_EQUAL(fixed_counts[order - 1],
+                  PolyominoCatalog(order, PolyominoSet::FIXED)
+                                                            .getPieceCount());
+    }
+  }
+
+  TEST(TetrominoKinds)
+  {
+    PolyominoCatalog catalog(4, PolyominoSet::ONE_SIDED);
+    set<ShapeKind> kinds;
+    for (size_t i = 0; i < catalog.getPieceCount(); ++i) {
+      kinds.insert(catalog.getPiece(i).getKind());
+    }
+    set<ShapeKind> exp_kinds {ShapeCatalog::I, ShapeCatalog::J,
+                              ShapeCatalog::L, ShapeCatalog::O,
+                              ShapeCatalog::S, ShapeCatalog::T,
+                              ShapeCatalog::Z};
+    CHECK(exp_kinds == kinds);
+  }
+
+  TEST(FixedPiecesAreDistinct)
+  {
+    PolyominoCatalog catalog(5, PolyominoSet::FIXED);
+    set<pair<ShapeKind, int>> rotations;
+    for (size_t i = 0; i < catalog.getPieceCount(); ++i) {
+      const PolyominoCatalog::Piece& piece = catalog.getPiece(i);
+      rotations.insert(make_pair(piece.getKind(), piece.getRotation()));
+    }
+    CHECK_EQUAL(catalog.getPieceCount(), rotations.size());
+  }
+
+  TEST(PieceTables)
+  {
+    PolyominoCatalog catalog(5, PolyominoSet::FREE);
+    for (size_t i = 0; i < catalog.getPieceCount(); ++i) {
+      const PolyominoCatalog::Piece& piece = catalog.getPiece(i);
+      CHECK_EQUAL(5u, piece.getBlockCount());
+      CHECK_EQUAL(true, piece.hasMasks());
+      for (int turns = 0; turns < 4; ++turns) {
+        const PackedCoords* positions = piece.getPositions(turns);
+        CollisionMask mask(positions, piece.getBlockCount());
+        CHECK_EQUAL(mask.getTop(), piece.getMask(turns).getTop());
+        CHECK_EQUAL(mask.getLeft(), piece.getMask(turns).getLeft());
+        CHECK_EQUAL(mask.getRow(0), piece.getMask(turns).getRow(0));
+        CHECK_EQUAL(KickTable::getOrientation(positions, 5,
+                                              piece.getBBoxSize()),
+                    piece.getOrientation(turns));
+      }
+      CHECK(&KickTable::forBBoxSize(piece.getBBoxSize())
+            == &piece.getKickTable());
+    }
+  }
+
+  TEST(CreateShapes)
+  {
+    PolyominoCatalog catalog(6, PolyominoSet::ONE_SIDED);
+    vector<shared_ptr<Shape>> shapes =
+                            catalog.createShapes(make_shared<BasicBlock>());
+    CHECK_EQUAL(catalog.getPieceCount(), shapes.size());
+    for (size_t i = 0; i < shapes.size(); ++i) {
+      const PolyominoCatalog::Piece& piece = catalog.getPiece(i);
+      CHECK_EQUAL(piece.getKind(), shapes[i]->getKind());
+      CHECK_EQUAL(piece.getRotation(), shapes[i]->getRotation());
+      CHECK_EQUAL(6u, shapes[i]->getBlockCount());
+    }
+    CHECK_THROW(catalog.createShapes(nullptr), invalid_argument);
+  }
+
+  TEST(Cache)
+  {
+    const string path = "PolyominoCatalogTest.cache";
+    remove(path.c_str());
+
+    PolyominoCatalog generated(6, PolyominoSet::FIXED, path);
+    CHECK_EQUAL(false, generated.isFromCache());
+    PolyominoCatalog loaded(6, PolyominoSet::FIXED, path);
+    CHECK_EQUAL(true, loaded.isFromCache());
+    CHECK_EQUAL(generated.getPieceCount(), loaded.getPieceCount());
+    for (size_t i = 0; i < loaded.getPieceCount(); ++i) {
+      CHECK_EQUAL(generated.getPiece(i).getKind(),
+                  loaded.getPiece(i).getKind());
+      CHECK_EQUAL(generated.getPiece(i).getRotation(),
+                  loaded.getPiece(i).getRotation());
+    }
+
+    // A cache of another order is replaced.
+    PolyominoCatalog other(5, PolyominoSet::FIXED, path);
+    CHECK_EQUAL(false, other.isFromCache());
+    CHECK_EQUAL(true, PolyominoCatalog(5, PolyominoSet::FIXED, path)
+                                                              .isFromCache());
+    remove(path.c_str());
+  }
+
+  TEST(InvalidCache)
+  {
+    const string path = "PolyominoCatalogTest.invalid";
+    FILE* file = fopen(path.c_str(), "w");
+    fputs("not a catalog", file);
+    fclose(file);
+    CHECK_THROW(PolyominoCatalog(4, PolyominoSet::FREE, path),
+                invalid_argument);
+    remove(path.c_str());
+  }
+
+  TEST(IncompleteCache)
+  {
+    const string path = "PolyominoCatalogTest.incomplete";
+    remove(path.c_str());
+    PolyominoCatalog generated(5, PolyominoSet::FIXED, path);
+
+    // Dropping the last piece and counting one piece less keeps the file
+    // well-formed.
+    FILE* file = fopen(path.c_str(), "rb");
+    vector<char> data(64 * 1024);
+    data.resize(fread(data.data(), 1, data.size(), file));
+    fclose(file);
+    const size_t count_offset = 8 + 3;
+    data[count_offset] = static_cast<char>(generated.getPieceCount() - 1);
+    data.resize(data.size() - (1 + 2 * 5));
+    file = fopen(path.c_str(), "wb");
+    fwrite(data.data(), 1, data.size(), file);
+    fclose(file);
+
+    CHECK_THROW(PolyominoCatalog(5, PolyominoSet::FIXED, path),
+                invalid_argument);
+    remove(path.c_str());
+  }
+
+  TEST(RejectedCacheRegistersNothing)
+  {
+    // A cache of the right size whose first piece is new and valid and
+    // whose second piece repeats it.
+    const int order = 9;
+    const size_t count = 2500;
+    string data("TPOLYCAT");
+    data.push_back(1);
+    data.push_back(order);
+    data.push_back(static_cast<char>(PolyominoSet::ONE_SIDED));
+    for (int i = 0; i < 4; ++i) {
+      data.push_back(static_cast<char>((count >> (8 * i)) & 0xFF));
+    }
+    string straight(1, order);
+    for (int b = 0; b < order; ++b) {
+      straight.push_back(order / 2);
+      straight.push_back(b);
+    }
+    for (size_t i = 0; i < count; ++i) {
+      data += straight;
+    }
+
+    const string path = "PolyominoCatalogTest.repeated";
+    FILE* file = fopen(path.c_str(), "wb");
+    fwrite(data.data(), 1, data.size(), file);
+    fclose(file);
+
+    size_t kinds = ShapeCatalog::getKindCount();
+    CHECK_THROW(PolyominoCatalog(order, PolyominoSet::ONE_SIDED, path),
+                invalid_argument);
+    CHECK_EQUAL(kinds, ShapeCatalog::getKindCount());
+    remove(path.c_str());
+  }
+
+  TEST(InvalidOrder)
+  {
+    CHECK_THROW(PolyominoCatalog(0, PolyominoSet::FREE), invalid_argument);
+    CHECK_THROW(PolyominoCatalog(PolyominoCatalog::MAX_ORDER + 1,
+                                 PolyominoSet::FREE),
+                invalid_argument);
+    CHECK_THROW(PolyominoCatalog(4, PolyominoSet::FREE).getPiece(5),
+                invalid_argument);
+  }
+}
+
+}
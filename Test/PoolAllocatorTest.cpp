@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2016 Daniel Becker <beckerdaniel.dani@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "UnitTest++.h"
+#include "TestHelpers.h"
+
+#include <typeinfo>
+
+#include "BasicBlock.h"
+#include "BasicBoard.h"
+#include "DefaultGame.h"
+#include "DefaultGameBoard.h"
+#include "PoolAllocator.h"
+#include "TetrominoT.h"
+
+using namespace std;
+using namespace tetris;
+
+namespace {
+
+SUITE(PoolAllocator)
+{
+  TEST(reuseFreedMemory)
+  {
+    PoolResource pool;
+    void* first = pool.allocate(40);
+    pool.deallocate(first, 40);
+    void* second = pool.allocate(33);
+
+    CHECK_EQUAL(first, second);
+    CHECK_EQUAL(1u, pool.getLiveAllocations());
+    pool.deallocate(second, 33);
+  }
+
+  TEST(cloneShapeIntoPool)
+  {
+    shared_ptr<PoolResource> pool = make_shared<PoolResource>();
+    TetrominoT prototype(make_shared<BasicBlock>());
+
+    shared_ptr<Shape> clone = prototype.clone(PoolAllocator<char>(pool));
+    bool same_type = typeid(*clone) == typeid(TetrominoT);
+    CHECK_EQUAL(true, same_type);
+    CHECK_EQUAL(true, same_elements(prototype.getBlockPositions(),
+                                    clone->getBlockPositions()));
+    // The shape, its internal data, the position, block and cell arrays and
+    // the 4 blocks.
+    CHECK_EQUAL(9u, pool->getLiveAllocations());
+
+    clone = nullptr;
+    CHECK_EQUAL(0u, pool->getLiveAllocations());
+    CHECK_EQUAL(true, pool->reset());
+  }
+
+  TEST(gameReclaimsPoolOnNewGame)
+  {
+    shared_ptr<PoolResource> pool = make_shared<PoolResource>();
+    shared_ptr<Board> board = make_shared<BasicBoard>(20, 10);
+    shared_ptr<GameBoard> game_board = make_shared<DefaultGameBoard>(board);
+    DefaultGame game(game_board, {make_shared<TetrominoT>(
+                                              make_shared<BasicBlock>())}, 1u);
+    game.setAllocationPool(pool);
+
+    game.newGame();
+    for (int i = 0; i < 3; ++i) {
+      game.drop();
+    }
+    size_t reserved = pool->getReservedBytes();
+    CHECK_EQUAL(true, pool->getLiveAllocations() > 0);
+
+    game.newGame();
+    // Only the current shape is alive; the upcoming ones are not cloned
+    // before they spawn.
+    CHECK_EQUAL(9u, pool->getLiveAllocations());
+    CHECK_EQUAL(reserved, pool->getReservedBytes());
+  }
+}
+
+}
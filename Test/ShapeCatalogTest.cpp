@@ -0,0 +1,166 @@
+/*
+ * Copyright (C) 2016 Daniel Becker <beckerdaniel.dani@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <algorithm>
+#include <thread>
+
+#include "UnitTest++.h"
+#include "TestHelpers.h"
+
+#include "BasicBlock.h"
+#include "BasicShape.h"
+#include "ShapeCatalog.h"
+#include "TetrominoI.h"
+#include "TetrominoJ.h"
+#include "TetrominoO.h"
+#include "TetrominoT.h"
+
+using namespace std;
+using namespace tetris;
+
+namespace {
+
+vector<PackedCoords> sortedPositions(const Shape& shape) {
+  vector<PackedCoords> res(shape.getBlockCount());
+  shape.getPackedBlockPositions(res.data());
+  sort(res.begin(), res.end(), [](PackedCoords lhs, PackedCoords rhs) {
+    return lhs.vertical != rhs.vertical ? lhs.vertical < rhs.vertical
+                                        : lhs.horizontal < rhs.horizontal;
+  });
+  return res;
+}
+
+shared_ptr<Shape> pentomino(vector<Coords> coords) {
+  vector<shared_ptr<Block>> blocks;
+  for (size_t i = 0; i < coords.size(); ++i) {
+    blocks.push_back(make_shared<BasicBlock>());
+  }
+  return make_shared<BasicShape>(5, coords, blocks);
+}
+
+// Tests.
+SUITE(ShapeCatalog)
+{
+  const shared_ptr<Block> bblock = make_shared<BasicBlock>();
+
+  TEST(TetrominoKinds)
+  {
+    CHECK_EQUAL(ShapeCatalog::I, TetrominoI(bblock).getKind());
+    CHECK_EQUAL(ShapeCatalog::J, TetrominoJ(bblock).getKind());
+    CHECK_EQUAL(ShapeCatalog::O, TetrominoO(bblock).getKind());
+    CHECK_EQUAL(ShapeCatalog::T, TetrominoT(bblock).getKind());
+    CHECK(ShapeCatalog::getKindCount() >= 7u);
+  }
+
+  TEST(RotationIsTracked)
+  {
+    TetrominoT shape(bblock);
+    CHECK_EQUAL(0, shape.getRotation());
+    shape.rotateRight();
+    CHECK_EQUAL(1, shape.getRotation());
+    shape.rotateLeft();
+    shape.rotateLeft();
+    CHECK_EQUAL(3, shape.getRotation());
+    CHECK_EQUAL(ShapeCatalog::T, shape.getKind());
+  }
+
+  TEST(CoordsAreClassified)
+  {
+    TetrominoJ rotated(bblock);
+    rotated.rotateRight();
+    vector<shared_ptr<Block>> blocks;
+    for (int i = 0; i < 4; ++i) {
+      blocks.push_back(bblock->clone());
+    }
+    BasicShape shape(rotated.getBBoxSize(), rotated.getBlockPositions(),
+                     blocks);
+    CHECK_EQUAL(ShapeCatalog::J, shape.getKind());
+    CHECK_EQUAL(1, shape.getRotation());
+  }
+
+  TEST(NewKindsAreRegistered)
+  {
+    shared_ptr<Shape> shape = pentomino({Coords(1, 1), Coords(1, 2),
+                                         Coords(2, 2), Coords(2, 3),
+                                         Coords(3, 3)});
+    ShapeKind kind = shape->getKind();
+    CHECK(kind > ShapeCatalog::Z);
+    CHECK_EQUAL(0, shape->getRotation());
+
+    shape->rotateRight();
+    shared_ptr<Shape> same = pentomino(shape->getBlockPositions());
+    CHECK_EQUAL(kind, same->getKind());
+    CHECK_EQUAL(1, same->getRotation());
+    CHECK_EQUAL(5u, ShapeCatalog::get(kind).getBlockCount());
+  }
+
+  TEST(CreateMatchesRotatedShape)
+  {
+    shared_ptr<Shape> created = ShapeCatalog::create(ShapeCatalog::T, bblock,
+                                                     2);
+    TetrominoT rotated(bblock);
+    rotated.rotateRight();
+    rotated.rotateRight();
+    CHECK_EQUAL(ShapeCatalog::T, created->getKind());
+    CHECK_EQUAL(2, created->getRotation());
+    CHECK(sortedPositions(rotated) == sortedPositions(*created));
+  }
+
+  TEST(ClonesKeepKindAndRotation)
+  {
+    TetrominoI shape(bblock);
+    shape.rotateLeft();
+    shared_ptr<Shape> clone = shape.clone();
+    CHECK_EQUAL(ShapeCatalog::I, clone->getKind());
+    CHECK_EQUAL(3, clone->getRotation());
+  }
+
+  TEST(InvalidKind)
+  {
+    CHECK_THROW(ShapeCatalog::get(ShapeCatalog::MAX_KINDS - 1),
+                invalid_argument);
+    CHECK_THROW(ShapeCatalog::create(ShapeCatalog::O, nullptr),
+                invalid_argument);
+  }
+
+  TEST(ConcurrentClassification)
+  {
+    const int thread_count = 4;
+    vector<PackedCoords> positions {PackedCoords(0, 0), PackedCoords(0, 1),
+                                    PackedCoords(1, 1), PackedCoords(1, 2),
+                                    PackedCoords(2, 2), PackedCoords(2, 3)};
+    vector<ShapeKind> kinds(thread_count);
+    vector<thread> threads;
+    for (int t = 0; t < thread_count; ++t) {
+      threads.emplace_back([&, t]() {
+        int rotation = 0;
+        kinds[t] = ShapeCatalog::classify(4, positions.data(),
+                                          positions.size(), rotation);
+      });
+    }
+    for (thread& t : threads) {
+      t.join();
+    }
+
+    for (int t = 1; t < thread_count; ++t) {
+      CHECK_EQUAL(kinds[0], kinds[t]);
+    }
+    CHECK_EQUAL(6u, ShapeCatalog::get(kinds[0]).getBlockCount());
+  }
+}
+
+}
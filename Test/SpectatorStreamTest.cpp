@@ -0,0 +1,182 @@
+/*
+ * Copyright (C) 2016 Daniel Becker <beckerdaniel.dani@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "UnitTest++.h"
+
+#include "BasicBlock.h"
+#include "BasicBoard.h"
+#include "DefaultGame.h"
+#include "DefaultGameBoard.h"
+#include "MatchProtocol.h"
+#include "SpectatorStream.h"
+#include "TetrominoI.h"
+#include "TetrominoO.h"
+#include "TetrominoT.h"
+
+using namespace std;
+using namespace tetris;
+
+namespace {
+
+SUITE(SpectatorStream)
+{
+  const int height = 16;
+  const int width = 6;
+
+  class SpectatorFixture {
+  public:
+    SpectatorFixture() {
+      shared_ptr<Block> block = make_shared<BasicBlock>();
+      game = make_shared<DefaultGame>(make_shared<DefaultGameBoard>(board),
+                                      vector<shared_ptr<Shape>> {
+                                        make_shared<TetrominoI>(block),
+                                        make_shared<TetrominoO>(block),
+                                        make_shared<TetrominoT>(block)},
+                                      11u);
+      game->newGame();
+      encoder = make_shared<SpectatorEncoder>(*game, 1, 64);
+      game->addEventListener(encoder);
+    }
+
+    // Encodes a tick and feeds it to the decoder, returning its size.
+    size_t tick() {
+      vector<uint8_t> frame;
+      keyframe = encoder->encodeTick(frame);
+      FrameReader reader;
+      reader.append(frame.data(), frame.size());
+      MessageType type;
+      vector<uint8_t> payload;
+      CHECK(reader.next(type, payload));
+      applied = decoder.apply(type, payload);
+      return frame.size();
+    }
+
+    bool matches() const {
+      if (!decoder.hasState()) { return false; }
+      const Board& decoded = *decoder.getBoard();
+      for (int v = 0; v < height; ++v) {
+        for (int h = 0; h < width; ++h) {
+          if (decoded.isFilled(v, h) != board->isFilled(v, h)) {
+            return false;
+          }
+        }
+      }
+      vector<PackedCoords> shape;
+      for (const Coords& c : game->getGameBoard()->getAbsolutePositions()) {
+        shape.push_back(c);
+      }
+      return shape == decoder.getShapePositions();
+    }
+
+    shared_ptr<BasicBoard> board = make_shared<BasicBoard>(height, width);
+    shared_ptr<DefaultGame> game;
+    shared_ptr<SpectatorEncoder> encoder;
+    SpectatorDecoder decoder;
+    bool keyframe = false;
+    bool applied = false;
+  };
+
+  TEST_FIXTURE(SpectatorFixture, decoderFollowsTheGame)
+  {
+    CHECK_EQUAL(true, tick() > 0);
+    CHECK_EQUAL(true, keyframe);
+    CHECK(matches());
+    CHECK_EQUAL(1, decoder.getPlayer());
+
+    size_t delta_bytes = 0;
+    int deltas = 0;
+    for (int i = 0; i < 300 && !game->isGameOver(); ++i) {
+      switch (i % 5) {
+      case 0: game->moveLeft(); break;
+      case 1: game->rotateRight(); break;
+      case 2: game->moveRight(); game->moveRight(); break;
+      case 3: game->advance(); break;
+      default: if (i % 15 == 4) { game->drop(); } break;
+      }
+
+      size_t size = tick();
+      CHECK(applied);
+      CHECK(matches());
+      if (!keyframe) {
+        delta_bytes += size;
+        ++deltas;
+      }
+    }
+
+    CHECK(deltas > 0);
+    CHECK(delta_bytes / deltas < 12u);
+    CHECK_EQUAL(encoder->getTick(), decoder.getTick());
+  }
+
+  TEST_FIXTURE(SpectatorFixture, keyframesAtTheInterval)
+  {
+    tick();
+    int keyframes = 0;
+    for (int i = 0; i < 128; ++i) {
+      tick();
+      keyframes += keyframe ? 1 : 0;
+    }
+    CHECK_EQUAL(2, keyframes);
+  }
+
+  TEST_FIXTURE(SpectatorFixture, changesWithoutEventsSendKeyframe)
+  {
+    tick();
+    tick();
+    CHECK_EQUAL(false, keyframe);
+
+    // Garbage is not reported by the events.
+    board->set(height - 1, 0, make_shared<BasicBlock>());
+    tick();
+    CHECK_EQUAL(true, keyframe);
+    CHECK(matches());
+
+    game->newGame();
+    tick();
+    CHECK_EQUAL(true, keyframe);
+    CHECK(matches());
+  }
+
+  TEST_FIXTURE(SpectatorFixture, missedDeltaWaitsForKeyframe)
+  {
+    tick();
+    game->moveLeft();
+    vector<uint8_t> lost;
+    encoder->encodeTick(lost);
+
+    game->moveRight();
+    tick();
+    CHECK_EQUAL(false, applied);
+    CHECK_EQUAL(false, decoder.hasState());
+
+    encoder->requestKeyframe();
+    tick();
+    CHECK(applied);
+    CHECK(matches());
+  }
+
+  TEST_FIXTURE(SpectatorFixture, encoderDoesNotKeepTheGameAlive)
+  {
+    weak_ptr<DefaultGame> weak_game = game;
+    weak_ptr<SpectatorEncoder> weak_encoder = encoder;
+    encoder.reset();
+    game.reset();
+    CHECK(weak_game.expired());
+    CHECK(weak_encoder.expired());
+  }
+}
+
+}
@@ -0,0 +1,145 @@
+/*
+ * Copyright (C) 2016 Daniel Becker <beckerdaniel.dani@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "UnitTest++.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "BasicBlock.h"
+#include "BasicBoard.h"
+#include "TranspositionTable.h"
+
+using namespace std;
+using namespace tetris;
+
+namespace {
+
+SUITE(TranspositionTable)
+{
+  typedef TranspositionTable::Entry Entry;
+
+  Entry makeEntry(float value, int depth) {
+    Entry entry;
+    entry.value = value;
+    entry.depth = depth;
+    entry.move = 7;
+    return entry;
+  }
+
+  TEST(storeAndProbe)
+  {
+    TranspositionTable table(1 << 16);
+    CHECK_EQUAL(4096u, table.getCapacity());
+
+    Entry entry;
+    CHECK_EQUAL(false, table.probe(42u, entry));
+    table.store(42u, makeEntry(1.5f, 3));
+    CHECK_EQUAL(true, table.probe(42u, entry));
+    CHECK_EQUAL(1.5f, entry.value);
+    CHECK_EQUAL(3, entry.depth);
+    CHECK_EQUAL(7, entry.move);
+    CHECK_EQUAL(false, table.probe(42u + 4096u, entry));
+
+    TranspositionTable::Stats stats = table.getStats();
+    CHECK_EQUAL(3u, stats.probes);
+    CHECK_EQUAL(1u, stats.hits);
+    CHECK_EQUAL(1u, stats.stores);
+  }
+
+  TEST(smallestBudget)
+  {
+    TranspositionTable table(0);
+    CHECK_EQUAL(4u, table.getCapacity());
+  }
+
+  TEST(replacesShallowAndOldEntries)
+  {
+    // A single bucket, so every key competes for the same slots.
+    TranspositionTable table(64);
+    int depths[] = {5, 1, 7, 3};
+    for (uint64_t key = 0; key < 4; ++key) {
+      table.store(key + 1, makeEntry(key, depths[key]));
+    }
+    CHECK_EQUAL(0u, table.getStats().collisions);
+
+    Entry entry;
+    table.store(100u, makeEntry(0.0f, 2));
+    CHECK_EQUAL(1u, table.getStats().collisions);
+    CHECK_EQUAL(false, table.probe(2u, entry));
+    CHECK_EQUAL(true, table.probe(100u, entry));
+
+    // A shallower result of the same state is ignored, unless the stored
+    // one is from an earlier search.
+    table.store(3u, makeEntry(9.0f, 1));
+    CHECK_EQUAL(true, table.probe(3u, entry));
+    CHECK_EQUAL(7, entry.depth);
+    table.newSearch();
+    table.store(3u, makeEntry(9.0f, 1));
+    CHECK_EQUAL(true, table.probe(3u, entry));
+    CHECK_EQUAL(1, entry.depth);
+
+    // The entries of the earlier search go before the deep ones of this.
+    table.store(200u, makeEntry(0.0f, 0));
+    CHECK_EQUAL(true, table.probe(3u, entry));
+    CHECK_EQUAL(true, table.probe(200u, entry));
+  }
+
+  TEST(concurrentAccessNeverReturnsTornEntries)
+  {
+    TranspositionTable table(4096);
+    atomic<int> wrong(0);
+    vector<thread> threads;
+    for (int t = 0; t < 4; ++t) {
+      threads.emplace_back([&table, &wrong, t]() {
+        Entry entry;
+        for (uint64_t i = 0; i < 20000; ++i) {
+          uint64_t key = (i * 7919u + t) % 512u + 1u;
+          table.store(key, makeEntry(static_cast<float>(key), key % 200));
+          if (table.probe(key ^ 1u, entry)
+              && entry.value != static_cast<float>(key ^ 1u)) {
+            ++wrong;
+          }
+        }
+      });
+    }
+    for (thread& t : threads) {
+      t.join();
+    }
+    CHECK_EQUAL(0, wrong.load());
+    // The counts of all threads add up once they have finished.
+    TranspositionTable::Stats stats = table.getStats();
+    CHECK(stats.hits > 0u);
+    CHECK_EQUAL(80000u, stats.probes);
+  }
+
+  TEST(hashBoards)
+  {
+    BasicBoard board1(10, 70);
+    BasicBoard board2(10, 70);
+    CHECK_EQUAL(TranspositionTable::hash(board1),
+                TranspositionTable::hash(board2));
+
+    board1.set(4, 66, make_shared<BasicBlock>());
+    CHECK(TranspositionTable::hash(board1) != TranspositionTable::hash(board2));
+    board2.set(4, 66, make_shared<BasicBlock>());
+    CHECK_EQUAL(TranspositionTable::hash(board1),
+                TranspositionTable::hash(board2));
+  }
+}
+
+}
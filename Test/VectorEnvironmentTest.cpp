@@ -0,0 +1,137 @@
+/*
+ * Copyright (C) 2016 Daniel Becker <beckerdaniel.dani@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "UnitTest++.h"
+
+#include <algorithm>
+
+#include "BasicBlock.h"
+#include "Game.h"
+#include "TetrominoO.h"
+#include "TetrominoT.h"
+#include "VectorEnvironment.h"
+
+using namespace std;
+using namespace tetris;
+
+namespace {
+
+SUITE(VectorEnvironment)
+{
+  const int count = 8;
+  const int height = 12;
+  const int width = 6;
+
+  class VectorEnvironmentFixture {
+  public:
+    vector<shared_ptr<Shape>> shapes {
+      make_shared<TetrominoO>(make_shared<BasicBlock>()),
+      make_shared<TetrominoT>(make_shared<BasicBlock>())
+    };
+    vector<uint8_t> obs = vector<uint8_t>(count * height * width);
+    vector<float> rewards = vector<float>(count);
+    vector<uint8_t> dones = vector<uint8_t>(count);
+  };
+
+  TEST_FIXTURE(VectorEnvironmentFixture, observationSize)
+  {
+    VectorEnvironment env(count, height, width, shapes, 1u, 2u);
+    CHECK_EQUAL(height * width, env.getObservationSize());
+    CHECK_EQUAL(height * 1, env.getPackedObservationSize());
+  }
+
+  TEST_FIXTURE(VectorEnvironmentFixture, resetShowsCurrentShape)
+  {
+    VectorEnvironment env(count, height, width, shapes, 1u, 2u);
+    env.reset(obs.data());
+
+    for (int i = 0; i < count; ++i) {
+      uint8_t* begin = obs.data() + i * env.getObservationSize();
+      uint8_t* end = begin + env.getObservationSize();
+      CHECK_EQUAL(0, std::count(begin, end, 1));
+      CHECK_EQUAL(true, std::count(begin, end, 2) > 0);
+    }
+  }
+
+  TEST_FIXTURE(VectorEnvironmentFixture, dropUntilDone)
+  {
+    VectorEnvironment env(count, height, width, shapes, 1u, 3u);
+    env.reset(obs.data());
+    vector<Action> actions(count, Action::DROP);
+
+    vector<bool> was_done(count, false);
+    for (int step = 0; step < height * width; ++step) {
+      env.step(actions.data(), obs.data(), rewards.data(), dones.data());
+      for (int i = 0; i < count; ++i) {
+        if (dones[i]) {
+          was_done[i] = true;
+          CHECK_EQUAL(false, env.getGame(i)->isGameOver());
+        }
+      }
+    }
+
+    CHECK_EQUAL(count, std::count(was_done.begin(), was_done.end(), true));
+  }
+
+  TEST_FIXTURE(VectorEnvironmentFixture, packedObservationMatches)
+  {
+    VectorEnvironment env(count, height, width, shapes, 5u, 2u);
+    VectorEnvironment packed_env(count, height, width, shapes, 5u, 2u);
+    vector<uint8_t> packed(count * packed_env.getPackedObservationSize());
+
+    vector<Action> actions(count);
+    for (int step = 0; step < 100; ++step) {
+      for (int i = 0; i < count; ++i) {
+        actions[i] = static_cast<Action>((step * 3 + i) % 6);
+      }
+      env.step(actions.data(), obs.data(), rewards.data(), dones.data());
+      packed_env.stepPacked(actions.data(), packed.data(), rewards.data(),
+                            dones.data());
+    }
+
+    for (int i = 0; i < count * height; ++i) {
+      for (int h = 0; h < width; ++h) {
+        CHECK_EQUAL(obs[i * width + h] != 0, ((packed[i] >> h) & 1u) != 0);
+      }
+    }
+  }
+
+  TEST_FIXTURE(VectorEnvironmentFixture, deterministicAcrossThreadCounts)
+  {
+    VectorEnvironment env1(count, height, width, shapes, 7u, 1u);
+    VectorEnvironment env4(count, height, width, shapes, 7u, 4u);
+    vector<uint8_t> obs4(obs.size());
+    vector<float> rewards4(count);
+    vector<uint8_t> dones4(count);
+
+    env1.reset(obs.data());
+    env4.reset(obs4.data());
+    vector<Action> actions(count);
+    for (int step = 0; step < 200; ++step) {
+      for (int i = 0; i < count; ++i) {
+        actions[i] = static_cast<Action>((step + i) % 6);
+      }
+      env1.stepPacked(actions.data(), obs.data(), rewards.data(), dones.data());
+      env4.stepPacked(actions.data(), obs4.data(), rewards4.data(),
+                      dones4.data());
+    }
+
+    bool equals = (obs == obs4) && (rewards == rewards4) && (dones == dones4);
+    CHECK_EQUAL(true, equals);
+  }
+}
+
+}
@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2016 Daniel Becker <beckerdaniel.dani@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "UnitTest++.h"
+
+#include <cstdio>
+#include <stdexcept>
+
+#include "BasicBlock.h"
+#include "TetrominoI.h"
+#include "TetrominoO.h"
+#include "TetrominoT.h"
+#include "WeightTuner.h"
+
+using namespace std;
+using namespace tetris;
+
+namespace {
+
+SUITE(WeightTuner)
+{
+  vector<shared_ptr<Shape>> makeShapes() {
+    shared_ptr<Block> block = make_shared<BasicBlock>();
+    return {make_shared<TetrominoI>(block), make_shared<TetrominoO>(block),
+            make_shared<TetrominoT>(block)};
+  }
+
+  TunerConfig makeConfig(unsigned int threads) {
+    TunerConfig config;
+    config.height = 12;
+    config.width = 6;
+    config.population = 6;
+    config.elite = 2;
+    config.games = 3;
+    config.max_pieces = 40;
+    config.threads = threads;
+    return config;
+  }
+
+  void checkEqual(const SearchWeights& expected, const SearchWeights& actual)
+  {
+    CHECK_EQUAL(expected.height, actual.height);
+    CHECK_EQUAL(expected.lines, actual.lines);
+    CHECK_EQUAL(expected.holes, actual.holes);
+    CHECK_EQUAL(expected.bumpiness, actual.bumpiness);
+  }
+
+  TEST(invalidConfig)
+  {
+    TunerConfig config = makeConfig(1);
+    config.elite = config.population + 1;
+    CHECK_THROW(WeightTuner(config, makeShapes()), invalid_argument);
+    CHECK_THROW(WeightTuner(makeConfig(1), {}), invalid_argument);
+  }
+
+  TEST(scoresDoNotDependOnTheThreads)
+  {
+    WeightTuner tuner1(makeConfig(1), makeShapes());
+    WeightTuner tuner3(makeConfig(3), makeShapes());
+    double score = tuner1.evaluate(SearchWeights(), 7u, 5);
+    CHECK(score > 0.0);
+    CHECK_EQUAL(score, tuner3.evaluate(SearchWeights(), 7u, 5));
+    CHECK_EQUAL(score, tuner1.evaluate(SearchWeights(), 7u, 5));
+  }
+
+  TEST(runGeneration)
+  {
+    WeightTuner tuner(makeConfig(2), makeShapes());
+    GenerationReport report = tuner.runGeneration();
+    CHECK_EQUAL(1, report.generation);
+    CHECK_EQUAL(1, tuner.getGeneration());
+    CHECK_EQUAL(18u, report.games);
+    CHECK(report.pieces > 0u);
+    CHECK(report.pieces <= 18u * 40u);
+    CHECK(report.best_score >= report.mean_score);
+  }
+
+  TEST(resumesFromCheckpoints)
+  {
+    const string path = "WeightTunerTest.checkpoint";
+    WeightTuner tuner1(makeConfig(2), makeShapes());
+    WeightTuner tuner2(makeConfig(1), makeShapes());
+    CHECK_EQUAL(false, tuner2.loadCheckpoint(path));
+
+    tuner1.runGeneration();
+    tuner1.saveCheckpoint(path);
+    CHECK_EQUAL(true, tuner2.loadCheckpoint(path));
+    CHECK_EQUAL(1, tuner2.getGeneration());
+    checkEqual(tuner1.getMean(), tuner2.getMean());
+
+    GenerationReport report1 = tuner1.runGeneration();
+    GenerationReport report2 = tuner2.runGeneration();
+    CHECK_EQUAL(report1.best_score, report2.best_score);
+    checkEqual(report1.best, report2.best);
+    checkEqual(tuner1.getDeviation(), tuner2.getDeviation());
+    remove(path.c_str());
+  }
+
+  TEST(rejectsOtherFiles)
+  {
+    const string path = "WeightTunerTest.invalid";
+    FILE* file = fopen(path.c_str(), "w");
+    fputs("not a checkpoint\n", file);
+    fclose(file);
+
+    WeightTuner tuner(makeConfig(1), makeShapes());
+    CHECK_THROW(tuner.loadCheckpoint(path), invalid_argument);
+    remove(path.c_str());
+  }
+}
+
+}
@@ -0,0 +1,130 @@
+/*
+ * Copyright (C) 2016 Daniel Becker <beckerdaniel.dani@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Tunes the weights of PlacementSearch, printing a report after every
+// generation and saving a checkpoint that a later run resumes from.
+//
+// Usage: Tuner [--generations N] [--population N] [--elite N] [--games N]
+//              [--max-pieces N] [--threads N] [--seed N]
+//              [--checkpoint PATH]
+
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include "BasicBlock.h"
+#include "TetrominoI.h"
+#include "TetrominoJ.h"
+#include "TetrominoL.h"
+#include "TetrominoO.h"
+#include "TetrominoS.h"
+#include "TetrominoT.h"
+#include "TetrominoZ.h"
+#include "WeightTuner.h"
+
+using namespace std;
+using namespace tetris;
+
+namespace {
+
+void printWeights(const SearchWeights& weights) {
+  cout << "height " << weights.height << ", lines " << weights.lines
+       << ", holes " << weights.holes << ", bumpiness " << weights.bumpiness;
+}
+
+int usage(const char* name) {
+  cerr << "Usage: " << name << " [--generations N] [--population N]"
+       << " [--elite N] [--games N] [--max-pieces N] [--threads N]"
+       << " [--seed N] [--checkpoint PATH]\n";
+  return 1;
+}
+
+} // namespace.
+
+int main(int argc, char** argv)
+{
+  TunerConfig config;
+  int generations = 100;
+  string checkpoint = "tuner.checkpoint";
+  for (int i = 1; i < argc; ++i) {
+    if (i + 1 == argc) { return usage(argv[0]); }
+    const char* option = argv[i];
+    const char* value = argv[++i];
+    if (strcmp(option, "--generations") == 0) {
+      generations = atoi(value);
+    } else if (strcmp(option, "--population") == 0) {
+      config.population = atoi(value);
+    } else if (strcmp(option, "--elite") == 0) {
+      config.elite = atoi(value);
+    } else if (strcmp(option, "--games") == 0) {
+      config.games = atoi(value);
+    } else if (strcmp(option, "--max-pieces") == 0) {
+      config.max_pieces = atoi(value);
+    } else if (strcmp(option, "--threads") == 0) {
+      config.threads = strtoul(value, nullptr, 10);
+    } else if (strcmp(option, "--seed") == 0) {
+      config.seed = strtoul(value, nullptr, 10);
+    } else if (strcmp(option, "--checkpoint") == 0) {
+      checkpoint = value;
+    } else {
+      return usage(argv[0]);
+    }
+  }
+
+  shared_ptr<Block> block = make_shared<BasicBlock>();
+  vector<shared_ptr<Shape>> shapes {
+    make_shared<TetrominoI>(block), make_shared<TetrominoJ>(block),
+    make_shared<TetrominoL>(block), make_shared<TetrominoO>(block),
+    make_shared<TetrominoS>(block), make_shared<TetrominoT>(block),
+    make_shared<TetrominoZ>(block)
+  };
+
+  try {
+    WeightTuner tuner(config, shapes);
+    if (tuner.loadCheckpoint(checkpoint)) {
+      cout << "Resuming after generation " << tuner.getGeneration()
+           << " from " << checkpoint << ".\n";
+    }
+
+    cout << fixed << setprecision(3);
+    while (tuner.getGeneration() < generations) {
+      GenerationReport report = tuner.runGeneration();
+      tuner.saveCheckpoint(checkpoint);
+
+      cout << "Generation " << report.generation
+           << ": best " << report.best_score
+           << " lines, mean " << report.mean_score << " lines; "
+           << report.games << " games, " << report.pieces << " pieces in "
+           << report.seconds << " s ("
+           << setprecision(0)
+           << report.games / report.seconds << " games/s, "
+           << report.pieces / report.seconds << " pieces/s)\n"
+           << setprecision(3) << "  mean weights: ";
+      printWeights(tuner.getMean());
+      cout << "\n  best weights: ";
+      printWeights(report.best);
+      cout << endl;
+    }
+  } catch (const exception& e) {
+    cerr << e.what() << '\n';
+    return 1;
+  }
+  return 0;
+}
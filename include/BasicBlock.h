@@ -33,6 +33,8 @@ class BasicBlock : public Block
     BasicBlock(const BasicBlock& other);
 
     virtual std::shared_ptr<Block> clone() const override;
+    virtual std::shared_ptr<Block> clone(const PoolAllocator<char>& allocator)
+                                                              const override;
     virtual void draw(DrawingContextInfo& dci) const override;
 };
 
@@ -35,11 +35,14 @@ class BasicBoard : public Board
 
     virtual std::shared_ptr<Block> get(int vertical, int horizontal) override;
     virtual std::shared_ptr<const Block> get(int vertical, int horizontal) const;
+    virtual const Block* peek(int vertical, int horizontal) const override;
 
     virtual void set(int vertical, int horizontal,
                      std::shared_ptr<Block> block) override;
 
     virtual void removeRow(int row) override;
+    virtual void insertRowsAtBottom(int count,
+                   const std::vector<std::shared_ptr<Block>>& pattern) override;
     virtual void clear() override;
 
     virtual void draw(DrawingContextInfo& dci) const override;
@@ -19,15 +19,63 @@
 #define BASICSHAPE_H
 
 #include "Shape.h"
+#include "ShapeCatalog.h"
 
 namespace tetris {
 
 class BasicShape : public Shape
 {
 public:
+  /**
+   * Constructs a shape with the given blocks at the given positions. Its kind
+   * is looked up in the \c ShapeCatalog, where a new kind is added for
+   * positions not seen before.
+   *
+   * The lookup takes the lock of the catalog, and a new kind stays in the
+   * catalog for the lifetime of the program, so code that builds many
+   * shapes should classify each kind once and construct the shapes from
+   * its entry instead, which does neither. Once the catalog holds
+   * \c ShapeCatalog::MAX_KINDS kinds, shapes of new kinds can no longer be
+   * constructed this way.
+   *
+   * \param bbox_size The size of the side of the bounding box.
+   * \param coords The positions of the blocks.
+   * \param blocks The blocks, in the order of their positions.
+   *
+   * \throws std::invalid_argument if the bounding box is empty, the number
+   *         of positions and blocks differ, there are duplicates or a
+   *         position is outside the bounding box.
+   * \throws std::runtime_error if the positions are of a new kind and the
+   *         catalog is full.
+   */
   BasicShape(int bbox_size, std::vector<Coords> coords,
              std::vector<std::shared_ptr<Block>> blocks);
+
+  /**
+   * Constructs a shape of a kind in the \c ShapeCatalog, taking its
+   * positions from the catalog. Unlike the constructor from positions, it
+   * neither locks nor changes the catalog.
+   *
+   * \param entry The entry of the kind of the shape, as returned by
+   *        \c ShapeCatalog::get.
+   * \param blocks The blocks, in the order of the positions of the kind.
+   * \param rotation The number of right turns from rotation 0 of the kind.
+   *
+   * \throws std::invalid_argument if the number of blocks is not that of
+   *         the kind or there are duplicate blocks.
+   */
+  BasicShape(const ShapeCatalog::Entry& entry,
+             std::vector<std::shared_ptr<Block>> blocks, int rotation = 0);
   BasicShape(const BasicShape& other);
+
+  /**
+   * Copy-constructs a \c BasicShape whose internal data and blocks are
+   * allocated with \a allocator.
+   *
+   * \param other The shape to copy.
+   * \param allocator The allocator of the new shape.
+   */
+  BasicShape(const BasicShape& other, const PoolAllocator<char>& allocator);
   BasicShape(BasicShape&& other);
   virtual ~BasicShape();
 
@@ -36,20 +84,30 @@ public:
   virtual bool isValid(int vertical, int horizontal) const override;
 
   virtual std::shared_ptr<Block> get(int vertical, int horizontal) const override;
+  virtual const Block* peek(int vertical, int horizontal) const override;
   virtual std::vector<std::shared_ptr<Block>> getBlocks()  override;
   virtual std::vector<Coords> getBlockPositions() const override;
+  virtual std::size_t getBlockCount() const override;
+  virtual void getPackedBlockPositions(PackedCoords* out) const override;
 
+  virtual ShapeKind getKind() const override;
+  virtual int getRotation() const override;
 
   virtual void rotateRight() override;
   virtual void rotateLeft() override;
 
   virtual std::shared_ptr<Shape> clone() const override;
+  virtual std::shared_ptr<Shape> clone(const PoolAllocator<char>& allocator)
+                                                              const override;
   virtual void draw(DrawingContextInfo& dci) const override;
 protected:
 private:
   class PIMPL;
   PIMPL* m_pimpl;
 
+  // The allocator that m_pimpl was allocated with.
+  PoolAllocator<char> m_allocator;
+
 };
 
 } // namespace tetris.
@@ -0,0 +1,185 @@
+/*
+ * Copyright (C) 2016 Daniel Becker <beckerdaniel.dani@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BATCHBOARD_H
+#define BATCHBOARD_H
+
+#include <cstdint>
+#include <vector>
+
+namespace tetris {
+
+/**
+ * Stores the occupancy of the boards of many games in a single contiguous
+ * buffer. Every row of a board is a bitmask, bit \c h standing for column
+ * \c h, so the width of the boards is at most 64.
+ *
+ * The buffer is laid out as a structure of arrays: the rows with the same
+ * index are stored next to each other for all games, so the address of a row
+ * is <tt>row * getCount() + game</tt>. The batch kernels (\c testCollisions,
+ * \c lock and \c removeFilledRows) process all games with simple loops over
+ * these arrays that the compiler can vectorize.
+ *
+ * The coordinate system is the same as that of \c Board: row 0 is the top
+ * row of a board.
+ */
+class BatchBoard
+{
+  public:
+    typedef std::uint64_t Row;
+
+    /**
+     * The maximal number of rows of a piece footprint used by the kernels.
+     */
+    static const int MASK_ROWS = 4;
+
+    /**
+     * Constructs a store for \a count empty boards.
+     *
+     * \param count The number of games.
+     * \param height The height of every board.
+     * \param width The width of every board, at most 64.
+     */
+    BatchBoard(int count, int height, int width);
+    virtual ~BatchBoard();
+
+    int getCount() const;
+    int getHeight() const;
+    int getWidth() const;
+
+    /**
+     * Returns the bitmask of a row in which every column of the board is set.
+     *
+     * \return The bitmask of a completely filled row.
+     */
+    Row getFullRow() const;
+
+    /**
+     * Returns the row \a row of the game with index \a game.
+     * No bounds checking is done.
+     */
+    Row getRow(int game, int row) const {
+      return m_rows[row * m_count + game];
+    }
+
+    /**
+     * Sets the row \a row of the game with index \a game to \a bits.
+     * No bounds checking is done.
+     */
+    void setRow(int game, int row, Row bits) {
+      m_rows[row * m_count + game] = bits;
+      ++m_modifications[game];
+    }
+
+    /**
+     * Returns a counter of the changes of the board of the game with index
+     * \a game, in the sense of \c Board::getModificationCount. Every
+     * operation that may change the board increases it: by exactly one for
+     * \c setFilled and \c removeRow, so that a \c BatchBoardView can pass
+     * it on, and also for the batch kernels, which change the boards
+     * without going through their views.
+     *
+     * \return The number of modifications of the board of the game.
+     */
+    std::uint64_t getModificationCount(int game) const {
+      return m_modifications[game];
+    }
+
+    /**
+     * Checks whether the given cell of the given game is filled.
+     * No bounds checking is done.
+     */
+    bool isFilled(int game, int vertical, int horizontal) const {
+      return (getRow(game, vertical) >> horizontal) & 1u;
+    }
+
+    /**
+     * Sets or clears the given cell of the given game.
+     * No bounds checking is done.
+     */
+    void setFilled(int game, int vertical, int horizontal, bool filled);
+
+    /**
+     * Removes the row \a row of the game with index \a game and adds an empty
+     * row to the top of its board.
+     */
+    void removeRow(int game, int row);
+
+    /**
+     * Moves the rows of the game with index \a game up by \a count and fills
+     * the bottom \a count rows with \a bits. The rows are single words, so
+     * they are moved as such; the layout interleaves the games row by row, so
+     * the rows of one game cannot be turned around as a ring.
+     */
+    void insertRowsAtBottom(int game, int count, Row bits);
+
+    /**
+     * Clears the board of the game with index \a game.
+     */
+    void clear(int game);
+
+    /**
+     * Clears all boards.
+     */
+    void clear();
+
+    /**
+     * Tests piece footprints against all boards.
+     *
+     * The footprint of game \c g consists of the \c MASK_ROWS bitmasks
+     * starting at <tt>masks[g * MASK_ROWS]</tt>, already shifted to the columns
+     * of the piece, the first of which is at row \c tops[g]. A footprint
+     * collides if any of its bits is outside the board or overlaps a filled
+     * cell. Rows of the footprint above the board are only checked against
+     * the side walls.
+     *
+     * \param masks The footprints of the pieces.
+     * \param tops The rows of the first mask of the footprints.
+     * \param results Receives 1 for the games whose footprint collides and 0
+     *        for the others.
+     */
+    void testCollisions(const Row* masks, const int* tops,
+                        std::uint8_t* results) const;
+
+    /**
+     * Locks the piece footprints (in the format of \c testCollisions) on the
+     * boards. The parts of the footprints outside the boards are dropped.
+     */
+    void lock(const Row* masks, const int* tops);
+
+    /**
+     * Removes the filled rows from all boards, moving the rows above them
+     * down and adding empty rows to the top.
+     *
+     * \param removed If not \c nullptr, receives the number of rows removed
+     *        from each board.
+     */
+    void removeFilledRows(int* removed);
+  private:
+    int m_count;
+    int m_height;
+    int m_width;
+    Row m_full_row;
+    std::vector<Row> m_rows;
+    std::vector<std::uint64_t> m_modifications;
+
+    // Scratch space for removeFilledRows, kept to avoid allocating per call.
+    std::vector<int> m_write_rows;
+};
+
+} // namespace tetris.
+
+#endif // BATCHBOARD_H
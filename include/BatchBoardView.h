@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2016 Daniel Becker <beckerdaniel.dani@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BATCHBOARDVIEW_H
+#define BATCHBOARDVIEW_H
+
+#include "Board.h"
+
+namespace tetris {
+
+class BatchBoard;
+
+/**
+ * A \c Board that addresses the board of a single game in a \c BatchBoard,
+ * so that a \c DefaultGameBoard can work on it.
+ *
+ * A \c BatchBoard only stores whether the cells are filled, not the blocks
+ * themselves. Because of this, \c get returns the same filler \c Block for
+ * every filled cell, and \c set only records whether the block it receives is
+ * \c nullptr.
+ *
+ * The modification count of a view is that of its game in the
+ * \c BatchBoard, so it also changes when the batch kernels lock pieces or
+ * remove rows.
+ */
+class BatchBoardView : public Board
+{
+  public:
+    /**
+     * Constructs a view of the board of the game with index \a game.
+     *
+     * \param batch The store that contains the board.
+     * \param game The index of the game in \a batch.
+     * \param filler The block returned for the filled cells. If it is
+     *        \c nullptr, a \c BasicBlock is used.
+     */
+    BatchBoardView(std::shared_ptr<BatchBoard> batch, int game,
+                   std::shared_ptr<Block> filler = nullptr);
+    BatchBoardView(const BatchBoardView& other) = delete;
+    virtual ~BatchBoardView();
+
+    /**
+     * Returns the index of the game whose board this view addresses.
+     *
+     * \return The index of the game in the underlying \c BatchBoard.
+     */
+    int getGameIndex() const;
+
+    virtual int getHeight() const override;
+    virtual int getWidth() const override;
+
+    virtual std::shared_ptr<Block> get(int vertical, int horizontal) override;
+    virtual std::shared_ptr<const Block> get(int vertical, int horizontal)
+                                                                const override;
+    virtual const Block* peek(int vertical, int horizontal) const override;
+    virtual std::uint64_t getRowBits(int row, int left, std::uint64_t mask)
+                                                              const override;
+
+    virtual void set(int vertical, int horizontal,
+                     std::shared_ptr<Block> block) override;
+
+    virtual void removeRow(int row) override;
+    virtual void insertRowsAtBottom(int count,
+                   const std::vector<std::shared_ptr<Block>>& pattern) override;
+    virtual void clear() override;
+
+    virtual std::uint64_t getModificationCount() const override;
+
+    virtual void draw(DrawingContextInfo& dci) const override;
+  private:
+    std::shared_ptr<BatchBoard> m_batch;
+    int m_game;
+    std::shared_ptr<Block> m_filler;
+};
+
+} // namespace tetris.
+
+#endif // BATCHBOARDVIEW_H
@@ -0,0 +1,165 @@
+/*
+ * Copyright (C) 2016 Daniel Becker <beckerdaniel.dani@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BITSETBOARD_H
+#define BITSETBOARD_H
+
+#include <cstdint>
+#include <vector>
+
+#include "Board.h"
+
+namespace tetris {
+
+/**
+ * A \c Board for large dimensions that stores every row as a bitset of
+ * 64-bit words instead of a pointer per cell.
+ *
+ * The rows are not stored in board order: a ring buffer of row indices maps
+ * the rows of the board to the stored rows. Removing a row only moves the
+ * indices on the shorter side of the removed row, and no cell data is moved.
+ *
+ * In sparse mode, storage is only allocated for the rows that contain at
+ * least one filled cell, which suits tall, mostly empty boards.
+ *
+ * Only occupancy is stored, so \c get returns the same filler \c Block for
+ * every filled cell, and \c set only records whether the block it receives is
+ * \c nullptr.
+ */
+class BitsetBoard : public Board
+{
+  public:
+    typedef std::uint64_t Word;
+
+    enum class Storage {
+      DENSE,  ///< Every row is allocated up front.
+      SPARSE  ///< Only the rows with filled cells are allocated.
+    };
+
+    /**
+     * Constructs an empty \c BitsetBoard.
+     *
+     * \param height The height of the board.
+     * \param width The width of the board.
+     * \param storage Whether the rows are allocated up front or on demand.
+     * \param filler The block returned for the filled cells. If it is
+     *        \c nullptr, a \c BasicBlock is used.
+     */
+    BitsetBoard(int height, int width, Storage storage = Storage::DENSE,
+                std::shared_ptr<Block> filler = nullptr);
+    BitsetBoard(const BitsetBoard& other) = delete;
+    virtual ~BitsetBoard();
+
+    virtual int getHeight() const override;
+    virtual int getWidth() const override;
+
+    /**
+     * Returns the storage mode of this board.
+     *
+     * \return The storage mode of this board.
+     */
+    Storage getStorage() const;
+
+    /**
+     * Returns the number of words that make up a row.
+     *
+     * \return The number of words that make up a row.
+     */
+    int getWordsPerRow() const;
+
+    /**
+     * Returns the words of the given row, bit \c h of the whole bitset being
+     * column \c h, or \c nullptr if the row is empty and has no storage
+     * (sparse mode only). No bounds checking is done.
+     *
+     * \param row The vertical coordinate of the row.
+     *
+     * \return The words of the row or \c nullptr.
+     */
+    const Word* getRowWords(int row) const;
+
+    /**
+     * Checks whether every cell of the given row is filled.
+     * No bounds checking is done.
+     *
+     * \param row The vertical coordinate of the row.
+     *
+     * \return \c true if the row is completely filled; \c false otherwise.
+     */
+    bool isRowFull(int row) const;
+
+    /**
+     * Returns the number of rows that currently have storage allocated.
+     *
+     * \return The number of rows that have storage allocated.
+     */
+    int getAllocatedRows() const;
+
+    virtual std::shared_ptr<Block> get(int vertical, int horizontal) override;
+    virtual std::shared_ptr<const Block> get(int vertical, int horizontal)
+                                                                const override;
+    virtual const Block* peek(int vertical, int horizontal) const override;
+    virtual std::uint64_t getRowBits(int row, int left, std::uint64_t mask)
+                                                              const override;
+
+    virtual void set(int vertical, int horizontal,
+                     std::shared_ptr<Block> block) override;
+
+    virtual void removeRow(int row) override;
+    virtual void insertRowsAtBottom(int count,
+                   const std::vector<std::shared_ptr<Block>>& pattern) override;
+    virtual void clear() override;
+
+    virtual void draw(DrawingContextInfo& dci) const override;
+  private:
+    // The position of the board row in m_order.
+    int orderIndex(int row) const {
+      int index = m_start + row;
+      return index >= m_height ? index - m_height : index;
+    }
+
+    bool testCell(int vertical, int horizontal) const;
+    int allocateRow();
+    void releaseRow(int storage_index);
+
+  private:
+    int m_height;
+    int m_width;
+    int m_words_per_row;
+    Storage m_storage;
+    std::shared_ptr<Block> m_filler;
+
+    // The ring buffer mapping board rows to stored rows: board row r is
+    // stored at m_order[(m_start + r) % m_height]. In sparse mode, -1 means
+    // an empty row without storage.
+    std::vector<int> m_order;
+    int m_start;
+
+    // The stored rows, m_words_per_row words each, and the number of filled
+    // cells in them.
+    std::vector<Word> m_row_data;
+    std::vector<int> m_filled_count;
+
+    // The stored rows that can be reused (sparse mode only).
+    std::vector<int> m_free_rows;
+
+    // Scratch space for insertRowsAtBottom, kept to avoid allocating per call.
+    std::vector<Word> m_pattern_words;
+};
+
+} // namespace tetris.
+
+#endif // BITSETBOARD_H
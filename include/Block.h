@@ -21,6 +21,7 @@
 #include <memory>
 
 #include "Drawing.h"
+#include "PoolAllocator.h"
 
 namespace tetris {
 
@@ -43,6 +44,22 @@ class Block : public Drawable<Block>
      * \return A polymorphic copy of this \c Block.
      */
     virtual std::shared_ptr<Block> clone() const = 0;
+
+    /**
+     * Returns a polymorphic copy of this \c Block whose memory is obtained
+     * from \a allocator. The default implementation ignores \a allocator and
+     * calls \c clone(). Overrides follow the same rule as those of
+     * \c Shape::clone(const PoolAllocator<char>&).
+     *
+     * \param allocator The allocator to use for the copy.
+     *
+     * \return A polymorphic copy of this \c Block.
+     */
+    virtual std::shared_ptr<Block> clone(const PoolAllocator<char>& allocator)
+                                                                        const {
+      (void) allocator;
+      return clone();
+    }
 };
 
 } // namespace tetris.
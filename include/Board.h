@@ -18,7 +18,11 @@
 #ifndef BOARD_H
 #define BOARD_H
 
+#include <algorithm>
+#include <cstdint>
 #include <memory>
+#include <stdexcept>
+#include <vector>
 
 #include "Coords.h"
 #include "Drawing.h"
@@ -86,6 +90,38 @@ class Board : public Drawable<Board>
       return get(coords.getVertical(), coords.getHorizontal());
     }
 
+    /**
+     * Returns a non-owning pointer to the \c Block at the given position, or
+     * \c nullptr if the cell is empty or the position is not valid. Unlike
+     * \c get, this does not copy a \c std::shared_ptr, so it is meant for the
+     * hot paths (collision tests, line clearing, rendering). The pointer is
+     * only valid until the cell is modified.
+     *
+     * \param vertical The vertical position of the block to query.
+     * \param horizontal The horizontal position of the block to query.
+     *
+     * \return A non-owning pointer to the \c Block at the given position.
+     */
+    virtual const Block* peek(int vertical, int horizontal) const {
+      return get(vertical, horizontal).get();
+    }
+
+    /**
+     * Checks whether there is a \c Block at the given position.
+     * The same as <tt>peek(vertical, horizontal) != nullptr</tt>.
+     */
+    bool isFilled(int vertical, int horizontal) const {
+      return peek(vertical, horizontal) != nullptr;
+    }
+
+    /**
+     * The same as calling
+     * isFilled(coords.getVertical(), coords.getHorizontal()).
+     */
+    bool isFilled(const Coords& coords) const {
+      return isFilled(coords.getVertical(), coords.getHorizontal());
+    }
+
     /**
      * Sets the \c Block pointer at the given position to point to the object
      * pointed to by \a block.
@@ -127,6 +163,60 @@ class Board : public Drawable<Board>
       return isValid(coords.getVertical(), coords.getHorizontal());
     }
 
+    /**
+     * Returns which of the cells in a window of 64 cells of a row are filled
+     * or outside of this \c Board, restricted to the cells selected by
+     * \a mask. Bit \c i stands for the cell in column <tt>left + i</tt>.
+     * Rows that are not on the board count as completely filled.
+     *
+     * This is the basis of the collision tests of \c CollisionMask. The
+     * default implementation checks the selected cells one by one; boards that
+     * store their rows as bits should override it with a few shifts.
+     *
+     * \param row The vertical coordinate of the row.
+     * \param left The horizontal coordinate of the first cell of the window.
+     * \param mask The cells of the window to check.
+     *
+     * \return The bits of \a mask whose cells are filled or outside.
+     */
+    virtual std::uint64_t getRowBits(int row, int left, std::uint64_t mask)
+                                                                        const {
+      if (row < 0 || row >= getHeight()) {
+        return mask;
+      }
+
+      std::uint64_t res = mask & getWallBits(left);
+      std::uint64_t inside = mask & ~res;
+      for (int i = 0; inside != 0; ++i, inside >>= 1) {
+        if ((inside & 1u) && isFilled(row, left + i)) {
+          res |= std::uint64_t(1) << i;
+        }
+      }
+      return res;
+    }
+
+    /**
+     * Returns the cells of a window of 64 cells of a row that are to the left
+     * or to the right of this \c Board. Bit \c i stands for the cell in
+     * column <tt>left + i</tt>.
+     *
+     * \param left The horizontal coordinate of the first cell of the window.
+     *
+     * \return The bits of the cells of the window that are outside.
+     */
+    std::uint64_t getWallBits(int left) const {
+      // Bit i is inside if 0 <= left + i < width.
+      int begin = left < 0 ? -left : 0;
+      int end = getWidth() - left;
+      if (begin >= 64 || end <= 0 || begin >= end) {
+        return ~std::uint64_t(0);
+      }
+      std::uint64_t inside = end >= 64 ? ~std::uint64_t(0)
+                                       : (std::uint64_t(1) << end) - 1;
+      inside &= ~std::uint64_t(0) << begin;
+      return ~inside;
+    }
+
     /**
      * Removes the row with vertical coordinate \a row and adds a new empty row
      * to the top of the board.
@@ -135,10 +225,91 @@ class Board : public Drawable<Board>
      */
     virtual void removeRow(int row) = 0;
 
+    /**
+     * Pushes \a count rows in from the bottom of the board, moving every row
+     * up by \a count. The top \a count rows are pushed off the board and lost.
+     * This complements \c removeRow, which adds rows at the top; versus modes
+     * use it for garbage lines.
+     *
+     * The default implementation moves the cells one by one; the boards
+     * override it to move whole rows.
+     *
+     * \param count The number of rows to insert. Nothing happens if it is not
+     *        positive; if it is larger than the height, all rows are replaced.
+     * \param pattern The blocks of every inserted row, one per column from
+     *        left to right; \c nullptr stands for an empty cell. The same
+     *        \c Block objects are shared by all inserted rows.
+     *
+     * \throws std::invalid_argument if the size of \a pattern is not the
+     *         width of the board.
+     */
+    virtual void insertRowsAtBottom(int count,
+                   const std::vector<std::shared_ptr<Block>>& pattern) {
+      checkRowPattern(pattern);
+      if (count <= 0) { return; }
+
+      int height = getHeight();
+      int width = getWidth();
+      count = std::min(count, height);
+      for (int v = 0; v < height - count; ++v) {
+        for (int h = 0; h < width; ++h) {
+          set(v, h, get(v + count, h));
+        }
+      }
+      for (int v = height - count; v < height; ++v) {
+        for (int h = 0; h < width; ++h) {
+          set(v, h, pattern[h]);
+        }
+      }
+    }
+
     /**
      * Clears the board, that is, removes all filled blocks.
      */
     virtual void clear() = 0;
+
+    /**
+     * Returns a counter that is increased whenever the cells of this \c Board
+     * may have changed. Caches that depend on the contents of the board
+     * compare it to the value they were computed with. It is increased by
+     * exactly one for every call of \c set on a valid cell and of
+     * \c removeRow on a valid row, so listeners of these changes can tell
+     * whether anything else has happened.
+     *
+     * Boards that address cells stored elsewhere, which may be changed
+     * without going through the board, override it to return the counter of
+     * that store instead.
+     *
+     * \return The number of modifications of this \c Board.
+     */
+    virtual std::uint64_t getModificationCount() const {
+      return m_modifications;
+    }
+
+  protected:
+    /**
+     * Throws \c std::invalid_argument if \a pattern does not have exactly one
+     * element per column. To be used by the overrides of
+     * \c insertRowsAtBottom.
+     */
+    void checkRowPattern(const std::vector<std::shared_ptr<Block>>& pattern)
+                                                                        const {
+      if (pattern.size() != static_cast<std::size_t>(getWidth())) {
+        throw std::invalid_argument(
+                        "The pattern does not match the width of the board.");
+      }
+    }
+
+    /**
+     * Increases the counter returned by \c getModificationCount. Subclasses
+     * call it whenever they change their cells.
+     */
+    void markModified() {
+      ++m_modifications;
+    }
+
+  private:
+    std::uint64_t m_modifications = 0;
 };
 
 } // namespace tetris.
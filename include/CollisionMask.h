@@ -0,0 +1,143 @@
+/*
+ * Copyright (C) 2016 Daniel Becker <beckerdaniel.dani@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef COLLISIONMASK_H
+#define COLLISIONMASK_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "PackedCoords.h"
+
+namespace tetris {
+
+class Board;
+class Shape;
+
+/**
+ * The footprint of a shape in one orientation as one bitmask per row, so
+ * that testing whether the shape fits at a position takes one
+ * \c Board::getRowBits call and an AND per row instead of one query per
+ * block.
+ *
+ * Bit \c i of a row stands for the column <tt>getLeft() + i</tt> of the
+ * bounding box of the shape. A mask holds at most \c MAX_ROWS rows and
+ * \c MAX_WIDTH columns; \c isRepresentable tells whether a shape fits in
+ * these limits.
+ */
+class CollisionMask
+{
+  public:
+    typedef std::uint64_t Row;
+
+    static const int MAX_ROWS = 8;
+    static const int MAX_WIDTH = 64;
+
+    /**
+     * Constructs an empty mask that never collides.
+     */
+    CollisionMask();
+
+    /**
+     * Constructs the mask of the blocks at the given relative positions.
+     *
+     * \param positions The relative positions of the blocks.
+     * \param count The number of elements in \a positions.
+     *
+     * \throws std::invalid_argument if the positions cannot be represented.
+     */
+    CollisionMask(const PackedCoords* positions, std::size_t count);
+
+    /**
+     * Constructs the mask of the given shape in its current orientation.
+     *
+     * \param shape The shape.
+     *
+     * \throws std::invalid_argument if the shape cannot be represented.
+     */
+    explicit CollisionMask(const Shape& shape);
+
+    /**
+     * Checks whether the blocks at the given relative positions span at most
+     * \c MAX_ROWS rows and \c MAX_WIDTH columns.
+     *
+     * \param positions The relative positions of the blocks.
+     * \param count The number of elements in \a positions.
+     *
+     * \return \c true if a mask can be constructed from the positions;
+     *         \c false otherwise.
+     */
+    static bool isRepresentable(const PackedCoords* positions,
+                                std::size_t count);
+
+    /**
+     * Returns the relative vertical coordinate of the first row of the mask.
+     */
+    int getTop() const { return m_top; }
+
+    /**
+     * Returns the relative horizontal coordinate of bit 0 of the rows.
+     */
+    int getLeft() const { return m_left; }
+
+    /**
+     * Returns the number of rows in the mask.
+     */
+    int getHeight() const { return m_height; }
+
+    /**
+     * Returns row \a index of the mask, counted from \c getTop().
+     */
+    Row getRow(int index) const { return m_rows[index]; }
+
+    /**
+     * Checks whether the shape would collide with the filled cells or the
+     * walls of \a board at \a position. The \a hidden_rows rows above the
+     * board are empty.
+     *
+     * \param board The board to test against.
+     * \param hidden_rows The number of rows above the board a shape may
+     *        occupy.
+     * \param position The position of the top left corner of the bounding
+     *        box of the shape.
+     *
+     * \return \c true if the shape would collide; \c false otherwise.
+     */
+    bool collides(const Board& board, int hidden_rows,
+                  PackedCoords position) const {
+      int left = position.horizontal + m_left;
+      for (int i = 0; i < m_height; ++i) {
+        if (rowCollides(board, hidden_rows, position.vertical + m_top + i,
+                        left, m_rows[i])) {
+          return true;
+        }
+      }
+      return false;
+    }
+
+  private:
+    static bool rowCollides(const Board& board, int hidden_rows, int row,
+                            int left, Row bits);
+
+    Row m_rows[MAX_ROWS];
+    std::int16_t m_top;
+    std::int16_t m_left;
+    std::int16_t m_height;
+};
+
+} // namespace tetris.
+
+#endif // COLLISIONMASK_H
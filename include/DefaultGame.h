@@ -17,26 +17,194 @@
 #ifndef DEFAULTGAME_H
 #define DEFAULTGAME_H
 
+#include <array>
+#include <cstdint>
 #include <memory>
+#include <random>
 #include <vector>
 
 #include "Game.h"
 #include "GameBoard.h"
+#include "GameEvents.h"
+#include "PackedCoords.h"
+#include "PoolAllocator.h"
 #include "Shape.h"
 
 namespace tetris {
 
-class DefaultGame : public Game
+/**
+ * The default implementation of \c Game. It notifies its listeners when a
+ * shape spawns, when the current shape is dropped and when the game is over.
+ * The listeners are also added to the game board if it emits events itself,
+ * as \c DefaultGameBoard does, so one listener receives all events.
+ *
+ * The upcoming shapes are kept in a fixed ring buffer as the indices of their
+ * prototypes and their rotations, which is refilled in batches. A shape is
+ * only cloned from its prototype when it becomes the current one, so looking
+ * at the preview costs nothing. Holding keeps the shape object itself, so
+ * swapping it back does not clone either.
+ */
+class DefaultGame : public Game, public GameEventSource
 {
   public:
     DefaultGame(std::shared_ptr<GameBoard> gameBoard,
                 std::vector<std::shared_ptr<Shape>> shapes);
+
+    /**
+     * Constructs a \c DefaultGame whose shape sequence is determined by
+     * \a seed. Games constructed with the same seed and shapes produce the same
+     * sequence of shapes, and, unlike the global \c rand, the random engine
+     * belongs to this object, so separate games can be run on separate threads.
+     *
+     * \param gameBoard The game board of the new game.
+     * \param shapes The prototypes of the shapes that can appear in the game.
+     * \param seed The seed of the random engine of this game.
+     */
+    DefaultGame(std::shared_ptr<GameBoard> gameBoard,
+                std::vector<std::shared_ptr<Shape>> shapes,
+                unsigned int seed);
     virtual ~DefaultGame();
 
     virtual std::shared_ptr<const GameBoard> getGameBoard() const override;
 
+    /**
+     * Sets the pool that the shapes of this game (and their blocks) are
+     * allocated from. The pool is reset, reclaiming its memory in bulk, when
+     * a new game is started and no object allocated from it is alive.
+     *
+     * \param pool The pool to allocate from, or \c nullptr to use the global
+     *        allocator.
+     */
+    void setAllocationPool(std::shared_ptr<PoolResource> pool);
+
+    /**
+     * Returns the pool that the shapes of this game are allocated from.
+     *
+     * \return The pool that the shapes of this game are allocated from, or
+     *         \c nullptr if the global allocator is used.
+     */
+    std::shared_ptr<PoolResource> getAllocationPool() const;
+
     virtual bool isGameOver() const override;
     virtual void newGame() override;
+
+    /**
+     * Starts a new game with the random engine reseeded, so that the game
+     * gets the same sequence of shapes as every other game started with the
+     * same seed.
+     *
+     * \param seed The seed of the random engine.
+     */
+    void newGame(unsigned int seed);
+
+    /**
+     * Sets the number of upcoming shapes that can be looked at with
+     * \c getPreview. It is 1 by default.
+     *
+     * \param count The number of upcoming shapes to show.
+     *
+     * \throws std::invalid_argument if \a count is not in the range
+     *         [1, \c MAX_PREVIEW].
+     */
+    void setPreviewCount(int count);
+
+    /**
+     * Returns the number of upcoming shapes that can be looked at.
+     *
+     * \return The number of upcoming shapes that can be looked at.
+     */
+    int getPreviewCount() const;
+
+    /**
+     * Returns the prototype of an upcoming shape. The shape will spawn as a
+     * clone of it turned to the right \c getPreviewRotation times.
+     *
+     * \param index The position of the shape in the preview, 0 being the
+     *        next one.
+     *
+     * \return The prototype of the upcoming shape.
+     *
+     * \throws std::invalid_argument if \a index is not in the range
+     *         [0, \c getPreviewCount()).
+     */
+    const std::shared_ptr<Shape>& getPreview(int index) const;
+
+    /**
+     * Returns the number of right turns an upcoming shape will spawn with.
+     *
+     * \param index The position of the shape in the preview, 0 being the
+     *        next one.
+     *
+     * \return The number of right turns, in the range [0, 3].
+     *
+     * \throws std::invalid_argument if \a index is not in the range
+     *         [0, \c getPreviewCount()).
+     */
+    int getPreviewRotation(int index) const;
+
+    /**
+     * Returns the index of the prototype of an upcoming shape among the
+     * shapes the game was constructed with.
+     *
+     * \param index The position of the shape in the preview, 0 being the
+     *        next one.
+     *
+     * \return The index of the prototype of the upcoming shape.
+     *
+     * \throws std::invalid_argument if \a index is not in the range
+     *         [0, \c getPreviewCount()).
+     */
+    int getPreviewIndex(int index) const;
+
+    /**
+     * Replaces the contents of \a preview with the prototypes of the
+     * upcoming shapes, for the searches. Reusing the vector, it does not
+     * allocate memory.
+     *
+     * \param preview The vector to fill.
+     */
+    void getPreviewShapes(std::vector<std::shared_ptr<const Shape>>& preview)
+                                                                        const;
+
+    /**
+     * Puts the current shape on hold. The shape that was on hold spawns in
+     * its place, or the next one if there was none. The shape is turned back
+     * to the orientation it spawned with. Holding is allowed once for every
+     * shape that spawns from the preview.
+     *
+     * \return \c true if the shape was put on hold; \c false if the game is
+     *         over, there is no current shape or hold was already used.
+     */
+    bool hold();
+
+    /**
+     * Checks whether \c hold would do anything.
+     *
+     * \return \c true if the current shape can be put on hold;
+     *         \c false otherwise.
+     */
+    bool canHold() const;
+
+    /**
+     * Returns the shape on hold in the orientation it spawned with, for
+     * example to pass it to the searches.
+     *
+     * \return The shape on hold or \c nullptr if there is none.
+     */
+    std::shared_ptr<const Shape> getHeldShape() const;
+
+    /**
+     * Returns the index of the prototype of the shape on hold among the
+     * shapes the game was constructed with.
+     *
+     * \return The index of the prototype of the shape on hold or -1 if there
+     *         is none.
+     */
+    int getHeldIndex() const;
+
+    /** The largest number of upcoming shapes that can be shown. */
+    static const int MAX_PREVIEW = 32;
+
     virtual int advance() override;
     virtual int drop() override;
     virtual void rotateLeft() override;
@@ -44,20 +212,46 @@ class DefaultGame : public Game
     virtual void moveLeft() override;
     virtual void moveRight() override;
 
+    virtual void addEventListener(std::shared_ptr<GameEventListener> listener)
+                                                                      override;
+    virtual void removeEventListener(
+              const std::shared_ptr<GameEventListener>& listener) override;
+
     virtual void draw(DrawingContextInfo& dci) const override;
   protected:
   private:
+    // The upcoming shapes are packed as the index of the prototype times 4
+    // plus the number of right turns.
+    typedef std::uint16_t QueuedShape;
+    static const int QUEUE_CAPACITY = 2 * MAX_PREVIEW;
+
     void setNewShape();
-    std::shared_ptr<Shape> chooseNewShape() const;
+    void spawn(std::shared_ptr<Shape> shape, QueuedShape queued);
+    void fillQueue();
+    QueuedShape getQueued(int index) const;
     bool top_row_not_empty();
-    int get_lowest_block_of_current_shape() const; // The row number of the
-                                                   // lowest block of the
-                                                   // current shape.
+    int get_lowest_block_of_current_shape(); // The row number of the lowest
+                                             // block of the current shape.
 
     std::shared_ptr<GameBoard> m_game_board;
     std::vector<std::shared_ptr<Shape>> m_shapes;
-    std::shared_ptr<Shape> m_next_shape;
+    std::array<QueuedShape, QUEUE_CAPACITY> m_queue;
+    int m_queue_start;
+    int m_queue_size;
+    int m_preview_count;
+
+    // The current shape and the one on hold, with the entries of the queue
+    // they came from.
+    std::shared_ptr<Shape> m_current_shape;
+    QueuedShape m_current;
+    std::shared_ptr<Shape> m_held_shape;
+    QueuedShape m_held;
+    bool m_hold_used;
+
     bool m_game_over;
+    std::mt19937 m_random_engine;
+    PoolAllocator<char> m_allocator;
+    std::vector<PackedCoords> m_block_positions;
 };
 
 } // namespace tetris.
@@ -17,14 +17,26 @@
 #ifndef DEFAULTGAMEBOARD_H
 #define DEFAULTGAMEBOARD_H
 
+#include <cstdint>
+
+#include "CollisionMask.h"
 #include "GameBoard.h"
+#include "GameEvents.h"
+#include "KickTable.h"
+#include "PackedCoords.h"
 
 namespace tetris {
 
+class Block;
 class Board;
 class Shape;
 
-class DefaultGameBoard : public GameBoard
+/**
+ * The default implementation of \c GameBoard. It notifies its listeners when
+ * the current shape moves, rotates or is locked and when rows are cleared;
+ * changes made by \c undo and \c redo are not reported.
+ */
+class DefaultGameBoard : public GameBoard, public GameEventSource
 {
   public:
     DefaultGameBoard(std::shared_ptr<Board> board, int hidden_rows = 4);
@@ -40,13 +52,33 @@ class DefaultGameBoard : public GameBoard
 
     virtual Coords getCurrentShapePosition() const override;
     virtual void setCurrentShapePosition(Coords position) override;
+    virtual int getCurrentShapeRotation() const override;
 
     virtual std::vector<Coords> getAbsolutePositions() const override;
 
     virtual bool isAtValidPos() const override;
+    virtual bool fits(const CollisionMask& mask, PackedCoords position) const
+                                                                      override;
     virtual bool hasLanded() const override;
     virtual Coords whereWouldLand() const override;
 
+    /**
+     * Returns a counter that changes whenever the result of \c whereWouldLand
+     * may have changed, that is, when the current shape, its column or its
+     * rotation changes, it is placed with \c setCurrentShapePosition, or the
+     * board is modified. Moving the shape down towards where it lands does
+     * not change it, and neither does moving it back up to the row where the
+     * landing position was last found; moving it higher does. Undoing and
+     * redoing moves follow the same rule. Renderers can skip recomputing the
+     * ghost piece while it stays the same.
+     *
+     * The landing position is cached under the same conditions, so calling
+     * \c whereWouldLand repeatedly is cheap.
+     *
+     * \return The version of the landing position.
+     */
+    std::uint64_t getLandingVersion() const;
+
     virtual void lock() override;
     virtual int removeFilledRows() override;
 
@@ -54,6 +86,21 @@ class DefaultGameBoard : public GameBoard
     virtual void rotateLeft() override;
     virtual void rotateRight() override;
 
+    /**
+     * Returns how rotations that make the current shape collide are handled.
+     *
+     * \return The rotation mode of this \c DefaultGameBoard.
+     */
+    RotationMode getRotationMode() const;
+
+    /**
+     * Sets how rotations that make the current shape collide are handled. The
+     * default is \c RotationMode::SIMPLE.
+     *
+     * \param mode The new rotation mode.
+     */
+    void setRotationMode(RotationMode mode);
+
     virtual void moveUp() override;
     virtual void moveDown() override;
     virtual void moveLeft() override;
@@ -61,18 +108,142 @@ class DefaultGameBoard : public GameBoard
 
     virtual void clear() override;
 
+    /**
+     * Enables or disables the journal. While it is enabled, every change made
+     * through \c setCurrentShape, \c setCurrentShapePosition, \c lock,
+     * \c removeFilledRows and the move and rotate functions is recorded as a
+     * small delta, so that it can be reverted with \c undo and reapplied with
+     * \c redo. The journal grows until \c clearJournal or \c clear is
+     * called. Disabling the journal clears it.
+     *
+     * \param enabled Whether the changes should be recorded.
+     */
+    void setJournalEnabled(bool enabled);
+
+    /**
+     * Checks whether the journal is enabled.
+     *
+     * \return \c true if the changes are recorded; \c false otherwise.
+     */
+    bool isJournalEnabled() const;
+
+    /**
+     * Checks whether there is a recorded change that can be reverted.
+     *
+     * \return \c true if \c undo would do anything; \c false otherwise.
+     */
+    bool canUndo() const;
+
+    /**
+     * Checks whether there is a reverted change that can be reapplied.
+     *
+     * \return \c true if \c redo would do anything; \c false otherwise.
+     */
+    bool canRedo() const;
+
+    /**
+     * Reverts the last recorded change that has not been reverted yet.
+     *
+     * \return \c true if a change was reverted; \c false if there was none.
+     */
+    bool undo();
+
+    /**
+     * Reapplies the last reverted change. Recording a new change discards the
+     * changes that can be reapplied.
+     *
+     * \return \c true if a change was reapplied; \c false if there was none.
+     */
+    bool redo();
+
+    /**
+     * Discards all recorded changes.
+     */
+    void clearJournal();
+
     virtual void draw(DrawingContextInfo& dci) const override;
   protected:
     std::vector<Coords> getAbsolutePositions(std::shared_ptr<const Shape> shape,
-                                             const Coords& coords) const;
-    bool isAtValidPos(std::shared_ptr<Shape> shape, const Coords& coords) const;
-    bool hasLanded(std::shared_ptr<Shape> shape, const Coords& coords) const;
-    void move(const Coords& offset);
+                                             PackedCoords coords) const;
+    bool isAtValidPos(const std::shared_ptr<Shape>& shape,
+                      PackedCoords coords) const;
+    bool hasLanded(const std::shared_ptr<Shape>& shape,
+                   PackedCoords coords) const;
+    void move(PackedCoords offset);
+    void rotate(bool clockwise);
   private:
+    // A recorded change. The blocks and row indices that do not fit in the
+    // entry are appended to m_journal_blocks and m_journal_rows, starting at
+    // blocks_begin and rows_begin.
+    struct JournalEntry {
+      enum class Type : std::uint8_t {
+        MOVE, ROTATE, SET_SHAPE, SET_POSITION, LOCK, REMOVE_ROWS
+      };
+
+      Type type;
+      bool clockwise;
+      std::uint8_t rotation; // The rotation of shape, if there is one.
+      PackedCoords delta; // The change of the position.
+      std::shared_ptr<Shape> shape; // The previous or the locked shape.
+      std::uint32_t blocks_begin;
+      std::uint32_t rows_begin;
+      std::uint32_t count; // The number of locked blocks or removed rows.
+    };
+
+    void updateMasks(int rotation);
+    void refreshLandingCache() const;
+    void notifyRotated(bool clockwise);
+    JournalEntry& record(JournalEntry::Type type);
+    void swapShape(JournalEntry& entry);
+    void revert(JournalEntry& entry);
+    void reapply(JournalEntry& entry);
+
     std::shared_ptr<Board> m_board;
     std::shared_ptr<Shape> m_current_shape;
     const int m_hidden_rows;
-    Coords m_current_shape_pos = Coords(0, 0);
+    PackedCoords m_current_shape_pos = PackedCoords(0, 0);
+    RotationMode m_rotation_mode = RotationMode::SIMPLE;
+
+    // The collision masks and the kick table orientations of the current
+    // shape in its four rotations, computed when the shape is set.
+    // m_rotation is the index of the current rotation.
+    CollisionMask m_masks[4];
+    int m_orientations[4] {};
+    int m_rotation = 0;
+    bool m_has_masks = false;
+
+    // The landing position of the current shape and what it depends on. The
+    // placement epoch is increased when a shape is set or placed directly,
+    // since it may end up below or above an overhang. The landing found from
+    // m_landing_top is also that of every row down to it, so the cache
+    // stays valid while the shape falls, but not when it is moved above that
+    // row or below the landing row (by a kick, or by moving it sideways,
+    // down and back).
+    struct LandingKey {
+      int rotation;
+      int horizontal;
+      std::uint64_t placement_epoch;
+      std::uint64_t board_modifications;
+    };
+
+    std::uint64_t m_placement_epoch = 0;
+    mutable LandingKey m_landing_key {0, 0, 0, 0};
+    mutable std::uint64_t m_landing_version = 0;
+    mutable bool m_landing_valid = false;
+    mutable int m_landing_top = 0;
+    mutable PackedCoords m_landing_pos = PackedCoords(0, 0);
+
+    // The entries before m_journal_pos are applied, the rest are reverted.
+    bool m_journal_enabled = false;
+    std::vector<JournalEntry> m_journal {};
+    std::size_t m_journal_pos = 0;
+    std::vector<std::shared_ptr<Block>> m_journal_blocks {};
+    std::vector<int> m_journal_rows {};
+
+    // Reused for the arguments of the events, so that they do not allocate
+    // once they have grown large enough.
+    std::vector<PackedCoords> m_event_positions {};
+    std::vector<int> m_event_rows {};
 };
 
 } // namespace tetris.
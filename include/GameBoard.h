@@ -23,10 +23,12 @@
 
 #include "Coords.h"
 #include "Drawing.h"
+#include "PackedCoords.h"
 
 namespace tetris {
 
 class Board;
+class CollisionMask;
 class Shape;
 
 class GameBoard : public Drawable<GameBoard>
@@ -73,12 +75,25 @@ class GameBoard : public Drawable<GameBoard>
     virtual Coords getCurrentShapePosition() const = 0;
 
     /**
-     * Sets the current shape's position.
+     * Sets the current shape's position. Positions are kept as
+     * \c PackedCoords, so both coordinates must fit in 16 bits.
      *
      * \param position The current shape's new position.
+     *
+     * \throws std::invalid_argument if a coordinate of \a position is
+     *         outside of [-32768, 32767].
      */
     virtual void setCurrentShapePosition(Coords position) = 0;
 
+    /**
+     * Returns how many times the current shape was turned to the right since
+     * it was set, counting a left turn as three right ones. Turns that did
+     * not fit are not counted.
+     *
+     * \return The number of right turns modulo 4.
+     */
+    virtual int getCurrentShapeRotation() const = 0;
+
     /**
      * Returns the absolute positions (in the coordinate system of the \c Board)
      * of the blocks of the current shape.
@@ -98,6 +113,21 @@ class GameBoard : public Drawable<GameBoard>
      */
     virtual bool isAtValidPos() const = 0;
 
+    /**
+     * Checks whether a shape with the given collision mask would be at a
+     * valid position at \a position, in the same sense as \c isAtValidPos.
+     * This is the fast path that moving, rotating and dropping the current
+     * shape and searching for placements are built on; it does not allocate.
+     *
+     * \param mask The collision mask of the shape in the orientation to test.
+     * \param position The position of the shape to test.
+     *
+     * \return \c true if the shape would be at a valid position;
+     *         \c false otherwise.
+     */
+    virtual bool fits(const CollisionMask& mask, PackedCoords position) const
+                                                                          = 0;
+
     /**
      * Checks whether the current \c Shape has "landed", that is, there is a
      * block on the board or the bottom of the board under at least one of the
@@ -54,10 +54,10 @@ class GameBoardConsole : public DefaultGameBoard
       for (int v = 0; v < board->getHeight(); ++v) {
         for (int h = 0; h < board->getWidth(); ++h) {
           Coords blockPos(v, h);
-          if (board->get(blockPos) != nullptr
+          if (board->isFilled(blockPos)
               && find(blocks.begin(), blocks.end(), blockPos) != blocks.end()) {
             s << t_block_and_filled << sep;
-          } else if (board->get(blockPos) != nullptr) {
+          } else if (board->isFilled(blockPos)) {
             s << filled << sep;
           } else if (find(blocks.begin(), blocks.end(), blockPos) != blocks.end()) {
             s << t_block << sep;
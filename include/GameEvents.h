@@ -0,0 +1,187 @@
+/*
+ * Copyright (C) 2016 Daniel Becker <beckerdaniel.dani@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef GAMEEVENTS_H
+#define GAMEEVENTS_H
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "PackedCoords.h"
+
+namespace tetris {
+
+class Shape;
+
+/**
+ * An interface for the objects that want to be told what happens in a game,
+ * for example renderers, scorers or network layers that would otherwise have
+ * to compare the whole board after every step. Every function does nothing by
+ * default, so listeners only override the events they need.
+ *
+ * The arguments are only valid during the call. Events are dispatched by
+ * plain virtual calls, so no memory is allocated for them.
+ */
+class GameEventListener
+{
+  public:
+    virtual ~GameEventListener() {}
+
+    /**
+     * Called when a new shape appears on the board.
+     *
+     * \param shape The new current shape.
+     * \param position The position of the new shape.
+     */
+    virtual void onShapeSpawned(const Shape& shape, PackedCoords position) {
+      (void) shape; (void) position;
+    }
+
+    /**
+     * Called when the current shape has moved, either by one cell or, when it
+     * is dropped, straight to where it lands.
+     *
+     * \param from The previous position of the shape.
+     * \param to The new position of the shape.
+     */
+    virtual void onShapeMoved(PackedCoords from, PackedCoords to) {
+      (void) from; (void) to;
+    }
+
+    /**
+     * Called when the current shape has been rotated.
+     *
+     * \param clockwise Whether the shape was rotated to the right.
+     * \param position The position of the shape after the rotation, which
+     *        differs from the previous one if the shape was kicked.
+     */
+    virtual void onShapeRotated(bool clockwise, PackedCoords position) {
+      (void) clockwise; (void) position;
+    }
+
+    /**
+     * Called when the current shape has been locked on the board.
+     *
+     * \param positions The positions on the board the blocks were locked at.
+     * \param count The number of elements in \a positions.
+     */
+    virtual void onShapeLocked(const PackedCoords* positions,
+                               std::size_t count) {
+      (void) positions; (void) count;
+    }
+
+    /**
+     * Called when filled rows have been removed from the board.
+     *
+     * \param rows The indices of the removed rows on the board as it was
+     *        before the removal, in increasing order.
+     * \param count The number of elements in \a rows.
+     */
+    virtual void onRowsCleared(const int* rows, std::size_t count) {
+      (void) rows; (void) count;
+    }
+
+    /**
+     * Called when the game is over.
+     */
+    virtual void onGameOver() {}
+};
+
+/**
+ * A base class for the objects that emit game events. Listeners are shared
+ * with the source and are notified in the order they were added.
+ *
+ * A listener may add or remove listeners, itself included, while it is
+ * being notified. A removed listener is not notified any more, not even of
+ * the current event; an added one is notified from the next event on.
+ */
+class GameEventSource
+{
+  public:
+    GameEventSource();
+    GameEventSource(const GameEventSource& other) = delete;
+    virtual ~GameEventSource();
+
+    /**
+     * Registers a listener. Adding the same listener twice has no effect.
+     *
+     * \param listener The listener to notify of the events of this object.
+     *
+     * \throws std::invalid_argument if \a listener is \c nullptr.
+     */
+    virtual void addEventListener(std::shared_ptr<GameEventListener> listener);
+
+    /**
+     * Unregisters a listener. Removing a listener that is not registered has
+     * no effect.
+     *
+     * \param listener The listener to remove.
+     */
+    virtual void removeEventListener(
+                        const std::shared_ptr<GameEventListener>& listener);
+
+    /**
+     * Checks whether there are registered listeners, so that the arguments
+     * of the events need not be computed if there are none.
+     *
+     * \return \c true if there are listeners; \c false otherwise.
+     */
+    bool hasEventListeners() const {
+      return !m_listeners.empty();
+    }
+
+  protected:
+    /**
+     * Notifies every registered listener of an event.
+     *
+     * \param event A function that takes a \c GameEventListener& and calls
+     *        the function of the event on it.
+     */
+    template <typename Event>
+    void notifyListeners(Event event) {
+      ++m_dispatch_depth;
+      try {
+        // Indexing rather than iterating, since the listeners may be added
+        // to during the calls, and holding a copy of every listener, since it
+        // may remove itself.
+        std::size_t count = m_listeners.size();
+        for (std::size_t i = 0; i < count; ++i) {
+          std::shared_ptr<GameEventListener> listener = m_listeners[i];
+          if (listener != nullptr) {
+            event(*listener);
+          }
+        }
+      } catch (...) {
+        endDispatch();
+        throw;
+      }
+      endDispatch();
+    }
+
+  private:
+    void endDispatch();
+
+    // The listeners removed during a dispatch are set to nullptr and only
+    // erased when the outermost dispatch ends.
+    std::vector<std::shared_ptr<GameEventListener>> m_listeners;
+    int m_dispatch_depth;
+    bool m_has_removed;
+};
+
+} // namespace tetris.
+
+#endif // GAMEEVENTS_H
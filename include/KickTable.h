@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2016 Daniel Becker <beckerdaniel.dani@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KICKTABLE_H
+#define KICKTABLE_H
+
+#include <cstddef>
+
+#include "PackedCoords.h"
+
+namespace tetris {
+
+/**
+ * The ways a \c GameBoard can handle a rotation that would make the current
+ * shape collide.
+ */
+enum class RotationMode {
+  /** The rotation is rejected. */
+  SIMPLE,
+
+  /**
+   * The shape is moved by the offsets of the Super Rotation System until it
+   * fits, and the rotation is only rejected if none of them works.
+   */
+  SUPER
+};
+
+/**
+ * The wall kick offsets of the Super Rotation System. There is a table for
+ * the shapes with a bounding box of size 3 (J, L, S, T and Z), one for the
+ * shapes with a bounding box of size 4 (I) and an empty one for all other
+ * shapes, which are never kicked.
+ *
+ * The orientation of a shape is numbered as in the Super Rotation System: 0
+ * is the spawn orientation, in which the blocks lean towards the top of the
+ * bounding box, 1, 2 and 3 follow it clockwise. Because the shapes are not
+ * required to start in the spawn orientation, the orientation is derived
+ * from the block positions with \c getOrientation.
+ *
+ * The tables are static, so looking up the kicks does not allocate.
+ */
+class KickTable
+{
+  public:
+    /**
+     * The maximal number of kick offsets that are tried for a rotation.
+     */
+    static const int MAX_KICKS = 5;
+
+    /**
+     * Returns the table for the shapes with the given bounding box size.
+     *
+     * \param bbox_size The size of the bounding box of the shape.
+     *
+     * \return The table for the shapes with the given bounding box size.
+     */
+    static const KickTable& forBBoxSize(int bbox_size);
+
+    /**
+     * Returns the orientation of a shape, derived from the side of the
+     * bounding box its blocks lean towards. Shapes whose blocks are centered
+     * in their bounding box are in orientation 0.
+     *
+     * \param positions The relative positions of the blocks of the shape.
+     * \param count The number of elements in \a positions.
+     * \param bbox_size The size of the bounding box of the shape.
+     *
+     * \return The orientation of the shape, in the range [0, 3].
+     */
+    static int getOrientation(const PackedCoords* positions, std::size_t count,
+                              int bbox_size);
+
+    /**
+     * Returns the number of kick offsets in this table for every rotation.
+     *
+     * \return The number of kick offsets in this table for every rotation.
+     */
+    int getKickCount() const;
+
+    /**
+     * Returns the kick offsets of a rotation in the order they should be
+     * tried. The first one is always (0, 0).
+     *
+     * \param from The orientation of the shape before the rotation.
+     * \param clockwise Whether the shape is rotated to the right.
+     *
+     * \return An array of \c getKickCount() offsets.
+     */
+    const PackedCoords* getKicks(int from, bool clockwise) const;
+
+  private:
+    typedef PackedCoords Kicks[4][2][MAX_KICKS];
+
+    KickTable(const Kicks* kicks, int kick_count);
+
+    const Kicks* m_kicks;
+    int m_kick_count;
+};
+
+} // namespace tetris.
+
+#endif // KICKTABLE_H
@@ -0,0 +1,166 @@
+/*
+ * Copyright (C) 2016 Daniel Becker <beckerdaniel.dani@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MATCH_H
+#define MATCH_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "VectorEnvironment.h"
+
+namespace tetris {
+
+class DefaultGame;
+class GameBoard;
+class GameEventListener;
+class Shape;
+
+/**
+ * A versus match of two players, each playing a \c DefaultGame on a board of
+ * its own. When a player clears rows, the opponent receives garbage lines:
+ * rows that are pushed in from the bottom of the board, filled except for
+ * one hole. A player loses when their game is over or when garbage would
+ * push blocks off the top of their board.
+ */
+class Match
+{
+  public:
+    /**
+     * Constructs a match. Both players get the same sequence of shapes.
+     *
+     * \param height The height of the boards.
+     * \param width The width of the boards.
+     * \param shapes The prototypes of the shapes that can appear.
+     * \param seed The seed of the shape sequence and the garbage holes.
+     *
+     * \throws std::invalid_argument if the boards or the shapes are invalid.
+     */
+    Match(int height, int width, std::vector<std::shared_ptr<Shape>> shapes,
+          unsigned int seed);
+    Match(const Match& other) = delete;
+    virtual ~Match();
+
+    /**
+     * Returns the game of a player.
+     *
+     * \param player The index of the player, 0 or 1.
+     *
+     * \return The game of the player.
+     */
+    std::shared_ptr<const DefaultGame> getGame(int player) const;
+
+    /**
+     * Returns the game board of a player.
+     *
+     * \param player The index of the player, 0 or 1.
+     *
+     * \return The game board of the player.
+     */
+    const GameBoard& getGameBoard(int player) const;
+
+    /**
+     * Registers a listener for the events of the game of a player.
+     *
+     * \param player The index of the player, 0 or 1.
+     * \param listener The listener to register.
+     */
+    void addEventListener(int player,
+                          std::shared_ptr<GameEventListener> listener);
+
+    /**
+     * Unregisters a listener from the game of a player.
+     *
+     * \param player The index of the player, 0 or 1.
+     * \param listener The listener to remove.
+     */
+    void removeEventListener(int player,
+                             std::shared_ptr<GameEventListener> listener);
+
+    /**
+     * Applies an action of a player the way \c VectorEnvironment does:
+     * \c Action::DROP drops the current shape, \c Action::NONE advances the
+     * game once, and the other actions move or rotate the shape. Cleared rows
+     * are sent to the opponent as garbage. Nothing happens once the match is
+     * over.
+     *
+     * \param player The index of the player, 0 or 1.
+     * \param action The action to apply.
+     *
+     * \return The number of rows the player cleared.
+     */
+    int apply(int player, Action action);
+
+    /**
+     * Advances both games once, as the gravity would.
+     */
+    void advance();
+
+    /**
+     * Pushes garbage lines in from the bottom of the board of a player. All
+     * lines of one call have their hole in the same column. The player loses
+     * if the garbage would push filled cells off the top of the board, or if
+     * the current shape cannot be lifted out of it.
+     *
+     * \param player The index of the player, 0 or 1.
+     * \param lines The number of garbage lines.
+     */
+    void addGarbage(int player, int lines);
+
+    /**
+     * Returns the number of garbage lines sent for clearing \a rows rows at
+     * once: one less than the number of rows, except that four rows send
+     * four lines.
+     *
+     * \param rows The number of rows cleared at once.
+     *
+     * \return The number of garbage lines to send.
+     */
+    static int getGarbageLines(int rows);
+
+    /**
+     * Checks whether a player has lost.
+     *
+     * \param player The index of the player, 0 or 1.
+     *
+     * \return \c true if the player has lost; \c false otherwise.
+     */
+    bool hasLost(int player) const;
+
+    /**
+     * Checks whether the match is over, that is, a player has lost.
+     *
+     * \return \c true if the match is over; \c false otherwise.
+     */
+    bool isOver() const;
+
+    /**
+     * Returns the winner of a match that is over.
+     *
+     * \return The index of the winner, or -1 if the match is not over or both
+     *         players lost at the same time.
+     */
+    int getWinner() const;
+
+  private:
+    class PIMPL;
+    PIMPL* m_pimpl;
+};
+
+} // namespace tetris.
+
+#endif // MATCH_H
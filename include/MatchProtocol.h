@@ -0,0 +1,252 @@
+/*
+ * Copyright (C) 2016 Daniel Becker <beckerdaniel.dani@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MATCHPROTOCOL_H
+#define MATCHPROTOCOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "PackedCoords.h"
+#include "VectorEnvironment.h"
+
+namespace tetris {
+
+class Board;
+class GameBoard;
+
+/**
+ * The types of the messages exchanged between a \c MatchServer and its
+ * clients.
+ *
+ * Every message is a frame of a 16-bit little-endian length, followed by
+ * the one-byte type and the payload; the length counts the type and the
+ * payload. All integers are little-endian.
+ */
+enum class MessageType : std::uint8_t {
+  /** Client to server, no payload: asks to be paired with an opponent. */
+  JOIN = 1,
+
+  /** Client to server: one \c Action byte. \c Action::NONE soft-drops. */
+  INPUT = 2,
+
+  /**
+   * Client to server: asks to watch the match with the 32-bit id of the
+   * payload. The server answers with a \c KEYFRAME of both players and then
+   * streams their \c DELTA messages; see \c SpectatorEncoder.
+   */
+  SPECTATE = 3,
+
+  /**
+   * Server to client: a match has started. The payload is the 32-bit match
+   * id, the player index of the client (0 or 1), and the 16-bit height and
+   * width of the boards.
+   */
+  MATCH_START = 16,
+
+  /** Server to client: the state of one player, see \c MatchState. */
+  STATE = 17,
+
+  /**
+   * Server to client: the match is over. The payload is the index of the
+   * winner, or 255 if neither player won.
+   */
+  MATCH_END = 18,
+
+  /** Server to spectator: the whole state of one player. */
+  KEYFRAME = 19,
+
+  /** Server to spectator: the changes of one player in one tick. */
+  DELTA = 20
+};
+
+/**
+ * The largest length of a frame, which counts its type and its payload.
+ */
+const std::size_t MAX_FRAME_LENGTH = 0xFFFF;
+
+/**
+ * Returns the length of the largest \c MessageType::STATE or
+ * \c MessageType::KEYFRAME frame for boards of the given size, so that a
+ * server can check up front that its frames fit in \c MAX_FRAME_LENGTH.
+ * The \c MessageType::DELTA frames are never longer than the keyframes.
+ *
+ * \param height The height of the boards.
+ * \param width The width of the boards.
+ * \param shape_blocks The largest number of blocks of a shape.
+ *
+ * \return The length of the largest state frame.
+ */
+std::size_t getMaxStateFrameLength(int height, int width,
+                                   std::size_t shape_blocks);
+
+/**
+ * The state of one player of a match as sent in a \c MessageType::STATE
+ * message: the player index, a 32-bit sequence number that increases with
+ * every state of that player, a game over flag, the number of blocks of the
+ * current shape and their absolute positions as pairs of 16-bit signed
+ * coordinates, the 16-bit height and width of the board, and the cells of
+ * the board row by row, eight cells to a byte with the leftmost cell in the
+ * lowest bit.
+ */
+struct MatchState
+{
+  int player = 0;
+  std::uint32_t sequence = 0;
+  bool game_over = false;
+  std::vector<PackedCoords> shape;
+  int height = 0;
+  int width = 0;
+  std::vector<std::uint8_t> cells;
+
+  /**
+   * Checks whether a cell of the board is filled.
+   */
+  bool isFilled(int vertical, int horizontal) const {
+    return (cells[vertical * getRowBytes() + horizontal / 8]
+            >> (horizontal % 8)) & 1u;
+  }
+
+  /**
+   * Returns the number of bytes a row of the board takes up.
+   */
+  int getRowBytes() const {
+    return (width + 7) / 8;
+  }
+};
+
+/**
+ * Appends a \c MessageType::JOIN frame to \a out.
+ */
+void encodeJoin(std::vector<std::uint8_t>& out);
+
+/**
+ * Appends a \c MessageType::INPUT frame to \a out.
+ */
+void encodeInput(std::vector<std::uint8_t>& out, Action action);
+
+/**
+ * Appends a \c MessageType::MATCH_START frame to \a out.
+ */
+void encodeMatchStart(std::vector<std::uint8_t>& out, std::uint32_t match_id,
+                      int player, int height, int width);
+
+/**
+ * Appends a \c MessageType::STATE frame with the state of \a game_board to
+ * \a out.
+ */
+void encodeState(std::vector<std::uint8_t>& out, int player,
+                 std::uint32_t sequence, bool game_over,
+                 const GameBoard& game_board);
+
+/**
+ * Appends the cells of \a board to \a out row by row, eight cells to a byte
+ * with the leftmost cell in the lowest bit.
+ */
+void encodeCells(std::vector<std::uint8_t>& out, const Board& board);
+
+/**
+ * Appends the header of a frame of the given type to \a out. The payload is
+ * to be appended after it and the frame completed with \c endFrame.
+ *
+ * \return The offset of the frame in \a out, to be passed to \c endFrame.
+ */
+std::size_t beginFrame(std::vector<std::uint8_t>& out, MessageType type);
+
+/**
+ * Fills in the length of a frame started with \c beginFrame, once its whole
+ * payload has been appended.
+ *
+ * \throws std::invalid_argument if the payload is too large for a frame.
+ */
+void endFrame(std::vector<std::uint8_t>& out, std::size_t start);
+
+/**
+ * Appends a \c MessageType::MATCH_END frame to \a out.
+ *
+ * \param winner The index of the winner, or -1 if neither player won.
+ */
+void encodeMatchEnd(std::vector<std::uint8_t>& out, int winner);
+
+/**
+ * Decodes the payload of a \c MessageType::STATE frame.
+ *
+ * \return \c true if the payload was well-formed; \c false otherwise.
+ */
+bool decodeState(const std::vector<std::uint8_t>& payload, MatchState& state);
+
+/**
+ * Splits a byte stream into frames. Bytes are appended as they arrive and
+ * complete frames are taken out with \c next.
+ *
+ * Frames longer than the limit given to the constructor are rejected as
+ * soon as their length has arrived, so a reader whose frames are taken out
+ * after every append never buffers more than the appended bytes and one
+ * frame.
+ */
+class FrameReader
+{
+  public:
+    /**
+     * The size of the length field that precedes every frame.
+     */
+    static const std::size_t HEADER_SIZE = 2;
+
+    /**
+     * Constructs an empty reader.
+     *
+     * \param max_frame_length The largest length of a frame that is
+     *        accepted, at most \c MAX_FRAME_LENGTH.
+     */
+    explicit FrameReader(std::size_t max_frame_length = MAX_FRAME_LENGTH);
+
+    /**
+     * Appends received bytes.
+     *
+     * \param data The received bytes.
+     * \param size The number of received bytes.
+     */
+    void append(const std::uint8_t* data, std::size_t size);
+
+    /**
+     * Takes the next complete frame out of the buffer.
+     *
+     * \param type Set to the type of the frame.
+     * \param payload Set to the payload of the frame.
+     *
+     * \return \c true if a frame was taken; \c false if there is no complete
+     *         frame in the buffer yet.
+     *
+     * \throws std::invalid_argument if the stream is malformed or the
+     *         frame is longer than the limit of this reader.
+     */
+    bool next(MessageType& type, std::vector<std::uint8_t>& payload);
+
+    /**
+     * Returns the number of buffered bytes that have not been taken yet.
+     */
+    std::size_t getBufferedSize() const;
+
+  private:
+    std::vector<std::uint8_t> m_buffer;
+    std::size_t m_offset;
+    std::size_t m_max_frame_length;
+};
+
+} // namespace tetris.
+
+#endif // MATCHPROTOCOL_H
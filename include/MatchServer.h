@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) 2016 Daniel Becker <beckerdaniel.dani@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MATCHSERVER_H
+#define MATCHSERVER_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace tetris {
+
+class Shape;
+
+/**
+ * A server that hosts many versus matches (see \c Match) for clients
+ * connecting over TCP. The clients speak the binary protocol described by
+ * \c MessageType: a client sends \c MessageType::JOIN, is paired with the
+ * next client that does the same, and then sends its inputs. After every
+ * change the server sends the states of both players to both clients, and
+ * when the match is over, who won. A client that disconnects during a match
+ * loses it. After a match, a client can join again.
+ *
+ * A client can also watch a match in progress by sending
+ * \c MessageType::SPECTATE. Spectators receive the compact tick stream of
+ * \c SpectatorEncoder instead of the whole boards, encoded once per update for
+ * all of them.
+ *
+ * All connections are served by a single thread running an epoll event loop
+ * with non-blocking sockets, so one server can hold thousands of matches. The
+ * server is only available on Linux.
+ */
+class MatchServer
+{
+  public:
+    /**
+     * Constructs a server and starts listening.
+     *
+     * \param height The height of the boards of the matches.
+     * \param width The width of the boards of the matches.
+     * \param shapes The prototypes of the shapes that can appear.
+     * \param seed The seed of the first match; every match gets the next one.
+     * \param port The port to listen on; 0 picks a free port.
+     * \param gravity_ms The interval in milliseconds at which all matches are
+     *        advanced; 0 disables the gravity, so the games only advance on
+     *        the inputs of the players.
+     * \param loopback_only Whether to accept connections from the local
+     *        machine only.
+     *
+     * \throws std::invalid_argument if the parameters are invalid or the
+     *         state of the boards does not fit in a frame.
+     * \throws std::system_error if the socket cannot be set up.
+     */
+    MatchServer(int height, int width,
+                std::vector<std::shared_ptr<Shape>> shapes,
+                unsigned int seed, std::uint16_t port = 0, int gravity_ms = 0,
+                bool loopback_only = true);
+    MatchServer(const MatchServer& other) = delete;
+    virtual ~MatchServer();
+
+    /**
+     * Returns the port the server listens on.
+     *
+     * \return The port the server listens on.
+     */
+    std::uint16_t getPort() const;
+
+    /**
+     * Serves the clients until \c stop is called.
+     */
+    void run();
+
+    /**
+     * Waits for and handles the events that arrive within \a timeout_ms
+     * milliseconds once, for callers that run their own loop.
+     *
+     * \param timeout_ms The maximal time to wait; -1 waits indefinitely.
+     */
+    void poll(int timeout_ms);
+
+    /**
+     * Makes \c run return. This is the only function that may be called from
+     * another thread while the server is running.
+     */
+    void stop();
+
+    /**
+     * Returns the number of connected clients.
+     *
+     * \return The number of connected clients.
+     */
+    int getClientCount() const;
+
+    /**
+     * Returns the number of matches in progress.
+     *
+     * \return The number of matches in progress.
+     */
+    int getMatchCount() const;
+
+  private:
+    class PIMPL;
+    PIMPL* m_pimpl;
+};
+
+} // namespace tetris.
+
+#endif // MATCHSERVER_H
@@ -0,0 +1,184 @@
+/*
+ * Copyright (C) 2016 Daniel Becker <beckerdaniel.dani@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MONTECARLOSEARCH_H
+#define MONTECARLOSEARCH_H
+
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "PlacementSearch.h"
+
+namespace tetris {
+
+class Game;
+class GameBoard;
+class Shape;
+
+/**
+ * The settings of a \c MonteCarloSearch.
+ */
+struct MonteCarloConfig
+{
+  /**
+   * The weights that rate the boards at the end of the rollouts and that
+   * guide the playouts.
+   */
+  SearchWeights weights {};
+
+  /** The number of pieces a rollout places after leaving the tree. */
+  int rollout_depth = 6;
+
+  /**
+   * The probability that a playout places a piece at random instead of
+   * where it is rated best.
+   */
+  double playout_randomness = 0.1;
+
+  /** The exploration constant of UCB, in the units of the ratings. */
+  double exploration = 2.0;
+
+  /**
+   * The rating a thread assumes for a node while its rollout through the
+   * node is running, so that the other threads of the tree explore other
+   * nodes.
+   */
+  double virtual_loss = 5.0;
+
+  /** The rating of a game that was lost. */
+  double loss_value = -500.0;
+
+  /**
+   * The number of visits the most visited placement of the current piece
+   * needs for the search to choose it. With fewer, the placement rated best
+   * right after it is made is chosen, as a few rollouts are a worse guide
+   * than the rating.
+   */
+  unsigned int min_visits = 40;
+
+  /** The number of threads to search on; 0 uses every hardware thread. */
+  unsigned int threads = 1;
+
+  /**
+   * The number of independent trees the threads are split between (root
+   * parallelism); the threads of a tree share it (tree parallelism). It is
+   * at most the number of threads.
+   */
+  unsigned int trees = 1;
+
+  /** The number of nodes of all the trees together. */
+  std::size_t max_nodes = 1u << 20;
+
+  /** The seed of the random pieces and playouts. */
+  unsigned int seed = 1;
+};
+
+/**
+ * A Monte Carlo tree search over the placements of the pieces, as an
+ * alternative to \c PlacementSearch. Pieces that are not known from the
+ * preview are drawn at random from the shapes of the game, so below them
+ * the tree has a branch for each shape. Leaves are rated by a rollout that
+ * places a few more random pieces where a cheap greedy policy puts them,
+ * played on a copy of the board that takes one word per row.
+ *
+ * The nodes are taken from an arena that is allocated once, and nodes
+ * keep no board; the threads replay the placements on the way down
+ * instead. Searching beyond the arena goes on with rollouts from the
+ * leaves.
+ *
+ * A search object is not thread-safe itself; the threads it uses are its
+ * own.
+ */
+class MonteCarloSearch
+{
+  public:
+    /**
+     * Constructs a search.
+     *
+     * \param shapes The shapes the unknown pieces are drawn from, with
+     *        equal probability each.
+     * \param config The settings of the search.
+     *
+     * \throws std::invalid_argument if there are no shapes, a shape is
+     *         \c nullptr or a setting is out of range.
+     */
+    MonteCarloSearch(std::vector<std::shared_ptr<Shape>> shapes,
+                     MonteCarloConfig config = MonteCarloConfig());
+    MonteCarloSearch(const MonteCarloSearch& other) = delete;
+    virtual ~MonteCarloSearch();
+
+    /**
+     * Searches for the placement of the current shape of a game board that
+     * was visited the most. Until one was visited
+     * \c MonteCarloConfig::min_visits times, the placement rated best right
+     * after it is made is chosen.
+     *
+     * \param game_board The game board with the current shape.
+     * \param preview The shapes that come after the current one, in order.
+     * \param budget The time the search may take.
+     * \param max_rollouts The number of rollouts after which the search
+     *        stops even if there is time left; 0 for no limit.
+     *
+     * \return The best placement found; it is not valid if the current
+     *         shape cannot be placed.
+     *
+     * \throws std::invalid_argument if the board is wider than 64 cells or
+     *         there is no current shape.
+     */
+    Placement search(const GameBoard& game_board,
+                     const std::vector<std::shared_ptr<const Shape>>& preview,
+                     std::chrono::microseconds budget,
+                     std::size_t max_rollouts = 0);
+
+    /**
+     * Searches for the placement of the current shape of a game and plays
+     * it with \c playPlacement.
+     *
+     * \param game The game to play.
+     * \param budget The time the search may take.
+     * \param max_rollouts The number of rollouts after which the search
+     *        stops even if there is time left; 0 for no limit.
+     *
+     * \return \c true if a piece was placed; \c false if the game is over or
+     *         the current shape cannot be placed.
+     */
+    bool play(Game& game, std::chrono::microseconds budget,
+              std::size_t max_rollouts = 0);
+
+    /**
+     * Returns the number of rollouts of the last search.
+     *
+     * \return The number of rollouts of the last search.
+     */
+    std::size_t getRolloutCount() const;
+
+    /**
+     * Returns the number of nodes of the trees of the last search.
+     *
+     * \return The number of nodes of the last search.
+     */
+    std::size_t getNodeCount() const;
+
+  private:
+    class PIMPL;
+    PIMPL* m_pimpl;
+};
+
+} // namespace tetris.
+
+#endif // MONTECARLOSEARCH_H
@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2016 Daniel Becker <beckerdaniel.dani@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PACKEDCOORDS_H
+#define PACKEDCOORDS_H
+
+#include <cstdint>
+#include <type_traits>
+
+#include "Coords.h"
+
+namespace tetris {
+
+/**
+ * A compact coordinate pair for the internals of the engine. Unlike
+ * \c Coords, it has no virtual functions and is trivially copyable, so it
+ * fits in a single register, arrays of it can be copied with \c memcpy, and
+ * it can be used in constant expressions.
+ *
+ * Both coordinates are stored in 16 bits, so they must be in the range
+ * [-32768, 32767]. It converts implicitly to and from \c Coords.
+ */
+struct PackedCoords
+{
+  std::int16_t vertical;
+  std::int16_t horizontal;
+
+  constexpr PackedCoords() : vertical(0), horizontal(0) {}
+
+  constexpr PackedCoords(int p_vertical, int p_horizontal)
+    : vertical(static_cast<std::int16_t>(p_vertical)),
+      horizontal(static_cast<std::int16_t>(p_horizontal)) {}
+
+  PackedCoords(const Coords& coords)
+    : vertical(static_cast<std::int16_t>(coords.getVertical())),
+      horizontal(static_cast<std::int16_t>(coords.getHorizontal())) {}
+
+  operator Coords() const {
+    return Coords(vertical, horizontal);
+  }
+
+  constexpr int getVertical() const {
+    return vertical;
+  }
+
+  constexpr int getHorizontal() const {
+    return horizontal;
+  }
+};
+
+static_assert(sizeof(PackedCoords) == 4,
+              "PackedCoords must fit in 32 bits.");
+static_assert(std::is_trivially_copyable<PackedCoords>::value,
+              "PackedCoords must be trivially copyable.");
+
+constexpr bool operator==(PackedCoords lhs, PackedCoords rhs) {
+  return lhs.vertical == rhs.vertical && lhs.horizontal == rhs.horizontal;
+}
+
+constexpr bool operator!=(PackedCoords lhs, PackedCoords rhs) {
+  return !(lhs == rhs);
+}
+
+constexpr PackedCoords operator+(PackedCoords lhs, PackedCoords rhs) {
+  return PackedCoords(lhs.vertical + rhs.vertical,
+                      lhs.horizontal + rhs.horizontal);
+}
+
+constexpr PackedCoords operator-(PackedCoords lhs, PackedCoords rhs) {
+  return PackedCoords(lhs.vertical - rhs.vertical,
+                      lhs.horizontal - rhs.horizontal);
+}
+
+} // namespace tetris.
+
+#endif // PACKEDCOORDS_H
@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2016 Daniel Becker <beckerdaniel.dani@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PERFECTCLEARSOLVER_H
+#define PERFECTCLEARSOLVER_H
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "Coords.h"
+
+namespace tetris {
+
+class Board;
+class Shape;
+
+/**
+ * A placement of a sequence that clears the field.
+ */
+struct PerfectClearStep
+{
+  /**
+   * Whether hold is used before placing: the current shape goes on hold and
+   * the shape that was on hold, or the next one if none was, is placed.
+   */
+  bool hold = false;
+
+  /** The number of right turns from the orientation in the queue. */
+  int rotation = 0;
+
+  /** The position of the placed shape on the board. */
+  Coords position {0, 0};
+};
+
+/**
+ * Searches for a sequence of placements of the queued pieces that clears
+ * the bottom rows of a board completely, for perfect clears. The rows above
+ * them must be empty.
+ *
+ * The field is kept as a single 64-bit word, so its width times its height
+ * may be at most 64. The placements are found by moving and rotating the
+ * pieces on the field without kicks, so they include slides and turns
+ * under overhangs, and pieces must end up inside the field.
+ *
+ * The search is a depth-first search over the field states with these
+ * prunings:
+ *  - The empty cells must be a multiple of the size of the pieces and no
+ *    more than the remaining pieces can fill.
+ *  - The same holds for the empty cells between the columns that are
+ *    already full, as pieces cannot cross them.
+ *  - Colouring the columns of the field in stripes, the remaining pieces
+ *    must be able to make up for the difference of the empty cells of the
+ *    two colours; an upright I covers four more cells of one colour than
+ *    of the other and an upright T, L or J two more. Cells keep their
+ *    columns when rows are cleared, so this holds for placements that
+ *    clear rows before the last piece.
+ *  - Placements that give the same field, such as the turns of a
+ *    symmetric piece, are searched once, and so is holding a piece of the
+ *    same kind as the current one.
+ *  - The states that were found to fail are remembered, so that the
+ *    placement orders that lead to the same state are searched once.
+ */
+class PerfectClearSolver
+{
+  public:
+    /**
+     * Constructs a solver.
+     *
+     * \param height The number of rows at the bottom of the board to clear.
+     * \param use_hold Whether the sequences may use hold.
+     *
+     * \throws std::invalid_argument if \a height is not positive.
+     */
+    explicit PerfectClearSolver(int height = 4, bool use_hold = true);
+    PerfectClearSolver(const PerfectClearSolver& other) = delete;
+    virtual ~PerfectClearSolver();
+
+    /**
+     * Searches for a perfect clear.
+     *
+     * \param board The board whose bottom rows are to be cleared.
+     * \param queue The current shape followed by the next ones, in the
+     *        orientations they appear in.
+     * \param solution Set to the placements of a perfect clear if there is
+     *        one.
+     *
+     * \return \c true if a perfect clear was found; \c false otherwise.
+     *
+     * \throws std::invalid_argument if the field does not fit in 64 bits,
+     *         is higher than the board, the queue is longer than 32 pieces
+     *         or has \c nullptr elements.
+     */
+    bool solve(const Board& board,
+               const std::vector<std::shared_ptr<const Shape>>& queue,
+               std::vector<PerfectClearStep>& solution);
+
+    /**
+     * Returns the number of field states the last search visited.
+     *
+     * \return The number of states visited by the last search.
+     */
+    std::size_t getVisitedCount() const;
+
+  private:
+    class PIMPL;
+    PIMPL* m_pimpl;
+};
+
+} // namespace tetris.
+
+#endif // PERFECTCLEARSOLVER_H
@@ -0,0 +1,152 @@
+/*
+ * Copyright (C) 2016 Daniel Becker <beckerdaniel.dani@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef PLACEMENTFORMS_H
+#define PLACEMENTFORMS_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "CollisionMask.h"
+
+namespace tetris {
+
+class GameBoard;
+class Shape;
+struct Placement;
+struct SearchWeights;
+
+/** \cond INTERNAL */
+
+/*
+ * The pieces and boards that PlacementSearch and MonteCarloSearch search
+ * with. A board is a vector of rows of one word each, the top row first, and
+ * pieces are dropped onto it straight from above.
+ */
+namespace detail {
+
+typedef CollisionMask::Row Row;
+
+int popcount(Row bits);
+
+// The cells of a shape in one orientation, moved to the top left corner.
+struct Form
+{
+  int height = 0;
+  int width = 0;
+  Row rows[CollisionMask::MAX_ROWS] = {};
+
+  // The lowest row of the form in every column.
+  int bottoms[CollisionMask::MAX_WIDTH] = {};
+
+  explicit Form(const CollisionMask& mask) : height(mask.getHeight()) {
+    Row all = 0;
+    for (int i = 0; i < height; ++i) {
+      rows[i] = mask.getRow(i);
+      all |= rows[i];
+      for (int c = 0; c < CollisionMask::MAX_WIDTH; ++c) {
+        if ((rows[i] >> c) & 1u) { bottoms[c] = i; }
+      }
+    }
+    while (width < CollisionMask::MAX_WIDTH && (all >> width) != 0) {
+      ++width;
+    }
+  }
+
+  bool operator==(const Form& other) const {
+    return height == other.height
+           && std::equal(rows, rows + height, other.rows);
+  }
+
+  bool operator<(const Form& other) const {
+    if (height != other.height) { return height < other.height; }
+    return std::lexicographical_compare(rows, rows + height,
+                                        other.rows, other.rows + height);
+  }
+};
+
+// A kind of piece: its distinct orientations, in a fixed order that does not
+// depend on how the shape it was seen as was turned.
+struct PieceKind
+{
+  std::vector<Form> forms;
+  std::uint64_t hash = 0; // The same in every search, unlike the index.
+};
+
+// The four orientations of a given shape, in the order turning it to the
+// right reaches them, and the kind of piece it is.
+struct ShapeForms
+{
+  std::vector<CollisionMask> masks;
+  std::vector<Form> forms;
+  int kind = -1;
+};
+
+// Works out the forms once for every kind and rotation of shapes and
+// numbers the kinds of pieces in the order they are first seen.
+class FormCache
+{
+  public:
+    // The cached forms are not moved by later calls.
+    const ShapeForms& formsOf(const Shape& shape);
+
+    const PieceKind& getKind(int kind) const {
+      return m_kinds[kind];
+    }
+
+    std::size_t getKindCount() const {
+      return m_kinds.size();
+    }
+
+  private:
+    std::vector<PieceKind> m_kinds {};
+    std::unordered_map<std::uint32_t, ShapeForms> m_forms {};
+};
+
+// Checks whether the current shape can be turned and moved sideways to the
+// placement from where it is, turning it once to the left for rotation 3.
+bool isReachable(const GameBoard& game_board, const ShapeForms& current,
+                 const Placement& placement);
+
+// Sets the first filled row of every column, or the height of the board if
+// the column is empty; pieces dropped from above stop on it.
+void findTops(const std::vector<Row>& rows, Row full, int width, int* tops);
+
+// Returns the top row of a form dropped at the given column, or -1 if it
+// would stick out of the top of the board.
+int getDropTop(const Form& form, const int* tops, int left);
+
+void place(std::vector<Row>& rows, const Form& form, int left, int top);
+
+// Removes the full rows, returning their number.
+int clearLines(std::vector<Row>& rows, Row full);
+
+// Rates the board by the heights, holes and bumpiness of its columns and
+// the lines cleared on the way to it.
+double rate(const std::vector<Row>& rows, int width, int lines,
+            const SearchWeights& weights);
+
+} // namespace detail.
+
+/** \endcond */
+
+} // namespace tetris.
+
+#endif // PLACEMENTFORMS_H
@@ -0,0 +1,210 @@
+/*
+ * Copyright (C) 2016 Daniel Becker <beckerdaniel.dani@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PLACEMENTSEARCH_H
+#define PLACEMENTSEARCH_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace tetris {
+
+class Game;
+class GameBoard;
+class Shape;
+class TranspositionTable;
+
+/**
+ * The weights of the features that \c PlacementSearch rates boards by. The
+ * defaults are the well-known weights of the aggregate height, cleared
+ * lines, holes and bumpiness heuristic.
+ */
+struct SearchWeights
+{
+  /** The weight of the sum of the heights of the columns. */
+  double height = -0.510066;
+
+  /** The weight of the number of lines cleared along the way. */
+  double lines = 0.760666;
+
+  /** The weight of the number of empty cells below filled ones. */
+  double holes = -0.35663;
+
+  /** The weight of the sum of the height differences of adjacent columns. */
+  double bumpiness = -0.184483;
+};
+
+/**
+ * A move found by \c PlacementSearch: which piece to place and where. To
+ * play it, hold first if \c hold is set, turn the piece \c rotation times to
+ * the right, or once to the left if \c rotation is 3, move it to the
+ * horizontal coordinate \c horizontal and drop it. The search only returns
+ * placements whose turns and moves are not blocked.
+ */
+struct Placement
+{
+  /** Whether a move was found at all; \c false if every placement loses. */
+  bool valid = false;
+
+  /** Whether to place the hold piece, putting the current one on hold. */
+  bool hold = false;
+
+  /**
+   * The number of clockwise rotations, 0 to 3; 3 is played as one
+   * counterclockwise rotation.
+   */
+  int rotation = 0;
+
+  /** The horizontal coordinate of the position of the rotated shape. */
+  int horizontal = 0;
+
+  /** The rating of the best sequence of placements starting with this one. */
+  double value = 0.0;
+};
+
+/**
+ * Plays a placement on a game as the bots do: turns the current shape, moves
+ * it to the horizontal coordinate of the placement and drops it. A turn or a
+ * move that leaves the shape where it was ends the attempt before the drop,
+ * so that a placement that cannot be reached does not stall the caller.
+ *
+ * \param game The game to play on.
+ * \param placement The placement to play. Placements that use the hold piece
+ *        cannot be played, as \c Game has no hold.
+ *
+ * \return The number of lines the drop cleared, or -1 if the placement could
+ *         not be played and nothing was dropped.
+ */
+int playPlacement(Game& game, const Placement& placement);
+
+/**
+ * A lookahead search over the placements of the current shape and the shapes
+ * in the preview, for bots that have to answer within a tick of the game
+ * flow. It deepens the search one piece at a time until the deadline and
+ * returns the best placement of the deepest search it has completed.
+ *
+ * The tree of placements is kept between calls. If the board is the same as
+ * in the previous call, or it is the result of one of the placements
+ * searched, the matching subtree is reused, so the work of earlier ticks is
+ * not thrown away while the shape falls or after it has been placed. Pieces
+ * are dropped straight down from above; the returned placement is checked to
+ * be reachable from where the current shape is, by rotating in place and
+ * moving sideways.
+ *
+ * The boards may be at most 64 cells wide.
+ */
+class PlacementSearch
+{
+  public:
+    /**
+     * Constructs a search.
+     *
+     * \param weights The weights to rate the boards with.
+     * \param beam_width The number of best rated placements that are searched
+     *        deeper below the first piece; 0 searches all of them. Every
+     *        placement of the first piece is always searched.
+     */
+    explicit PlacementSearch(SearchWeights weights = SearchWeights(),
+                             int beam_width = 8);
+    PlacementSearch(const PlacementSearch& other) = delete;
+    virtual ~PlacementSearch();
+
+    /**
+     * Searches for the best placement of the current shape of a game board.
+     * The first level of the search is always completed, even if it takes
+     * longer than \a budget.
+     *
+     * \param game_board The game board with the current shape.
+     * \param preview The shapes that come after the current one, in order.
+     * \param hold The shape on hold, or \c nullptr if there is none, in which
+     *        case holding is not considered.
+     * \param budget The time the search may take.
+     *
+     * \return The best placement found.
+     *
+     * \throws std::invalid_argument if the board is wider than 64 cells or
+     *         there is no current shape.
+     */
+    Placement search(const GameBoard& game_board,
+                     const std::vector<std::shared_ptr<const Shape>>& preview,
+                     std::shared_ptr<const Shape> hold,
+                     std::chrono::microseconds budget);
+
+    /**
+     * Changes the weights to rate the boards with. The search tree of the
+     * previous searches is dropped, as its values were rated with the old
+     * weights.
+     *
+     * \param weights The new weights.
+     */
+    void setWeights(SearchWeights weights);
+
+    /**
+     * Sets a table to memoize the values of the states below the first
+     * piece in, which pays off when the same board is reached by placing the
+     * pieces in another order, and when the table is shared by the searches
+     * of several threads. The searches sharing a table must use the same
+     * weights and beam width. The owner of the table decides when to call
+     * \c TranspositionTable::newSearch.
+     *
+     * \param table The table to use, or \c nullptr to use none.
+     */
+    void setTranspositionTable(std::shared_ptr<TranspositionTable> table);
+
+    /**
+     * Returns the number of pieces the last search looked ahead, including
+     * the current one.
+     *
+     * \return The depth of the last completed search.
+     */
+    int getCompletedDepth() const;
+
+    /**
+     * Returns the number of placements in the search tree.
+     *
+     * \return The number of nodes of the search tree.
+     */
+    std::size_t getNodeCount() const;
+
+    /**
+     * Returns whether the last search started from a subtree of the previous
+     * one.
+     *
+     * \return \c true if the tree was reused; \c false if it was rebuilt.
+     */
+    bool wasTreeReused() const;
+
+    /**
+     * Returns a percentile of the time \c search took over the recent calls,
+     * to check the bot against the tick of the game.
+     *
+     * \param percentile The percentile in the range [0, 100].
+     *
+     * \return The latency in microseconds, or 0 if there was no search yet.
+     */
+    std::int64_t getLatencyPercentile(double percentile) const;
+
+  private:
+    class PIMPL;
+    PIMPL* m_pimpl;
+};
+
+} // namespace tetris.
+
+#endif // PLACEMENTSEARCH_H
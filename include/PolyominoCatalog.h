@@ -0,0 +1,274 @@
+/*
+ * Copyright (C) 2016 Daniel Becker <beckerdaniel.dani@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef POLYOMINOCATALOG_H
+#define POLYOMINOCATALOG_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "CollisionMask.h"
+#include "KickTable.h"
+#include "PackedCoords.h"
+#include "Shape.h"
+
+namespace tetris {
+
+class Block;
+
+/**
+ * Which polyominoes of an order are told apart.
+ */
+enum class PolyominoSet {
+  /** Polyominoes that are the same after turning or mirroring are one. */
+  FREE,
+
+  /**
+   * Polyominoes that are the same after turning are one; mirror images are
+   * different. These are the pieces of the usual games, for example the
+   * seven tetrominoes.
+   */
+  ONE_SIDED,
+
+  /** Every rotation of a polyomino is a piece of its own. */
+  FIXED
+};
+
+/**
+ * All polyominoes of an order, as shape kinds of the \c ShapeCatalog with
+ * the tables the game needs for them precomputed: the positions of their
+ * blocks in the four rotations, their collision masks and their wall kick
+ * orientations.
+ *
+ * The polyominoes are enumerated by growing those of the previous order by
+ * a block and keeping one of each class, identified by its canonical form:
+ * the smallest list of sorted positions over the rotations (and mirror
+ * images) of the polyomino. Each piece is placed in its bounding box lying
+ * flat, with its longer side horizontal and the side with the most blocks
+ * at the bottom, so the one-sided tetrominoes come out as the kinds of the
+ * seven \c Tetromino classes.
+ *
+ * Enumerating the large orders takes a while, so a catalog can be cached in
+ * a file. The cache holds the positions of every piece in a compact binary
+ * format; loading it checks that the file holds exactly the pieces
+ * enumerating would give, in the same order, then registers them in the
+ * \c ShapeCatalog and rebuilds the other tables, which takes time linear in
+ * the size of the file. A rejected file registers nothing.
+ */
+class PolyominoCatalog
+{
+  public:
+    /**
+     * A polyomino of the catalog.
+     */
+    class Piece
+    {
+      public:
+        /**
+         * Returns the kind of this piece in the \c ShapeCatalog.
+         *
+         * \return The kind of this piece.
+         */
+        ShapeKind getKind() const { return m_kind; }
+
+        /**
+         * Returns the rotation of the kind this piece spawns in.
+         *
+         * \return The rotation in the \c ShapeCatalog, in the range [0, 3].
+         */
+        int getRotation() const { return m_rotation; }
+
+        /**
+         * Returns the size of the side of the bounding box of this piece.
+         *
+         * \return The size of the side of the bounding box.
+         */
+        int getBBoxSize() const { return m_bbox_size; }
+
+        /**
+         * Returns the number of blocks of this piece, which is the order of
+         * the catalog.
+         *
+         * \return The number of blocks of this piece.
+         */
+        std::size_t getBlockCount() const { return m_block_count; }
+
+        /**
+         * Returns the positions of the blocks after turning this piece from
+         * its spawn rotation.
+         *
+         * \param turns The number of right turns, taken modulo 4.
+         *
+         * \return An array of \c getBlockCount() positions.
+         */
+        const PackedCoords* getPositions(int turns) const;
+
+        /**
+         * Returns whether the piece fits in a \c CollisionMask in all its
+         * rotations, which is the case up to the order
+         * \c CollisionMask::MAX_ROWS.
+         *
+         * \return \c true if \c getMask can be called.
+         */
+        bool hasMasks() const { return m_has_masks; }
+
+        /**
+         * Returns the collision mask of a rotation of this piece.
+         *
+         * \param turns The number of right turns, taken modulo 4.
+         *
+         * \return The collision mask of the rotation; an empty one if
+         *         \c hasMasks is \c false.
+         */
+        const CollisionMask& getMask(int turns) const {
+          return m_masks[(m_rotation + turns) & 3];
+        }
+
+        /**
+         * Returns the orientation of a rotation of this piece as
+         * \c KickTable::getOrientation would derive it.
+         *
+         * \param turns The number of right turns, taken modulo 4.
+         *
+         * \return The orientation for the kick table, in the range [0, 3].
+         */
+        int getOrientation(int turns) const {
+          return m_orientations[(m_rotation + turns) & 3];
+        }
+
+        /**
+         * Returns the table of wall kicks of this piece.
+         *
+         * \return The kick table for the bounding box of this piece.
+         */
+        const KickTable& getKickTable() const { return *m_kick_table; }
+
+      private:
+        friend class PolyominoCatalog;
+
+        ShapeKind m_kind = 0;
+        int m_rotation = 0;
+        int m_bbox_size = 0;
+        std::size_t m_block_count = 0;
+        bool m_has_masks = false;
+        CollisionMask m_masks[4];
+        int m_orientations[4] = {};
+        const KickTable* m_kick_table = nullptr;
+    };
+
+    /**
+     * The largest order that can be enumerated. The catalog of the
+     * one-sided polyominoes of this order takes about half of the kinds the
+     * \c ShapeCatalog can hold.
+     */
+    static const int MAX_ORDER = 11;
+
+    /**
+     * Constructs the catalog of the polyominoes of an order, loading it from
+     * a cache file if there is one.
+     *
+     * \param order The number of blocks of the polyominoes.
+     * \param set Which polyominoes are told apart.
+     * \param cache_path The path of the cache file, or an empty string for
+     *        no cache. A missing cache, or one of another order or set, is
+     *        (re)written after enumerating the polyominoes.
+     *
+     * \throws std::invalid_argument if the order is out of the range
+     *         [1, \c MAX_ORDER] or the cache file is not the complete
+     *         polyomino catalog of its order and set.
+     * \throws std::runtime_error if the \c ShapeCatalog is full or the cache
+     *         cannot be written.
+     */
+    PolyominoCatalog(int order, PolyominoSet set,
+                     const std::string& cache_path = "");
+    PolyominoCatalog(const PolyominoCatalog& other) = delete;
+    virtual ~PolyominoCatalog();
+
+    /**
+     * Returns the number of blocks of the polyominoes.
+     *
+     * \return The order of the catalog.
+     */
+    int getOrder() const;
+
+    /**
+     * Returns which polyominoes are told apart.
+     *
+     * \return The set of the catalog.
+     */
+    PolyominoSet getSet() const;
+
+    /**
+     * Returns whether the catalog was loaded from its cache file rather than
+     * enumerated.
+     *
+     * \return \c true if the catalog was loaded from the cache.
+     */
+    bool isFromCache() const;
+
+    /**
+     * Returns the number of polyominoes in the catalog.
+     *
+     * \return The number of pieces.
+     */
+    std::size_t getPieceCount() const;
+
+    /**
+     * Returns a piece of the catalog. The pieces are sorted by their
+     * canonical forms, so their order does not depend on the cache.
+     *
+     * \param index The index of the piece.
+     *
+     * \return The piece.
+     *
+     * \throws std::invalid_argument if the index is out of range.
+     */
+    const Piece& getPiece(std::size_t index) const;
+
+    /**
+     * Creates the shapes of all pieces in their spawn rotations, to be
+     * passed to a game.
+     *
+     * \param block The block that is cloned for every block of the shapes.
+     *
+     * \return The shapes, in the order of the pieces.
+     *
+     * \throws std::invalid_argument if the block is \c nullptr.
+     */
+    std::vector<std::shared_ptr<Shape>> createShapes(
+                                        std::shared_ptr<Block> block) const;
+
+    /**
+     * Writes the catalog to a cache file. The file is written next to its
+     * final path and then moved there, so a reader never sees half of it.
+     *
+     * \param path The path of the cache file.
+     *
+     * \throws std::runtime_error if the file cannot be written.
+     */
+    void save(const std::string& path) const;
+
+  private:
+    class PIMPL;
+    PIMPL* m_pimpl;
+};
+
+} // namespace tetris.
+
+#endif // POLYOMINOCATALOG_H
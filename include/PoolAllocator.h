@@ -0,0 +1,177 @@
+/*
+ * Copyright (C) 2016 Daniel Becker <beckerdaniel.dani@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef POOLALLOCATOR_H
+#define POOLALLOCATOR_H
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace tetris {
+
+/**
+ * A memory pool for the small objects of a game (shapes, their blocks and
+ * internal data). Memory is carved out of large chunks and freed objects are
+ * kept on free lists sorted by size, so that once the pool has warmed up,
+ * allocating a shape does not reach the global allocator.
+ *
+ * The memory of the whole pool can be reclaimed at once with \c reset when no
+ * object allocated from it is alive any more, for example when a new game is
+ * started.
+ *
+ * A \c PoolResource is not thread-safe. A pool must only be used by the
+ * thread that owns it: every game, search or tuner worker that runs on its
+ * own thread gets its own pool, and a pool may be handed to another thread
+ * only when no other thread uses it any more, including through the shapes
+ * and blocks allocated from it, whose destruction returns memory to it. It
+ * is normally used through \c PoolAllocator.
+ */
+class PoolResource
+{
+  public:
+    /**
+     * Constructs an empty pool.
+     *
+     * \param chunk_size The size of the chunks that memory is carved from.
+     */
+    explicit PoolResource(std::size_t chunk_size = 64 * 1024);
+    PoolResource(const PoolResource& other) = delete;
+    virtual ~PoolResource();
+
+    /**
+     * Allocates \a size bytes aligned for any fundamental type.
+     *
+     * \param size The number of bytes to allocate.
+     *
+     * \return A pointer to the allocated memory.
+     */
+    void* allocate(std::size_t size);
+
+    /**
+     * Returns memory obtained from \c allocate to the pool.
+     *
+     * \param ptr The pointer returned by \c allocate.
+     * \param size The size that was passed to \c allocate.
+     */
+    void deallocate(void* ptr, std::size_t size);
+
+    /**
+     * Returns the number of allocations that have not been deallocated yet.
+     *
+     * \return The number of live allocations.
+     */
+    std::size_t getLiveAllocations() const;
+
+    /**
+     * Returns the number of bytes obtained from the global allocator.
+     *
+     * \return The number of bytes reserved by this pool.
+     */
+    std::size_t getReservedBytes() const;
+
+    /**
+     * Reclaims all memory of the pool in bulk, keeping the chunks for reuse.
+     * This is only done if there are no live allocations.
+     *
+     * \return \c true if the memory was reclaimed; \c false if there were
+     *         live allocations.
+     */
+    bool reset();
+
+  private:
+    struct FreeNode {
+      FreeNode* next;
+    };
+
+    static const std::size_t GRANULARITY = 16;
+    static const std::size_t MAX_POOLED_SIZE = 512;
+
+    std::size_t m_chunk_size;
+    std::vector<FreeNode*> m_free_lists;
+    std::vector<char*> m_chunks;
+    std::size_t m_current_chunk;
+    char* m_cursor;
+    char* m_end;
+    std::size_t m_live;
+};
+
+/**
+ * A standard allocator that allocates from a \c PoolResource, to be used with
+ * \c std::allocate_shared and the standard containers. An allocator without a
+ * pool uses the global \c operator \c new, so code that takes a
+ * \c PoolAllocator works the same whether or not a pool is provided.
+ *
+ * The allocator shares the ownership of its pool, so the pool outlives every
+ * object allocated from it.
+ */
+template <typename T>
+class PoolAllocator
+{
+  public:
+    typedef T value_type;
+
+    PoolAllocator() : m_resource(nullptr) {}
+
+    PoolAllocator(std::shared_ptr<PoolResource> resource)
+      : m_resource(resource) {}
+
+    template <typename U>
+    PoolAllocator(const PoolAllocator<U>& other)
+      : m_resource(other.getResource()) {}
+
+    /**
+     * Returns the pool of this allocator.
+     *
+     * \return The pool of this allocator or \c nullptr if the global
+     *         allocator is used.
+     */
+    const std::shared_ptr<PoolResource>& getResource() const {
+      return m_resource;
+    }
+
+    T* allocate(std::size_t n) {
+      if (m_resource == nullptr) {
+        return static_cast<T*>(::operator new(n * sizeof(T)));
+      }
+      return static_cast<T*>(m_resource->allocate(n * sizeof(T)));
+    }
+
+    void deallocate(T* ptr, std::size_t n) {
+      if (m_resource == nullptr) {
+        ::operator delete(ptr);
+      } else {
+        m_resource->deallocate(ptr, n * sizeof(T));
+      }
+    }
+
+  private:
+    std::shared_ptr<PoolResource> m_resource;
+};
+
+template <typename T, typename U>
+bool operator==(const PoolAllocator<T>& lhs, const PoolAllocator<U>& rhs) {
+  return lhs.getResource() == rhs.getResource();
+}
+
+template <typename T, typename U>
+bool operator!=(const PoolAllocator<T>& lhs, const PoolAllocator<U>& rhs) {
+  return !(lhs == rhs);
+}
+
+} // namespace tetris.
+
+#endif // POOLALLOCATOR_H
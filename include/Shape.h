@@ -18,16 +18,25 @@
 #ifndef SHAPE_H
 #define SHAPE_H
 
+#include <cstdint>
 #include <memory>
 #include <vector>
 
 #include "Coords.h"
 #include "Drawing.h"
+#include "PackedCoords.h"
+#include "PoolAllocator.h"
 
 namespace tetris {
 
 class Block;
 
+/**
+ * The kind of a shape, which is its index in the \c ShapeCatalog. Shapes of
+ * the same kind have the same block positions up to rotation.
+ */
+typedef std::uint16_t ShapeKind;
+
 /**
  * A base interface for all shapes (tetrominoes or other shapes).
  */
@@ -82,6 +91,22 @@ class Shape : public Drawable<Shape>
       return get(coords.getVertical(), coords.getHorizontal());
     }
 
+    /**
+     * Returns a non-owning pointer to the \c Block object that is at the given
+     * position, or \c nullptr if there is none. Unlike \c get, this does not
+     * copy a \c std::shared_ptr. The pointer is only valid as long as this
+     * \c Shape is alive.
+     *
+     * \param vertical The vertical position of the \c Block object.
+     * \param horizontal The horizontal position of the \c Block object.
+     *
+     * \return A non-owning pointer to the \c Block object that is at the given
+     *         position.
+     */
+    virtual const Block* peek(int vertical, int horizontal) const {
+      return get(vertical, horizontal).get();
+    }
+
     /**
      * Returns a container of pointers to the blocks contained by this \c Shape.
      * There are no guarantees as to the order of the blocks.
@@ -100,6 +125,47 @@ class Shape : public Drawable<Shape>
      */
     virtual std::vector<Coords> getBlockPositions() const = 0;
 
+    /**
+     * Returns the number of blocks in this \c Shape.
+     *
+     * \return The number of blocks in this \c Shape.
+     */
+    virtual std::size_t getBlockCount() const {
+      return getBlockPositions().size();
+    }
+
+    /**
+     * Writes the relative positions of the blocks in this \c Shape to \a out
+     * in the same order as \c getBlockPositions, without allocating memory.
+     * The default implementation converts the result of
+     * \c getBlockPositions.
+     *
+     * \param out An array of at least \c getBlockCount() elements.
+     */
+    virtual void getPackedBlockPositions(PackedCoords* out) const {
+      for (const Coords& c : getBlockPositions()) {
+        *out++ = c;
+      }
+    }
+
+    /**
+     * Returns the kind of this \c Shape, so that it can be told which shape
+     * it is without comparing block positions.
+     *
+     * \return The kind of this \c Shape in the \c ShapeCatalog.
+     */
+    virtual ShapeKind getKind() const = 0;
+
+    /**
+     * Returns the rotation state of this \c Shape: the number of right
+     * turns that take rotation 0 of its kind in the \c ShapeCatalog to the
+     * current orientation. Together with the kind it tells the block
+     * positions.
+     *
+     * \return The rotation state in the range [0, 3].
+     */
+    virtual int getRotation() const = 0;
+
     /**
      * Rotates the \c Shape to the right with 90 degrees.
      */
@@ -116,6 +182,27 @@ class Shape : public Drawable<Shape>
      * \return A polymorphic copy of this \c Shape.
      */
     virtual std::shared_ptr<Shape> clone() const = 0;
+
+    /**
+     * Returns a polymorphic copy of this \c Shape whose memory, including that
+     * of its blocks, is obtained from \a allocator. The default
+     * implementation ignores \a allocator and calls \c clone().
+     *
+     * An override copies exactly its own class. A subclass of it that only
+     * overrides \c clone() inherits this function, and copying such an
+     * object as the base class would slice it. So the overrides check the
+     * dynamic type and fall back to \c clone() for subclasses, which are
+     * copied correctly but without the pool.
+     *
+     * \param allocator The allocator to use for the copy.
+     *
+     * \return A polymorphic copy of this \c Shape.
+     */
+    virtual std::shared_ptr<Shape> clone(const PoolAllocator<char>& allocator)
+                                                                        const {
+      (void) allocator;
+      return clone();
+    }
 };
 
 } // namespace tetris.
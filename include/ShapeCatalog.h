@@ -0,0 +1,178 @@
+/*
+ * Copyright (C) 2016 Daniel Becker <beckerdaniel.dani@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SHAPECATALOG_H
+#define SHAPECATALOG_H
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "PackedCoords.h"
+#include "Shape.h"
+
+namespace tetris {
+
+class Block;
+
+/**
+ * The global catalog of the kinds of shapes. A kind is a set of block
+ * positions in a bounding box, up to rotation, and its \c ShapeKind is its
+ * index in the catalog, so looking up a kind is an array index.
+ *
+ * The seven tetrominoes are always the first kinds, with the constants
+ * below. Every other shape gets a new kind the first time a \c BasicShape
+ * is constructed with its positions, and keeps it for the lifetime of the
+ * program. Entries are never changed or removed once added, so they can be
+ * read from any thread without locking.
+ *
+ * Classifying positions, which every \c BasicShape constructed from
+ * positions does, takes a global lock even when the kind is known, and the
+ * catalog only grows, up to \c MAX_KINDS kinds. Programs that generate
+ * shapes, such as \c PolyominoCatalog, should classify every kind once and
+ * construct the shapes from the entries with \c create or the \c BasicShape
+ * constructor that takes an entry, which need no lock.
+ */
+class ShapeCatalog
+{
+  private:
+    class Registry;
+
+  public:
+    /**
+     * A kind of shape in the catalog: its bounding box and the positions of
+     * its blocks in the four rotations.
+     */
+    class Entry
+    {
+      public:
+        /**
+         * Returns the kind of this entry.
+         *
+         * \return The index of this entry in the catalog.
+         */
+        ShapeKind getKind() const;
+
+        /**
+         * Returns the size of the side of the bounding box of the shape.
+         *
+         * \return The size of the side of the bounding box.
+         */
+        int getBBoxSize() const;
+
+        /**
+         * Returns the number of blocks of the shape.
+         *
+         * \return The number of blocks of the shape.
+         */
+        std::size_t getBlockCount() const;
+
+        /**
+         * Returns the positions of the blocks after turning the shape to the
+         * right from the orientation of rotation 0. The blocks are in the
+         * same order in every rotation.
+         *
+         * \param rotation The number of right turns in the range [0, 3].
+         *
+         * \return An array of \c getBlockCount() positions.
+         */
+        const PackedCoords* getPositions(int rotation) const;
+
+      private:
+        friend class ShapeCatalog::Registry;
+
+        ShapeKind m_kind = 0;
+        int m_bbox_size = 0;
+        std::vector<PackedCoords> m_positions[4];
+    };
+
+    /** The kinds of the tetrominoes. */
+    static const ShapeKind I = 0;
+    static const ShapeKind J = 1;
+    static const ShapeKind L = 2;
+    static const ShapeKind O = 3;
+    static const ShapeKind S = 4;
+    static const ShapeKind T = 5;
+    static const ShapeKind Z = 6;
+
+    /** The largest number of kinds the catalog can hold. */
+    static const std::size_t MAX_KINDS = 65536;
+
+    /**
+     * Returns the entry of a kind.
+     *
+     * \param kind The kind to look up.
+     *
+     * \return The entry of \a kind.
+     *
+     * \throws std::invalid_argument if there is no such kind.
+     */
+    static const Entry& get(ShapeKind kind);
+
+    /**
+     * Returns the number of kinds in the catalog.
+     *
+     * \return The number of kinds in the catalog.
+     */
+    static std::size_t getKindCount();
+
+    /**
+     * Finds the kind of a shape, adding a new one if no shape of its kind
+     * was seen before. It takes the lock of the catalog.
+     *
+     * \param bbox_size The size of the bounding box of the shape.
+     * \param positions The positions of the blocks of the shape.
+     * \param count The number of elements in \a positions.
+     * \param rotation Set to the number of right turns that take the shape
+     *        from rotation 0 of its kind to the given positions. For
+     *        symmetric shapes it is the smallest such number.
+     *
+     * \return The kind of the shape.
+     *
+     * \throws std::invalid_argument if a position is outside the bounding
+     *         box or appears more than once.
+     * \throws std::runtime_error if the shape is of a new kind and the
+     *         catalog already holds \c MAX_KINDS kinds.
+     */
+    static ShapeKind classify(int bbox_size, const PackedCoords* positions,
+                              std::size_t count, int& rotation);
+
+    /**
+     * Creates a shape of a kind in the catalog. The blocks are clones of
+     * \a block.
+     *
+     * \param kind The kind of the shape.
+     * \param block The block to clone the blocks of the shape from.
+     * \param rotation The number of right turns from rotation 0.
+     *
+     * \return The new shape.
+     *
+     * \throws std::invalid_argument if there is no such kind or \a block is
+     *         \c nullptr.
+     */
+    static std::shared_ptr<Shape> create(ShapeKind kind,
+                                         std::shared_ptr<Block> block,
+                                         int rotation = 0);
+
+  private:
+    ShapeCatalog() = delete;
+
+    static Registry& registry();
+};
+
+} // namespace tetris.
+
+#endif // SHAPECATALOG_H
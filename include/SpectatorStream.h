@@ -0,0 +1,230 @@
+/*
+ * Copyright (C) 2016 Daniel Becker <beckerdaniel.dani@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SPECTATORSTREAM_H
+#define SPECTATORSTREAM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "GameEvents.h"
+#include "MatchProtocol.h"
+#include "PackedCoords.h"
+
+namespace tetris {
+
+class Block;
+class Board;
+class Game;
+
+/**
+ * Encodes the progress of a game for spectators as a stream of ticks. Most
+ * ticks are \c MessageType::DELTA messages that only hold what has changed:
+ * the moves of the current shape, the locked shapes and the cleared rows,
+ * which is a few bytes per tick. Every \a keyframe_interval ticks, and
+ * whenever the board has changed in a way the events do not describe (for
+ * example garbage or a new game), a \c MessageType::KEYFRAME with the whole
+ * state is sent instead, from which a \c SpectatorDecoder can join the
+ * stream.
+ *
+ * The encoder learns about the board changes as a \c GameEventListener, so
+ * it must be registered with the game it encodes. A tick is encoded once and
+ * the same bytes can be sent to any number of spectators.
+ *
+ * A delta is made of operations, each a byte followed by its arguments,
+ * where numbers are LEB128 varints, zigzag encoded if signed:
+ *  - \c MOVE (1): the shape moved by the vertical and horizontal distance,
+ *  - \c SHAPE (2): a new shape or rotation: the position, the number of
+ *    blocks and their offsets from the position as signed bytes,
+ *  - \c NO_SHAPE (3): there is no current shape,
+ *  - \c LOCK (4): the current shape was locked on the board,
+ *  - \c CELLS (5): the number of cells and their positions that were filled,
+ *  - \c CLEAR (6): the number of rows and their indices that were removed,
+ *    as in \c GameEventListener::onRowsCleared,
+ *  - \c GAME_OVER (7): the game is over.
+ *
+ * The payload of a delta is the player index and the low 16 bits of the
+ * tick, followed by the operations. The payload of a keyframe is the player
+ * index, the 32-bit tick, the game over flag, the 16-bit height and width of
+ * the board, the number of blocks of the current shape (0 if there is none),
+ * its position as two 16-bit signed integers and the block offsets as in
+ * \c SHAPE if there is a shape, then the cells as in \c encodeCells.
+ */
+class SpectatorEncoder : public GameEventListener
+{
+  public:
+    /**
+     * Constructs an encoder. The first tick will be a keyframe.
+     *
+     * The encoder only refers to \a game, as the game usually owns it as a
+     * listener; it must be removed from the listeners of the game before
+     * the game is destroyed.
+     *
+     * \param game The game to encode.
+     * \param player The player index to put in the messages.
+     * \param keyframe_interval The number of ticks after which a keyframe is
+     *        sent even if deltas would do.
+     *
+     * \throws std::invalid_argument if \a keyframe_interval is not
+     *         positive.
+     */
+    SpectatorEncoder(const Game& game, int player = 0,
+                     int keyframe_interval = 256);
+    SpectatorEncoder(const SpectatorEncoder& other) = delete;
+    virtual ~SpectatorEncoder();
+
+    /**
+     * Ends the current tick and appends its message to \a out.
+     *
+     * \param out The buffer to append the frame to.
+     *
+     * \return \c true if the message is a keyframe; \c false if it is a
+     *         delta.
+     */
+    bool encodeTick(std::vector<std::uint8_t>& out);
+
+    /**
+     * Makes the next tick a keyframe, for example because a new spectator
+     * has joined.
+     */
+    void requestKeyframe();
+
+    /**
+     * Returns the number of ticks encoded so far.
+     *
+     * \return The number of the last tick.
+     */
+    std::uint32_t getTick() const;
+
+    virtual void onShapeLocked(const PackedCoords* positions,
+                               std::size_t count) override;
+    virtual void onRowsCleared(const int* rows, std::size_t count) override;
+    virtual void onGameOver() override;
+
+  private:
+    void encodeKeyframe(std::vector<std::uint8_t>& out);
+
+    // Appends the operations that bring the shape of the decoder up to date.
+    void syncShape();
+
+    // Notes whether the board has changed as much as the events explain.
+    void checkModifications(std::uint64_t expected);
+
+    const Game& m_game;
+    int m_player;
+    int m_keyframe_interval;
+    std::uint32_t m_tick;
+    int m_ticks_since_keyframe;
+    bool m_keyframe_needed;
+    std::uint64_t m_modifications;
+    std::vector<std::uint8_t> m_ops;
+
+    // The shape as the decoder knows it.
+    bool m_has_shape;
+    PackedCoords m_shape_pos;
+    std::vector<PackedCoords> m_shape;
+    std::vector<PackedCoords> m_scratch;
+};
+
+/**
+ * Reconstructs the state of a player from the messages of a
+ * \c SpectatorEncoder: a keyframe followed by the deltas of the subsequent
+ * ticks.
+ */
+class SpectatorDecoder
+{
+  public:
+    SpectatorDecoder();
+    SpectatorDecoder(const SpectatorDecoder& other) = delete;
+    virtual ~SpectatorDecoder();
+
+    /**
+     * Applies a message. A delta can only be applied on top of the state of
+     * the previous tick; if one is missing, or the message is malformed, the
+     * state is dropped until the next keyframe.
+     *
+     * \param type The type of the message; other types than
+     *        \c MessageType::KEYFRAME and \c MessageType::DELTA are ignored.
+     * \param payload The payload of the message.
+     *
+     * \return \c true if the state is up to date with the message;
+     *         \c false if the decoder is waiting for a keyframe.
+     */
+    bool apply(MessageType type, const std::vector<std::uint8_t>& payload);
+
+    /**
+     * Checks whether the decoder has a state, that is, whether it has
+     * received a keyframe and all deltas since.
+     *
+     * \return \c true if there is a state; \c false otherwise.
+     */
+    bool hasState() const;
+
+    /**
+     * Returns the player index of the stream.
+     *
+     * \return The player index of the stream.
+     */
+    int getPlayer() const;
+
+    /**
+     * Returns the tick of the state.
+     *
+     * \return The tick of the state.
+     */
+    std::uint32_t getTick() const;
+
+    /**
+     * Checks whether the game is over.
+     *
+     * \return \c true if the game is over; \c false otherwise.
+     */
+    bool isGameOver() const;
+
+    /**
+     * Returns the board with the locked blocks, or \c nullptr if there is no
+     * state.
+     *
+     * \return The board of the state.
+     */
+    std::shared_ptr<const Board> getBoard() const;
+
+    /**
+     * Returns the absolute positions of the blocks of the current shape.
+     *
+     * \return The positions of the current shape, empty if there is none.
+     */
+    std::vector<PackedCoords> getShapePositions() const;
+
+  private:
+    bool applyKeyframe(const std::vector<std::uint8_t>& payload);
+    bool applyDelta(const std::vector<std::uint8_t>& payload);
+
+    std::shared_ptr<Board> m_board;
+    std::shared_ptr<Block> m_block;
+    int m_player;
+    std::uint32_t m_tick;
+    bool m_game_over;
+    bool m_has_shape;
+    PackedCoords m_shape_pos;
+    std::vector<PackedCoords> m_shape;
+};
+
+} // namespace tetris.
+
+#endif // SPECTATORSTREAM_H
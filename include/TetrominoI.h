@@ -43,9 +43,12 @@ class TetrominoI : public BasicShape
 
     virtual ~TetrominoI();
     TetrominoI(const TetrominoI& other);
+    TetrominoI(const TetrominoI& other, const PoolAllocator<char>& allocator);
     TetrominoI(TetrominoI&& other);
 
     virtual std::shared_ptr<Shape> clone() const override;
+    virtual std::shared_ptr<Shape> clone(const PoolAllocator<char>& allocator)
+                                                              const override;
   protected:
   private:
 };
@@ -43,9 +43,12 @@ class TetrominoJ : public BasicShape
 
     virtual ~TetrominoJ();
     TetrominoJ(const TetrominoJ& other);
+    TetrominoJ(const TetrominoJ& other, const PoolAllocator<char>& allocator);
     TetrominoJ(TetrominoJ&& other);
 
     virtual std::shared_ptr<Shape> clone() const override;
+    virtual std::shared_ptr<Shape> clone(const PoolAllocator<char>& allocator)
+                                                              const override;
   protected:
   private:
 };
@@ -43,9 +43,12 @@ class TetrominoL : public BasicShape
 
     virtual ~TetrominoL();
     TetrominoL(const TetrominoL& other);
+    TetrominoL(const TetrominoL& other, const PoolAllocator<char>& allocator);
     TetrominoL(TetrominoL&& other);
 
     virtual std::shared_ptr<Shape> clone() const override;
+    virtual std::shared_ptr<Shape> clone(const PoolAllocator<char>& allocator)
+                                                              const override;
   protected:
   private:
 };
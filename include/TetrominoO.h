@@ -44,9 +44,12 @@ class TetrominoO : public BasicShape
     virtual ~TetrominoO();
 
     TetrominoO(const TetrominoO& other);
+    TetrominoO(const TetrominoO& other, const PoolAllocator<char>& allocator);
     TetrominoO(TetrominoO&& other);
 
     virtual std::shared_ptr<Shape> clone() const override;
+    virtual std::shared_ptr<Shape> clone(const PoolAllocator<char>& allocator)
+                                                              const override;
   protected:
   private:
 };
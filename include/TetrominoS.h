@@ -43,9 +43,12 @@ class TetrominoS : public BasicShape
 
     virtual ~TetrominoS();
     TetrominoS(const TetrominoS& other);
+    TetrominoS(const TetrominoS& other, const PoolAllocator<char>& allocator);
     TetrominoS(TetrominoS&& other);
 
     virtual std::shared_ptr<Shape> clone() const override;
+    virtual std::shared_ptr<Shape> clone(const PoolAllocator<char>& allocator)
+                                                              const override;
   protected:
   private:
 };
@@ -44,9 +44,12 @@ class TetrominoT : public BasicShape
     virtual ~TetrominoT();
 
     TetrominoT(const TetrominoT& other);
+    TetrominoT(const TetrominoT& other, const PoolAllocator<char>& allocator);
     TetrominoT(TetrominoT&& other);
 
     virtual std::shared_ptr<Shape> clone() const override;
+    virtual std::shared_ptr<Shape> clone(const PoolAllocator<char>& allocator)
+                                                              const override;
   protected:
   private:
 };
@@ -43,9 +43,12 @@ class TetrominoZ : public BasicShape
 
     virtual ~TetrominoZ();
     TetrominoZ(const TetrominoZ& other);
+    TetrominoZ(const TetrominoZ& other, const PoolAllocator<char>& allocator);
     TetrominoZ(TetrominoZ&& other);
 
     virtual std::shared_ptr<Shape> clone() const override;
+    virtual std::shared_ptr<Shape> clone(const PoolAllocator<char>& allocator)
+                                                              const override;
   protected:
   private:
 };
@@ -0,0 +1,193 @@
+/*
+ * Copyright (C) 2016 Daniel Becker <beckerdaniel.dani@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TRANSPOSITIONTABLE_H
+#define TRANSPOSITIONTABLE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace tetris {
+
+class Board;
+
+/**
+ * A fixed-size hash table of search results keyed by a 64-bit hash of the
+ * searched state, shared by any number of search threads without locks.
+ *
+ * Every entry is two 64-bit words, the packed result and the key XOR-ed with
+ * it, written and read with relaxed atomics. A reader only accepts an entry
+ * if the two words XOR back to its key, so an entry torn by concurrent
+ * writers is seen as a miss rather than as a wrong result. Entries are
+ * grouped in buckets of one cache line. When a bucket is full, the entry
+ * searched least deep is replaced, counting entries of earlier searches (see
+ * \c newSearch) as shallower the older they are.
+ */
+class TranspositionTable
+{
+  public:
+    /**
+     * What the value of an entry means, for searches that cut off.
+     */
+    enum class Bound : std::uint8_t {
+      EXACT = 1, ///< The value is exact.
+      LOWER = 2, ///< The real value is at least the value.
+      UPPER = 3  ///< The real value is at most the value.
+    };
+
+    /**
+     * A search result.
+     */
+    struct Entry {
+      float value = 0.0f;
+      std::uint16_t move = 0; ///< The best move, encoded by the search.
+      std::uint8_t depth = 0; ///< How deep the value was searched.
+      Bound bound = Bound::EXACT;
+    };
+
+    /**
+     * Counters for tuning the size of the table. Every thread counts in one
+     * of several stripes, which are only summed up by \c getStats, so the
+     * counters are only approximate while searches run.
+     */
+    struct Stats {
+      std::uint64_t probes = 0;
+      std::uint64_t hits = 0;
+      std::uint64_t stores = 0;
+      /** Stores that evicted the entry of another state. */
+      std::uint64_t collisions = 0;
+    };
+
+    /**
+     * Constructs an empty table.
+     *
+     * \param memory_budget The number of bytes the table may take. It is
+     *        rounded down to a power of two buckets, but is at least one
+     *        bucket.
+     */
+    explicit TranspositionTable(std::size_t memory_budget = 16u << 20);
+    TranspositionTable(const TranspositionTable& other) = delete;
+    virtual ~TranspositionTable();
+
+    /**
+     * Looks up the result for a state.
+     *
+     * \param key The hash of the state.
+     * \param entry Set to the result if there is one.
+     *
+     * \return \c true if a result was found; \c false otherwise.
+     */
+    bool probe(std::uint64_t key, Entry& entry) const;
+
+    /**
+     * Stores the result for a state. A result of the same state that was
+     * searched deeper in the current search is kept instead.
+     *
+     * \param key The hash of the state.
+     * \param entry The result.
+     */
+    void store(std::uint64_t key, const Entry& entry);
+
+    /**
+     * Starts a new search, so that the entries of the previous ones are
+     * replaced first.
+     */
+    void newSearch();
+
+    /**
+     * Removes all entries and resets the counters. Unlike the other
+     * functions, it must not be called while the table is used.
+     */
+    void clear();
+
+    /**
+     * Returns the number of entries the table holds.
+     *
+     * \return The capacity of the table.
+     */
+    std::size_t getCapacity() const;
+
+    /**
+     * Returns the counters of the table.
+     *
+     * \return The counters of the table.
+     */
+    Stats getStats() const;
+
+    /**
+     * Mixes \a value into \a hash, to build the keys of states from their
+     * parts.
+     *
+     * \param hash The hash so far.
+     * \param value The value to mix in.
+     *
+     * \return The new hash.
+     */
+    static std::uint64_t combine(std::uint64_t hash, std::uint64_t value);
+
+    /**
+     * Hashes the filled cells of a board.
+     *
+     * \param board The board to hash.
+     *
+     * \return The hash of the cells of \a board.
+     */
+    static std::uint64_t hash(const Board& board);
+
+  private:
+    static const int BUCKET_SIZE = 4;
+
+    static const std::size_t CACHE_LINE = 64;
+
+    static const int STRIPE_COUNT = 16;
+
+    struct Slot {
+      std::atomic<std::uint64_t> check; // The key XOR data.
+      std::atomic<std::uint64_t> data;
+    };
+
+    // One cache line; the storage is aligned by hand, as C++11 new does not
+    // align to more than the fundamental alignment.
+    struct Bucket {
+      Slot slots[BUCKET_SIZE];
+    };
+
+    // The counters of the threads of one stripe, in one cache line.
+    struct Counters {
+      std::atomic<std::uint64_t> probes;
+      std::atomic<std::uint64_t> hits;
+      std::atomic<std::uint64_t> stores;
+      std::atomic<std::uint64_t> collisions;
+      char padding[CACHE_LINE - 4 * sizeof(std::atomic<std::uint64_t>)];
+    };
+
+    Counters& getCounters() const;
+
+    std::unique_ptr<char[]> m_storage;
+    Bucket* m_buckets;
+    std::size_t m_mask;
+    std::atomic<std::uint8_t> m_generation;
+
+    // In the aligned storage after the buckets, so that the threads do not
+    // share the cache lines they count in.
+    Counters* m_counters;
+};
+
+} // namespace tetris.
+
+#endif // TRANSPOSITIONTABLE_H
@@ -0,0 +1,152 @@
+/*
+ * Copyright (C) 2016 Daniel Becker <beckerdaniel.dani@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef VECTORENVIRONMENT_H
+#define VECTORENVIRONMENT_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace tetris {
+
+class Game;
+class Shape;
+
+/**
+ * The actions that can be taken in a single step of a \c VectorEnvironment.
+ */
+enum class Action : std::uint8_t {
+  NONE = 0,
+  MOVE_LEFT,
+  MOVE_RIGHT,
+  ROTATE_LEFT,
+  ROTATE_RIGHT,
+  DROP
+};
+
+/**
+ * A batch of independent headless games that are stepped together, intended
+ * for training reinforcement learning agents.
+ *
+ * Every environment is a \c DefaultGame on a \c DefaultGameBoard with its own
+ * seeded random engine. A step applies one \c Action to every environment and
+ * then, unless the action was \c Action::DROP, advances the game once as the
+ * gravity would. Environments whose game is over are restarted automatically
+ * at the end of the step; the observation written for them is the first
+ * observation of the new game.
+ *
+ * Observations are written directly into buffers owned by the caller, so
+ * stepping does not allocate memory for them. The environments are split into
+ * contiguous chunks that are stepped on a fixed set of worker threads.
+ */
+class VectorEnvironment
+{
+  public:
+    /**
+     * Constructs \a count environments and starts a new game in each of them.
+     *
+     * \param count The number of environments.
+     * \param height The height of the board of each environment.
+     * \param width The width of the board of each environment.
+     * \param shapes The prototypes of the shapes that can appear in the games.
+     * \param seed The seed of the first environment; environment \c i is
+     *        seeded with <tt>seed + i</tt>.
+     * \param threads The number of threads to step the environments on. If it
+     *        is zero, the number of hardware threads is used.
+     */
+    VectorEnvironment(int count, int height, int width,
+                      std::vector<std::shared_ptr<Shape>> shapes,
+                      unsigned int seed, unsigned int threads = 0u);
+    VectorEnvironment(const VectorEnvironment& other) = delete;
+    virtual ~VectorEnvironment();
+
+    /**
+     * Returns the number of environments.
+     *
+     * \return The number of environments.
+     */
+    int getCount() const;
+
+    /**
+     * Returns the number of bytes that one environment occupies in the
+     * observation buffer of \c step, that is, the number of cells on the board.
+     *
+     * \return The size of one observation in bytes.
+     */
+    int getObservationSize() const;
+
+    /**
+     * Returns the number of bytes that one environment occupies in the
+     * observation buffer of \c stepPacked. Every row starts at a byte
+     * boundary.
+     *
+     * \return The size of one bit-packed observation in bytes.
+     */
+    int getPackedObservationSize() const;
+
+    /**
+     * Returns the game of the environment with the given index.
+     *
+     * \param index The index of the environment.
+     *
+     * \return The game of the environment with the given index.
+     */
+    std::shared_ptr<const Game> getGame(int index) const;
+
+    /**
+     * Starts a new game in every environment and writes the observations
+     * into \a observations in the format of \c step.
+     *
+     * \param observations A buffer of <tt>getCount() * getObservationSize()</tt>
+     *        bytes.
+     */
+    void reset(std::uint8_t* observations);
+
+    /**
+     * Applies \a actions to the environments and writes the results into the
+     * provided buffers. The observation of an environment is its board in
+     * row-major order, one byte per cell: 0 for an empty cell, 1 for a filled
+     * cell and 2 for a cell that is occupied by the current shape.
+     *
+     * \param actions The actions, one for each environment.
+     * \param observations A buffer of <tt>getCount() * getObservationSize()</tt>
+     *        bytes.
+     * \param rewards A buffer of \c getCount() elements that receives the
+     *        number of rows removed in the step.
+     * \param dones A buffer of \c getCount() elements that receives 1 if the
+     *        game of the environment was over (and so it was restarted)
+     *        and 0 otherwise.
+     */
+    void step(const Action* actions, std::uint8_t* observations,
+              float* rewards, std::uint8_t* dones);
+
+    /**
+     * The same as \c step, but the observations are bit-packed: every row is
+     * stored in <tt>(width + 7) / 8</tt> bytes, the lowest bit of the first
+     * byte being the leftmost column, and a bit is set if the cell is filled
+     * or occupied by the current shape.
+     */
+    void stepPacked(const Action* actions, std::uint8_t* observations,
+                    float* rewards, std::uint8_t* dones);
+  private:
+    class PIMPL;
+    PIMPL* m_pimpl;
+};
+
+} // namespace tetris.
+
+#endif // VECTORENVIRONMENT_H
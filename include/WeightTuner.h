@@ -0,0 +1,186 @@
+/*
+ * Copyright (C) 2016 Daniel Becker <beckerdaniel.dani@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WEIGHTTUNER_H
+#define WEIGHTTUNER_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "PlacementSearch.h"
+
+namespace tetris {
+
+class Shape;
+
+/**
+ * The settings of a \c WeightTuner.
+ */
+struct TunerConfig
+{
+  int height = 20; ///< The height of the boards the games are played on.
+  int width = 10; ///< The width of the boards the games are played on.
+
+  /** The number of weight vectors tried in a generation. */
+  int population = 32;
+
+  /** The number of the best weight vectors the next generation is bred from. */
+  int elite = 8;
+
+  /** The number of games each weight vector plays in a generation. */
+  int games = 64;
+
+  /** The number of pieces after which a game is stopped. */
+  int max_pieces = 1000;
+
+  /** The seed of the whole run, both of the sampling and of the games. */
+  unsigned int seed = 1;
+
+  /** The number of threads to play on; 0 uses every hardware thread. */
+  unsigned int threads = 0;
+
+  /** The standard deviation of the weights in the first generation. */
+  double initial_deviation = 0.5;
+
+  /**
+   * Added to the standard deviations of every generation, so that they do
+   * not collapse before the weights settle.
+   */
+  double noise = 0.05;
+};
+
+/**
+ * What a generation of a \c WeightTuner did.
+ */
+struct GenerationReport
+{
+  int generation = 0; ///< The number of the generation, starting from 1.
+
+  SearchWeights best {}; ///< The weights that scored the most.
+  double best_score = 0.0; ///< The mean number of lines \c best cleared.
+  double mean_score = 0.0; ///< The mean number of lines of all weights.
+
+  std::uint64_t games = 0; ///< The number of games played.
+  std::uint64_t pieces = 0; ///< The number of pieces placed.
+  double seconds = 0.0; ///< The wall clock time the generation took.
+};
+
+/**
+ * Tunes the weights of \c PlacementSearch by playing headless games with
+ * them. Each generation samples weight vectors from a normal distribution,
+ * scores them by the mean number of lines they clear and moves the
+ * distribution to the best of them (the cross-entropy method).
+ *
+ * Every weight vector of a generation plays the games with the same seeds,
+ * so the differences of the scores come from the weights rather than from
+ * the luck of the shapes. The games are dealt to a pool of threads one at a
+ * time, so that the threads stay busy until the last game. Each thread
+ * plays all its games on the same board with the same search, drawing the
+ * shapes from its own memory pool.
+ *
+ * The state between the generations can be saved to a checkpoint, and a
+ * tuner that loads it goes on exactly as the one that saved it.
+ */
+class WeightTuner
+{
+  public:
+    /**
+     * Constructs a tuner that starts from the default weights.
+     *
+     * \param config The settings of the tuner.
+     * \param shapes The shapes the games are played with.
+     *
+     * \throws std::invalid_argument if a setting is out of range or there are
+     *         no shapes.
+     */
+    WeightTuner(TunerConfig config,
+                std::vector<std::shared_ptr<Shape>> shapes);
+    WeightTuner(const WeightTuner& other) = delete;
+    virtual ~WeightTuner();
+
+    /**
+     * Plays a generation and moves the distribution of the weights.
+     *
+     * \return What the generation did.
+     */
+    GenerationReport runGeneration();
+
+    /**
+     * Scores weights by playing games with them on the threads of the tuner.
+     *
+     * \param weights The weights to score.
+     * \param first_seed The seed of the first game; the others follow it.
+     * \param games The number of games to play.
+     *
+     * \return The mean number of lines cleared in a game.
+     */
+    double evaluate(const SearchWeights& weights, unsigned int first_seed,
+                    int games);
+
+    /**
+     * Returns the number of generations played so far.
+     *
+     * \return The number of generations played.
+     */
+    int getGeneration() const;
+
+    /**
+     * Returns the mean of the distribution of the weights, which is the
+     * result of the tuning.
+     *
+     * \return The mean of the weights.
+     */
+    SearchWeights getMean() const;
+
+    /**
+     * Returns the standard deviations of the distribution of the weights.
+     *
+     * \return The standard deviations of the weights.
+     */
+    SearchWeights getDeviation() const;
+
+    /**
+     * Saves the state of the tuner. The file is replaced at once, so a run
+     * that is stopped while saving leaves the previous checkpoint.
+     *
+     * \param path The path of the checkpoint.
+     *
+     * \throws std::runtime_error if the file cannot be written.
+     */
+    void saveCheckpoint(const std::string& path) const;
+
+    /**
+     * Restores the state of the tuner from a checkpoint.
+     *
+     * \param path The path of the checkpoint.
+     *
+     * \return \c true if the checkpoint was loaded; \c false if there is no
+     *         such file.
+     *
+     * \throws std::invalid_argument if the file is not a checkpoint.
+     */
+    bool loadCheckpoint(const std::string& path);
+
+  private:
+    class PIMPL;
+    PIMPL* m_pimpl;
+};
+
+} // namespace tetris.
+
+#endif // WEIGHTTUNER_H
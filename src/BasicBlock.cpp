@@ -17,6 +17,8 @@
 
 #include "BasicBlock.h"
 
+#include <typeinfo>
+
 using namespace std;
 
 namespace tetris {
@@ -42,6 +44,14 @@ shared_ptr<Block> BasicBlock::clone() const {
   return make_shared<BasicBlock>(*this);
 }
 
+shared_ptr<Block> BasicBlock::clone(const PoolAllocator<char>& allocator) const
+{
+  if (typeid(*this) != typeid(BasicBlock)) {
+    return clone();
+  }
+  return allocate_shared<BasicBlock>(allocator, *this);
+}
+
 void BasicBlock::draw(DrawingContextInfo& dci) const {
   const std::shared_ptr<DrawingTool<Block>>& dt = getDrawingTool();
   if (dt != nullptr) {
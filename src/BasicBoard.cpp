@@ -16,6 +16,8 @@
 
 #include "BasicBoard.h"
 
+#include <algorithm>
+
 using namespace std;
 
 namespace tetris {
@@ -52,8 +54,18 @@ shared_ptr<const Block> BasicBoard::get(int vertical, int horizontal) const {
   return m_const_neutral_get(vertical, horizontal);
 }
 
+const Block* BasicBoard::peek(int vertical, int horizontal) const {
+  if (!isValid(vertical, horizontal)) {
+    return nullptr;
+  }
+
+  int vertical_index = getHeight() - vertical - 1;
+  return m_table[vertical_index][horizontal].get();
+}
+
 void BasicBoard::set(int vertical, int horizontal, shared_ptr<Block> block) {
   if (!isValid(vertical, horizontal)) { return; }
+  markModified();
 
   int vertical_index = getHeight() - vertical - 1;
   int horizontal_index = horizontal;
@@ -64,6 +76,7 @@ void BasicBoard::removeRow(int row) {
   if (row < 0 || row >= getHeight()) {
     return;
   }
+  markModified();
 
   int index = getHeight() - row - 1;
   m_table.erase(m_table.begin() + index);
@@ -71,7 +84,24 @@ void BasicBoard::removeRow(int row) {
   m_table.emplace_back(getWidth(), nullptr);
 }
 
+void BasicBoard::insertRowsAtBottom(int count,
+                                    const vector<shared_ptr<Block>>& pattern) {
+  checkRowPattern(pattern);
+  if (count <= 0) { return; }
+  markModified();
+
+  // The top rows are at the back of the table. Turning them around to the
+  // front, where the bottom rows are, and refilling them only moves the
+  // vectors of the rows, not their cells.
+  count = min(count, getHeight());
+  rotate(m_table.begin(), m_table.end() - count, m_table.end());
+  for (int i = 0; i < count; ++i) {
+    m_table[i].assign(pattern.begin(), pattern.end());
+  }
+}
+
 void BasicBoard::clear() {
+  markModified();
   for (std::vector<std::shared_ptr<Block>>& row : m_table) {
     for (std::shared_ptr<Block>& block : row) {
       block = nullptr;
@@ -18,9 +18,13 @@
 #include "BasicShape.h"
 
 #include <algorithm>
+#include <cstdint>
+#include <new>
 #include <stdexcept>
+#include <typeinfo>
 
 #include "Block.h"
+#include "ShapeCatalog.h"
 
 using namespace std;
 
@@ -33,8 +37,12 @@ class BasicShape::PIMPL
 {
 public:
 
-  PIMPL(int bbox_size, vector<Coords> coords, vector<shared_ptr<Block>> blocks)
-   : m_bbox_size(bbox_size)
+  typedef PoolAllocator<char> Allocator;
+
+  PIMPL(int bbox_size, vector<Coords> coords, vector<shared_ptr<Block>> blocks,
+        const Allocator& allocator)
+   : m_bbox_size(bbox_size), m_positions(allocator), m_blocks(allocator),
+     m_cells(allocator)
   {
     if (bbox_size < 1) {
       throw invalid_argument("An empty bounding box is not allowed.");
@@ -44,51 +52,139 @@ public:
       throw invalid_argument(
               "The number of coordinates does not match the number of blocks.");
     }
-    checkDuplicates(coords);
     checkDuplicates(blocks);
 
+    m_positions.reserve(coords.size());
+    m_blocks.reserve(coords.size());
     for (unsigned int i = 0; i < coords.size(); ++i) {
       Coords& coord = coords.at(i);
       if (!isValid(coord.getVertical(), coord.getHorizontal())) {
         throw invalid_argument("A block is outside the bounding box.");
       }
-      m_blocks.emplace_back(coords.at(i), blocks.at(i)/*->clone()*/);
+      m_positions.push_back(coord);
+      m_blocks.push_back(blocks.at(i));
     }
+    fillCells();
+
+    int rotation = 0;
+    m_kind = ShapeCatalog::classify(bbox_size, m_positions.data(),
+                                    m_positions.size(), rotation);
+    m_rotation = rotation;
   }
 
-  PIMPL(const PIMPL& other)
-   : m_bbox_size(other.m_bbox_size), m_blocks(other.m_blocks) {}
+  PIMPL(const ShapeCatalog::Entry& entry, vector<shared_ptr<Block>> blocks,
+        int rotation, const Allocator& allocator)
+   : m_bbox_size(0), m_positions(allocator), m_blocks(allocator),
+     m_cells(allocator), m_kind(entry.getKind()), m_rotation(rotation & 3)
+  {
+    if (blocks.size() != entry.getBlockCount()) {
+      throw invalid_argument(
+              "The number of blocks does not match the kind of the shape.");
+    }
+    checkDuplicates(blocks);
 
-  PIMPL(PIMPL&& other)
-   : m_bbox_size(other.m_bbox_size), m_blocks(other.m_blocks) {}
+    m_bbox_size = entry.getBBoxSize();
+    const PackedCoords* positions = entry.getPositions(m_rotation);
+    m_positions.assign(positions, positions + blocks.size());
+    m_blocks.assign(blocks.begin(), blocks.end());
+    fillCells();
+  }
 
-  struct BlockWithPos {
-    BlockWithPos(Coords p_pos, std::shared_ptr<Block> p_block)
-     : pos(p_pos), block(p_block) {}
+  PIMPL(const PIMPL& other, const Allocator& allocator)
+   : m_bbox_size(other.m_bbox_size),
+     m_positions(other.m_positions, allocator),
+     m_blocks(allocator),
+     m_cells(other.m_cells, allocator),
+     m_kind(other.m_kind),
+     m_rotation(other.m_rotation)
+  {
+    m_blocks.reserve(other.m_blocks.size());
+    for (const shared_ptr<Block>& block : other.m_blocks) {
+      m_blocks.push_back(block->clone(allocator));
+    }
+  }
 
-     BlockWithPos(const BlockWithPos& other)
-      : pos(other.pos), block(other.block->clone()) {}
+  int m_bbox_size;
 
-     BlockWithPos(BlockWithPos&& other) : pos(other.pos), block(other.block) {}
+  // The positions and the blocks are kept in separate arrays so that the
+  // positions, which are what the hot loops read, are dense.
+  std::vector<PackedCoords, PoolAllocator<PackedCoords>> m_positions;
+  std::vector<std::shared_ptr<Block>, PoolAllocator<std::shared_ptr<Block>>>
+                                                                      m_blocks;
 
-    Coords pos;
-    std::shared_ptr<Block> block;
-  };
+  // The index of the block in every cell of the bounding box, row by row,
+  // or -1 for the empty cells, so that a cell is looked up in constant time
+  // whatever the size of the shape.
+  std::vector<std::int32_t, PoolAllocator<std::int32_t>> m_cells;
 
-  int m_bbox_size;
-  std::vector<BlockWithPos> m_blocks {};
+  ShapeKind m_kind = 0;
+  int m_rotation = 0;
+
+  int find(int vertical, int horizontal) const {
+    if (!isValid(vertical, horizontal)) {
+      return -1;
+    }
+    return m_cells[vertical * m_bbox_size + horizontal];
+  }
+
+  // Also finds the duplicates in the positions, which must be valid.
+  void fillCells() {
+    m_cells.assign(static_cast<size_t>(m_bbox_size) * m_bbox_size, -1);
+    for (std::size_t i = 0; i < m_positions.size(); ++i) {
+      int32_t& cell = m_cells[m_positions[i].vertical * m_bbox_size
+                              + m_positions[i].horizontal];
+      if (cell >= 0) {
+        throw invalid_argument("Duplicates in the vector.");
+      }
+      cell = i;
+    }
+  }
+
+  // Moves every block with turn, keeping the cells up to date. Only the
+  // cells of the blocks are touched, not the whole bounding box.
+  template <typename Turn>
+  void turn(Turn turn) {
+    for (const PackedCoords& coords : m_positions) {
+      m_cells[coords.vertical * m_bbox_size + coords.horizontal] = -1;
+    }
+    for (std::size_t i = 0; i < m_positions.size(); ++i) {
+      PackedCoords& coords = m_positions[i];
+      coords = turn(coords);
+      m_cells[coords.vertical * m_bbox_size + coords.horizontal] = i;
+    }
+  }
+
+  template <typename... Args>
+  static PIMPL* create(const Allocator& allocator, Args&&... args) {
+    PoolAllocator<PIMPL> pimpl_allocator(allocator);
+    PIMPL* res = pimpl_allocator.allocate(1);
+    try {
+      new (res) PIMPL(std::forward<Args>(args)..., allocator);
+    } catch (...) {
+      pimpl_allocator.deallocate(res, 1);
+      throw;
+    }
+    return res;
+  }
+
+  static void destroy(PIMPL* pimpl, const Allocator& allocator) {
+    if (pimpl == nullptr) { return; }
+    PoolAllocator<PIMPL> pimpl_allocator(allocator);
+    pimpl->~PIMPL();
+    pimpl_allocator.deallocate(pimpl, 1);
+  }
 
   bool isValid(int vertical, int horizontal) const {
     return vertical >= 0 && horizontal >= 0
         && vertical < m_bbox_size && horizontal < m_bbox_size;
   }
 
+  // Sorts a copy, so that large shapes are checked in O(n log n).
   template <typename T>
   void checkDuplicates(std::vector<T> vec) {
-    for (unsigned int i = 0; i < vec.size(); ++i) {
-      if (std::find(vec.begin(), vec.end(), vec.at(i)) != vec.begin() + i) {
-        throw invalid_argument("Duplicates in the vector.");
-      }
+    std::sort(vec.begin(), vec.end());
+    if (std::adjacent_find(vec.begin(), vec.end()) != vec.end()) {
+      throw invalid_argument("Duplicates in the vector.");
     }
   }
 
@@ -99,19 +195,37 @@ public:
 BasicShape::BasicShape(int bbox_size, vector<Coords> coords,
                        vector<shared_ptr<Block>> blocks)
   : Shape(),
-    m_pimpl(new PIMPL(bbox_size, coords, blocks))
+    m_pimpl(PIMPL::create(PoolAllocator<char>(), bbox_size, coords, blocks)),
+    m_allocator()
 {
 
 
+}
+
+BasicShape::BasicShape(const ShapeCatalog::Entry& entry,
+                       vector<shared_ptr<Block>> blocks, int rotation)
+  : Shape(),
+    m_pimpl(PIMPL::create(PoolAllocator<char>(), entry, blocks, rotation)),
+    m_allocator()
+{
+
 }
 
 BasicShape::BasicShape(const BasicShape& other)
  : Shape(other),
-   m_pimpl(new PIMPL(*other.m_pimpl)) {}
+   m_pimpl(PIMPL::create(PoolAllocator<char>(), *other.m_pimpl)),
+   m_allocator() {}
+
+BasicShape::BasicShape(const BasicShape& other,
+                       const PoolAllocator<char>& allocator)
+ : Shape(other),
+   m_pimpl(PIMPL::create(allocator, *other.m_pimpl)),
+   m_allocator(allocator) {}
 
 BasicShape::BasicShape(BasicShape&& other)
  : Shape(other),
-   m_pimpl(other.m_pimpl)
+   m_pimpl(other.m_pimpl),
+   m_allocator(other.m_allocator)
 {
   other.m_pimpl = nullptr;
 }
@@ -119,7 +233,7 @@ BasicShape::BasicShape(BasicShape&& other)
 BasicShape::~BasicShape()
 {
   //dtor
-  delete m_pimpl;
+  PIMPL::destroy(m_pimpl, m_allocator);
   m_pimpl = nullptr;
 }
 
@@ -132,58 +246,69 @@ bool BasicShape::isValid(int vertical, int horizontal) const {
 }
 
 shared_ptr<Block> BasicShape::get(int vertical, int horizontal) const {
-  for (PIMPL::BlockWithPos b : m_pimpl->m_blocks) {
-    if (b.pos.getVertical() == vertical && b.pos.getHorizontal() == horizontal)
-    {
-      return b.block;
-    }
-  }
-  return nullptr;
+  int index = m_pimpl->find(vertical, horizontal);
+  return index >= 0 ? m_pimpl->m_blocks[index] : nullptr;
+}
+
+const Block* BasicShape::peek(int vertical, int horizontal) const {
+  int index = m_pimpl->find(vertical, horizontal);
+  return index >= 0 ? m_pimpl->m_blocks[index].get() : nullptr;
 }
 
 vector<shared_ptr<Block>> BasicShape::getBlocks() {
-  vector<shared_ptr<Block>> res;
-  for (PIMPL::BlockWithPos b : m_pimpl->m_blocks) {
-    res.push_back(b.block);
-  }
-  return res;
+  return vector<shared_ptr<Block>>(m_pimpl->m_blocks.begin(),
+                                   m_pimpl->m_blocks.end());
 }
 
 vector<Coords> BasicShape::getBlockPositions() const {
-  vector<Coords> res;
-  for (PIMPL::BlockWithPos b : m_pimpl->m_blocks) {
-    res.push_back(b.pos);
-  }
-  return res;
+  return vector<Coords>(m_pimpl->m_positions.begin(),
+                        m_pimpl->m_positions.end());
+}
+
+size_t BasicShape::getBlockCount() const {
+  return m_pimpl->m_positions.size();
+}
+
+void BasicShape::getPackedBlockPositions(PackedCoords* out) const {
+  copy(m_pimpl->m_positions.begin(), m_pimpl->m_positions.end(), out);
+}
+
+ShapeKind BasicShape::getKind() const {
+  return m_pimpl->m_kind;
 }
 
+int BasicShape::getRotation() const {
+  return m_pimpl->m_rotation;
+}
 
 void BasicShape::rotateRight() {
+  m_pimpl->m_rotation = (m_pimpl->m_rotation + 1) % 4;
   int bbox_size = m_pimpl->m_bbox_size;
-  for (PIMPL::BlockWithPos& b : m_pimpl->m_blocks) {
-    Coords& coords = b.pos;
-    int vertical = coords.getVertical();
-    int horizontal = coords.getHorizontal();
-    coords.setVertical(horizontal);
-    coords.setHorizontal(bbox_size - 1 - vertical);
-  }
+  m_pimpl->turn([bbox_size](PackedCoords coords) {
+    return PackedCoords(coords.horizontal, bbox_size - 1 - coords.vertical);
+  });
 }
 
 void BasicShape::rotateLeft() {
+  m_pimpl->m_rotation = (m_pimpl->m_rotation + 3) % 4;
   int bbox_size = m_pimpl->m_bbox_size;
-  for (PIMPL::BlockWithPos& b : m_pimpl->m_blocks) {
-    Coords& coords = b.pos;
-    int vertical = coords.getVertical();
-    int horizontal = coords.getHorizontal();
-    coords.setVertical(bbox_size - 1 - horizontal);
-    coords.setHorizontal(vertical);
-  }
+  m_pimpl->turn([bbox_size](PackedCoords coords) {
+    return PackedCoords(bbox_size - 1 - coords.horizontal, coords.vertical);
+  });
 }
 
 shared_ptr<Shape> BasicShape::clone() const {
   return make_shared<BasicShape>(*this);
 }
 
+shared_ptr<Shape> BasicShape::clone(const PoolAllocator<char>& allocator) const
+{
+  if (typeid(*this) != typeid(BasicShape)) {
+    return clone();
+  }
+  return allocate_shared<BasicShape>(allocator, *this, allocator);
+}
+
 void BasicShape::draw(DrawingContextInfo& dci) const {
   const std::shared_ptr<DrawingTool<Shape>>& dt = getDrawingTool();
   if (dt != nullptr) {
@@ -0,0 +1,172 @@
+/*
+ * Copyright (C) 2016 Daniel Becker <beckerdaniel.dani@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "BatchBoard.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+using namespace std;
+
+namespace tetris {
+
+const int BatchBoard::MASK_ROWS;
+
+BatchBoard::BatchBoard(int count, int height, int width)
+  : m_count(count), m_height(height), m_width(width),
+    m_full_row(width >= 64 ? ~Row(0) : (Row(1) << width) - 1),
+    m_rows(), m_modifications(), m_write_rows()
+{
+  if (m_count < 1) {
+    throw invalid_argument("At least one game is required.");
+  }
+  if (m_height < 1) {
+    throw invalid_argument("Zero or negative height is not allowed.");
+  }
+  if (m_width < 1 || m_width > 64) {
+    throw invalid_argument("The width must be between 1 and 64.");
+  }
+
+  m_rows.assign(static_cast<size_t>(m_count) * m_height, Row(0));
+  m_modifications.assign(m_count, 0);
+  m_write_rows.resize(m_count);
+}
+
+BatchBoard::~BatchBoard()
+{
+
+}
+
+int BatchBoard::getCount() const {
+  return m_count;
+}
+
+int BatchBoard::getHeight() const {
+  return m_height;
+}
+
+int BatchBoard::getWidth() const {
+  return m_width;
+}
+
+BatchBoard::Row BatchBoard::getFullRow() const {
+  return m_full_row;
+}
+
+void BatchBoard::setFilled(int game, int vertical, int horizontal,
+                           bool filled) {
+  Row& row = m_rows[vertical * m_count + game];
+  Row bit = Row(1) << horizontal;
+  row = filled ? (row | bit) : (row & ~bit);
+  ++m_modifications[game];
+}
+
+void BatchBoard::removeRow(int game, int row) {
+  for (int r = row; r > 0; --r) {
+    m_rows[r * m_count + game] = getRow(game, r - 1);
+  }
+  m_rows[game] = Row(0);
+  ++m_modifications[game];
+}
+
+void BatchBoard::insertRowsAtBottom(int game, int count, Row bits) {
+  count = min(count, m_height);
+  for (int r = 0; r < m_height - count; ++r) {
+    m_rows[r * m_count + game] = getRow(game, r + count);
+  }
+  for (int r = m_height - count; r < m_height; ++r) {
+    m_rows[r * m_count + game] = bits & m_full_row;
+  }
+  ++m_modifications[game];
+}
+
+void BatchBoard::clear(int game) {
+  for (int r = 0; r < m_height; ++r) {
+    m_rows[r * m_count + game] = Row(0);
+  }
+  ++m_modifications[game];
+}
+
+void BatchBoard::clear() {
+  fill(m_rows.begin(), m_rows.end(), Row(0));
+  for (uint64_t& modifications : m_modifications) {
+    ++modifications;
+  }
+}
+
+void BatchBoard::testCollisions(const Row* masks, const int* tops,
+                                uint8_t* results) const {
+  const Row* rows = m_rows.data();
+  for (int g = 0; g < m_count; ++g) {
+    Row collision = 0;
+    for (int k = 0; k < MASK_ROWS; ++k) {
+      int r = tops[g] + k;
+      Row mask = masks[g * MASK_ROWS + k];
+      bool in_board = r >= 0 && r < m_height;
+      // Rows below the board are completely filled, the hidden rows above it
+      // are empty.
+      Row cells = in_board ? rows[r * m_count + g]
+                           : (r >= m_height ? ~Row(0) : Row(0));
+      collision |= (mask & ~m_full_row) | (mask & cells);
+    }
+    results[g] = collision != 0;
+  }
+}
+
+void BatchBoard::lock(const Row* masks, const int* tops) {
+  Row* rows = m_rows.data();
+  for (int k = 0; k < MASK_ROWS; ++k) {
+    for (int g = 0; g < m_count; ++g) {
+      int r = tops[g] + k;
+      if (r >= 0 && r < m_height) {
+        rows[r * m_count + g] |= masks[g * MASK_ROWS + k] & m_full_row;
+      }
+    }
+  }
+  for (uint64_t& modifications : m_modifications) {
+    ++modifications;
+  }
+}
+
+void BatchBoard::removeFilledRows(int* removed) {
+  Row* rows = m_rows.data();
+  int* write = m_write_rows.data();
+  fill(m_write_rows.begin(), m_write_rows.end(), m_height - 1);
+
+  // Compacting the non-full rows of every board towards the bottom. Going
+  // from the bottom up, every row is copied to the write position of its
+  // game, which only advances if the row was not full.
+  for (int r = m_height - 1; r >= 0; --r) {
+    const Row* src = rows + r * m_count;
+    for (int g = 0; g < m_count; ++g) {
+      Row bits = src[g];
+      rows[write[g] * m_count + g] = bits;
+      write[g] -= (bits != m_full_row);
+    }
+  }
+
+  for (int g = 0; g < m_count; ++g) {
+    for (int r = write[g]; r >= 0; --r) {
+      rows[r * m_count + g] = Row(0);
+    }
+    m_modifications[g] += write[g] >= 0;
+    if (removed != nullptr) {
+      removed[g] = write[g] + 1;
+    }
+  }
+}
+
+} // namespace tetris.
@@ -0,0 +1,143 @@
+/*
+ * Copyright (C) 2016 Daniel Becker <beckerdaniel.dani@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "BatchBoardView.h"
+
+#include <stdexcept>
+
+#include "BasicBlock.h"
+#include "BatchBoard.h"
+
+using namespace std;
+
+namespace tetris {
+
+BatchBoardView::BatchBoardView(shared_ptr<BatchBoard> batch, int game,
+                               shared_ptr<Block> filler)
+  : Board(),
+    m_batch(batch), m_game(game),
+    m_filler(filler != nullptr ? filler : make_shared<BasicBlock>())
+{
+  if (m_batch == nullptr) {
+    throw invalid_argument("A null batch board is not allowed.");
+  }
+  if (m_game < 0 || m_game >= m_batch->getCount()) {
+    throw invalid_argument("The game index is out of range.");
+  }
+}
+
+BatchBoardView::~BatchBoardView()
+{
+
+}
+
+int BatchBoardView::getGameIndex() const {
+  return m_game;
+}
+
+int BatchBoardView::getHeight() const {
+  return m_batch->getHeight();
+}
+
+int BatchBoardView::getWidth() const {
+  return m_batch->getWidth();
+}
+
+shared_ptr<Block> BatchBoardView::get(int vertical, int horizontal) {
+  if (!isValid(vertical, horizontal)
+      || !m_batch->isFilled(m_game, vertical, horizontal)) {
+    return nullptr;
+  }
+  return m_filler;
+}
+
+shared_ptr<const Block> BatchBoardView::get(int vertical, int horizontal)
+const {
+  if (!isValid(vertical, horizontal)
+      || !m_batch->isFilled(m_game, vertical, horizontal)) {
+    return nullptr;
+  }
+  return m_filler;
+}
+
+const Block* BatchBoardView::peek(int vertical, int horizontal) const {
+  if (!isValid(vertical, horizontal)
+      || !m_batch->isFilled(m_game, vertical, horizontal)) {
+    return nullptr;
+  }
+  return m_filler.get();
+}
+
+uint64_t BatchBoardView::getRowBits(int row, int left, uint64_t mask) const {
+  if (row < 0 || row >= getHeight()) {
+    return mask;
+  }
+
+  uint64_t bits = getWallBits(left);
+  uint64_t cells = m_batch->getRow(m_game, row);
+  if (left >= 0 && left < 64) {
+    bits |= cells >> left;
+  } else if (left < 0 && left > -64) {
+    bits |= cells << -left;
+  }
+  return bits & mask;
+}
+
+void BatchBoardView::set(int vertical, int horizontal, shared_ptr<Block> block)
+{
+  if (!isValid(vertical, horizontal)) { return; }
+
+  m_batch->setFilled(m_game, vertical, horizontal, block != nullptr);
+}
+
+void BatchBoardView::removeRow(int row) {
+  if (row < 0 || row >= getHeight()) {
+    return;
+  }
+
+  m_batch->removeRow(m_game, row);
+}
+
+void BatchBoardView::insertRowsAtBottom(int count,
+                                 const vector<shared_ptr<Block>>& pattern) {
+  checkRowPattern(pattern);
+  if (count <= 0) { return; }
+
+  BatchBoard::Row bits = 0;
+  for (int h = 0; h < getWidth(); ++h) {
+    if (pattern[h] != nullptr) {
+      bits |= BatchBoard::Row(1) << h;
+    }
+  }
+  m_batch->insertRowsAtBottom(m_game, count, bits);
+}
+
+void BatchBoardView::clear() {
+  m_batch->clear(m_game);
+}
+
+uint64_t BatchBoardView::getModificationCount() const {
+  return m_batch->getModificationCount(m_game);
+}
+
+void BatchBoardView::draw(DrawingContextInfo& dci) const {
+  const std::shared_ptr<DrawingTool<Board>>& dt = getDrawingTool();
+  if (dt != nullptr) {
+    dt->draw(*this, dci);
+  }
+}
+
+} // namespace tetris.
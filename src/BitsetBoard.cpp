@@ -0,0 +1,275 @@
+/*
+ * Copyright (C) 2016 Daniel Becker <beckerdaniel.dani@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "BitsetBoard.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "BasicBlock.h"
+
+using namespace std;
+
+namespace tetris {
+
+BitsetBoard::BitsetBoard(int height, int width, Storage storage,
+                         shared_ptr<Block> filler)
+  : Board(),
+    m_height(height), m_width(width),
+    m_words_per_row((width + 63) / 64),
+    m_storage(storage),
+    m_filler(filler != nullptr ? filler : make_shared<BasicBlock>()),
+    m_order(), m_start(0),
+    m_row_data(), m_filled_count(), m_free_rows(), m_pattern_words()
+{
+  if (m_height < 1) {
+    throw invalid_argument("Zero or negative height is not allowed.");
+  }
+  if (m_width < 1) {
+    throw invalid_argument("Zero or negative width is not allowed.");
+  }
+
+  clear();
+}
+
+BitsetBoard::~BitsetBoard()
+{
+
+}
+
+int BitsetBoard::getHeight() const {
+  return m_height;
+}
+
+int BitsetBoard::getWidth() const {
+  return m_width;
+}
+
+BitsetBoard::Storage BitsetBoard::getStorage() const {
+  return m_storage;
+}
+
+int BitsetBoard::getWordsPerRow() const {
+  return m_words_per_row;
+}
+
+const BitsetBoard::Word* BitsetBoard::getRowWords(int row) const {
+  int storage_index = m_order[orderIndex(row)];
+  if (storage_index < 0) {
+    return nullptr;
+  }
+  return m_row_data.data() + storage_index * m_words_per_row;
+}
+
+bool BitsetBoard::isRowFull(int row) const {
+  int storage_index = m_order[orderIndex(row)];
+  return storage_index >= 0 && m_filled_count[storage_index] == m_width;
+}
+
+int BitsetBoard::getAllocatedRows() const {
+  return m_filled_count.size() - m_free_rows.size();
+}
+
+shared_ptr<Block> BitsetBoard::get(int vertical, int horizontal) {
+  return testCell(vertical, horizontal) ? m_filler : nullptr;
+}
+
+shared_ptr<const Block> BitsetBoard::get(int vertical, int horizontal) const {
+  return testCell(vertical, horizontal) ? m_filler : nullptr;
+}
+
+const Block* BitsetBoard::peek(int vertical, int horizontal) const {
+  return testCell(vertical, horizontal) ? m_filler.get() : nullptr;
+}
+
+uint64_t BitsetBoard::getRowBits(int row, int left, uint64_t mask) const {
+  if (row < 0 || row >= m_height) {
+    return mask;
+  }
+
+  Word bits = getWallBits(left);
+  const Word* words = getRowWords(row);
+  if (words != nullptr && left > -64 && left < m_width) {
+    if (left < 0) {
+      bits |= words[0] << -left;
+    } else {
+      int index = left / 64;
+      int offset = left % 64;
+      bits |= words[index] >> offset;
+      if (offset != 0 && index + 1 < m_words_per_row) {
+        bits |= words[index + 1] << (64 - offset);
+      }
+    }
+  }
+  return bits & mask;
+}
+
+void BitsetBoard::set(int vertical, int horizontal, shared_ptr<Block> block) {
+  if (!isValid(vertical, horizontal)) { return; }
+  markModified();
+
+  int& storage_index = m_order[orderIndex(vertical)];
+  if (storage_index < 0) {
+    if (block == nullptr) { return; }
+    storage_index = allocateRow();
+  }
+
+  Word& word = m_row_data[storage_index * m_words_per_row + horizontal / 64];
+  Word bit = Word(1) << (horizontal % 64);
+  bool was_filled = word & bit;
+  if (block != nullptr && !was_filled) {
+    word |= bit;
+    ++m_filled_count[storage_index];
+  } else if (block == nullptr && was_filled) {
+    word &= ~bit;
+    --m_filled_count[storage_index];
+    if (m_filled_count[storage_index] == 0 && m_storage == Storage::SPARSE) {
+      releaseRow(storage_index);
+      storage_index = -1;
+    }
+  }
+}
+
+void BitsetBoard::removeRow(int row) {
+  if (row < 0 || row >= getHeight()) {
+    return;
+  }
+  markModified();
+
+  int removed = m_order[orderIndex(row)];
+  if (row < m_height / 2) {
+    // Moving the indices of the rows above the removed one down by one.
+    for (int r = row; r > 0; --r) {
+      m_order[orderIndex(r)] = m_order[orderIndex(r - 1)];
+    }
+  } else {
+    // Moving the indices of the rows below the removed one up by one, then
+    // turning the ring so that every row is back in its place and the slot
+    // that was at the bottom is at the top.
+    for (int r = row; r < m_height - 1; ++r) {
+      m_order[orderIndex(r)] = m_order[orderIndex(r + 1)];
+    }
+    m_start = orderIndex(m_height - 1);
+  }
+
+  // Reusing the storage of the removed row as the new empty top row.
+  if (removed >= 0 && m_storage == Storage::SPARSE) {
+    releaseRow(removed);
+    removed = -1;
+  } else if (removed >= 0) {
+    fill_n(m_row_data.begin() + removed * m_words_per_row, m_words_per_row,
+           Word(0));
+    m_filled_count[removed] = 0;
+  }
+  m_order[orderIndex(0)] = removed;
+}
+
+void BitsetBoard::insertRowsAtBottom(int count,
+                                     const vector<shared_ptr<Block>>& pattern)
+{
+  checkRowPattern(pattern);
+  if (count <= 0) { return; }
+  markModified();
+
+  count = min(count, m_height);
+  m_pattern_words.assign(m_words_per_row, Word(0));
+  int filled = 0;
+  for (int h = 0; h < m_width; ++h) {
+    if (pattern[h] != nullptr) {
+      m_pattern_words[h / 64] |= Word(1) << (h % 64);
+      ++filled;
+    }
+  }
+
+  // Turning the ring so that the top rows become the bottom ones; the other
+  // rows stay where they are in the storage.
+  m_start = orderIndex(count);
+  for (int r = m_height - count; r < m_height; ++r) {
+    int& storage_index = m_order[orderIndex(r)];
+    if (filled == 0 && m_storage == Storage::SPARSE) {
+      if (storage_index >= 0) {
+        releaseRow(storage_index);
+        storage_index = -1;
+      }
+      continue;
+    }
+
+    if (storage_index < 0) {
+      storage_index = allocateRow();
+    }
+    copy(m_pattern_words.begin(), m_pattern_words.end(),
+         m_row_data.begin() + storage_index * m_words_per_row);
+    m_filled_count[storage_index] = filled;
+  }
+}
+
+void BitsetBoard::clear() {
+  markModified();
+  m_start = 0;
+  m_free_rows.clear();
+  if (m_storage == Storage::SPARSE) {
+    m_order.assign(m_height, -1);
+    m_row_data.clear();
+    m_filled_count.clear();
+  } else {
+    m_order.resize(m_height);
+    for (int r = 0; r < m_height; ++r) {
+      m_order[r] = r;
+    }
+    m_row_data.assign(static_cast<size_t>(m_height) * m_words_per_row,
+                      Word(0));
+    m_filled_count.assign(m_height, 0);
+  }
+}
+
+void BitsetBoard::draw(DrawingContextInfo& dci) const {
+  const std::shared_ptr<DrawingTool<Board>>& dt = getDrawingTool();
+  if (dt != nullptr) {
+    dt->draw(*this, dci);
+  }
+}
+
+// Helpers.
+bool BitsetBoard::testCell(int vertical, int horizontal) const {
+  if (!isValid(vertical, horizontal)) {
+    return false;
+  }
+
+  const Word* words = getRowWords(vertical);
+  return words != nullptr
+      && ((words[horizontal / 64] >> (horizontal % 64)) & 1u);
+}
+
+int BitsetBoard::allocateRow() {
+  if (!m_free_rows.empty()) {
+    int storage_index = m_free_rows.back();
+    m_free_rows.pop_back();
+    return storage_index;
+  }
+
+  m_row_data.resize(m_row_data.size() + m_words_per_row, Word(0));
+  m_filled_count.push_back(0);
+  return m_filled_count.size() - 1;
+}
+
+void BitsetBoard::releaseRow(int storage_index) {
+  fill_n(m_row_data.begin() + storage_index * m_words_per_row,
+         m_words_per_row, Word(0));
+  m_filled_count[storage_index] = 0;
+  m_free_rows.push_back(storage_index);
+}
+
+} // namespace tetris.
@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2016 Daniel Becker <beckerdaniel.dani@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CollisionMask.h"
+
+#include <algorithm>
+#include <climits>
+#include <stdexcept>
+#include <vector>
+
+#include "Board.h"
+#include "Shape.h"
+
+using namespace std;
+
+namespace tetris {
+
+const int CollisionMask::MAX_ROWS;
+const int CollisionMask::MAX_WIDTH;
+
+CollisionMask::CollisionMask()
+  : m_rows(), m_top(0), m_left(0), m_height(0)
+{
+
+}
+
+CollisionMask::CollisionMask(const PackedCoords* positions, size_t count)
+  : m_rows(), m_top(0), m_left(0), m_height(0)
+{
+  if (!isRepresentable(positions, count)) {
+    throw invalid_argument("The shape is too large for a collision mask.");
+  }
+  if (count == 0) {
+    return;
+  }
+
+  int top = INT_MAX, bottom = INT_MIN, left = INT_MAX;
+  for (size_t i = 0; i < count; ++i) {
+    top = min(top, positions[i].getVertical());
+    bottom = max(bottom, positions[i].getVertical());
+    left = min(left, positions[i].getHorizontal());
+  }
+
+  m_top = top;
+  m_left = left;
+  m_height = bottom - top + 1;
+  for (size_t i = 0; i < count; ++i) {
+    m_rows[positions[i].vertical - top]
+        |= Row(1) << (positions[i].horizontal - left);
+  }
+}
+
+CollisionMask::CollisionMask(const Shape& shape)
+  : m_rows(), m_top(0), m_left(0), m_height(0)
+{
+  vector<PackedCoords> positions(shape.getBlockCount());
+  shape.getPackedBlockPositions(positions.data());
+  *this = CollisionMask(positions.data(), positions.size());
+}
+
+bool CollisionMask::isRepresentable(const PackedCoords* positions,
+                                    size_t count) {
+  if (count == 0) {
+    return true;
+  }
+
+  int top = INT_MAX, bottom = INT_MIN, left = INT_MAX, right = INT_MIN;
+  for (size_t i = 0; i < count; ++i) {
+    top = min(top, positions[i].getVertical());
+    bottom = max(bottom, positions[i].getVertical());
+    left = min(left, positions[i].getHorizontal());
+    right = max(right, positions[i].getHorizontal());
+  }
+  return bottom - top < MAX_ROWS && right - left < MAX_WIDTH;
+}
+
+bool CollisionMask::rowCollides(const Board& board, int hidden_rows, int row,
+                                int left, Row bits) {
+  if (row < 0 && row >= -hidden_rows) {
+    // The hidden rows are empty, only the walls matter.
+    return (board.getWallBits(left) & bits) != 0;
+  }
+  return board.getRowBits(row, left, bits) != 0;
+}
+
+} // namespace tetris.
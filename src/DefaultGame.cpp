@@ -16,8 +16,8 @@
 
 #include "DefaultGame.h"
 
-#include <cstdlib>
 #include <ctime>
+#include <limits>
 #include <stdexcept>
 
 #include "Board.h"
@@ -26,11 +26,31 @@ namespace tetris {
 
 DefaultGame::DefaultGame(std::shared_ptr<GameBoard> gameBoard,
                          std::vector<std::shared_ptr<Shape>> shapes)
+  : DefaultGame(gameBoard, shapes, time(nullptr))
+{
+
+}
+
+DefaultGame::DefaultGame(std::shared_ptr<GameBoard> gameBoard,
+                         std::vector<std::shared_ptr<Shape>> shapes,
+                         unsigned int seed)
   : Game(),
+    GameEventSource(),
     m_game_board(gameBoard),
     m_shapes(shapes),
-    m_next_shape(nullptr),
-    m_game_over(false)
+    m_queue(),
+    m_queue_start(0),
+    m_queue_size(0),
+    m_preview_count(1),
+    m_current_shape(nullptr),
+    m_current(0),
+    m_held_shape(nullptr),
+    m_held(0),
+    m_hold_used(false),
+    m_game_over(false),
+    m_random_engine(seed),
+    m_allocator(),
+    m_block_positions()
 {
   if (m_game_board == nullptr) {
     throw std::invalid_argument("A null game board is not allowed.");
@@ -40,14 +60,17 @@ DefaultGame::DefaultGame(std::shared_ptr<GameBoard> gameBoard,
     throw std::invalid_argument("At least one shape must be specified.");
   }
 
+  if (m_shapes.size() > std::numeric_limits<QueuedShape>::max() / 4) {
+    throw std::invalid_argument("Too many shapes.");
+  }
+
   for (std::shared_ptr<Shape>& ptr : m_shapes) {
     if (ptr == nullptr) {
       throw std::invalid_argument("A null shape is not allowed.");
     }
   }
 
-  // Setting the random seed.
-  srand(time(nullptr));
+  fillQueue();
 }
 
 DefaultGame::~DefaultGame()
@@ -63,13 +86,107 @@ bool DefaultGame::isGameOver() const {
   return m_game_over;
 }
 
+void DefaultGame::setAllocationPool(std::shared_ptr<PoolResource> pool) {
+  m_allocator = PoolAllocator<char>(pool);
+}
+
+std::shared_ptr<PoolResource> DefaultGame::getAllocationPool() const {
+  return m_allocator.getResource();
+}
+
 void DefaultGame::newGame() {
   m_game_board->clear();
+  m_current_shape = nullptr;
+  m_held_shape = nullptr;
   m_game_over = false;
 
+  // The shapes and blocks of the previous game are gone, so the memory of
+  // the pool can be reclaimed at once.
+  if (m_allocator.getResource() != nullptr) {
+    m_allocator.getResource()->reset();
+  }
+
   setNewShape();
 }
 
+void DefaultGame::newGame(unsigned int seed) {
+  m_random_engine.seed(seed);
+  m_queue_start = 0;
+  m_queue_size = 0;
+  fillQueue();
+  newGame();
+}
+
+void DefaultGame::setPreviewCount(int count) {
+  if (count < 1 || count > MAX_PREVIEW) {
+    throw std::invalid_argument("The preview count is out of range.");
+  }
+  m_preview_count = count;
+  if (m_queue_size < m_preview_count) {
+    fillQueue();
+  }
+}
+
+int DefaultGame::getPreviewCount() const {
+  return m_preview_count;
+}
+
+const std::shared_ptr<Shape>& DefaultGame::getPreview(int index) const {
+  return m_shapes[getQueued(index) / 4];
+}
+
+int DefaultGame::getPreviewRotation(int index) const {
+  return getQueued(index) % 4;
+}
+
+int DefaultGame::getPreviewIndex(int index) const {
+  return getQueued(index) / 4;
+}
+
+bool DefaultGame::hold() {
+  if (!canHold()) {
+    return false;
+  }
+
+  int turns = m_game_board->getCurrentShapeRotation();
+  std::shared_ptr<Shape> held = m_held_shape;
+  QueuedShape held_queued = m_held;
+  m_held_shape = m_current_shape;
+  m_held = m_current;
+  if (held != nullptr) {
+    spawn(held, held_queued);
+  } else {
+    setNewShape();
+  }
+  m_hold_used = true;
+
+  // Turning the shape back only now that the game board has let go of it.
+  for (; turns % 4 != 0; ++turns) {
+    m_held_shape->rotateRight();
+  }
+  return true;
+}
+
+bool DefaultGame::canHold() const {
+  return !m_game_over && m_current_shape != nullptr && !m_hold_used;
+}
+
+std::shared_ptr<const Shape> DefaultGame::getHeldShape() const {
+  return m_held_shape;
+}
+
+int DefaultGame::getHeldIndex() const {
+  return m_held_shape != nullptr ? m_held / 4 : -1;
+}
+
+void DefaultGame::getPreviewShapes(
+                  std::vector<std::shared_ptr<const Shape>>& preview) const {
+  preview.resize(m_preview_count);
+  for (int i = 0; i < m_preview_count; ++i) {
+    preview[i] = m_shapes[getQueued(i) / 4];
+  }
+}
+
 int DefaultGame::advance() {
   if (m_game_over) {
     return 0;
@@ -83,6 +200,9 @@ int DefaultGame::advance() {
     // Checking for game over.
     if (top_row_not_empty()) {
       m_game_over = true;
+      notifyListeners([](GameEventListener& listener) {
+        listener.onGameOver();
+      });
       return 0;
     }
 
@@ -95,8 +215,19 @@ int DefaultGame::advance() {
 }
 
 int DefaultGame::drop() {
-  while(!(m_game_board->hasLanded())) {
-    advance();
+  if (m_game_over || m_game_board->getCurrentShape() == nullptr) {
+    return 0;
+  }
+
+  // Moving the shape straight to where it would land instead of advancing row
+  // by row; the last advance locks it and clears the rows as before.
+  Coords from = m_game_board->getCurrentShapePosition();
+  Coords to = m_game_board->whereWouldLand();
+  m_game_board->setCurrentShapePosition(to);
+  if (!(from == to)) {
+    notifyListeners([&](GameEventListener& listener) {
+      listener.onShapeMoved(from, to);
+    });
   }
   return advance();
 }
@@ -117,6 +248,26 @@ void DefaultGame::moveRight() {
   m_game_board->moveRight();
 }
 
+void DefaultGame::addEventListener(
+                                  std::shared_ptr<GameEventListener> listener) {
+  GameEventSource::addEventListener(listener);
+  GameEventSource* board_source =
+                          dynamic_cast<GameEventSource*>(m_game_board.get());
+  if (board_source != nullptr) {
+    board_source->addEventListener(listener);
+  }
+}
+
+void DefaultGame::removeEventListener(
+                      const std::shared_ptr<GameEventListener>& listener) {
+  GameEventSource::removeEventListener(listener);
+  GameEventSource* board_source =
+                          dynamic_cast<GameEventSource*>(m_game_board.get());
+  if (board_source != nullptr) {
+    board_source->removeEventListener(listener);
+  }
+}
+
 void DefaultGame::draw(DrawingContextInfo& dci) const {
   const std::shared_ptr<DrawingTool<Game>>& dt = getDrawingTool();
   if (dt != nullptr) {
@@ -125,40 +276,63 @@ void DefaultGame::draw(DrawingContextInfo& dci) const {
 }
 
 void DefaultGame::setNewShape() {
-  unsigned int index = rand() % m_shapes.size();
-  m_game_board->setCurrentShape(m_shapes.at(index)->clone());
-
-  if (m_next_shape == nullptr) {
-    m_next_shape = chooseNewShape();
-    m_game_board->setCurrentShape(chooseNewShape());
-  } else {
-    m_game_board->setCurrentShape(m_next_shape);
-    m_next_shape = chooseNewShape();
+  // Keeping the preview full after the current shape is taken off.
+  if (m_queue_size <= m_preview_count) {
+    fillQueue();
   }
+  QueuedShape queued = m_queue[m_queue_start];
+  m_queue_start = (m_queue_start + 1) % QUEUE_CAPACITY;
+  --m_queue_size;
+
+  std::shared_ptr<Shape> shape = m_shapes[queued / 4]->clone(m_allocator);
+  for (int i = 0; i < queued % 4; ++i) { shape->rotateRight(); }
+  m_hold_used = false;
+  spawn(shape, queued);
+}
+
+void DefaultGame::spawn(std::shared_ptr<Shape> shape, QueuedShape queued) {
+  m_current_shape = shape;
+  m_current = queued;
+  m_game_board->setCurrentShape(shape);
 
   int vertical_coord = - std::min(m_game_board->getHiddenRows(),
                                   get_lowest_block_of_current_shape());
 
   // It would be better in the middle.
   m_game_board->setCurrentShapePosition(Coords(vertical_coord, 0));
-}
 
-std::shared_ptr<Shape> DefaultGame::chooseNewShape() const {
-  unsigned int index = rand() % m_shapes.size();
-  std::shared_ptr<Shape> res = m_shapes.at(index)->clone();
+  notifyListeners([&](GameEventListener& listener) {
+    listener.onShapeSpawned(*m_game_board->getCurrentShape(),
+                            Coords(vertical_coord, 0));
+  });
+}
 
-  // Random rotations.
-  int  rotate_times = rand() % 4;
-  for (int i = 0; i < rotate_times; ++i) { res->rotateRight(); }
+void DefaultGame::fillQueue() {
+  // Filling the whole free part of the ring at once; the random engine is
+  // drawn in the same order as when the shapes were chosen one by one.
+  for (; m_queue_size < QUEUE_CAPACITY; ++m_queue_size) {
+    unsigned int index = m_random_engine() % m_shapes.size();
+
+    // Random rotations.
+    unsigned int rotate_times = m_random_engine() % 4;
+    m_queue[(m_queue_start + m_queue_size) % QUEUE_CAPACITY] =
+                                          static_cast<QueuedShape>(index * 4
+                                                              + rotate_times);
+  }
+}
 
-  return res;
+DefaultGame::QueuedShape DefaultGame::getQueued(int index) const {
+  if (index < 0 || index >= m_preview_count) {
+    throw std::invalid_argument("The preview index is out of range.");
+  }
+  return m_queue[(m_queue_start + index) % QUEUE_CAPACITY];
 }
 
 bool DefaultGame::top_row_not_empty() {
   std::shared_ptr<const Board> board = m_game_board->getBoard();
   int width = board->getWidth();
   for (int i = 0; i < width; ++i) {
-    if (board->get(0, i) != nullptr) {
+    if (board->isFilled(0, i)) {
       return true;
     }
   }
@@ -166,16 +340,15 @@ bool DefaultGame::top_row_not_empty() {
   return false;
 }
 
-int DefaultGame::get_lowest_block_of_current_shape() const {
+int DefaultGame::get_lowest_block_of_current_shape() {
   std::shared_ptr<const Shape> current_shape = m_game_board->getCurrentShape();
   int res = -1;
   if (current_shape != nullptr) {
-    std::vector<Coords> coords = current_shape->getBlockPositions();
-    for (const Coords& coord : coords) {
-      int vertical = coord.getVertical();
-      if (coord.getVertical() > res) {
-        res = vertical;
-      }
+    // Reusing the buffer, so that spawning does not allocate.
+    m_block_positions.resize(current_shape->getBlockCount());
+    current_shape->getPackedBlockPositions(m_block_positions.data());
+    for (const PackedCoords& coord : m_block_positions) {
+      res = std::max(res, coord.getVertical());
     }
   }
 
@@ -16,7 +16,9 @@
 
 #include "DefaultGameBoard.h"
 
+#include <limits>
 #include <stdexcept>
+#include <utility>
 
 #include "Board.h"
 #include "Shape.h"
@@ -25,8 +27,70 @@ using namespace std;
 
 namespace tetris {
 
+namespace {
+
+// The relative block positions of a shape. Shapes with up to INLINE_SIZE
+// blocks, that is every ordinary shape, are kept on the stack so that
+// checking a position does not allocate.
+class PositionBuffer
+{
+public:
+  explicit PositionBuffer(const Shape& shape)
+    : m_size(shape.getBlockCount()), m_heap(), m_data(m_inline)
+  {
+    if (m_size > INLINE_SIZE) {
+      m_heap.resize(m_size);
+      m_data = m_heap.data();
+    }
+    shape.getPackedBlockPositions(m_data);
+  }
+
+  PositionBuffer(const PositionBuffer& other) = delete;
+
+  const PackedCoords* begin() const { return m_data; }
+  const PackedCoords* end() const { return m_data + m_size; }
+  size_t size() const { return m_size; }
+
+private:
+  static const size_t INLINE_SIZE = 16;
+
+  size_t m_size;
+  PackedCoords m_inline[INLINE_SIZE];
+  vector<PackedCoords> m_heap;
+  PackedCoords* m_data;
+};
+
+// Sets the blocks of the shape at the position on the board, without the
+// events of locking it.
+void writeShape(Board& board, const Shape& shape, PackedCoords position,
+                const PositionBuffer& positions) {
+  for (PackedCoords c : positions) {
+    board.set(c + position, shape.get(c.vertical, c.horizontal));
+  }
+}
+
+// Checks whether the blocks at the given relative positions fit on the board
+// when the shape is at pos.
+bool positionsFit(const Board& board, int hidden_rows,
+                  const PositionBuffer& positions, PackedCoords pos) {
+  for (PackedCoords rel : positions) {
+    PackedCoords c = pos + rel;
+    // The shape is not within the board.
+    if (!board.isValid(c.vertical, c.horizontal)
+        // The shape is not in the hidden rows either.
+        && !board.isValid(c.vertical + hidden_rows, c.horizontal)) {
+          return false;
+    }
+    if (board.isFilled(c.vertical, c.horizontal)) { return false; }
+  }
+  return true;
+}
+
+} // anonymous namespace.
+
 DefaultGameBoard::DefaultGameBoard(shared_ptr<Board> board, int hidden_rows)
   : GameBoard(),
+    GameEventSource(),
     m_board(board),
     m_hidden_rows(hidden_rows)
 {
@@ -49,7 +113,13 @@ shared_ptr<const Shape> DefaultGameBoard::getCurrentShape() const {
 }
 
 void DefaultGameBoard::setCurrentShape(std::shared_ptr<Shape> shape) {
+  if (m_journal_enabled) {
+    JournalEntry& entry = record(JournalEntry::Type::SET_SHAPE);
+    entry.shape = m_current_shape;
+    entry.rotation = m_rotation;
+  }
   m_current_shape = shape;
+  updateMasks(0);
 }
 
 int DefaultGameBoard::getHiddenRows() const {
@@ -60,8 +130,24 @@ Coords DefaultGameBoard::getCurrentShapePosition() const {
   return m_current_shape_pos;
 }
 
+int DefaultGameBoard::getCurrentShapeRotation() const {
+  return m_rotation;
+}
+
 void DefaultGameBoard::setCurrentShapePosition(Coords position) {
+  const int min = numeric_limits<int16_t>::min();
+  const int max = numeric_limits<int16_t>::max();
+  if (position.getVertical() < min || position.getVertical() > max
+      || position.getHorizontal() < min || position.getHorizontal() > max) {
+    throw invalid_argument("The position does not fit in 16 bits.");
+  }
+
+  if (m_journal_enabled) {
+    record(JournalEntry::Type::SET_POSITION).delta =
+                                  PackedCoords(position) - m_current_shape_pos;
+  }
   m_current_shape_pos = position;
+  ++m_placement_epoch;
 }
 
 vector<Coords> DefaultGameBoard::getAbsolutePositions() const {
@@ -72,84 +158,184 @@ bool DefaultGameBoard::isAtValidPos() const {
   return isAtValidPos(m_current_shape, m_current_shape_pos);
 }
 
+bool DefaultGameBoard::fits(const CollisionMask& mask, PackedCoords position)
+                                                                        const {
+  return !mask.collides(*m_board, m_hidden_rows, position);
+}
+
 bool DefaultGameBoard::hasLanded() const {
   return hasLanded(m_current_shape, m_current_shape_pos);
 }
 
 Coords DefaultGameBoard::whereWouldLand() const {
-  Coords res = m_current_shape_pos;
-  for (; !hasLanded(m_current_shape, res); res += Coords(1, 0))
-  {}
-  return res;
+  refreshLandingCache();
+  if (!m_landing_valid) {
+    m_landing_top = m_current_shape_pos.vertical;
+    PackedCoords res = m_current_shape_pos;
+    for (; !hasLanded(m_current_shape, res); res = res + PackedCoords(1, 0))
+    {}
+    m_landing_pos = res;
+    m_landing_valid = true;
+  }
+  return PackedCoords(m_landing_pos.vertical, m_current_shape_pos.horizontal);
+}
+
+uint64_t DefaultGameBoard::getLandingVersion() const {
+  refreshLandingCache();
+  return m_landing_version;
 }
 
 void DefaultGameBoard::lock() {
   if (m_current_shape == nullptr) { return; }
 
-  for (const Coords& c : m_current_shape->getBlockPositions()) {
-    shared_ptr<Block> block = m_current_shape->get(c);
-    m_board->set(c + m_current_shape_pos, block);
+  PositionBuffer positions(*m_current_shape);
+  if (m_journal_enabled) {
+    JournalEntry& entry = record(JournalEntry::Type::LOCK);
+    entry.shape = m_current_shape;
+    entry.rotation = m_rotation;
+    entry.count = positions.size();
+    for (PackedCoords c : positions) {
+      m_journal_blocks.push_back(m_board->get(c + m_current_shape_pos));
+    }
+  }
+
+  writeShape(*m_board, *m_current_shape, m_current_shape_pos, positions);
+
+  if (hasEventListeners()) {
+    m_event_positions.clear();
+    for (PackedCoords c : positions) {
+      m_event_positions.push_back(c + m_current_shape_pos);
+    }
+    notifyListeners([this](GameEventListener& listener) {
+      listener.onShapeLocked(m_event_positions.data(),
+                             m_event_positions.size());
+    });
   }
   m_current_shape = nullptr;
+  m_has_masks = false;
 }
 
 int DefaultGameBoard::removeFilledRows() {
+  m_event_rows.clear();
   int res = 0;
   for (int i = 0; i < m_board->getHeight(); ++i) {
     bool contains_empty = false;
     for (int j = 0; j < m_board->getWidth(); ++j) {
-      if (m_board->get(i, j) == nullptr) {
+      if (!m_board->isFilled(i, j)) {
         contains_empty = true;
         break;
       }
     }
     if (!contains_empty) {
+      if (m_journal_enabled) {
+        JournalEntry& entry = res == 0
+                            ? record(JournalEntry::Type::REMOVE_ROWS)
+                            : m_journal.back();
+        ++entry.count;
+        m_journal_rows.push_back(i);
+        for (int j = 0; j < m_board->getWidth(); ++j) {
+          m_journal_blocks.push_back(m_board->get(i, j));
+        }
+      }
       m_board->removeRow(i);
+      if (hasEventListeners()) {
+        m_event_rows.push_back(i);
+      }
       res++;
     }
   }
+
+  if (res > 0 && hasEventListeners()) {
+    notifyListeners([this](GameEventListener& listener) {
+      listener.onRowsCleared(m_event_rows.data(), m_event_rows.size());
+    });
+  }
   return res;
 }
 
 void DefaultGameBoard::rotateLeft() {
-  if (m_current_shape == nullptr) { return; }
-
-  shared_ptr<Shape> orig_current_shape = m_current_shape->clone();
-  m_current_shape->rotateLeft();
-  if (!isAtValidPos()) {
-    m_current_shape = orig_current_shape;
-  }
+  rotate(false);
 }
 
 void DefaultGameBoard::rotateRight() {
-  if (m_current_shape == nullptr) { return; }
+  rotate(true);
+}
 
-  shared_ptr<Shape> orig_current_shape = m_current_shape->clone();
-  m_current_shape->rotateRight();
-  if (!isAtValidPos()) {
-    m_current_shape = orig_current_shape;
-  }
+RotationMode DefaultGameBoard::getRotationMode() const {
+  return m_rotation_mode;
+}
+
+void DefaultGameBoard::setRotationMode(RotationMode mode) {
+  m_rotation_mode = mode;
 }
 
 void DefaultGameBoard::moveUp() {
-  move(Coords(-1, 0));
+  move(PackedCoords(-1, 0));
 }
 
 void DefaultGameBoard::moveDown() {
-  move(Coords(1, 0));
+  move(PackedCoords(1, 0));
 }
 
 void DefaultGameBoard::moveLeft() {
-  move(Coords(0, -1));
+  move(PackedCoords(0, -1));
 }
 
 void DefaultGameBoard::moveRight() {
-  move(Coords(0, 1));
+  move(PackedCoords(0, 1));
 }
 
 void DefaultGameBoard::clear() {
+  clearJournal();
   m_board->clear();
   m_current_shape = nullptr;
+  m_has_masks = false;
+}
+
+void DefaultGameBoard::setJournalEnabled(bool enabled) {
+  m_journal_enabled = enabled;
+  if (!enabled) {
+    clearJournal();
+  }
+}
+
+bool DefaultGameBoard::isJournalEnabled() const {
+  return m_journal_enabled;
+}
+
+bool DefaultGameBoard::canUndo() const {
+  return m_journal_pos > 0;
+}
+
+bool DefaultGameBoard::canRedo() const {
+  return m_journal_pos < m_journal.size();
+}
+
+bool DefaultGameBoard::undo() {
+  if (!canUndo()) { return false; }
+
+  --m_journal_pos;
+  revert(m_journal[m_journal_pos]);
+  return true;
+}
+
+bool DefaultGameBoard::redo() {
+  if (!canRedo()) { return false; }
+
+  // Reapplying a change must not record it again.
+  bool enabled = m_journal_enabled;
+  m_journal_enabled = false;
+  reapply(m_journal[m_journal_pos]);
+  m_journal_enabled = enabled;
+  ++m_journal_pos;
+  return true;
+}
+
+void DefaultGameBoard::clearJournal() {
+  m_journal.clear();
+  m_journal_pos = 0;
+  m_journal_blocks.clear();
+  m_journal_rows.clear();
 }
 
 void DefaultGameBoard::draw(DrawingContextInfo& dci) const {
@@ -164,50 +350,301 @@ void DefaultGameBoard::draw(DrawingContextInfo& dci) const {
 
 vector<Coords> DefaultGameBoard::getAbsolutePositions(
                                              shared_ptr<const Shape> shape,
-                                             const Coords& coords) const {
+                                             PackedCoords coords) const {
   vector<Coords> res;
   if (shape != nullptr) {
-    for (const Coords& c : shape->getBlockPositions()) {
+    for (PackedCoords c : PositionBuffer(*shape)) {
       res.emplace_back(coords + c);
     }
   }
   return res;
  }
 
-bool DefaultGameBoard::isAtValidPos(shared_ptr<Shape> shape,
-                                    const Coords& coords) const {
-  vector<Coords> abs_pos = getAbsolutePositions(shape, coords);
-  for (const Coords& c : abs_pos) {
-    // The current shape is not within the board.
-    if (!m_board->isValid(c)
-        // The current shape is not in the hidden rows either.
-        && !m_board->isValid(c + Coords(getHiddenRows(), 0))) {
-          return false;
-    }
-    if (m_board->get(c) != nullptr) { return false; }
+bool DefaultGameBoard::isAtValidPos(const shared_ptr<Shape>& shape,
+                                    PackedCoords coords) const {
+  if (shape == nullptr) { return true; }
+
+  if (shape == m_current_shape && m_has_masks) {
+    return fits(m_masks[m_rotation], coords);
   }
-  return true;
+  return positionsFit(*m_board, getHiddenRows(), PositionBuffer(*shape),
+                      coords);
 }
 
-bool DefaultGameBoard::hasLanded(shared_ptr<Shape> shape,
-                                 const Coords& coords) const {
-  vector<Coords> abs_pos = getAbsolutePositions(shape, coords);
-  for (const Coords& c : abs_pos) {
-    int vertical_under = c.getVertical() + 1;
-    int horizontal = c.getHorizontal();
+bool DefaultGameBoard::hasLanded(const shared_ptr<Shape>& shape,
+                                 PackedCoords coords) const {
+  if (shape == nullptr) { return false; }
+
+  if (shape == m_current_shape && m_has_masks) {
+    return !fits(m_masks[m_rotation], coords + PackedCoords(1, 0));
+  }
+  for (PackedCoords rel : PositionBuffer(*shape)) {
+    int vertical_under = coords.vertical + rel.vertical + 1;
+    int horizontal = coords.horizontal + rel.horizontal;
     if (vertical_under >= m_board->getHeight()
-     || m_board->get(vertical_under, horizontal) != nullptr) {
+     || m_board->isFilled(vertical_under, horizontal)) {
       return true;
     }
   }
   return false;
 }
 
-void DefaultGameBoard::move(const Coords& offset) {
-  Coords orig_pos = m_current_shape_pos;
-  m_current_shape_pos += offset;
+void DefaultGameBoard::move(PackedCoords offset) {
+  PackedCoords orig_pos = m_current_shape_pos;
+  m_current_shape_pos = m_current_shape_pos + offset;
   if (!isAtValidPos()) {
     m_current_shape_pos = orig_pos;
+  } else {
+    if (m_journal_enabled) {
+      record(JournalEntry::Type::MOVE).delta = offset;
+    }
+    if (m_current_shape != nullptr) {
+      notifyListeners([&](GameEventListener& listener) {
+        listener.onShapeMoved(orig_pos, m_current_shape_pos);
+      });
+    }
+  }
+}
+
+void DefaultGameBoard::rotate(bool clockwise) {
+  if (m_current_shape == nullptr) { return; }
+
+  int bbox_size = m_current_shape->getBBoxSize();
+  const KickTable& kicks = m_rotation_mode == RotationMode::SUPER
+              ? KickTable::forBBoxSize(bbox_size)
+              : KickTable::forBBoxSize(0);
+
+  if (m_has_masks) {
+    // Every kick is tested on the precomputed mask of the target rotation,
+    // and the shape itself is only rotated if one of them fits.
+    int target = (m_rotation + (clockwise ? 1 : 3)) % 4;
+    const PackedCoords* offsets = kicks.getKicks(m_orientations[m_rotation],
+                                                 clockwise);
+    for (int i = 0; i < kicks.getKickCount(); ++i) {
+      PackedCoords pos = m_current_shape_pos + offsets[i];
+      if (fits(m_masks[target], pos)) {
+        if (clockwise) {
+          m_current_shape->rotateRight();
+        } else {
+          m_current_shape->rotateLeft();
+        }
+        m_rotation = target;
+        if (m_journal_enabled) {
+          JournalEntry& entry = record(JournalEntry::Type::ROTATE);
+          entry.clockwise = clockwise;
+          entry.delta = offsets[i];
+        }
+        m_current_shape_pos = pos;
+        notifyRotated(clockwise);
+        return;
+      }
+    }
+    return;
+  }
+
+  if (clockwise) {
+    m_current_shape->rotateRight();
+  } else {
+    m_current_shape->rotateLeft();
+  }
+
+  // The rotated positions are read once and every kick is tested on them.
+  PositionBuffer positions(*m_current_shape);
+  int to = KickTable::getOrientation(positions.begin(), positions.size(),
+                                     bbox_size);
+  int from = clockwise ? to + 3 : to + 1;
+  const PackedCoords* offsets = kicks.getKicks(from, clockwise);
+  for (int i = 0; i < kicks.getKickCount(); ++i) {
+    PackedCoords pos = m_current_shape_pos + offsets[i];
+    if (positionsFit(*m_board, getHiddenRows(), positions, pos)) {
+      m_rotation = (m_rotation + (clockwise ? 1 : 3)) % 4;
+      if (m_journal_enabled) {
+        JournalEntry& entry = record(JournalEntry::Type::ROTATE);
+        entry.clockwise = clockwise;
+        entry.delta = offsets[i];
+      }
+      m_current_shape_pos = pos;
+      notifyRotated(clockwise);
+      return;
+    }
+  }
+
+  // Rotating back instead of restoring a copy saves cloning the shape.
+  if (clockwise) {
+    m_current_shape->rotateLeft();
+  } else {
+    m_current_shape->rotateRight();
+  }
+}
+
+void DefaultGameBoard::notifyRotated(bool clockwise) {
+  notifyListeners([&](GameEventListener& listener) {
+    listener.onShapeRotated(clockwise, m_current_shape_pos);
+  });
+}
+
+void DefaultGameBoard::refreshLandingCache() const {
+  LandingKey key {m_rotation, m_current_shape_pos.horizontal,
+                  m_placement_epoch, m_board->getModificationCount()};
+  if (key.rotation != m_landing_key.rotation
+      || key.horizontal != m_landing_key.horizontal
+      || key.placement_epoch != m_landing_key.placement_epoch
+      || key.board_modifications != m_landing_key.board_modifications
+      || (m_landing_valid
+          && (m_current_shape_pos.vertical < m_landing_top
+              || m_current_shape_pos.vertical > m_landing_pos.vertical))) {
+    m_landing_key = key;
+    m_landing_valid = false;
+    ++m_landing_version;
+  }
+}
+
+// The current orientation of the shape is taken as the given rotation, so
+// that a shape restored by the journal keeps the rotation it had.
+void DefaultGameBoard::updateMasks(int rotation) {
+  ++m_placement_epoch;
+  m_rotation = rotation;
+  m_has_masks = false;
+  if (m_current_shape == nullptr) { return; }
+
+  int bbox_size = m_current_shape->getBBoxSize();
+  int rotations = 0;
+  bool representable = true;
+  for (; rotations < 4; ++rotations) {
+    PositionBuffer positions(*m_current_shape);
+    if (!CollisionMask::isRepresentable(positions.begin(), positions.size())) {
+      representable = false;
+      break;
+    }
+    int index = (rotation + rotations) % 4;
+    m_masks[index] = CollisionMask(positions.begin(), positions.size());
+    m_orientations[index] = KickTable::getOrientation(positions.begin(),
+                                                      positions.size(),
+                                                      bbox_size);
+    m_current_shape->rotateRight();
+  }
+
+  // Turning the shape back to its original orientation.
+  for (; rotations % 4 != 0; ++rotations) {
+    m_current_shape->rotateRight();
+  }
+  m_has_masks = representable;
+}
+
+DefaultGameBoard::JournalEntry& DefaultGameBoard::record(
+                                                    JournalEntry::Type type) {
+  // A new change discards the changes that could be reapplied.
+  if (m_journal_pos < m_journal.size()) {
+    const JournalEntry& first_discarded = m_journal[m_journal_pos];
+    m_journal_blocks.resize(first_discarded.blocks_begin);
+    m_journal_rows.resize(first_discarded.rows_begin);
+    m_journal.resize(m_journal_pos);
+  }
+
+  JournalEntry entry {type, false, 0, PackedCoords(0, 0), nullptr,
+                      static_cast<uint32_t>(m_journal_blocks.size()),
+                      static_cast<uint32_t>(m_journal_rows.size()), 0};
+  m_journal.push_back(entry);
+  ++m_journal_pos;
+  return m_journal.back();
+}
+
+void DefaultGameBoard::swapShape(JournalEntry& entry) {
+  int rotation = entry.rotation;
+  entry.rotation = m_rotation;
+  swap(m_current_shape, entry.shape);
+  updateMasks(rotation);
+}
+
+void DefaultGameBoard::revert(JournalEntry& entry) {
+  switch (entry.type) {
+  case JournalEntry::Type::MOVE:
+    // Keyed like the moves themselves, by the column and the rows the
+    // cached landing holds for.
+    m_current_shape_pos = m_current_shape_pos - entry.delta;
+    break;
+  case JournalEntry::Type::SET_POSITION:
+    m_current_shape_pos = m_current_shape_pos - entry.delta;
+    ++m_placement_epoch;
+    break;
+  case JournalEntry::Type::ROTATE:
+    if (entry.clockwise) {
+      m_current_shape->rotateLeft();
+    } else {
+      m_current_shape->rotateRight();
+    }
+    m_rotation = (m_rotation + (entry.clockwise ? 3 : 1)) % 4;
+    m_current_shape_pos = m_current_shape_pos - entry.delta;
+    break;
+  case JournalEntry::Type::SET_SHAPE:
+    // The entry keeps the replaced shape and its rotation so that they can
+    // be set again.
+    swapShape(entry);
+    break;
+  case JournalEntry::Type::LOCK: {
+    int k = entry.blocks_begin;
+    for (PackedCoords c : PositionBuffer(*entry.shape)) {
+      m_board->set(c + m_current_shape_pos, m_journal_blocks[k++]);
+    }
+    m_current_shape = entry.shape;
+    updateMasks(entry.rotation);
+    break;
+  }
+  case JournalEntry::Type::REMOVE_ROWS: {
+    int width = m_board->getWidth();
+    for (int k = static_cast<int>(entry.count) - 1; k >= 0; --k) {
+      // Moving the rows above the removed one back up and restoring it.
+      int row = m_journal_rows[entry.rows_begin + k];
+      for (int r = 0; r < row; ++r) {
+        for (int j = 0; j < width; ++j) {
+          m_board->set(r, j, m_board->get(r + 1, j));
+        }
+      }
+      const shared_ptr<Block>* blocks =
+                  m_journal_blocks.data() + entry.blocks_begin + k * width;
+      for (int j = 0; j < width; ++j) {
+        m_board->set(row, j, blocks[j]);
+      }
+    }
+    break;
+  }
+  }
+}
+
+void DefaultGameBoard::reapply(JournalEntry& entry) {
+  switch (entry.type) {
+  case JournalEntry::Type::MOVE:
+    // Keyed like the moves themselves, by the column and the rows the
+    // cached landing holds for.
+    m_current_shape_pos = m_current_shape_pos + entry.delta;
+    break;
+  case JournalEntry::Type::SET_POSITION:
+    m_current_shape_pos = m_current_shape_pos + entry.delta;
+    ++m_placement_epoch;
+    break;
+  case JournalEntry::Type::ROTATE:
+    if (entry.clockwise) {
+      m_current_shape->rotateRight();
+    } else {
+      m_current_shape->rotateLeft();
+    }
+    m_rotation = (m_rotation + (entry.clockwise ? 1 : 3)) % 4;
+    m_current_shape_pos = m_current_shape_pos + entry.delta;
+    break;
+  case JournalEntry::Type::SET_SHAPE:
+    swapShape(entry);
+    break;
+  case JournalEntry::Type::LOCK:
+    writeShape(*m_board, *m_current_shape, m_current_shape_pos,
+               PositionBuffer(*m_current_shape));
+    m_current_shape = nullptr;
+    m_has_masks = false;
+    break;
+  case JournalEntry::Type::REMOVE_ROWS:
+    for (unsigned int k = 0; k < entry.count; ++k) {
+      m_board->removeRow(m_journal_rows[entry.rows_begin + k]);
+    }
+    break;
   }
 }
 
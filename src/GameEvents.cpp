@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2016 Daniel Becker <beckerdaniel.dani@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "GameEvents.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+using namespace std;
+
+namespace tetris {
+
+GameEventSource::GameEventSource()
+  : m_listeners(), m_dispatch_depth(0), m_has_removed(false)
+{
+
+}
+
+GameEventSource::~GameEventSource()
+{
+
+}
+
+void GameEventSource::addEventListener(shared_ptr<GameEventListener> listener)
+{
+  if (listener == nullptr) {
+    throw invalid_argument("A null listener is not allowed.");
+  }
+
+  if (find(m_listeners.begin(), m_listeners.end(), listener)
+      == m_listeners.end()) {
+    m_listeners.push_back(listener);
+  }
+}
+
+void GameEventSource::removeEventListener(
+                            const shared_ptr<GameEventListener>& listener) {
+  if (m_dispatch_depth == 0) {
+    m_listeners.erase(remove(m_listeners.begin(), m_listeners.end(),
+                             listener),
+                      m_listeners.end());
+    return;
+  }
+
+  auto it = find(m_listeners.begin(), m_listeners.end(), listener);
+  if (it != m_listeners.end() && listener != nullptr) {
+    *it = nullptr;
+    m_has_removed = true;
+  }
+}
+
+void GameEventSource::endDispatch() {
+  if (--m_dispatch_depth == 0 && m_has_removed) {
+    m_listeners.erase(remove(m_listeners.begin(), m_listeners.end(), nullptr),
+                      m_listeners.end());
+    m_has_removed = false;
+  }
+}
+
+} // namespace tetris.
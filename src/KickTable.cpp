@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) 2016 Daniel Becker <beckerdaniel.dani@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "KickTable.h"
+
+#include <algorithm>
+#include <climits>
+
+using namespace std;
+
+namespace tetris {
+
+namespace {
+
+// The offsets are (vertical, horizontal) with the vertical axis pointing
+// down, so the "up" offsets of the usual tables are negative here. The
+// second index is 0 for clockwise and 1 for counter-clockwise rotations.
+
+const PackedCoords JLSTZ_KICKS[4][2][KickTable::MAX_KICKS] = {
+  { // 0 -> 1, 0 -> 3
+    {{0, 0}, {0, -1}, {-1, -1}, {2, 0}, {2, -1}},
+    {{0, 0}, {0, 1}, {-1, 1}, {2, 0}, {2, 1}}
+  },
+  { // 1 -> 2, 1 -> 0
+    {{0, 0}, {0, 1}, {1, 1}, {-2, 0}, {-2, 1}},
+    {{0, 0}, {0, 1}, {1, 1}, {-2, 0}, {-2, 1}}
+  },
+  { // 2 -> 3, 2 -> 1
+    {{0, 0}, {0, 1}, {-1, 1}, {2, 0}, {2, 1}},
+    {{0, 0}, {0, -1}, {-1, -1}, {2, 0}, {2, -1}}
+  },
+  { // 3 -> 0, 3 -> 2
+    {{0, 0}, {0, -1}, {1, -1}, {-2, 0}, {-2, -1}},
+    {{0, 0}, {0, -1}, {1, -1}, {-2, 0}, {-2, -1}}
+  }
+};
+
+const PackedCoords I_KICKS[4][2][KickTable::MAX_KICKS] = {
+  { // 0 -> 1, 0 -> 3
+    {{0, 0}, {0, -2}, {0, 1}, {1, -2}, {-2, 1}},
+    {{0, 0}, {0, -1}, {0, 2}, {-2, -1}, {1, 2}}
+  },
+  { // 1 -> 2, 1 -> 0
+    {{0, 0}, {0, -1}, {0, 2}, {-2, -1}, {1, 2}},
+    {{0, 0}, {0, 2}, {0, -1}, {-1, 2}, {2, -1}}
+  },
+  { // 2 -> 3, 2 -> 1
+    {{0, 0}, {0, 2}, {0, -1}, {-1, 2}, {2, -1}},
+    {{0, 0}, {0, 1}, {0, -2}, {2, 1}, {-1, -2}}
+  },
+  { // 3 -> 0, 3 -> 2
+    {{0, 0}, {0, 1}, {0, -2}, {2, 1}, {-1, -2}},
+    {{0, 0}, {0, -2}, {0, 1}, {1, -2}, {-2, 1}}
+  }
+};
+
+const PackedCoords NO_KICKS[4][2][KickTable::MAX_KICKS] = {};
+
+} // anonymous namespace.
+
+const int KickTable::MAX_KICKS;
+
+KickTable::KickTable(const Kicks* kicks, int kick_count)
+  : m_kicks(kicks), m_kick_count(kick_count)
+{
+
+}
+
+const KickTable& KickTable::forBBoxSize(int bbox_size) {
+  static const KickTable jlstz(&JLSTZ_KICKS, MAX_KICKS);
+  static const KickTable i(&I_KICKS, MAX_KICKS);
+  static const KickTable none(&NO_KICKS, 1);
+
+  switch (bbox_size) {
+  case 3: return jlstz;
+  case 4: return i;
+  default: return none;
+  }
+}
+
+int KickTable::getOrientation(const PackedCoords* positions, size_t count,
+                              int bbox_size) {
+  if (count == 0) {
+    return 0;
+  }
+
+  int min_v = INT_MAX, max_v = INT_MIN, min_h = INT_MAX, max_h = INT_MIN;
+  for (size_t i = 0; i < count; ++i) {
+    min_v = min(min_v, positions[i].getVertical());
+    max_v = max(max_v, positions[i].getVertical());
+    min_h = min(min_h, positions[i].getHorizontal());
+    max_h = max(max_h, positions[i].getHorizontal());
+  }
+
+  // Twice the offset of the centre of the blocks from that of the bounding
+  // box, so that it stays an integer.
+  int offset_v = min_v + max_v - (bbox_size - 1);
+  int offset_h = min_h + max_h - (bbox_size - 1);
+  if (offset_v < 0) { return 0; }
+  if (offset_h > 0) { return 1; }
+  if (offset_v > 0) { return 2; }
+  if (offset_h < 0) { return 3; }
+  return 0;
+}
+
+int KickTable::getKickCount() const {
+  return m_kick_count;
+}
+
+const PackedCoords* KickTable::getKicks(int from, bool clockwise) const {
+  return (*m_kicks)[from & 3][clockwise ? 0 : 1];
+}
+
+} // namespace tetris.
@@ -0,0 +1,212 @@
+/*
+ * Copyright (C) 2016 Daniel Becker <beckerdaniel.dani@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Match.h"
+
+#include <random>
+#include <stdexcept>
+
+#include "BasicBlock.h"
+#include "BasicBoard.h"
+#include "DefaultGame.h"
+#include "DefaultGameBoard.h"
+#include "PoolAllocator.h"
+#include "Shape.h"
+
+using namespace std;
+
+namespace tetris {
+
+/** \cond PIMPL */
+
+class Match::PIMPL
+{
+public:
+  PIMPL(int height, int width, vector<shared_ptr<Shape>> shapes,
+        unsigned int seed)
+    : m_random_engine(seed), m_garbage_block(make_shared<BasicBlock>())
+  {
+    for (int player = 0; player < 2; ++player) {
+      m_boards[player] = make_shared<BasicBoard>(height, width);
+      m_game_boards[player] = make_shared<DefaultGameBoard>(m_boards[player]);
+      m_games[player] = make_shared<DefaultGame>(m_game_boards[player], shapes,
+                                                 seed);
+      m_games[player]->setAllocationPool(make_shared<PoolResource>());
+      m_games[player]->newGame();
+      m_lost[player] = false;
+    }
+  }
+
+  shared_ptr<Board> m_boards[2];
+  shared_ptr<DefaultGameBoard> m_game_boards[2];
+  shared_ptr<DefaultGame> m_games[2];
+  bool m_lost[2];
+  mt19937 m_random_engine;
+  shared_ptr<Block> m_garbage_block;
+
+  void checkPlayer(int player) const {
+    if (player < 0 || player > 1) {
+      throw invalid_argument("The player index must be 0 or 1.");
+    }
+  }
+
+  bool isOver() const {
+    return m_lost[0] || m_lost[1];
+  }
+
+  void updateLost(int player) {
+    if (m_games[player]->isGameOver()) {
+      m_lost[player] = true;
+    }
+  }
+
+  void addGarbage(int player, int lines) {
+    if (lines <= 0 || m_lost[player]) { return; }
+
+    Board& board = *m_boards[player];
+    // The garbage must not push blocks off the top of the board.
+    for (int v = 0; v < min(lines, board.getHeight()); ++v) {
+      for (int h = 0; h < board.getWidth(); ++h) {
+        if (board.isFilled(v, h)) {
+          m_lost[player] = true;
+          return;
+        }
+      }
+    }
+
+    vector<shared_ptr<Block>> pattern(board.getWidth(), m_garbage_block);
+    pattern[m_random_engine() % board.getWidth()] = nullptr;
+    board.insertRowsAtBottom(lines, pattern);
+
+    // Lifting the current shape out of the garbage, through the hidden rows
+    // if necessary.
+    DefaultGameBoard& game_board = *m_game_boards[player];
+    Coords pos = game_board.getCurrentShapePosition();
+    for (int i = 0; i <= lines && !game_board.isAtValidPos(); ++i) {
+      pos -= Coords(1, 0);
+      game_board.setCurrentShapePosition(pos);
+    }
+    if (!game_board.isAtValidPos()) {
+      m_lost[player] = true;
+    }
+  }
+}; // PIMPL
+
+/** \endcond */
+
+Match::Match(int height, int width, vector<shared_ptr<Shape>> shapes,
+             unsigned int seed)
+  : m_pimpl(new PIMPL(height, width, shapes, seed))
+{
+
+}
+
+Match::~Match()
+{
+  delete m_pimpl;
+  m_pimpl = nullptr;
+}
+
+shared_ptr<const DefaultGame> Match::getGame(int player) const {
+  m_pimpl->checkPlayer(player);
+  return m_pimpl->m_games[player];
+}
+
+const GameBoard& Match::getGameBoard(int player) const {
+  m_pimpl->checkPlayer(player);
+  return *m_pimpl->m_game_boards[player];
+}
+
+void Match::addEventListener(int player,
+                             shared_ptr<GameEventListener> listener) {
+  m_pimpl->checkPlayer(player);
+  m_pimpl->m_games[player]->addEventListener(listener);
+}
+
+void Match::removeEventListener(int player,
+                                shared_ptr<GameEventListener> listener) {
+  m_pimpl->checkPlayer(player);
+  m_pimpl->m_games[player]->removeEventListener(listener);
+}
+
+int Match::apply(int player, Action action) {
+  m_pimpl->checkPlayer(player);
+  if (isOver()) { return 0; }
+
+  DefaultGame& game = *m_pimpl->m_games[player];
+  int rows = 0;
+  switch (action) {
+  case Action::MOVE_LEFT: game.moveLeft(); break;
+  case Action::MOVE_RIGHT: game.moveRight(); break;
+  case Action::ROTATE_LEFT: game.rotateLeft(); break;
+  case Action::ROTATE_RIGHT: game.rotateRight(); break;
+  case Action::DROP: rows = game.drop(); break;
+  case Action::NONE: rows = game.advance(); break;
+  }
+
+  m_pimpl->updateLost(player);
+  if (!m_pimpl->m_lost[player]) {
+    m_pimpl->addGarbage(1 - player, getGarbageLines(rows));
+  }
+  return rows;
+}
+
+void Match::advance() {
+  if (isOver()) { return; }
+
+  int rows[2];
+  for (int player = 0; player < 2; ++player) {
+    rows[player] = m_pimpl->m_games[player]->advance();
+    m_pimpl->updateLost(player);
+  }
+  // The garbage is exchanged after both games have advanced, so the order of
+  // the players does not matter.
+  for (int player = 0; player < 2; ++player) {
+    if (!m_pimpl->m_lost[player]) {
+      m_pimpl->addGarbage(1 - player, getGarbageLines(rows[player]));
+    }
+  }
+}
+
+void Match::addGarbage(int player, int lines) {
+  m_pimpl->checkPlayer(player);
+  m_pimpl->addGarbage(player, lines);
+}
+
+int Match::getGarbageLines(int rows) {
+  if (rows >= 4) {
+    return rows;
+  }
+  return rows > 1 ? rows - 1 : 0;
+}
+
+bool Match::hasLost(int player) const {
+  m_pimpl->checkPlayer(player);
+  return m_pimpl->m_lost[player];
+}
+
+bool Match::isOver() const {
+  return m_pimpl->isOver();
+}
+
+int Match::getWinner() const {
+  if (m_pimpl->m_lost[0] == m_pimpl->m_lost[1]) {
+    return -1;
+  }
+  return m_pimpl->m_lost[0] ? 1 : 0;
+}
+
+} // namespace tetris.
@@ -0,0 +1,240 @@
+/*
+ * Copyright (C) 2016 Daniel Becker <beckerdaniel.dani@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "MatchProtocol.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "Board.h"
+#include "GameBoard.h"
+
+using namespace std;
+
+namespace tetris {
+
+namespace {
+
+void putU16(vector<uint8_t>& out, uint16_t value) {
+  out.push_back(value & 0xFFu);
+  out.push_back(value >> 8);
+}
+
+void putU32(vector<uint8_t>& out, uint32_t value) {
+  putU16(out, value & 0xFFFFu);
+  putU16(out, value >> 16);
+}
+
+// Reads little-endian integers from a payload, remembering whether it ran
+// past the end.
+class ByteReader
+{
+public:
+  explicit ByteReader(const vector<uint8_t>& data)
+    : m_data(data), m_offset(0), m_ok(true) {}
+
+  uint8_t u8() {
+    if (m_offset + 1 > m_data.size()) { m_ok = false; return 0; }
+    return m_data[m_offset++];
+  }
+
+  uint16_t u16() {
+    uint16_t low = u8();
+    return low | (static_cast<uint16_t>(u8()) << 8);
+  }
+
+  uint32_t u32() {
+    uint32_t low = u16();
+    return low | (static_cast<uint32_t>(u16()) << 16);
+  }
+
+  size_t remaining() const { return m_data.size() - m_offset; }
+  const uint8_t* current() const { return m_data.data() + m_offset; }
+  bool ok() const { return m_ok; }
+
+private:
+  const vector<uint8_t>& m_data;
+  size_t m_offset;
+  bool m_ok;
+};
+
+} // anonymous namespace.
+
+const size_t FrameReader::HEADER_SIZE;
+
+size_t getMaxStateFrameLength(int height, int width, size_t shape_blocks) {
+  size_t cells = static_cast<size_t>(height)
+                 * ((static_cast<size_t>(width) + 7) / 8);
+  // The type, the player, the sequence number, the game over flag, the
+  // block count, 4 bytes per block, the size of the board and the cells.
+  size_t state = 1 + 1 + 4 + 1 + 1 + 4 * shape_blocks + 4 + cells;
+  // The type, the player, the tick, the game over flag, the size of the
+  // board, the block count, the position, 2 bytes per block and the cells.
+  size_t keyframe = 1 + 1 + 4 + 1 + 4 + 1 + 4 + 2 * shape_blocks + cells;
+  return max(state, keyframe);
+}
+
+size_t beginFrame(vector<uint8_t>& out, MessageType type) {
+  size_t start = out.size();
+  putU16(out, 0);
+  out.push_back(static_cast<uint8_t>(type));
+  return start;
+}
+
+void endFrame(vector<uint8_t>& out, size_t start) {
+  size_t length = out.size() - start - FrameReader::HEADER_SIZE;
+  if (length > MAX_FRAME_LENGTH) {
+    throw invalid_argument("The message is too large for a frame.");
+  }
+  out[start] = length & 0xFFu;
+  out[start + 1] = length >> 8;
+}
+
+void encodeCells(vector<uint8_t>& out, const Board& board) {
+  int height = board.getHeight();
+  int width = board.getWidth();
+  for (int v = 0; v < height; ++v) {
+    // Whole words of the row at a time where the board stores its rows as
+    // bits, byte by byte otherwise.
+    for (int h = 0; h < width; h += 8) {
+      uint64_t bits = board.getRowBits(v, h, 0xFFu);
+      bits &= ~board.getWallBits(h);
+      out.push_back(static_cast<uint8_t>(bits));
+    }
+  }
+}
+
+void encodeJoin(vector<uint8_t>& out) {
+  endFrame(out, beginFrame(out, MessageType::JOIN));
+}
+
+void encodeInput(vector<uint8_t>& out, Action action) {
+  size_t start = beginFrame(out, MessageType::INPUT);
+  out.push_back(static_cast<uint8_t>(action));
+  endFrame(out, start);
+}
+
+void encodeMatchStart(vector<uint8_t>& out, uint32_t match_id, int player,
+                      int height, int width) {
+  size_t start = beginFrame(out, MessageType::MATCH_START);
+  putU32(out, match_id);
+  out.push_back(player);
+  putU16(out, height);
+  putU16(out, width);
+  endFrame(out, start);
+}
+
+void encodeState(vector<uint8_t>& out, int player, uint32_t sequence,
+                 bool game_over, const GameBoard& game_board) {
+  const Board& board = *game_board.getBoard();
+  int height = board.getHeight();
+  int width = board.getWidth();
+
+  size_t start = beginFrame(out, MessageType::STATE);
+  out.push_back(player);
+  putU32(out, sequence);
+  out.push_back(game_over ? 1 : 0);
+
+  vector<Coords> shape = game_board.getAbsolutePositions();
+  out.push_back(shape.size());
+  for (const Coords& c : shape) {
+    putU16(out, static_cast<uint16_t>(c.getVertical()));
+    putU16(out, static_cast<uint16_t>(c.getHorizontal()));
+  }
+
+  putU16(out, height);
+  putU16(out, width);
+  encodeCells(out, board);
+  endFrame(out, start);
+}
+
+void encodeMatchEnd(vector<uint8_t>& out, int winner) {
+  size_t start = beginFrame(out, MessageType::MATCH_END);
+  out.push_back(winner < 0 ? 255 : winner);
+  endFrame(out, start);
+}
+
+bool decodeState(const vector<uint8_t>& payload, MatchState& state) {
+  ByteReader reader(payload);
+  state.player = reader.u8();
+  state.sequence = reader.u32();
+  state.game_over = reader.u8() != 0;
+
+  int count = reader.u8();
+  state.shape.clear();
+  for (int i = 0; i < count; ++i) {
+    int16_t vertical = reader.u16();
+    int16_t horizontal = reader.u16();
+    state.shape.emplace_back(vertical, horizontal);
+  }
+
+  state.height = reader.u16();
+  state.width = reader.u16();
+  size_t size = static_cast<size_t>(state.height) * state.getRowBytes();
+  if (!reader.ok() || reader.remaining() != size) {
+    return false;
+  }
+  state.cells.assign(reader.current(), reader.current() + size);
+  return true;
+}
+
+FrameReader::FrameReader(size_t max_frame_length)
+  : m_buffer(), m_offset(0),
+    m_max_frame_length(min(max_frame_length, MAX_FRAME_LENGTH))
+{
+
+}
+
+void FrameReader::append(const uint8_t* data, size_t size) {
+  // Dropping the bytes that have been taken before growing the buffer.
+  if (m_offset > 0 && m_offset == m_buffer.size()) {
+    m_buffer.clear();
+    m_offset = 0;
+  } else if (m_offset > 4096) {
+    m_buffer.erase(m_buffer.begin(), m_buffer.begin() + m_offset);
+    m_offset = 0;
+  }
+  m_buffer.insert(m_buffer.end(), data, data + size);
+}
+
+bool FrameReader::next(MessageType& type, vector<uint8_t>& payload) {
+  if (getBufferedSize() < HEADER_SIZE) {
+    return false;
+  }
+
+  size_t length = m_buffer[m_offset] | (m_buffer[m_offset + 1] << 8);
+  if (length == 0) {
+    throw invalid_argument("A frame without a type is not allowed.");
+  }
+  if (length > m_max_frame_length) {
+    throw invalid_argument("The frame is too long.");
+  }
+  if (getBufferedSize() < HEADER_SIZE + length) {
+    return false;
+  }
+
+  const uint8_t* frame = m_buffer.data() + m_offset + HEADER_SIZE;
+  type = static_cast<MessageType>(frame[0]);
+  payload.assign(frame + 1, frame + length);
+  m_offset += HEADER_SIZE + length;
+  return true;
+}
+
+size_t FrameReader::getBufferedSize() const {
+  return m_buffer.size() - m_offset;
+}
+
+} // namespace tetris.
@@ -0,0 +1,659 @@
+/*
+ * Copyright (C) 2016 Daniel Becker <beckerdaniel.dani@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "MatchServer.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+#include <system_error>
+#include <unordered_map>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include "DefaultGame.h"
+#include "Match.h"
+#include "MatchProtocol.h"
+#include "SpectatorStream.h"
+
+using namespace std;
+
+namespace tetris {
+
+namespace {
+
+// A client that lets this much output pile up is dropped instead of letting
+// it hold the memory of the server.
+const size_t MAX_PENDING_OUTPUT = 1024 * 1024;
+
+// The clients only send short frames, so a longer one drops the client before
+// its bytes are buffered.
+const size_t MAX_CLIENT_FRAME_LENGTH = 64;
+
+const int MAX_EVENTS = 256;
+
+system_error systemError(const char* what) {
+  return system_error(errno, system_category(), what);
+}
+
+} // anonymous namespace.
+
+/** \cond PIMPL */
+
+class MatchServer::PIMPL
+{
+public:
+  PIMPL(int height, int width, vector<shared_ptr<Shape>> shapes,
+        unsigned int seed, uint16_t port, int gravity_ms, bool loopback_only)
+    : m_height(height), m_width(width), m_shapes(shapes), m_seed(seed)
+  {
+    if (height < 1 || width < 1) {
+      throw invalid_argument("The boards must not be empty.");
+    }
+    if (gravity_ms < 0) {
+      throw invalid_argument("The gravity interval must not be negative.");
+    }
+    // Rejecting the boards whose state cannot be framed here, rather than
+    // failing to send it from poll.
+    size_t shape_blocks = 0;
+    for (const shared_ptr<Shape>& shape : shapes) {
+      shape_blocks = max(shape_blocks, shape->getBlockCount());
+    }
+    if (height > 0xFFFF || width > 0xFFFF || shape_blocks > 0xFF
+        || getMaxStateFrameLength(height, width, shape_blocks)
+           > MAX_FRAME_LENGTH) {
+      throw invalid_argument("The state of the boards does not fit in a "
+                             "frame.");
+    }
+
+    try {
+      setUp(port, gravity_ms, loopback_only);
+    } catch (...) {
+      closeAll();
+      throw;
+    }
+  }
+
+  ~PIMPL() {
+    for (auto& entry : m_connections) {
+      ::close(entry.first);
+    }
+    closeAll();
+  }
+
+  void poll(int timeout_ms) {
+    epoll_event events[MAX_EVENTS];
+    int count = epoll_wait(m_epoll_fd, events, MAX_EVENTS, timeout_ms);
+    if (count < 0) {
+      if (errno == EINTR) { return; }
+      throw systemError("epoll_wait");
+    }
+
+    for (int i = 0; i < count; ++i) {
+      int fd = events[i].data.fd;
+      if (fd == m_listen_fd) {
+        acceptClients();
+      } else if (fd == m_wake_fd) {
+        uint64_t value;
+        while (::read(m_wake_fd, &value, sizeof(value)) > 0) {}
+      } else if (fd == m_timer_fd) {
+        uint64_t expirations;
+        while (::read(m_timer_fd, &expirations, sizeof(expirations)) > 0) {}
+        applyGravity();
+      } else {
+        handleClient(fd, events[i].events);
+      }
+    }
+
+    // Closing only now, so that no descriptor of this batch can be reused by
+    // a new connection while its events are still being handled.
+    for (int fd : m_to_close) {
+      closeClient(fd);
+    }
+    m_to_close.clear();
+  }
+
+  void run() {
+    while (!m_stop.load()) {
+      poll(-1);
+    }
+    m_stop.store(false);
+  }
+
+  void stop() {
+    m_stop.store(true);
+    uint64_t one = 1;
+    // The counter of the eventfd cannot overflow here in practice, and a
+    // failed write still leaves the flag set for the next wake-up.
+    ssize_t res = ::write(m_wake_fd, &one, sizeof(one));
+    (void) res;
+  }
+
+  int m_height;
+  int m_width;
+  vector<shared_ptr<Shape>> m_shapes;
+  unsigned int m_seed;
+  uint16_t m_port = 0;
+  atomic<int> m_client_count {0};
+  atomic<int> m_match_count {0};
+
+private:
+  struct Connection {
+    FrameReader reader {MAX_CLIENT_FRAME_LENGTH};
+    vector<uint8_t> output {};
+    size_t output_offset = 0;
+    bool writing = false;
+    bool closing = false;
+    uint32_t match_id = 0; // 0 if not in a match.
+    int player = 0;
+    uint32_t spectating = 0; // The match watched, 0 if none.
+  };
+
+  struct MatchSlot {
+    unique_ptr<Match> match;
+    int fds[2];
+    uint32_t sequence;
+    // Created when the first spectator arrives.
+    shared_ptr<SpectatorEncoder> encoders[2];
+    vector<int> spectators;
+  };
+
+  void setUp(uint16_t port, int gravity_ms, bool loopback_only) {
+    m_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (m_epoll_fd < 0) { throw systemError("epoll_create1"); }
+
+    m_listen_fd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC,
+                           0);
+    if (m_listen_fd < 0) { throw systemError("socket"); }
+    int one = 1;
+    setsockopt(m_listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(loopback_only ? INADDR_LOOPBACK
+                                                  : INADDR_ANY);
+    if (::bind(m_listen_fd, reinterpret_cast<sockaddr*>(&address),
+               sizeof(address)) < 0) {
+      throw systemError("bind");
+    }
+    if (::listen(m_listen_fd, SOMAXCONN) < 0) {
+      throw systemError("listen");
+    }
+    socklen_t length = sizeof(address);
+    if (getsockname(m_listen_fd, reinterpret_cast<sockaddr*>(&address),
+                    &length) < 0) {
+      throw systemError("getsockname");
+    }
+    m_port = ntohs(address.sin_port);
+    watch(m_listen_fd, EPOLLIN);
+
+    m_wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (m_wake_fd < 0) { throw systemError("eventfd"); }
+    watch(m_wake_fd, EPOLLIN);
+
+    if (gravity_ms > 0) {
+      m_timer_fd = timerfd_create(CLOCK_MONOTONIC,
+                                  TFD_NONBLOCK | TFD_CLOEXEC);
+      if (m_timer_fd < 0) { throw systemError("timerfd_create"); }
+      itimerspec spec;
+      spec.it_interval.tv_sec = gravity_ms / 1000;
+      spec.it_interval.tv_nsec = (gravity_ms % 1000) * 1000000L;
+      spec.it_value = spec.it_interval;
+      if (timerfd_settime(m_timer_fd, 0, &spec, nullptr) < 0) {
+        throw systemError("timerfd_settime");
+      }
+      watch(m_timer_fd, EPOLLIN);
+    }
+  }
+
+  void closeAll() {
+    for (int* fd : {&m_timer_fd, &m_wake_fd, &m_listen_fd, &m_epoll_fd}) {
+      if (*fd >= 0) {
+        ::close(*fd);
+        *fd = -1;
+      }
+    }
+  }
+
+  void watch(int fd, uint32_t events) {
+    epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = events;
+    event.data.fd = fd;
+    if (epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0) {
+      throw systemError("epoll_ctl");
+    }
+  }
+
+  void setWriting(int fd, Connection& connection, bool writing) {
+    if (connection.writing == writing) { return; }
+    epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN | (writing ? EPOLLOUT : 0u);
+    event.data.fd = fd;
+    if (epoll_ctl(m_epoll_fd, EPOLL_CTL_MOD, fd, &event) < 0) {
+      throw systemError("epoll_ctl");
+    }
+    connection.writing = writing;
+  }
+
+  void acceptClients() {
+    while (true) {
+      int fd = accept4(m_listen_fd, nullptr, nullptr,
+                       SOCK_NONBLOCK | SOCK_CLOEXEC);
+      if (fd < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR
+            || errno == ECONNABORTED) {
+          return;
+        }
+        // Running out of descriptors is survivable: the pending connections
+        // are accepted once some clients have left.
+        if (errno == EMFILE || errno == ENFILE) { return; }
+        throw systemError("accept4");
+      }
+
+      int one = 1;
+      setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+      watch(fd, EPOLLIN);
+      m_connections.emplace(fd, Connection());
+      ++m_client_count;
+    }
+  }
+
+  void handleClient(int fd, uint32_t events) {
+    auto it = m_connections.find(fd);
+    if (it == m_connections.end() || it->second.closing) { return; }
+    Connection& connection = it->second;
+
+    if (events & (EPOLLERR | EPOLLHUP)) {
+      requestClose(fd, connection);
+      return;
+    }
+    if (events & EPOLLOUT) {
+      flush(fd, connection);
+    }
+    if (events & EPOLLIN) {
+      receive(fd, connection);
+    }
+  }
+
+  void receive(int fd, Connection& connection) {
+    uint8_t buffer[4096];
+    MessageType type;
+    while (!connection.closing) {
+      ssize_t received = ::read(fd, buffer, sizeof(buffer));
+      if (received > 0) {
+        // Handling the frames of every chunk as it arrives, so that the
+        // reader never holds more than a chunk and a partial frame.
+        connection.reader.append(buffer, received);
+        try {
+          while (!connection.closing
+                 && connection.reader.next(type, m_payload)) {
+            handleMessage(fd, connection, type);
+          }
+        } catch (const invalid_argument&) {
+          requestClose(fd, connection);
+        }
+        continue;
+      }
+      if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        break;
+      }
+      if (received < 0 && errno == EINTR) {
+        continue;
+      }
+      // The client has closed the connection or it has failed.
+      requestClose(fd, connection);
+      return;
+    }
+  }
+
+  void handleMessage(int fd, Connection& connection, MessageType type) {
+    switch (type) {
+    case MessageType::JOIN:
+      if (connection.match_id == 0 && connection.spectating == 0
+          && m_waiting_fd != fd) {
+        join(fd);
+      }
+      break;
+    case MessageType::SPECTATE:
+      if (m_payload.size() != 4) {
+        requestClose(fd, connection);
+      } else if (connection.match_id == 0 && connection.spectating == 0
+                 && m_waiting_fd != fd) {
+        spectate(fd, connection, m_payload[0] | (m_payload[1] << 8)
+                                 | (m_payload[2] << 16)
+                                 | (static_cast<uint32_t>(m_payload[3]) << 24));
+      }
+      break;
+    case MessageType::INPUT:
+      if (m_payload.size() != 1
+          || m_payload[0] > static_cast<uint8_t>(Action::DROP)) {
+        requestClose(fd, connection);
+      } else if (connection.match_id != 0) {
+        MatchSlot& slot = m_matches.at(connection.match_id);
+        slot.match->apply(connection.player,
+                          static_cast<Action>(m_payload[0]));
+        update(connection.match_id, slot);
+      }
+      break;
+    default:
+      // Only the server sends the other messages.
+      requestClose(fd, connection);
+      break;
+    }
+  }
+
+  void join(int fd) {
+    if (m_waiting_fd < 0) {
+      m_waiting_fd = fd;
+      return;
+    }
+
+    uint32_t id = m_next_match_id++;
+    if (m_next_match_id == 0) { m_next_match_id = 1; }
+
+    MatchSlot slot;
+    slot.match.reset(new Match(m_height, m_width, m_shapes, m_seed++));
+    slot.fds[0] = m_waiting_fd;
+    slot.fds[1] = fd;
+    slot.sequence = 0;
+    m_waiting_fd = -1;
+
+    for (int player = 0; player < 2; ++player) {
+      Connection& member = m_connections.at(slot.fds[player]);
+      member.match_id = id;
+      member.player = player;
+      m_message.clear();
+      encodeMatchStart(m_message, id, player, m_height, m_width);
+      send(slot.fds[player], member);
+    }
+
+    MatchSlot& stored = m_matches.emplace(id, move(slot)).first->second;
+    ++m_match_count;
+    update(id, stored);
+  }
+
+  void spectate(int fd, Connection& connection, uint32_t id) {
+    auto it = m_matches.find(id);
+    if (it == m_matches.end()) {
+      m_message.clear();
+      encodeMatchEnd(m_message, -1);
+      send(fd, connection);
+      return;
+    }
+
+    MatchSlot& slot = it->second;
+    for (int player = 0; player < 2; ++player) {
+      if (slot.encoders[player] == nullptr) {
+        slot.encoders[player] = make_shared<SpectatorEncoder>(
+                                      *slot.match->getGame(player), player);
+        slot.match->addEventListener(player, slot.encoders[player]);
+      }
+      // The new spectator needs the whole state; the others get it too, as
+      // every spectator receives the same bytes.
+      slot.encoders[player]->requestKeyframe();
+    }
+    slot.spectators.push_back(fd);
+    connection.spectating = id;
+
+    m_message.clear();
+    stream(slot);
+    sendToSpectators(slot);
+  }
+
+  // Appends the next tick of both players to m_message.
+  void stream(MatchSlot& slot) {
+    for (int player = 0; player < 2; ++player) {
+      slot.encoders[player]->encodeTick(m_message);
+    }
+  }
+
+  // Sends the states of both players to both of them and ends the match if
+  // it is over.
+  void update(uint32_t id, MatchSlot& slot) {
+    ++slot.sequence;
+    m_message.clear();
+    for (int player = 0; player < 2; ++player) {
+      encodeState(m_message, player, slot.sequence,
+                  slot.match->hasLost(player),
+                  slot.match->getGameBoard(player));
+    }
+    if (slot.match->isOver()) {
+      encodeMatchEnd(m_message, slot.match->getWinner());
+    }
+    broadcast(slot);
+
+    // The encoders keep streaming while there are no spectators, so that
+    // their deltas do not pile up.
+    if (slot.encoders[0] != nullptr) {
+      m_message.clear();
+      stream(slot);
+      if (slot.match->isOver()) {
+        encodeMatchEnd(m_message, slot.match->getWinner());
+      }
+      sendToSpectators(slot);
+    }
+
+    if (slot.match->isOver()) {
+      endMatch(id);
+    }
+  }
+
+  void broadcast(const MatchSlot& slot) {
+    for (int fd : slot.fds) {
+      auto it = m_connections.find(fd);
+      if (it != m_connections.end()) {
+        send(fd, it->second);
+      }
+    }
+  }
+
+  void sendToSpectators(const MatchSlot& slot) {
+    for (int fd : slot.spectators) {
+      send(fd, m_connections.at(fd));
+    }
+  }
+
+  void endMatch(uint32_t id) {
+    auto it = m_matches.find(id);
+    if (it == m_matches.end()) { return; }
+    for (int fd : it->second.fds) {
+      auto connection = m_connections.find(fd);
+      if (connection != m_connections.end()) {
+        connection->second.match_id = 0;
+      }
+    }
+    for (int fd : it->second.spectators) {
+      m_connections.at(fd).spectating = 0;
+    }
+    for (int player = 0; player < 2; ++player) {
+      if (it->second.encoders[player] != nullptr) {
+        it->second.match->removeEventListener(player,
+                                              it->second.encoders[player]);
+      }
+    }
+    m_matches.erase(it);
+    --m_match_count;
+  }
+
+  void applyGravity() {
+    // Collecting the identifiers first, as finished matches are erased.
+    m_match_ids.clear();
+    for (auto& entry : m_matches) {
+      m_match_ids.push_back(entry.first);
+    }
+    for (uint32_t id : m_match_ids) {
+      MatchSlot& slot = m_matches.at(id);
+      slot.match->advance();
+      update(id, slot);
+    }
+  }
+
+  // Queues m_message for the client and writes as much as the socket takes.
+  void send(int fd, Connection& connection) {
+    if (connection.closing) { return; }
+    connection.output.insert(connection.output.end(), m_message.begin(),
+                             m_message.end());
+    if (connection.output.size() - connection.output_offset
+        > MAX_PENDING_OUTPUT) {
+      requestClose(fd, connection);
+      return;
+    }
+    if (!connection.writing) {
+      flush(fd, connection);
+    }
+  }
+
+  void flush(int fd, Connection& connection) {
+    while (connection.output_offset < connection.output.size()) {
+      ssize_t sent = ::send(fd, connection.output.data()
+                                + connection.output_offset,
+                            connection.output.size()
+                            - connection.output_offset, MSG_NOSIGNAL);
+      if (sent > 0) {
+        connection.output_offset += sent;
+      } else if (sent < 0 && errno == EINTR) {
+        continue;
+      } else if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        // A client that never catches up completely would otherwise keep
+        // every byte it was sent. Erasing once half of it is sent copies
+        // no more bytes than were sent.
+        if (connection.output_offset >= connection.output.size() / 2) {
+          connection.output.erase(connection.output.begin(),
+                                  connection.output.begin()
+                                  + connection.output_offset);
+          connection.output_offset = 0;
+        }
+        setWriting(fd, connection, true);
+        return;
+      } else {
+        requestClose(fd, connection);
+        return;
+      }
+    }
+
+    connection.output.clear();
+    connection.output_offset = 0;
+    setWriting(fd, connection, false);
+  }
+
+  // Only marks the client, as it may be in the middle of a broadcast; the
+  // socket is closed and its match forfeited at the end of the current batch
+  // of events.
+  void requestClose(int fd, Connection& connection) {
+    if (connection.closing) { return; }
+    connection.closing = true;
+    m_to_close.push_back(fd);
+    if (m_waiting_fd == fd) {
+      m_waiting_fd = -1;
+    }
+  }
+
+  void closeClient(int fd) {
+    Connection& connection = m_connections.at(fd);
+    if (connection.match_id != 0) {
+      uint32_t id = connection.match_id;
+      m_message.clear();
+      encodeMatchEnd(m_message, 1 - connection.player);
+      MatchSlot& slot = m_matches.at(id);
+      broadcast(slot);
+      sendToSpectators(slot);
+      endMatch(id);
+    }
+    if (connection.spectating != 0) {
+      vector<int>& spectators = m_matches.at(connection.spectating).spectators;
+      spectators.erase(find(spectators.begin(), spectators.end(), fd));
+    }
+
+    epoll_ctl(m_epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+    ::close(fd);
+    m_connections.erase(fd);
+    --m_client_count;
+  }
+
+  int m_epoll_fd = -1;
+  int m_listen_fd = -1;
+  int m_wake_fd = -1;
+  int m_timer_fd = -1;
+  atomic<bool> m_stop {false};
+
+  unordered_map<int, Connection> m_connections {};
+  unordered_map<uint32_t, MatchSlot> m_matches {};
+  uint32_t m_next_match_id = 1;
+  int m_waiting_fd = -1;
+  vector<int> m_to_close {};
+
+  // Scratch buffers reused across events.
+  vector<uint8_t> m_payload {};
+  vector<uint8_t> m_message {};
+  vector<uint32_t> m_match_ids {};
+}; // PIMPL
+
+/** \endcond */
+
+MatchServer::MatchServer(int height, int width,
+                         vector<shared_ptr<Shape>> shapes, unsigned int seed,
+                         uint16_t port, int gravity_ms, bool loopback_only)
+  : m_pimpl(new PIMPL(height, width, shapes, seed, port, gravity_ms,
+                      loopback_only))
+{
+
+}
+
+MatchServer::~MatchServer()
+{
+  delete m_pimpl;
+  m_pimpl = nullptr;
+}
+
+uint16_t MatchServer::getPort() const {
+  return m_pimpl->m_port;
+}
+
+void MatchServer::run() {
+  m_pimpl->run();
+}
+
+void MatchServer::poll(int timeout_ms) {
+  m_pimpl->poll(timeout_ms);
+}
+
+void MatchServer::stop() {
+  m_pimpl->stop();
+}
+
+int MatchServer::getClientCount() const {
+  return m_pimpl->m_client_count.load();
+}
+
+int MatchServer::getMatchCount() const {
+  return m_pimpl->m_match_count.load();
+}
+
+} // namespace tetris.
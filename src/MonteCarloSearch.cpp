@@ -0,0 +1,609 @@
+/*
+ * Copyright (C) 2016 Daniel Becker <beckerdaniel.dani@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "MonteCarloSearch.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <thread>
+
+#include "Board.h"
+#include "CollisionMask.h"
+#include "Game.h"
+#include "GameBoard.h"
+#include "PlacementForms.h"
+#include "Shape.h"
+
+using namespace std;
+
+namespace tetris {
+
+namespace {
+
+using detail::Form;
+using detail::Row;
+using detail::ShapeForms;
+
+typedef chrono::steady_clock Clock;
+
+// The ratings are summed in fixed point, as there is no atomic addition of
+// doubles in C++11.
+const double VALUE_SCALE = 1024.0;
+
+// The root and the placements of a piece must fit in any arena.
+const size_t MIN_TREE_NODES = 1024;
+
+const uint32_t NO_INDEX = numeric_limits<uint32_t>::max();
+
+enum NodeState : uint8_t {
+  UNEXPANDED,
+  EXPANDING,
+  EXPANDED,
+  LEAF // The arena was full when the node was expanded.
+};
+
+// A placement of a piece on a board and its rating right after it is made.
+struct Candidate
+{
+  uint8_t kind;
+  uint8_t form;
+  int8_t left;
+  int16_t top;
+  double rating;
+};
+
+// A placement in a tree. The children are the placements of the next piece,
+// one branch for each piece it may be.
+struct Node
+{
+  atomic<uint32_t> visits;
+  atomic<int64_t> value; // The sum of the ratings, times VALUE_SCALE.
+  atomic<uint8_t> state;
+  uint8_t kind;
+  uint8_t form;
+  int8_t left;
+  uint8_t branch_count;
+  uint32_t first_branch; // The branches of a node end where the next starts.
+
+  void init(const Candidate& candidate) {
+    visits.store(0, memory_order_relaxed);
+    value.store(0, memory_order_relaxed);
+    state.store(UNEXPANDED, memory_order_relaxed);
+    kind = candidate.kind;
+    form = candidate.form;
+    left = candidate.left;
+    branch_count = 0;
+    first_branch = 0;
+  }
+};
+
+// The arenas of a tree, allocated once and shared by the threads of the
+// tree.
+struct Tree
+{
+  explicit Tree(size_t capacity)
+    : nodes(new Node[capacity]), node_capacity(capacity), node_count(0),
+      branches(new uint32_t[capacity]), branch_capacity(capacity),
+      branch_count(0) {}
+
+  unique_ptr<Node[]> nodes;
+  size_t node_capacity;
+  atomic<size_t> node_count;
+  unique_ptr<uint32_t[]> branches; // The index of the first child of each.
+  size_t branch_capacity;
+  atomic<size_t> branch_count;
+};
+
+// Takes count elements of an arena, returning the index of the first or
+// NO_INDEX if the arena is full.
+uint32_t allocate(atomic<size_t>& used, size_t capacity, size_t count) {
+  size_t first = used.fetch_add(count, memory_order_relaxed);
+  return first + count <= capacity ? first : NO_INDEX;
+}
+
+// What a thread searches with; the buffers are reused by every rollout.
+struct Worker
+{
+  mt19937 engine {};
+  vector<Row> rows {};
+  vector<Row> scratch {};
+  vector<uint32_t> path {};
+  vector<Candidate> candidates {};
+  vector<size_t> branch_ends {};
+};
+
+} // anonymous namespace.
+
+/** \cond PIMPL */
+
+class MonteCarloSearch::PIMPL
+{
+public:
+  PIMPL(vector<shared_ptr<Shape>> shapes, MonteCarloConfig config)
+    : m_config(config)
+  {
+    if (shapes.empty() || shapes.size() > 255) {
+      throw invalid_argument("Between 1 and 255 shapes must be specified.");
+    }
+    if (m_config.rollout_depth < 0 || m_config.playout_randomness < 0.0
+        || m_config.playout_randomness > 1.0 || m_config.exploration < 0.0
+        || m_config.virtual_loss < 0.0) {
+      throw invalid_argument("A setting of the search is out of range.");
+    }
+    for (const shared_ptr<Shape>& shape : shapes) {
+      if (shape == nullptr) {
+        throw invalid_argument("A null shape is not allowed.");
+      }
+      m_shape_kinds.push_back(formsOf(*shape).kind);
+    }
+
+    if (m_config.threads == 0u) {
+      m_config.threads = max(1u, thread::hardware_concurrency());
+    }
+    m_config.trees = max(1u, min(m_config.trees, m_config.threads));
+    size_t tree_nodes = m_config.max_nodes / m_config.trees;
+    if (tree_nodes < MIN_TREE_NODES) {
+      throw invalid_argument("Too few nodes for the number of trees.");
+    }
+    for (unsigned int i = 0; i < m_config.trees; ++i) {
+      m_trees.emplace_back(new Tree(tree_nodes));
+    }
+    for (unsigned int i = 0; i < m_config.threads; ++i) {
+      m_workers.emplace_back(new Worker());
+    }
+  }
+
+  Placement search(const GameBoard& game_board,
+                   const vector<shared_ptr<const Shape>>& preview,
+                   chrono::microseconds budget, size_t max_rollouts) {
+    Clock::time_point deadline = Clock::now() + budget;
+
+    shared_ptr<const Shape> current = game_board.getCurrentShape();
+    if (current == nullptr) {
+      throw invalid_argument("There is no current shape to place.");
+    }
+    const Board& board = *game_board.getBoard();
+    if (board.getWidth() > CollisionMask::MAX_WIDTH) {
+      throw invalid_argument("The board is too wide for the search.");
+    }
+
+    const ShapeForms& current_forms = formsOf(*current);
+    m_known.assign(1, current_forms.kind);
+    for (const shared_ptr<const Shape>& shape : preview) {
+      m_known.push_back(formsOf(*shape).kind);
+    }
+
+    m_width = board.getWidth();
+    m_full = m_width == 64 ? ~Row(0) : (Row(1) << m_width) - 1;
+    m_rows.resize(board.getHeight());
+    for (int v = 0; v < board.getHeight(); ++v) {
+      m_rows[v] = board.getRowBits(v, 0, m_full);
+    }
+
+    // The children of the root are the placements the current shape can
+    // reach, the same in every tree and best rated first like the children
+    // of the other nodes.
+    Worker& first = *m_workers[0];
+    first.candidates.clear();
+    listPlacements(m_rows, current_forms.kind, first);
+    stable_sort(first.candidates.begin(), first.candidates.end(),
+                [](const Candidate& lhs, const Candidate& rhs) {
+                  return lhs.rating > rhs.rating;
+                });
+    m_root_candidates.clear();
+    m_root_placements.clear();
+    for (const Candidate& candidate : first.candidates) {
+      Placement placement = toPlacement(candidate, current_forms);
+      if (placement.valid && detail::isReachable(game_board, current_forms,
+                                                 placement)) {
+        m_root_candidates.push_back(candidate);
+        m_root_placements.push_back(placement);
+      }
+    }
+    m_rollouts.store(0);
+    if (m_root_candidates.empty()) {
+      for (unique_ptr<Tree>& tree : m_trees) {
+        tree->node_count.store(0);
+      }
+      return Placement();
+    }
+    for (unique_ptr<Tree>& tree : m_trees) {
+      initTree(*tree);
+    }
+
+    atomic<size_t> started(0);
+    auto work = [&](unsigned int index) {
+      Tree& tree = *m_trees[index % m_trees.size()];
+      Worker& worker = *m_workers[index];
+      worker.engine.seed(m_config.seed + m_search_count * m_workers.size()
+                         + index);
+      while (Clock::now() < deadline
+             && (max_rollouts == 0
+                 || started.fetch_add(1, memory_order_relaxed)
+                                                            < max_rollouts)) {
+        iterate(tree, worker);
+        m_rollouts.fetch_add(1, memory_order_relaxed);
+      }
+    };
+
+    // The calling thread searches too.
+    vector<thread> threads;
+    for (unsigned int i = 1; i < m_workers.size(); ++i) {
+      threads.emplace_back(work, i);
+    }
+    work(0);
+    for (thread& t : threads) {
+      t.join();
+    }
+    ++m_search_count;
+
+    return choose();
+  }
+
+  size_t getNodeCount() const {
+    size_t res = 0;
+    for (const unique_ptr<Tree>& tree : m_trees) {
+      res += min(tree->node_count.load(), tree->node_capacity);
+    }
+    return res;
+  }
+
+  MonteCarloConfig m_config;
+  atomic<size_t> m_rollouts {0};
+
+private:
+  // The kinds of pieces are kept in a byte of the nodes.
+  const ShapeForms& formsOf(const Shape& shape) {
+    const ShapeForms& res = m_forms.formsOf(shape);
+    if (res.kind >= 255) {
+      throw invalid_argument("Too many kinds of pieces for the search.");
+    }
+    return res;
+  }
+
+  Placement toPlacement(const Candidate& candidate,
+                        const ShapeForms& forms) const {
+    Placement res;
+    const Form& form = m_forms.getKind(candidate.kind).forms[candidate.form];
+    int rotation = find(forms.forms.begin(), forms.forms.end(), form)
+                   - forms.forms.begin();
+    if (rotation < 4) {
+      res.valid = true;
+      res.rotation = rotation;
+      res.horizontal = candidate.left - forms.masks[rotation].getLeft();
+    }
+    return res;
+  }
+
+  void initTree(Tree& tree) {
+    size_t count = m_root_candidates.size();
+    tree.node_count.store(1 + count);
+    tree.branch_count.store(2);
+
+    Node& root = tree.nodes[0];
+    root.init(Candidate());
+    root.branch_count = 1;
+    root.first_branch = 0;
+    root.state.store(EXPANDED, memory_order_relaxed);
+    tree.branches[0] = 1;
+    tree.branches[1] = 1 + count;
+    for (size_t i = 0; i < count; ++i) {
+      tree.nodes[1 + i].init(m_root_candidates[i]);
+    }
+  }
+
+  // Runs a rollout from the root: selects a path down the tree, expands its
+  // end, plays on from there and backs up the rating of the board it got
+  // to.
+  void iterate(Tree& tree, Worker& worker) {
+    vector<Row>& rows = worker.rows;
+    rows = m_rows;
+    worker.path.clear();
+    int64_t virtual_loss = llround(m_config.virtual_loss * VALUE_SCALE);
+
+    uint32_t index = 0;
+    int ply = 0;
+    int lines = 0;
+    bool lost = false;
+    while (true) {
+      Node& node = tree.nodes[index];
+      worker.path.push_back(index);
+      node.visits.fetch_add(1, memory_order_relaxed);
+      node.value.fetch_sub(virtual_loss, memory_order_relaxed);
+
+      uint8_t state = node.state.load(memory_order_acquire);
+      if (state == UNEXPANDED) {
+        if (node.state.compare_exchange_strong(state, EXPANDING,
+                                               memory_order_acquire)) {
+          expand(tree, node, rows, ply, worker);
+        }
+        break;
+      }
+      if (state != EXPANDED) {
+        break;
+      }
+
+      int branch = node.branch_count == 1
+                   ? 0 : worker.engine() % node.branch_count;
+      uint32_t begin = tree.branches[node.first_branch + branch];
+      uint32_t end = tree.branches[node.first_branch + branch + 1];
+      if (begin == end) {
+        lost = true; // The piece cannot be placed.
+        break;
+      }
+
+      index = selectChild(tree, node, begin, end);
+      const Node& child = tree.nodes[index];
+      lines += drop(rows, m_forms.getKind(child.kind).forms[child.form],
+                    child.left);
+      ++ply;
+    }
+
+    if (!lost) {
+      lost = !rollout(rows, ply, lines, worker);
+    }
+    double rating = lost ? m_config.loss_value
+                         : detail::rate(rows, m_width, lines, m_config.weights);
+    int64_t delta = llround(rating * VALUE_SCALE) + virtual_loss;
+    for (uint32_t i : worker.path) {
+      tree.nodes[i].value.fetch_add(delta, memory_order_relaxed);
+    }
+  }
+
+  // Adds the placements of the pieces that may come after the node as its
+  // children, best rated first in every branch.
+  void expand(Tree& tree, Node& node, const vector<Row>& rows, int ply,
+              Worker& worker) {
+    bool known = ply < static_cast<int>(m_known.size());
+    int branch_count = known ? 1 : m_shape_kinds.size();
+    worker.candidates.clear();
+    worker.branch_ends.clear();
+    for (int b = 0; b < branch_count; ++b) {
+      size_t begin = worker.candidates.size();
+      listPlacements(rows, known ? m_known[ply] : m_shape_kinds[b], worker);
+      stable_sort(worker.candidates.begin() + begin, worker.candidates.end(),
+                  [](const Candidate& lhs, const Candidate& rhs) {
+                    return lhs.rating > rhs.rating;
+                  });
+      worker.branch_ends.push_back(worker.candidates.size());
+    }
+
+    uint32_t first_child = allocate(tree.node_count, tree.node_capacity,
+                                    worker.candidates.size());
+    uint32_t first_branch = allocate(tree.branch_count, tree.branch_capacity,
+                                     branch_count + 1);
+    if (first_child == NO_INDEX || first_branch == NO_INDEX) {
+      node.state.store(LEAF, memory_order_release);
+      return;
+    }
+
+    for (size_t i = 0; i < worker.candidates.size(); ++i) {
+      tree.nodes[first_child + i].init(worker.candidates[i]);
+    }
+    tree.branches[first_branch] = first_child;
+    for (int b = 0; b < branch_count; ++b) {
+      tree.branches[first_branch + 1 + b] = first_child
+                                            + worker.branch_ends[b];
+    }
+    node.first_branch = first_branch;
+    node.branch_count = branch_count;
+    node.state.store(EXPANDED, memory_order_release);
+  }
+
+  // Chooses the child by UCB, trying the children that were not visited yet
+  // first, in the order of their ratings.
+  uint32_t selectChild(const Tree& tree, const Node& node, uint32_t begin,
+                       uint32_t end) const {
+    double log_visits = log(max(1u, node.visits.load(memory_order_relaxed)));
+    uint32_t res = begin;
+    double best = -numeric_limits<double>::infinity();
+    for (uint32_t i = begin; i < end; ++i) {
+      const Node& child = tree.nodes[i];
+      uint32_t visits = child.visits.load(memory_order_relaxed);
+      if (visits == 0) {
+        return i;
+      }
+      double mean = child.value.load(memory_order_relaxed)
+                    / (VALUE_SCALE * visits);
+      double score = mean + m_config.exploration * sqrt(log_visits / visits);
+      if (score > best) {
+        best = score;
+        res = i;
+      }
+    }
+    return res;
+  }
+
+  // Places rollout_depth more pieces with the playout policy: where they
+  // are rated best, or at random now and then. Returns false if a piece
+  // could not be placed.
+  bool rollout(vector<Row>& rows, int ply, int& lines, Worker& worker) {
+    uniform_real_distribution<double> chance(0.0, 1.0);
+    for (int i = 0; i < m_config.rollout_depth; ++i, ++ply) {
+      int kind = ply < static_cast<int>(m_known.size())
+                 ? m_known[ply]
+                 : m_shape_kinds[worker.engine() % m_shape_kinds.size()];
+      worker.candidates.clear();
+      listPlacements(rows, kind, worker);
+      if (worker.candidates.empty()) {
+        return false;
+      }
+
+      size_t choice = 0;
+      if (chance(worker.engine) < m_config.playout_randomness) {
+        choice = worker.engine() % worker.candidates.size();
+      } else {
+        for (size_t c = 1; c < worker.candidates.size(); ++c) {
+          if (worker.candidates[c].rating
+              > worker.candidates[choice].rating) {
+            choice = c;
+          }
+        }
+      }
+
+      const Candidate& candidate = worker.candidates[choice];
+      detail::place(rows, m_forms.getKind(kind).forms[candidate.form],
+                    candidate.left, candidate.top);
+      lines += detail::clearLines(rows, m_full);
+    }
+    return true;
+  }
+
+  // Appends the placements of a kind of piece dropped straight down onto
+  // the rows to the candidates of the worker.
+  void listPlacements(const vector<Row>& rows, int kind, Worker& worker) {
+    int tops[CollisionMask::MAX_WIDTH];
+    detail::findTops(rows, m_full, m_width, tops);
+
+    const vector<Form>& forms = m_forms.getKind(kind).forms;
+    for (size_t f = 0; f < forms.size(); ++f) {
+      const Form& form = forms[f];
+      for (int left = 0; left + form.width <= m_width; ++left) {
+        int top = detail::getDropTop(form, tops, left);
+        if (top < 0) {
+          continue; // The piece would stick out of the top of the board.
+        }
+
+        worker.scratch = rows;
+        detail::place(worker.scratch, form, left, top);
+        int lines = detail::clearLines(worker.scratch, m_full);
+
+        Candidate candidate;
+        candidate.kind = kind;
+        candidate.form = f;
+        candidate.left = left;
+        candidate.top = top;
+        candidate.rating = detail::rate(worker.scratch, m_width, lines,
+                                        m_config.weights);
+        worker.candidates.push_back(candidate);
+      }
+    }
+  }
+
+  // Drops a form onto the rows where it was placed when the node was
+  // expanded, returning the number of lines cleared.
+  int drop(vector<Row>& rows, const Form& form, int left) const {
+    int height = rows.size();
+    int top = height;
+    for (int c = 0; c < form.width; ++c) {
+      Row bit = Row(1) << (left + c);
+      int v = 0;
+      while (v < height && (rows[v] & bit) == 0) {
+        ++v;
+      }
+      top = min(top, v - 1 - form.bottoms[c]);
+    }
+    detail::place(rows, form, left, top);
+    return detail::clearLines(rows, m_full);
+  }
+
+  // Chooses the child of the root visited the most in all the trees, the
+  // better rated on ties. Until a child has been visited min_visits times,
+  // the visits say less than the ratings, so the best rated child is chosen.
+  Placement choose() const {
+    size_t best = 0;
+    uint64_t best_visits = 0;
+    double best_mean = 0.0;
+    for (size_t i = 0; i < m_root_candidates.size(); ++i) {
+      uint64_t visits = 0;
+      double value = 0.0;
+      for (const unique_ptr<Tree>& tree : m_trees) {
+        const Node& child = tree->nodes[1 + i];
+        visits += child.visits.load();
+        value += child.value.load() / VALUE_SCALE;
+      }
+      double mean = visits == 0 ? m_root_candidates[i].rating
+                                : value / visits;
+      if (i == 0 || visits > best_visits
+          || (visits == best_visits && mean > best_mean)) {
+        best = i;
+        best_visits = visits;
+        best_mean = mean;
+      }
+    }
+
+    if (best_visits < m_config.min_visits) {
+      // The candidates are sorted by their ratings.
+      best = 0;
+      best_mean = m_root_candidates[0].rating;
+    }
+    Placement res = m_root_placements[best];
+    res.value = best_mean;
+    return res;
+  }
+
+  detail::FormCache m_forms {};
+  vector<int> m_shape_kinds {}; // The kinds the unknown pieces are drawn from.
+  vector<unique_ptr<Tree>> m_trees {};
+  vector<unique_ptr<Worker>> m_workers {};
+  unsigned long m_search_count = 0;
+
+  // The state of the current search.
+  vector<int> m_known {}; // The kinds of the current piece and the preview.
+  vector<Row> m_rows {};
+  Row m_full = 0;
+  int m_width = 0;
+  vector<Candidate> m_root_candidates {};
+  vector<Placement> m_root_placements {};
+}; // PIMPL
+
+/** \endcond */
+
+MonteCarloSearch::MonteCarloSearch(vector<shared_ptr<Shape>> shapes,
+                                   MonteCarloConfig config)
+  : m_pimpl(new PIMPL(shapes, config))
+{
+
+}
+
+MonteCarloSearch::~MonteCarloSearch()
+{
+  delete m_pimpl;
+  m_pimpl = nullptr;
+}
+
+Placement MonteCarloSearch::search(const GameBoard& game_board,
+                                   const vector<shared_ptr<const Shape>>&
+                                                                      preview,
+                                   chrono::microseconds budget,
+                                   size_t max_rollouts) {
+  return m_pimpl->search(game_board, preview, budget, max_rollouts);
+}
+
+bool MonteCarloSearch::play(Game& game, chrono::microseconds budget,
+                            size_t max_rollouts) {
+  shared_ptr<const GameBoard> game_board = game.getGameBoard();
+  if (game.isGameOver() || game_board->getCurrentShape() == nullptr) {
+    return false;
+  }
+
+  Placement placement = search(*game_board, {}, budget, max_rollouts);
+  return playPlacement(game, placement) >= 0;
+}
+
+size_t MonteCarloSearch::getRolloutCount() const {
+  return m_pimpl->m_rollouts.load();
+}
+
+size_t MonteCarloSearch::getNodeCount() const {
+  return m_pimpl->getNodeCount();
+}
+
+} // namespace tetris.
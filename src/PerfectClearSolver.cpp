@@ -0,0 +1,561 @@
+/*
+ * Copyright (C) 2016 Daniel Becker <beckerdaniel.dani@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "PerfectClearSolver.h"
+
+#include <algorithm>
+#include <bitset>
+#include <cstdlib>
+#include <stdexcept>
+#include <unordered_set>
+
+#include "Board.h"
+#include "CollisionMask.h"
+#include "Shape.h"
+
+using namespace std;
+
+namespace tetris {
+
+namespace {
+
+typedef uint64_t Field;
+typedef CollisionMask::Row Row;
+
+const size_t MAX_QUEUE = 32;
+
+// The cells of every other column of a row.
+const uint64_t STRIPES = 0x5555555555555555ull;
+
+int popcount(uint64_t bits) {
+  return bitset<64>(bits).count();
+}
+
+// A piece in one orientation: the rows of its bounding box and where the
+// box is relative to the position of the shape.
+struct Rotation
+{
+  int top = 0;
+  int left = 0;
+  int height = 0;
+  int width = 0;
+  Row rows[CollisionMask::MAX_ROWS] = {};
+};
+
+// A queued piece in the four orientations that turning it to the right
+// reaches.
+struct Piece
+{
+  Rotation rotations[4];
+  int forms[4] = {}; // The first orientation of the same form.
+  int kind = 0;
+  int size = 0;
+  int imbalance = 0; // The most of any orientation, on the two colours of
+                     // the stripes.
+};
+
+// A state that was searched and cannot be cleared from.
+struct MemoKey
+{
+  Field field;
+  uint32_t rest; // The cleared rows, the queue index and the kind on hold.
+
+  bool operator==(const MemoKey& other) const {
+    return field == other.field && rest == other.rest;
+  }
+};
+
+struct MemoKeyHash
+{
+  size_t operator()(const MemoKey& key) const {
+    uint64_t x = key.field ^ (static_cast<uint64_t>(key.rest) << 40)
+                 ^ (static_cast<uint64_t>(key.rest) >> 24);
+    x = (x ^ (x >> 33)) * 0xFF51AFD7ED558CCDull;
+    return x ^ (x >> 33);
+  }
+};
+
+// Where a placement ends up, as the bounding box of its rotation.
+struct Landing
+{
+  int rotation;
+  int left;
+  int top;
+  Field cells;
+  int score;
+};
+
+} // anonymous namespace.
+
+/** \cond PIMPL */
+
+class PerfectClearSolver::PIMPL
+{
+public:
+  PIMPL(int height, bool use_hold) : m_height(height), m_use_hold(use_hold)
+  {
+    if (height < 1) {
+      throw invalid_argument("Zero or negative height is not allowed.");
+    }
+  }
+
+  bool solve(const Board& board,
+             const vector<shared_ptr<const Shape>>& queue,
+             vector<PerfectClearStep>& solution) {
+    m_width = board.getWidth();
+    if (m_width * m_height > 64) {
+      throw invalid_argument("The field must fit in 64 bits.");
+    }
+    if (m_height > board.getHeight()) {
+      throw invalid_argument("The field is higher than the board.");
+    }
+    if (queue.size() > MAX_QUEUE) {
+      throw invalid_argument("The queue is too long.");
+    }
+    m_row_offset = board.getHeight() - m_height;
+    m_visited = 0;
+    m_failed.clear();
+    m_steps.clear();
+
+    initPieces(queue);
+
+    Row full_row = m_width == 64 ? ~Row(0) : (Row(1) << m_width) - 1;
+    for (int v = 0; v < m_row_offset; ++v) {
+      if (board.getRowBits(v, 0, full_row) != 0) {
+        return false;
+      }
+    }
+    Field field = 0;
+    for (int r = 0; r < m_height; ++r) {
+      field |= board.getRowBits(m_row_offset + r, 0, full_row) << (r * m_width);
+    }
+    m_full_row = full_row;
+    m_field_cells = 0;
+    m_stripes = 0;
+    for (int r = 0; r < m_height; ++r) {
+      m_field_cells |= Field(full_row) << (r * m_width);
+      m_stripes |= Field(full_row & STRIPES) << (r * m_width);
+    }
+
+    // Full rows are cleared before the first piece, like the game would
+    // have.
+    int cleared = 0;
+    clearRows(field, cleared);
+
+    if (!search(field, cleared, 0, -1)) {
+      return false;
+    }
+    solution = m_steps;
+    return true;
+  }
+
+  size_t m_visited = 0;
+
+private:
+  void initPieces(const vector<shared_ptr<const Shape>>& queue) {
+    m_pieces.clear();
+    vector<vector<Row>> kinds;
+    m_gcd = 0;
+    m_max_size = 0;
+    for (const shared_ptr<const Shape>& shape : queue) {
+      if (shape == nullptr) {
+        throw invalid_argument("A null shape is not allowed.");
+      }
+
+      Piece piece;
+      vector<vector<Row>> forms;
+      shared_ptr<Shape> turned = shape->clone();
+      for (int r = 0; r < 4; ++r) {
+        CollisionMask mask(*turned);
+        Rotation& rotation = piece.rotations[r];
+        rotation.top = mask.getTop();
+        rotation.left = mask.getLeft();
+        rotation.height = mask.getHeight();
+        Row all = 0;
+        vector<Row> form;
+        for (int i = 0; i < rotation.height; ++i) {
+          rotation.rows[i] = mask.getRow(i);
+          all |= rotation.rows[i];
+          form.push_back(rotation.rows[i]);
+        }
+        while (rotation.width < CollisionMask::MAX_WIDTH
+               && (all >> rotation.width) != 0) {
+          ++rotation.width;
+        }
+        piece.forms[r] = find(forms.begin(), forms.end(), form)
+                         - forms.begin();
+        forms.push_back(form);
+        turned->rotateRight();
+      }
+
+      // The kind is told by the forms, whatever orientation it came in.
+      sort(forms.begin(), forms.end());
+      forms.erase(unique(forms.begin(), forms.end()), forms.end());
+      vector<Row> key;
+      for (const vector<Row>& form : forms) {
+        key.push_back(form.size());
+        key.insert(key.end(), form.begin(), form.end());
+      }
+      piece.kind = find(kinds.begin(), kinds.end(), key) - kinds.begin();
+      if (piece.kind == static_cast<int>(kinds.size())) {
+        kinds.push_back(key);
+      }
+
+      for (int i = 0; i < piece.rotations[0].height; ++i) {
+        piece.size += popcount(piece.rotations[0].rows[i]);
+      }
+      for (const Rotation& rotation : piece.rotations) {
+        int imbalance = 0;
+        for (int i = 0; i < rotation.height; ++i) {
+          Row row = rotation.rows[i];
+          imbalance += popcount(row & STRIPES) - popcount(row & ~STRIPES);
+        }
+        piece.imbalance = max(piece.imbalance, abs(imbalance));
+      }
+      m_gcd = gcd(m_gcd, piece.size);
+      m_max_size = max(m_max_size, piece.size);
+      m_pieces.push_back(piece);
+    }
+
+    m_balancing.assign(m_pieces.size() + 1, 0);
+    for (int i = m_pieces.size() - 1; i >= 0; --i) {
+      m_balancing[i] = m_balancing[i + 1] + m_pieces[i].imbalance;
+    }
+  }
+
+  static int gcd(int a, int b) {
+    while (b != 0) {
+      int t = a % b;
+      a = b;
+      b = t;
+    }
+    return a;
+  }
+
+  // Searches on from a state: the field with cleared rows gone from its
+  // top, the index of the current piece in the queue and the index of the
+  // piece on hold, or -1.
+  bool search(Field field, int cleared, int index, int hold) {
+    if (cleared == m_height) {
+      return true;
+    }
+    int count = m_pieces.size();
+    if (index >= count || isHopeless(field, cleared, index, hold)) {
+      return false;
+    }
+
+    MemoKey key;
+    key.field = field;
+    key.rest = cleared | index << 8
+               | (hold < 0 ? 0 : m_pieces[hold].kind + 1) << 16;
+    if (m_failed.count(key) != 0) {
+      return false;
+    }
+    ++m_visited;
+
+    // Placing the current piece.
+    if (tryPiece(field, cleared, index, false, index + 1, hold)) {
+      return true;
+    }
+
+    // Holding it and placing the one on hold or the next one instead,
+    // unless that is the same kind of piece.
+    if (m_use_hold) {
+      int other = hold < 0 ? index + 1 : hold;
+      if (other < count && m_pieces[other].kind != m_pieces[index].kind
+          && tryPiece(field, cleared, other, true,
+                      hold < 0 ? index + 2 : index + 1, index)) {
+        return true;
+      }
+    }
+
+    m_failed.insert(key);
+    return false;
+  }
+
+  bool tryPiece(Field field, int cleared, int piece, bool used_hold,
+                int next_index, int next_hold) {
+    size_t depth = m_steps.size();
+    if (m_landings.size() <= depth) {
+      m_landings.resize(depth + 1);
+    }
+    vector<Landing>& landings = m_landings[depth];
+    findLandings(field, cleared, m_pieces[piece], landings);
+    for (const Landing& landing : landings) {
+      Field next_field = field | landing.cells;
+      int next_cleared = cleared;
+      clearRows(next_field, next_cleared);
+
+      const Rotation& rotation = m_pieces[piece].rotations[landing.rotation];
+      PerfectClearStep step;
+      step.hold = used_hold;
+      step.rotation = landing.rotation;
+      step.position = Coords(m_row_offset + landing.top - rotation.top,
+                             landing.left - rotation.left);
+      m_steps.push_back(step);
+      if (search(next_field, next_cleared, next_index, next_hold)) {
+        return true;
+      }
+      m_steps.pop_back();
+    }
+    return false;
+  }
+
+  // Checks the counts of the empty cells: they must be filled by whole
+  // pieces, between every two full columns too, and the pieces left must
+  // be able to make up for the difference of the empty cells of the two
+  // colours of the stripes. Columns are coloured rather than cells, as a
+  // checkerboard would flip under the rows that a clear moves down.
+  bool isHopeless(Field field, int cleared, int index, int hold) const {
+    int rows = m_height - cleared;
+    Field cells = m_field_cells & ~((Field(1) << (cleared * m_width)) - 1);
+    Field empty_cells = cells & ~field;
+    int empty = popcount(empty_cells);
+    // Holding swaps pieces, so one piece is placed for every one left in
+    // the queue.
+    int pieces_left = m_pieces.size() - index;
+    if (empty % m_gcd != 0 || empty > pieces_left * m_max_size) {
+      return true;
+    }
+
+    int imbalance = popcount(empty_cells & m_stripes)
+                    - popcount(empty_cells & ~m_stripes);
+    int balancing = m_balancing[index]
+                    + (hold < 0 ? 0 : m_pieces[hold].imbalance);
+    if (abs(imbalance) > balancing) {
+      return true;
+    }
+
+    if (m_gcd != m_max_size) {
+      return false; // The pieces differ in size; any split may be filled.
+    }
+
+    int segment = 0;
+    for (int c = 0; c < m_width; ++c) {
+      int filled = 0;
+      for (int r = cleared; r < m_height; ++r) {
+        filled += (field >> (r * m_width + c)) & 1u;
+      }
+      if (filled == rows) {
+        if (segment % m_gcd != 0) { return true; }
+        segment = 0;
+      } else {
+        segment += rows - filled;
+      }
+    }
+    return segment % m_gcd != 0;
+  }
+
+  // Lists the distinct places the piece can be moved and turned to from
+  // above the field and locked at, inside the field. The places are found
+  // a row at a time: for every orientation and every top of its bounding
+  // box there is a mask of the lefts where it fits and another one of
+  // those that it reaches.
+  void findLandings(Field field, int cleared, const Piece& piece,
+                    vector<Landing>& landings) {
+    landings.clear();
+
+    // The tops of the bounding boxes start a full piece above the field.
+    int min_top = cleared - CollisionMask::MAX_ROWS;
+    int tops = m_height - min_top;
+    m_fits.resize(4 * (tops + 1));
+    m_reach.resize(4 * (tops + 1));
+    for (int r = 0; r < 4; ++r) {
+      const Rotation& rotation = piece.rotations[r];
+      Row* fits = &m_fits[r * (tops + 1)];
+      Row* reach = &m_reach[r * (tops + 1)];
+      for (int t = 0; t <= tops; ++t) {
+        fits[t] = fitsMask(field, rotation, min_top + t);
+
+        // Everything above the field is empty, so the piece gets anywhere
+        // there.
+        reach[t] = min_top + t + rotation.height <= cleared ? fits[t] : 0;
+      }
+    }
+
+    bool changed = true;
+    while (changed) {
+      changed = false;
+      for (int r = 0; r < 4; ++r) {
+        Row* fits = &m_fits[r * (tops + 1)];
+        Row* reach = &m_reach[r * (tops + 1)];
+        for (int t = 0; t < tops; ++t) {
+          Row row = reach[t];
+          if (t > 0) {
+            row |= reach[t - 1] & fits[t];
+          }
+          Row spread = row;
+          do {
+            row = spread;
+            spread = row | ((row << 1 | row >> 1) & fits[t]);
+          } while (spread != row);
+          changed = changed || row != reach[t];
+          reach[t] = row;
+        }
+      }
+
+      // Turning keeps the position of the shape, so the box moves by the
+      // difference of the offsets.
+      for (int r = 0; r < 4; ++r) {
+        const Rotation& rotation = piece.rotations[r];
+        const Row* reach = &m_reach[r * (tops + 1)];
+        for (int turn : {1, 3}) {
+          int to = (r + turn) % 4;
+          const Rotation& turned = piece.rotations[to];
+          int down = turned.top - rotation.top;
+          int right = turned.left - rotation.left;
+          const Row* to_fits = &m_fits[to * (tops + 1)];
+          Row* to_reach = &m_reach[to * (tops + 1)];
+          for (int t = max(0, -down); t < tops && t + down < tops; ++t) {
+            if (reach[t] == 0) { continue; }
+            Row moved = right >= 0 ? reach[t] << right : reach[t] >> -right;
+            Row added = moved & to_fits[t + down] & ~to_reach[t + down];
+            if (added != 0) {
+              to_reach[t + down] |= added;
+              changed = true;
+            }
+          }
+        }
+      }
+    }
+
+    // The piece locks where it cannot move down. Orientations of the same
+    // form land on the same cells, so only the first of them is listed.
+    for (int r = 0; r < 4; ++r) {
+      int form = piece.forms[r];
+      Row* reach = &m_reach[r * (tops + 1)];
+      const Row* fits = &m_fits[r * (tops + 1)];
+      for (int t = cleared - min_top; t < tops; ++t) {
+        Row landed = reach[t] & ~fits[t + 1];
+        if (form != r) {
+          Row* form_reach = &m_reach[form * (tops + 1)];
+          const Row* form_fits = &m_fits[form * (tops + 1)];
+          landed &= ~(form_reach[t] & ~form_fits[t + 1]);
+          form_reach[t] |= landed; // Keeps later orientations out.
+        }
+        for (; landed != 0; landed &= landed - 1) {
+          int left = __builtin_ctzll(landed);
+          Landing landing {r, left, min_top + t, 0, 0};
+          landing.cells = cellsOf(piece.rotations[r], left, min_top + t);
+          landings.push_back(landing);
+        }
+      }
+    }
+
+    // Trying the places that cover the fewest empty cells first, then the
+    // lowest ones.
+    Field below_field = ~field & m_field_cells;
+    for (Landing& landing : landings) {
+      Field under = (landing.cells << m_width) & below_field & ~landing.cells;
+      landing.score = popcount(under) * 64 - landing.top;
+    }
+    stable_sort(landings.begin(), landings.end(),
+                [](const Landing& lhs, const Landing& rhs) {
+                  return lhs.score < rhs.score;
+                });
+  }
+
+  // Returns the mask of the lefts where the bounding box of the rotation
+  // fits with the given top.
+  Row fitsMask(Field field, const Rotation& rotation, int top) const {
+    if (rotation.width > m_width) {
+      return 0;
+    }
+    Row blocked = 0;
+    for (int i = 0; i < rotation.height; ++i) {
+      int row = top + i;
+      if (row >= m_height) {
+        return 0;
+      }
+      if (row < 0) {
+        continue;
+      }
+      Row cells = (field >> (row * m_width)) & m_full_row;
+      for (Row piece = rotation.rows[i]; piece != 0; piece &= piece - 1) {
+        blocked |= cells >> __builtin_ctzll(piece);
+      }
+    }
+    return (m_full_row >> (rotation.width - 1)) & ~blocked;
+  }
+
+  Field cellsOf(const Rotation& rotation, int left, int top) const {
+    Field res = 0;
+    for (int i = 0; i < rotation.height; ++i) {
+      res |= (rotation.rows[i] << left) << ((top + i) * m_width);
+    }
+    return res;
+  }
+
+  // Removes the full rows, moving the rows above them down, and counts
+  // them in cleared.
+  void clearRows(Field& field, int& cleared) const {
+    for (int r = cleared; r < m_height; ++r) {
+      int shift = r * m_width;
+      if (((field >> shift) & m_full_row) == m_full_row) {
+        Field above = shift == 0 ? 0 : field & ((Field(1) << shift) - 1);
+        Field below = field & ~((Field(1) << (shift + m_width)) - 1);
+        if (shift + m_width == 64) {
+          below = 0;
+        }
+        field = below | above << m_width;
+        ++cleared;
+      }
+    }
+  }
+
+  int m_height;
+  bool m_use_hold;
+  int m_width = 0;
+  int m_row_offset = 0;
+  Row m_full_row = 0;
+  Field m_field_cells = 0;
+  Field m_stripes = 0; // The even columns.
+  vector<int> m_balancing {}; // The sum of the imbalances from an index on.
+  int m_gcd = 0;
+  int m_max_size = 0;
+  vector<Piece> m_pieces {};
+  unordered_set<MemoKey, MemoKeyHash> m_failed {};
+  vector<PerfectClearStep> m_steps {};
+  vector<vector<Landing>> m_landings {}; // For every depth of the search.
+  vector<Row> m_fits {};
+  vector<Row> m_reach {};
+}; // PIMPL
+
+/** \endcond */
+
+PerfectClearSolver::PerfectClearSolver(int height, bool use_hold)
+  : m_pimpl(new PIMPL(height, use_hold))
+{
+
+}
+
+PerfectClearSolver::~PerfectClearSolver()
+{
+  delete m_pimpl;
+  m_pimpl = nullptr;
+}
+
+bool PerfectClearSolver::solve(const Board& board,
+                               const vector<shared_ptr<const Shape>>& queue,
+                               vector<PerfectClearStep>& solution) {
+  return m_pimpl->solve(board, queue, solution);
+}
+
+size_t PerfectClearSolver::getVisitedCount() const {
+  return m_pimpl->m_visited;
+}
+
+} // namespace tetris.
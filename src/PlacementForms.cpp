@@ -0,0 +1,171 @@
+/*
+ * Copyright (C) 2016 Daniel Becker <beckerdaniel.dani@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "PlacementForms.h"
+
+#include <bitset>
+#include <cstdlib>
+
+#include "GameBoard.h"
+#include "PlacementSearch.h"
+#include "Shape.h"
+#include "TranspositionTable.h"
+
+using namespace std;
+
+namespace tetris {
+
+namespace detail {
+
+int popcount(Row bits) {
+  return bitset<64>(bits).count();
+}
+
+const ShapeForms& FormCache::formsOf(const Shape& shape) {
+  uint32_t key = static_cast<uint32_t>(shape.getKind()) << 2
+                 | shape.getRotation();
+  auto it = m_forms.find(key);
+  if (it != m_forms.end()) {
+    return it->second;
+  }
+
+  ShapeForms& res = m_forms[key];
+  shared_ptr<Shape> turned = shape.clone();
+  for (int r = 0; r < 4; ++r) {
+    res.masks.emplace_back(*turned);
+    res.forms.emplace_back(res.masks.back());
+    turned->rotateRight();
+  }
+
+  PieceKind kind;
+  kind.forms = res.forms;
+  sort(kind.forms.begin(), kind.forms.end());
+  kind.forms.erase(unique(kind.forms.begin(), kind.forms.end()),
+                   kind.forms.end());
+  for (size_t i = 0; i < m_kinds.size() && res.kind < 0; ++i) {
+    if (m_kinds[i].forms.size() == kind.forms.size()
+        && equal(kind.forms.begin(), kind.forms.end(),
+                 m_kinds[i].forms.begin())) {
+      res.kind = i;
+    }
+  }
+  if (res.kind < 0) {
+    kind.hash = 1;
+    for (const Form& form : kind.forms) {
+      kind.hash = TranspositionTable::combine(kind.hash, form.height);
+      for (int i = 0; i < form.height; ++i) {
+        kind.hash = TranspositionTable::combine(kind.hash, form.rows[i]);
+      }
+    }
+    res.kind = m_kinds.size();
+    m_kinds.push_back(kind);
+  }
+  return res;
+}
+
+bool isReachable(const GameBoard& game_board, const ShapeForms& current,
+                 const Placement& placement) {
+  PackedCoords pos = game_board.getCurrentShapePosition();
+  if (placement.rotation == 3) {
+    if (!game_board.fits(current.masks[3], pos)) { return false; }
+  } else {
+    for (int r = 1; r <= placement.rotation; ++r) {
+      if (!game_board.fits(current.masks[r], pos)) { return false; }
+    }
+  }
+
+  const CollisionMask& mask = current.masks[placement.rotation];
+  int step = placement.horizontal < pos.horizontal ? -1 : 1;
+  while (pos.horizontal != placement.horizontal) {
+    pos.horizontal += step;
+    if (!game_board.fits(mask, pos)) { return false; }
+  }
+  return true;
+}
+
+void findTops(const vector<Row>& rows, Row full, int width, int* tops) {
+  int height = rows.size();
+  fill(tops, tops + width, height);
+  Row covered = 0;
+  for (int v = 0; v < height && covered != full; ++v) {
+    Row new_bits = rows[v] & ~covered;
+    for (int c = 0; new_bits != 0 && c < width; ++c) {
+      if ((new_bits >> c) & 1u) { tops[c] = v; }
+    }
+    covered |= rows[v];
+  }
+}
+
+int getDropTop(const Form& form, const int* tops, int left) {
+  int top = tops[left] - 1 - form.bottoms[0];
+  for (int c = 1; c < form.width; ++c) {
+    top = min(top, tops[left + c] - 1 - form.bottoms[c]);
+  }
+  return max(top, -1);
+}
+
+void place(vector<Row>& rows, const Form& form, int left, int top) {
+  for (int i = 0; i < form.height; ++i) {
+    rows[top + i] |= form.rows[i] << left;
+  }
+}
+
+int clearLines(vector<Row>& rows, Row full) {
+  int height = rows.size();
+  int write = height - 1;
+  for (int v = height - 1; v >= 0; --v) {
+    if (rows[v] != full) {
+      rows[write--] = rows[v];
+    }
+  }
+  int cleared = write + 1;
+  for (int v = write; v >= 0; --v) {
+    rows[v] = 0;
+  }
+  return cleared;
+}
+
+double rate(const vector<Row>& rows, int width, int lines,
+            const SearchWeights& weights) {
+  int height = rows.size();
+  int heights[CollisionMask::MAX_WIDTH] = {};
+  int holes = 0;
+  Row covered = 0;
+  for (int v = 0; v < height; ++v) {
+    Row new_bits = rows[v] & ~covered;
+    for (int c = 0; new_bits != 0 && c < width; ++c) {
+      if ((new_bits >> c) & 1u) { heights[c] = height - v; }
+    }
+    holes += popcount(covered & ~rows[v]);
+    covered |= rows[v];
+  }
+
+  int aggregate = 0;
+  int bumpiness = 0;
+  for (int c = 0; c < width; ++c) {
+    aggregate += heights[c];
+    if (c > 0) {
+      bumpiness += abs(heights[c] - heights[c - 1]);
+    }
+  }
+  return weights.height * aggregate + weights.lines * lines
+         + weights.holes * holes + weights.bumpiness * bumpiness;
+}
+
+} // namespace detail.
+
+} // namespace tetris.
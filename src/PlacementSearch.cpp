@@ -0,0 +1,547 @@
+/*
+ * Copyright (C) 2016 Daniel Becker <beckerdaniel.dani@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "PlacementSearch.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include "Board.h"
+#include "CollisionMask.h"
+#include "Game.h"
+#include "GameBoard.h"
+#include "PlacementForms.h"
+#include "Shape.h"
+#include "TranspositionTable.h"
+
+using namespace std;
+
+namespace tetris {
+
+namespace {
+
+using detail::Form;
+using detail::Row;
+using detail::ShapeForms;
+
+typedef chrono::steady_clock Clock;
+
+const double LOST = -1e30;
+const size_t MAX_NODES = 1u << 18;
+const size_t MAX_SAMPLES = 1024;
+
+// A placement and the board after it. The piece placed at the children is
+// the current piece of the ply, or the piece on hold.
+struct Node
+{
+  vector<Row> rows;
+  vector<unique_ptr<Node>> children {};
+  int kind = -1;
+  int form = 0;
+  int left = 0;
+  bool used_hold = false;
+  int hold = -1; // The piece on hold after this placement.
+  int lines = 0; // The lines cleared since the root.
+  double static_value = 0.0;
+  double value = 0.0;
+  bool expanded = false;
+  bool complete = false; // Whether no children were cut off by the beam.
+  uint64_t hash = 0; // The hash of the rows, 0 if not computed yet.
+};
+
+} // anonymous namespace.
+
+/** \cond PIMPL */
+
+class PlacementSearch::PIMPL
+{
+public:
+  PIMPL(SearchWeights weights, int beam_width)
+    : m_weights(weights), m_beam_width(beam_width)
+  {
+    if (beam_width < 0) {
+      throw invalid_argument("The beam width must not be negative.");
+    }
+  }
+
+  Placement search(const GameBoard& game_board,
+                   const vector<shared_ptr<const Shape>>& preview,
+                   shared_ptr<const Shape> hold, chrono::microseconds budget)
+  {
+    Clock::time_point start = Clock::now();
+    m_deadline = start + budget;
+
+    shared_ptr<const Shape> current = game_board.getCurrentShape();
+    if (current == nullptr) {
+      throw invalid_argument("There is no current shape to place.");
+    }
+    const Board& board = *game_board.getBoard();
+    if (board.getWidth() > CollisionMask::MAX_WIDTH) {
+      throw invalid_argument("The board is too wide for the search.");
+    }
+
+    const ShapeForms& current_forms = m_forms.formsOf(*current);
+    const ShapeForms& hold_forms = hold != nullptr ? m_forms.formsOf(*hold)
+                                                   : m_no_forms;
+    vector<int> preview_kinds;
+    for (const shared_ptr<const Shape>& shape : preview) {
+      preview_kinds.push_back(m_forms.formsOf(*shape).kind);
+    }
+
+    vector<Row> rows(board.getHeight());
+    Row full = board.getWidth() == 64 ? ~Row(0)
+                                      : (Row(1) << board.getWidth()) - 1;
+    for (int v = 0; v < board.getHeight(); ++v) {
+      rows[v] = board.getRowBits(v, 0, full);
+    }
+
+    setRoot(rows, full, board.getWidth(), current_forms.kind, hold_forms.kind,
+            preview_kinds);
+
+    // Deepening one piece at a time, keeping the ranking of the placements
+    // of the current piece of the deepest completed search.
+    int max_depth = m_preview.size() + 1;
+    m_completed_depth = 0;
+    for (int depth = 1; depth <= max_depth; ++depth) {
+      m_aborted = false;
+      evaluate(*m_root, 0, depth, depth == 1);
+      if (m_aborted) { break; }
+
+      m_completed_depth = depth;
+      m_ranking.clear();
+      for (const unique_ptr<Node>& child : m_root->children) {
+        m_ranking.emplace_back(child->value, child.get());
+      }
+      stable_sort(m_ranking.begin(), m_ranking.end(),
+                  [](const pair<double, Node*>& lhs,
+                     const pair<double, Node*>& rhs) {
+                    return lhs.first > rhs.first;
+                  });
+    }
+
+    Placement res = choose(game_board, current_forms, hold_forms);
+    recordLatency(Clock::now() - start);
+    return res;
+  }
+
+  int64_t getLatencyPercentile(double percentile) const {
+    if (m_samples.empty()) {
+      return 0;
+    }
+    vector<int64_t> sorted = m_samples;
+    sort(sorted.begin(), sorted.end());
+    // The nearest rank.
+    double rank = ceil(percentile / 100.0 * sorted.size());
+    size_t index = rank < 1.0 ? 0 : static_cast<size_t>(rank) - 1;
+    return sorted[min(index, sorted.size() - 1)];
+  }
+
+  void setWeights(SearchWeights weights) {
+    m_weights = weights;
+    recycle(move(m_root));
+    m_node_count = 0;
+  }
+
+  int m_completed_depth = 0;
+  size_t m_node_count = 0;
+  bool m_reused = false;
+  shared_ptr<TranspositionTable> m_table {};
+
+private:
+  // Makes the root match the given state, reusing the tree of the previous
+  // search if it contains the state.
+  void setRoot(const vector<Row>& rows, Row full, int width, int current,
+               int hold, const vector<int>& preview) {
+    unique_ptr<Node> root;
+    if (m_root != nullptr && full == m_full && width == m_width) {
+      if (m_root_current == current && m_root->hold == hold
+          && m_root->rows == rows && isPrefix(m_preview, 0, preview)) {
+        root = move(m_root);
+      } else if (!m_preview.empty() && m_preview[0] == current
+                 && isPrefix(m_preview, 1, preview)) {
+        for (unique_ptr<Node>& child : m_root->children) {
+          if (child->hold == hold && child->rows == rows) {
+            root = move(child);
+            break;
+          }
+        }
+      }
+    }
+
+    m_reused = root != nullptr;
+    if (!m_reused) {
+      root = newNode();
+      root->rows = rows;
+      root->hold = hold;
+      m_node_count = 1;
+    }
+    recycle(move(m_root));
+    m_root = move(root);
+    m_root_current = current;
+    m_preview = preview;
+    m_full = full;
+    m_width = width;
+    m_ranking.clear();
+
+    if (m_reused && m_root->expanded && !m_root->complete) {
+      completeRoot();
+    }
+    if (m_reused) {
+      m_node_count = countNodes(*m_root);
+    }
+  }
+
+  // Every placement of the current piece is searched, so the placements the
+  // beam cut off when the root was deeper in the tree are added back, keeping
+  // the subtrees of the others.
+  void completeRoot() {
+    vector<unique_ptr<Node>> old_children;
+    old_children.swap(m_root->children);
+    m_root->expanded = false;
+    expand(*m_root, 0);
+
+    for (unique_ptr<Node>& child : m_root->children) {
+      for (unique_ptr<Node>& old : old_children) {
+        if (old != nullptr && old->kind == child->kind
+            && old->form == child->form && old->left == child->left
+            && old->used_hold == child->used_hold) {
+          swap(child, old);
+          break;
+        }
+      }
+    }
+    for (unique_ptr<Node>& old : old_children) {
+      recycle(move(old));
+    }
+  }
+
+  // Checks whether old, from the index first on, is a prefix of preview.
+  static bool isPrefix(const vector<int>& old, size_t first,
+                       const vector<int>& preview) {
+    return old.size() - first <= preview.size()
+           && equal(old.begin() + first, old.end(), preview.begin());
+  }
+
+  static size_t countNodes(const Node& node) {
+    size_t res = 1;
+    for (const unique_ptr<Node>& child : node.children) {
+      res += countNodes(*child);
+    }
+    return res;
+  }
+
+  int currentAt(int ply) const {
+    if (ply == 0) {
+      return m_root_current;
+    }
+    return ply - 1 < static_cast<int>(m_preview.size()) ? m_preview[ply - 1]
+                                                        : -1;
+  }
+
+  // Computes the value of the node searching depth pieces ahead. Unless
+  // must_finish is set, gives up when the deadline has passed.
+  void evaluate(Node& node, int ply, int depth, bool must_finish) {
+    if (depth == 0 || currentAt(ply) < 0) {
+      node.value = node.static_value;
+      return;
+    }
+
+    if (!must_finish && (Clock::now() >= m_deadline
+                         || (!node.expanded && m_node_count >= MAX_NODES))) {
+      m_aborted = true;
+      return;
+    }
+
+    // The values in the table do not count the lines cleared before the
+    // node, as other paths to the same board may have cleared others.
+    double path_value = m_weights.lines * node.lines;
+    uint64_t key = 0;
+    bool use_table = m_table != nullptr && ply > 0 && depth > 1;
+    if (use_table) {
+      key = getKey(node, ply, depth);
+      TranspositionTable::Entry entry;
+      if (m_table->probe(key, entry) && entry.depth >= depth) {
+        node.value = entry.value + path_value;
+        return;
+      }
+    }
+
+    if (!node.expanded) {
+      expand(node, ply);
+    }
+
+    double best = LOST;
+    for (const unique_ptr<Node>& child : node.children) {
+      evaluate(*child, ply + 1, depth - 1, must_finish);
+      if (m_aborted) { return; }
+      best = max(best, child->value);
+    }
+    node.value = best;
+
+    if (use_table) {
+      TranspositionTable::Entry entry;
+      entry.value = best - path_value;
+      entry.depth = min(depth, 255);
+      m_table->store(key, entry);
+    }
+  }
+
+  // The key of the state: the board, the piece on hold and the pieces that
+  // the search of the given depth places.
+  uint64_t getKey(Node& node, int ply, int depth) {
+    if (node.hash == 0) {
+      node.hash = TranspositionTable::combine(node.rows.size(), m_width);
+      for (Row row : node.rows) {
+        node.hash = TranspositionTable::combine(node.hash, row);
+      }
+    }
+    uint64_t hold = node.hold < 0 ? 0 : m_forms.getKind(node.hold).hash;
+    uint64_t res = TranspositionTable::combine(node.hash, hold);
+    for (int k = ply; k < ply + depth && currentAt(k) >= 0; ++k) {
+      res = TranspositionTable::combine(res,
+                                        m_forms.getKind(currentAt(k)).hash);
+    }
+    return res;
+  }
+
+  void expand(Node& node, int ply) {
+    int current = currentAt(ply);
+    int tops[CollisionMask::MAX_WIDTH];
+    detail::findTops(node.rows, m_full, m_width, tops);
+
+    addChildren(node, tops, current, false, node.hold);
+    if (node.hold >= 0 && node.hold != current) {
+      addChildren(node, tops, node.hold, true, current);
+    }
+
+    stable_sort(node.children.begin(), node.children.end(),
+                [](const unique_ptr<Node>& lhs, const unique_ptr<Node>& rhs) {
+                  return lhs->static_value > rhs->static_value;
+                });
+    node.complete = true;
+    if (ply > 0 && m_beam_width > 0
+        && node.children.size() > static_cast<size_t>(m_beam_width)) {
+      while (node.children.size() > static_cast<size_t>(m_beam_width)) {
+        recycle(move(node.children.back()));
+        node.children.pop_back();
+      }
+      node.complete = false;
+    }
+    node.expanded = true;
+    m_node_count += node.children.size();
+  }
+
+  void addChildren(Node& node, const int* tops, int kind, bool used_hold,
+                   int next_hold) {
+    const vector<Form>& forms = m_forms.getKind(kind).forms;
+    for (size_t f = 0; f < forms.size(); ++f) {
+      const Form& form = forms[f];
+      for (int left = 0; left + form.width <= m_width; ++left) {
+        int top = detail::getDropTop(form, tops, left);
+        if (top < 0) {
+          continue; // The piece would stick out of the top of the board.
+        }
+
+        unique_ptr<Node> child = newNode();
+        child->rows = node.rows;
+        detail::place(child->rows, form, left, top);
+        child->kind = kind;
+        child->form = f;
+        child->left = left;
+        child->used_hold = used_hold;
+        child->hold = next_hold;
+        child->lines = node.lines + detail::clearLines(child->rows, m_full);
+        child->static_value = detail::rate(child->rows, m_width, child->lines,
+                                           m_weights);
+        node.children.push_back(move(child));
+      }
+    }
+  }
+
+  // Keeps the node and its subtree for newNode, so that nodes and their rows
+  // are only allocated while the trees grow beyond the earlier ones.
+  void recycle(unique_ptr<Node> node) {
+    if (node == nullptr) { return; }
+    for (unique_ptr<Node>& child : node->children) {
+      recycle(move(child));
+    }
+    node->children.clear();
+    if (m_free_nodes.size() < MAX_NODES) {
+      m_free_nodes.push_back(move(node));
+    }
+  }
+
+  unique_ptr<Node> newNode() {
+    if (m_free_nodes.empty()) {
+      return unique_ptr<Node>(new Node());
+    }
+    unique_ptr<Node> node = move(m_free_nodes.back());
+    m_free_nodes.pop_back();
+    // Resetting everything but the buffers, whose capacity is kept.
+    vector<Row> rows;
+    vector<unique_ptr<Node>> children;
+    rows.swap(node->rows);
+    children.swap(node->children);
+    *node = Node();
+    node->rows.swap(rows);
+    node->children.swap(children);
+    return node;
+  }
+
+  // Returns the best ranked placement that can be played from where the
+  // current shape is.
+  Placement choose(const GameBoard& game_board, const ShapeForms& current,
+                   const ShapeForms& hold) const {
+    for (const pair<double, Node*>& entry : m_ranking) {
+      const Node& node = *entry.second;
+      const ShapeForms& forms = node.used_hold ? hold : current;
+      const Form& form = m_forms.getKind(node.kind).forms[node.form];
+      int rotation = find(forms.forms.begin(), forms.forms.end(), form)
+                     - forms.forms.begin();
+      if (rotation == 4) { continue; }
+
+      Placement res;
+      res.valid = true;
+      res.hold = node.used_hold;
+      res.rotation = rotation;
+      res.horizontal = node.left - forms.masks[rotation].getLeft();
+      res.value = entry.first;
+      if (entry.first > LOST
+          && (node.used_hold
+              || detail::isReachable(game_board, current, res))) {
+        return res;
+      }
+    }
+    return Placement();
+  }
+
+  void recordLatency(Clock::duration duration) {
+    int64_t micros = chrono::duration_cast<chrono::microseconds>(duration)
+                                                                    .count();
+    if (m_samples.size() < MAX_SAMPLES) {
+      m_samples.push_back(micros);
+    } else {
+      m_samples[m_next_sample] = micros;
+    }
+    m_next_sample = (m_next_sample + 1) % MAX_SAMPLES;
+  }
+
+  SearchWeights m_weights;
+  int m_beam_width;
+  detail::FormCache m_forms {};
+  const ShapeForms m_no_forms {};
+
+  unique_ptr<Node> m_root {};
+  vector<unique_ptr<Node>> m_free_nodes {};
+  int m_root_current = -1;
+  vector<int> m_preview {};
+  Row m_full = 0;
+  int m_width = 0;
+  vector<pair<double, Node*>> m_ranking {};
+
+  Clock::time_point m_deadline {};
+  bool m_aborted = false;
+
+  vector<int64_t> m_samples {};
+  size_t m_next_sample = 0;
+}; // PIMPL
+
+/** \endcond */
+
+PlacementSearch::PlacementSearch(SearchWeights weights, int beam_width)
+  : m_pimpl(new PIMPL(weights, beam_width))
+{
+
+}
+
+PlacementSearch::~PlacementSearch()
+{
+  delete m_pimpl;
+  m_pimpl = nullptr;
+}
+
+Placement PlacementSearch::search(const GameBoard& game_board,
+                                  const vector<shared_ptr<const Shape>>&
+                                                                      preview,
+                                  shared_ptr<const Shape> hold,
+                                  chrono::microseconds budget) {
+  return m_pimpl->search(game_board, preview, hold, budget);
+}
+
+void PlacementSearch::setWeights(SearchWeights weights) {
+  m_pimpl->setWeights(weights);
+}
+
+void PlacementSearch::setTranspositionTable(
+                                      shared_ptr<TranspositionTable> table) {
+  m_pimpl->m_table = table;
+}
+
+int PlacementSearch::getCompletedDepth() const {
+  return m_pimpl->m_completed_depth;
+}
+
+size_t PlacementSearch::getNodeCount() const {
+  return m_pimpl->m_node_count;
+}
+
+bool PlacementSearch::wasTreeReused() const {
+  return m_pimpl->m_reused;
+}
+
+int64_t PlacementSearch::getLatencyPercentile(double percentile) const {
+  return m_pimpl->getLatencyPercentile(percentile);
+}
+
+int playPlacement(Game& game, const Placement& placement) {
+  shared_ptr<const GameBoard> game_board = game.getGameBoard();
+  if (!placement.valid || placement.hold
+      || game_board->getCurrentShape() == nullptr) {
+    return -1;
+  }
+
+  // Three turns to the right are played as one to the left.
+  int turns = placement.rotation == 3 ? 1 : placement.rotation;
+  for (int r = 0; r < turns; ++r) {
+    int rotation = game_board->getCurrentShapeRotation();
+    if (placement.rotation == 3) {
+      game.rotateLeft();
+    } else {
+      game.rotateRight();
+    }
+    if (game_board->getCurrentShapeRotation() == rotation) {
+      return -1;
+    }
+  }
+
+  int horizontal = game_board->getCurrentShapePosition().getHorizontal();
+  while (horizontal != placement.horizontal) {
+    if (horizontal < placement.horizontal) {
+      game.moveRight();
+    } else {
+      game.moveLeft();
+    }
+    int moved = game_board->getCurrentShapePosition().getHorizontal();
+    if (moved == horizontal) {
+      return -1;
+    }
+    horizontal = moved;
+  }
+  return game.drop();
+}
+
+} // namespace tetris.
@@ -0,0 +1,536 @@
+/*
+ * Copyright (C) 2016 Daniel Becker <beckerdaniel.dani@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "PolyominoCatalog.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <unordered_set>
+#include <utility>
+
+#include "Block.h"
+#include "ShapeCatalog.h"
+
+using namespace std;
+
+namespace tetris {
+
+namespace {
+
+// A polyomino moved to the top left corner, as the sorted list of its
+// cells. Every cell is a byte with the row in the high and the column in
+// the low four bits, which is enough up to MAX_ORDER, and comparing two
+// forms compares their sorted positions.
+typedef string Form;
+
+const char CACHE_MAGIC[] = "TPOLYCAT";
+const size_t CACHE_MAGIC_SIZE = sizeof(CACHE_MAGIC) - 1;
+const unsigned char CACHE_VERSION = 1;
+const size_t CACHE_HEADER_SIZE = CACHE_MAGIC_SIZE + 3 + 4;
+
+// The numbers of polyominoes of the orders 1 to MAX_ORDER in every set, in
+// the order of PolyominoSet.
+const size_t PIECE_COUNTS[3][PolyominoCatalog::MAX_ORDER] = {
+  {1, 1, 2, 5, 12, 35, 108, 369, 1285, 4655, 17073},
+  {1, 1, 2, 7, 18, 60, 196, 704, 2500, 9189, 33896},
+  {1, 2, 6, 19, 63, 216, 760, 2725, 9910, 36446, 135268}
+};
+
+int rowOf(char cell) {
+  return static_cast<unsigned char>(cell) >> 4;
+}
+
+int columnOf(char cell) {
+  return static_cast<unsigned char>(cell) & 0xF;
+}
+
+// Returns the form of cells given with any offset.
+Form formOf(const vector<pair<int, int>>& cells) {
+  int top = cells[0].first, left = cells[0].second;
+  for (const pair<int, int>& cell : cells) {
+    top = min(top, cell.first);
+    left = min(left, cell.second);
+  }
+  Form res;
+  res.reserve(cells.size());
+  for (const pair<int, int>& cell : cells) {
+    res.push_back(static_cast<char>((cell.first - top) << 4
+                                    | (cell.second - left)));
+  }
+  sort(res.begin(), res.end(), [](char lhs, char rhs) {
+    return static_cast<unsigned char>(lhs) < static_cast<unsigned char>(rhs);
+  });
+  return res;
+}
+
+Form turned(const Form& form) {
+  vector<pair<int, int>> cells;
+  for (char cell : form) {
+    cells.emplace_back(columnOf(cell), -rowOf(cell));
+  }
+  return formOf(cells);
+}
+
+Form mirrored(const Form& form) {
+  vector<pair<int, int>> cells;
+  for (char cell : form) {
+    cells.emplace_back(rowOf(cell), -columnOf(cell));
+  }
+  return formOf(cells);
+}
+
+// Returns the smallest of the rotations of the form.
+Form canonical(Form form) {
+  Form res = form;
+  for (int r = 1; r < 4; ++r) {
+    form = turned(form);
+    res = min(res, form);
+  }
+  return res;
+}
+
+// Returns the canonical forms of all one-sided polyominoes of the order,
+// sorted. Every polyomino has a block whose removal leaves a polyomino of
+// the previous order, so growing one of each class of that order by every
+// free neighbouring cell reaches every class.
+vector<Form> enumerate(int order) {
+  vector<Form> level {formOf({{0, 0}})};
+  const int steps[4][2] = {{-1, 0}, {1, 0}, {0, -1}, {0, 1}};
+  for (int size = 2; size <= order; ++size) {
+    unordered_set<Form> seen;
+    vector<Form> next;
+    for (const Form& form : level) {
+      vector<pair<int, int>> cells;
+      for (char cell : form) {
+        cells.emplace_back(rowOf(cell), columnOf(cell));
+      }
+      for (size_t i = 0; i + 1 < static_cast<size_t>(size); ++i) {
+        for (const int* step : steps) {
+          pair<int, int> grown(cells[i].first + step[0],
+                               cells[i].second + step[1]);
+          if (find(cells.begin(), cells.end(), grown) != cells.end()) {
+            continue;
+          }
+          cells.push_back(grown);
+          Form res = canonical(formOf(cells));
+          cells.pop_back();
+          if (seen.insert(res).second) {
+            next.push_back(res);
+          }
+        }
+      }
+    }
+    sort(next.begin(), next.end());
+    level.swap(next);
+  }
+  return level;
+}
+
+// Returns the positions of the form in its bounding box, turned to lie
+// flat with the most blocks at the bottom and centered, rounding towards the
+// top left.
+vector<PackedCoords> place(Form form, int& bbox_size) {
+  Form best;
+  int best_bottom = -1;
+  for (int r = 0; r < 4; ++r, form = turned(form)) {
+    int height = 0, width = 0;
+    for (char cell : form) {
+      height = max(height, rowOf(cell) + 1);
+      width = max(width, columnOf(cell) + 1);
+    }
+    if (height > width) {
+      continue;
+    }
+    int bottom = count_if(form.begin(), form.end(), [=](char cell) {
+      return rowOf(cell) == height - 1;
+    });
+    if (bottom > best_bottom || (bottom == best_bottom && form < best)) {
+      best = form;
+      best_bottom = bottom;
+    }
+  }
+
+  int height = 0, width = 0;
+  for (char cell : best) {
+    height = max(height, rowOf(cell) + 1);
+    width = max(width, columnOf(cell) + 1);
+  }
+  bbox_size = max(height, width);
+  int top = (bbox_size - height) / 2;
+  int left = (bbox_size - width) / 2;
+  vector<PackedCoords> res;
+  for (char cell : best) {
+    res.emplace_back(top + rowOf(cell), left + columnOf(cell));
+  }
+  return res;
+}
+
+Form formOf(const PackedCoords* positions, size_t count) {
+  vector<pair<int, int>> cells;
+  for (size_t i = 0; i < count; ++i) {
+    cells.emplace_back(positions[i].vertical, positions[i].horizontal);
+  }
+  return formOf(cells);
+}
+
+// Returns the sorted cells of positions in a bounding box of at most
+// MAX_ORDER, without moving them to the top left corner.
+Form cellsOf(const vector<PackedCoords>& positions) {
+  Form res;
+  for (const PackedCoords& coords : positions) {
+    res.push_back(static_cast<char>(coords.vertical << 4
+                                    | coords.horizontal));
+  }
+  sort(res.begin(), res.end(), [](char lhs, char rhs) {
+    return static_cast<unsigned char>(lhs) < static_cast<unsigned char>(rhs);
+  });
+  return res;
+}
+
+vector<PackedCoords> turnRight(const vector<PackedCoords>& positions,
+                               int bbox_size) {
+  vector<PackedCoords> res;
+  for (const PackedCoords& coords : positions) {
+    res.emplace_back(coords.horizontal, bbox_size - 1 - coords.vertical);
+  }
+  return res;
+}
+
+// Checks whether the cells of a form are connected through their sides.
+bool isConnected(const Form& form) {
+  vector<bool> reached(form.size(), false);
+  vector<size_t> pending {0};
+  reached[0] = true;
+  size_t count = 1;
+  while (!pending.empty()) {
+    char cell = form[pending.back()];
+    pending.pop_back();
+    for (size_t i = 0; i < form.size(); ++i) {
+      if (!reached[i] && abs(rowOf(cell) - rowOf(form[i]))
+                         + abs(columnOf(cell) - columnOf(form[i])) == 1) {
+        reached[i] = true;
+        ++count;
+        pending.push_back(i);
+      }
+    }
+  }
+  return count == form.size();
+}
+
+} // anonymous namespace.
+
+/** \cond PIMPL */
+
+class PolyominoCatalog::PIMPL
+{
+public:
+  PIMPL(int order, PolyominoSet set)
+   : m_order(order), m_set(set)
+  {
+    if (order < 1 || order > MAX_ORDER) {
+      throw invalid_argument("The order is out of range.");
+    }
+  }
+
+  int m_order;
+  PolyominoSet m_set;
+  bool m_from_cache = false;
+  vector<Piece> m_pieces {};
+
+  void generate() {
+    vector<pair<Form, Piece>> pieces;
+    for (const Form& form : enumerate(m_order)) {
+      if (m_set == PolyominoSet::FREE && canonical(mirrored(form)) < form) {
+        continue;
+      }
+
+      int bbox_size = 0;
+      vector<PackedCoords> positions = place(form, bbox_size);
+      Piece piece = makePiece(bbox_size, positions);
+      if (m_set != PolyominoSet::FIXED) {
+        pieces.emplace_back(form, piece);
+        continue;
+      }
+
+      // Every distinct rotation is a piece; the rotations of a symmetric
+      // polyomino repeat, possibly moved in the bounding box.
+      int spawn = piece.m_rotation;
+      vector<Form> seen;
+      for (int turns = 0; turns < 4; ++turns) {
+        piece.m_rotation = (spawn + turns) & 3;
+        Form fixed = formOf(piece.getPositions(0), m_order);
+        if (find(seen.begin(), seen.end(), fixed) == seen.end()) {
+          seen.push_back(fixed);
+          pieces.emplace_back(fixed, piece);
+        }
+      }
+    }
+
+    sort(pieces.begin(), pieces.end(),
+         [](const pair<Form, Piece>& lhs, const pair<Form, Piece>& rhs) {
+           return lhs.first < rhs.first;
+         });
+    m_pieces.clear();
+    m_pieces.reserve(pieces.size());
+    for (const pair<Form, Piece>& piece : pieces) {
+      m_pieces.push_back(piece.second);
+    }
+  }
+
+  // Returns false if there is no cache for this order and set.
+  bool load(const string& path) {
+    ifstream in(path, ios::binary);
+    if (!in) {
+      return false;
+    }
+    string data((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+    if (in.bad() || data.size() < CACHE_HEADER_SIZE
+        || data.compare(0, CACHE_MAGIC_SIZE, CACHE_MAGIC) != 0) {
+      throw invalid_argument(path + " is not a polyomino catalog.");
+    }
+
+    const unsigned char* bytes =
+                      reinterpret_cast<const unsigned char*>(data.data());
+    const unsigned char* header = bytes + CACHE_MAGIC_SIZE;
+    if (header[0] != CACHE_VERSION || header[1] != m_order
+        || header[2] != static_cast<unsigned char>(m_set)) {
+      return false;
+    }
+
+    size_t count = 0;
+    for (int i = 0; i < 4; ++i) {
+      count |= static_cast<size_t>(header[3 + i]) << (8 * i);
+    }
+    size_t piece_size = 1 + 2 * m_order;
+    if (count != PIECE_COUNTS[static_cast<int>(m_set)][m_order - 1]
+        || data.size() != CACHE_HEADER_SIZE + count * piece_size) {
+      throw invalid_argument(path + " is not a polyomino catalog.");
+    }
+
+    // Checking every entry before registering any, so that a rejected file
+    // leaves no kinds behind in the shape catalog. Entries placed as
+    // generate places them and in its strict order are the distinct
+    // polyominoes, so with the right count they are all of them.
+    vector<pair<int, vector<PackedCoords>>> entries(count);
+    Form previous;
+    const unsigned char* cursor = bytes + CACHE_HEADER_SIZE;
+    for (size_t i = 0; i < count; ++i, cursor += piece_size) {
+      entries[i].first = cursor[0];
+      vector<PackedCoords>& positions = entries[i].second;
+      for (int b = 0; b < m_order; ++b) {
+        positions.emplace_back(cursor[1 + 2 * b], cursor[2 + 2 * b]);
+      }
+      Form key;
+      if (!isPlaced(entries[i].first, positions, key)
+          || (i > 0 && !(previous < key))) {
+        throw invalid_argument(path + " is not a polyomino catalog.");
+      }
+      previous.swap(key);
+    }
+
+    vector<Piece> pieces;
+    pieces.reserve(count);
+    for (const pair<int, vector<PackedCoords>>& entry : entries) {
+      pieces.push_back(makePiece(entry.first, entry.second));
+    }
+    m_pieces.swap(pieces);
+    m_from_cache = true;
+    return true;
+  }
+
+  void save(const string& path) const {
+    string data(CACHE_MAGIC, CACHE_MAGIC_SIZE);
+    data.push_back(static_cast<char>(CACHE_VERSION));
+    data.push_back(static_cast<char>(m_order));
+    data.push_back(static_cast<char>(m_set));
+    for (int i = 0; i < 4; ++i) {
+      data.push_back(static_cast<char>((m_pieces.size() >> (8 * i)) & 0xFF));
+    }
+    for (const Piece& piece : m_pieces) {
+      data.push_back(static_cast<char>(piece.m_bbox_size));
+      const PackedCoords* positions = piece.getPositions(0);
+      for (int b = 0; b < m_order; ++b) {
+        data.push_back(static_cast<char>(positions[b].vertical));
+        data.push_back(static_cast<char>(positions[b].horizontal));
+      }
+    }
+
+    string temp_path = path + ".tmp";
+    {
+      ofstream out(temp_path, ios::binary);
+      out.write(data.data(), data.size());
+      out.flush();
+      if (!out) {
+        throw runtime_error("Could not write the catalog " + temp_path + ".");
+      }
+    }
+
+    if (rename(temp_path.c_str(), path.c_str()) != 0) {
+      throw runtime_error("Could not replace the catalog " + path + ".");
+    }
+  }
+
+private:
+  // Checks whether the positions are those of a piece as generate places it,
+  // setting key to the form generate sorts the piece by.
+  bool isPlaced(int bbox_size, const vector<PackedCoords>& positions,
+                Form& key) const {
+    if (bbox_size < 1 || bbox_size > m_order) {
+      return false;
+    }
+    for (const PackedCoords& coords : positions) {
+      if (coords.vertical >= bbox_size || coords.horizontal >= bbox_size) {
+        return false;
+      }
+    }
+    Form form = formOf(positions.data(), positions.size());
+    if (adjacent_find(form.begin(), form.end()) != form.end()
+        || !isConnected(form)) {
+      return false;
+    }
+
+    Form shape = canonical(form);
+    if (m_set == PolyominoSet::FREE && canonical(mirrored(shape)) < shape) {
+      return false;
+    }
+    int placed_bbox_size = 0;
+    vector<PackedCoords> placed = place(shape, placed_bbox_size);
+    if (placed_bbox_size != bbox_size) {
+      return false;
+    }
+    if (m_set != PolyominoSet::FIXED) {
+      key = shape;
+      return cellsOf(positions) == cellsOf(placed);
+    }
+
+    // The first rotation with the form of the positions, as in generate.
+    key = form;
+    for (int turns = 0; turns < 4; ++turns) {
+      if (formOf(placed.data(), placed.size()) == form) {
+        return cellsOf(positions) == cellsOf(placed);
+      }
+      placed = turnRight(placed, bbox_size);
+    }
+    return false;
+  }
+
+  // Registers the positions in the shape catalog and works out the tables
+  // of all rotations.
+  static Piece makePiece(int bbox_size,
+                         const vector<PackedCoords>& positions) {
+    Piece res;
+    res.m_kind = ShapeCatalog::classify(bbox_size, positions.data(),
+                                        positions.size(), res.m_rotation);
+    res.m_bbox_size = bbox_size;
+    res.m_block_count = positions.size();
+    res.m_kick_table = &KickTable::forBBoxSize(bbox_size);
+
+    const ShapeCatalog::Entry& entry = ShapeCatalog::get(res.m_kind);
+    res.m_has_masks = true;
+    for (int r = 0; r < 4; ++r) {
+      const PackedCoords* turned = entry.getPositions(r);
+      res.m_orientations[r] = KickTable::getOrientation(
+                                        turned, res.m_block_count, bbox_size);
+      res.m_has_masks = res.m_has_masks
+          && CollisionMask::isRepresentable(turned, res.m_block_count);
+    }
+    if (res.m_has_masks) {
+      for (int r = 0; r < 4; ++r) {
+        res.m_masks[r] = CollisionMask(entry.getPositions(r),
+                                       res.m_block_count);
+      }
+    }
+    return res;
+  }
+}; // PIMPL
+
+/** \endcond */
+
+const int PolyominoCatalog::MAX_ORDER;
+
+const PackedCoords* PolyominoCatalog::Piece::getPositions(int turns) const {
+  return ShapeCatalog::get(m_kind).getPositions((m_rotation + turns) & 3);
+}
+
+PolyominoCatalog::PolyominoCatalog(int order, PolyominoSet set,
+                                   const string& cache_path)
+  : m_pimpl(new PIMPL(order, set))
+{
+  try {
+    if (cache_path.empty() || !m_pimpl->load(cache_path)) {
+      m_pimpl->generate();
+      if (!cache_path.empty()) {
+        m_pimpl->save(cache_path);
+      }
+    }
+  } catch (...) {
+    delete m_pimpl;
+    throw;
+  }
+}
+
+PolyominoCatalog::~PolyominoCatalog()
+{
+  delete m_pimpl;
+  m_pimpl = nullptr;
+}
+
+int PolyominoCatalog::getOrder() const {
+  return m_pimpl->m_order;
+}
+
+PolyominoSet PolyominoCatalog::getSet() const {
+  return m_pimpl->m_set;
+}
+
+bool PolyominoCatalog::isFromCache() const {
+  return m_pimpl->m_from_cache;
+}
+
+size_t PolyominoCatalog::getPieceCount() const {
+  return m_pimpl->m_pieces.size();
+}
+
+const PolyominoCatalog::Piece& PolyominoCatalog::getPiece(size_t index) const
+{
+  if (index >= m_pimpl->m_pieces.size()) {
+    throw invalid_argument("The piece index is out of range.");
+  }
+  return m_pimpl->m_pieces[index];
+}
+
+vector<shared_ptr<Shape>> PolyominoCatalog::createShapes(
+                                          shared_ptr<Block> block) const {
+  vector<shared_ptr<Shape>> res;
+  res.reserve(m_pimpl->m_pieces.size());
+  for (const Piece& piece : m_pimpl->m_pieces) {
+    res.push_back(ShapeCatalog::create(piece.getKind(), block,
+                                       piece.getRotation()));
+  }
+  return res;
+}
+
+void PolyominoCatalog::save(const string& path) const {
+  m_pimpl->save(path);
+}
+
+} // namespace tetris.
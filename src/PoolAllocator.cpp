@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2016 Daniel Becker <beckerdaniel.dani@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "PoolAllocator.h"
+
+#include <algorithm>
+#include <new>
+
+using namespace std;
+
+namespace tetris {
+
+const size_t PoolResource::GRANULARITY;
+const size_t PoolResource::MAX_POOLED_SIZE;
+
+PoolResource::PoolResource(size_t chunk_size)
+  : m_chunk_size(max(chunk_size, MAX_POOLED_SIZE)),
+    m_free_lists(MAX_POOLED_SIZE / GRANULARITY + 1, nullptr),
+    m_chunks(),
+    m_current_chunk(0),
+    m_cursor(nullptr),
+    m_end(nullptr),
+    m_live(0)
+{
+
+}
+
+PoolResource::~PoolResource()
+{
+  for (char* chunk : m_chunks) {
+    ::operator delete(chunk);
+  }
+}
+
+void* PoolResource::allocate(size_t size) {
+  if (size > MAX_POOLED_SIZE) {
+    ++m_live;
+    return ::operator new(size);
+  }
+
+  size_t size_class = (max<size_t>(size, 1) + GRANULARITY - 1) / GRANULARITY;
+  size_t rounded = size_class * GRANULARITY;
+
+  FreeNode*& free_list = m_free_lists[size_class];
+  void* res = nullptr;
+  if (free_list != nullptr) {
+    res = free_list;
+    free_list = free_list->next;
+  } else {
+    bool exhausted = m_cursor == nullptr
+                     || static_cast<size_t>(m_end - m_cursor) < rounded;
+    if (exhausted) {
+      // Moving on to the next chunk, allocating it if it is not reserved yet.
+      if (m_cursor != nullptr) { ++m_current_chunk; }
+      if (m_current_chunk == m_chunks.size()) {
+        m_chunks.push_back(static_cast<char*>(::operator new(m_chunk_size)));
+      }
+      m_cursor = m_chunks[m_current_chunk];
+      m_end = m_cursor + m_chunk_size;
+    }
+    res = m_cursor;
+    m_cursor += rounded;
+  }
+
+  ++m_live;
+  return res;
+}
+
+void PoolResource::deallocate(void* ptr, size_t size) {
+  --m_live;
+  if (size > MAX_POOLED_SIZE) {
+    ::operator delete(ptr);
+    return;
+  }
+
+  size_t size_class = (max<size_t>(size, 1) + GRANULARITY - 1) / GRANULARITY;
+  FreeNode* node = static_cast<FreeNode*>(ptr);
+  node->next = m_free_lists[size_class];
+  m_free_lists[size_class] = node;
+}
+
+size_t PoolResource::getLiveAllocations() const {
+  return m_live;
+}
+
+size_t PoolResource::getReservedBytes() const {
+  return m_chunks.size() * m_chunk_size;
+}
+
+bool PoolResource::reset() {
+  if (m_live != 0) {
+    return false;
+  }
+
+  fill(m_free_lists.begin(), m_free_lists.end(), nullptr);
+  m_current_chunk = 0;
+  m_cursor = nullptr;
+  m_end = nullptr;
+  return true;
+}
+
+} // namespace tetris.
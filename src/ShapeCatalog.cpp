@@ -0,0 +1,241 @@
+/*
+ * Copyright (C) 2016 Daniel Becker <beckerdaniel.dani@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ShapeCatalog.h"
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include "BasicShape.h"
+#include "Block.h"
+
+using namespace std;
+
+namespace tetris {
+
+namespace {
+
+typedef ShapeCatalog::Entry Entry;
+
+// The entries are allocated in chunks that never move, so that a reader
+// can index them while another thread adds an entry.
+const size_t CHUNK_SIZE = 256;
+
+// Turns the positions to the right the same way BasicShape does.
+vector<PackedCoords> turnRight(const vector<PackedCoords>& positions,
+                               int bbox_size) {
+  vector<PackedCoords> res;
+  res.reserve(positions.size());
+  for (const PackedCoords& coords : positions) {
+    res.emplace_back(coords.horizontal, bbox_size - 1 - coords.vertical);
+  }
+  return res;
+}
+
+// A key of the set of positions, whatever order they are in.
+string keyOf(int bbox_size, vector<PackedCoords> positions) {
+  sort(positions.begin(), positions.end(),
+       [](const PackedCoords& lhs, const PackedCoords& rhs) {
+         return lhs.vertical != rhs.vertical ? lhs.vertical < rhs.vertical
+                                             : lhs.horizontal < rhs.horizontal;
+       });
+  string res;
+  res.reserve(2 + 4 * positions.size());
+  res.push_back(static_cast<char>(bbox_size & 0xFF));
+  res.push_back(static_cast<char>(bbox_size >> 8));
+  for (const PackedCoords& coords : positions) {
+    res.push_back(static_cast<char>(coords.vertical & 0xFF));
+    res.push_back(static_cast<char>(coords.vertical >> 8));
+    res.push_back(static_cast<char>(coords.horizontal & 0xFF));
+    res.push_back(static_cast<char>(coords.horizontal >> 8));
+  }
+  return res;
+}
+
+} // anonymous namespace.
+
+/** \cond PIMPL */
+
+class ShapeCatalog::Registry
+{
+public:
+  Registry() {
+    // The tetrominoes, in the order of their kinds; the blocks are listed
+    // from the top line down, from left to right.
+    const vector<pair<int, vector<PackedCoords>>> tetrominoes {
+      {4, {{0, 1}, {1, 1}, {2, 1}, {3, 1}}},
+      {3, {{0, 1}, {1, 1}, {2, 1}, {2, 0}}},
+      {3, {{0, 1}, {1, 1}, {2, 1}, {2, 2}}},
+      {2, {{0, 0}, {0, 1}, {1, 0}, {1, 1}}},
+      {3, {{0, 1}, {0, 2}, {1, 0}, {1, 1}}},
+      {3, {{1, 0}, {1, 1}, {1, 2}, {2, 1}}},
+      {3, {{0, 0}, {0, 1}, {1, 1}, {1, 2}}}
+    };
+    lock_guard<mutex> lock(m_mutex);
+    for (const pair<int, vector<PackedCoords>>& tetromino : tetrominoes) {
+      add(tetromino.first, tetromino.second);
+    }
+  }
+
+  const Entry* get(ShapeKind kind) const {
+    if (kind >= m_count.load(memory_order_acquire)) {
+      return nullptr;
+    }
+    return &m_chunks[kind / CHUNK_SIZE][kind % CHUNK_SIZE];
+  }
+
+  size_t getCount() const {
+    return m_count.load(memory_order_acquire);
+  }
+
+  ShapeKind classify(int bbox_size, const vector<PackedCoords>& positions,
+                     const string& key, int& rotation) {
+    lock_guard<mutex> lock(m_mutex);
+    auto it = m_keys.find(key);
+    if (it != m_keys.end()) {
+      rotation = it->second.second;
+      return it->second.first;
+    }
+    rotation = 0;
+    return add(bbox_size, positions);
+  }
+
+private:
+  // Adds a new kind whose rotation 0 is the given positions. The mutex must
+  // be held.
+  ShapeKind add(int bbox_size, const vector<PackedCoords>& positions) {
+    size_t kind = m_count.load(memory_order_relaxed);
+    if (kind == ShapeCatalog::MAX_KINDS) {
+      throw runtime_error("The shape catalog is full.");
+    }
+    if (kind % CHUNK_SIZE == 0) {
+      m_storage.emplace_back(new Entry[CHUNK_SIZE]);
+      m_chunks[kind / CHUNK_SIZE] = m_storage.back().get();
+    }
+
+    Entry& entry = m_chunks[kind / CHUNK_SIZE][kind % CHUNK_SIZE];
+    entry.m_kind = static_cast<ShapeKind>(kind);
+    entry.m_bbox_size = bbox_size;
+    entry.m_positions[0] = positions;
+    for (int r = 1; r < 4; ++r) {
+      entry.m_positions[r] = turnRight(entry.m_positions[r - 1], bbox_size);
+    }
+
+    // The first rotation with the positions is kept for symmetric shapes.
+    for (int r = 0; r < 4; ++r) {
+      m_keys.emplace(keyOf(bbox_size, entry.m_positions[r]),
+                     make_pair(entry.m_kind, r));
+    }
+
+    // Publishing the entry only now that it is complete.
+    m_count.store(kind + 1, memory_order_release);
+    return entry.m_kind;
+  }
+
+  Entry* m_chunks[ShapeCatalog::MAX_KINDS / CHUNK_SIZE] = {};
+  atomic<size_t> m_count {0};
+
+  mutex m_mutex {}; // Protects the members below.
+  vector<unique_ptr<Entry[]>> m_storage {};
+  unordered_map<string, pair<ShapeKind, int>> m_keys {};
+}; // Registry
+
+/** \endcond */
+
+ShapeCatalog::Registry& ShapeCatalog::registry() {
+  static Registry res;
+  return res;
+}
+
+const ShapeKind ShapeCatalog::I;
+const ShapeKind ShapeCatalog::J;
+const ShapeKind ShapeCatalog::L;
+const ShapeKind ShapeCatalog::O;
+const ShapeKind ShapeCatalog::S;
+const ShapeKind ShapeCatalog::T;
+const ShapeKind ShapeCatalog::Z;
+const size_t ShapeCatalog::MAX_KINDS;
+
+ShapeKind ShapeCatalog::Entry::getKind() const {
+  return m_kind;
+}
+
+int ShapeCatalog::Entry::getBBoxSize() const {
+  return m_bbox_size;
+}
+
+size_t ShapeCatalog::Entry::getBlockCount() const {
+  return m_positions[0].size();
+}
+
+const PackedCoords* ShapeCatalog::Entry::getPositions(int rotation) const {
+  return m_positions[rotation & 3].data();
+}
+
+const ShapeCatalog::Entry& ShapeCatalog::get(ShapeKind kind) {
+  const Entry* res = registry().get(kind);
+  if (res == nullptr) {
+    throw invalid_argument("There is no such kind of shape.");
+  }
+  return *res;
+}
+
+size_t ShapeCatalog::getKindCount() {
+  return registry().getCount();
+}
+
+ShapeKind ShapeCatalog::classify(int bbox_size, const PackedCoords* positions,
+                                 size_t count, int& rotation) {
+  if (bbox_size < 1) {
+    throw invalid_argument("An empty bounding box is not allowed.");
+  }
+  vector<PackedCoords> copy(positions, positions + count);
+  for (const PackedCoords& coords : copy) {
+    if (coords.vertical < 0 || coords.horizontal < 0
+        || coords.vertical >= bbox_size || coords.horizontal >= bbox_size) {
+      throw invalid_argument("A block is outside the bounding box.");
+    }
+  }
+
+  // The key lists the positions sorted, so duplicates end up next to each
+  // other in it.
+  string key = keyOf(bbox_size, copy);
+  for (size_t i = 2 + 4; i < key.size(); i += 4) {
+    if (key.compare(i, 4, key, i - 4, 4) == 0) {
+      throw invalid_argument("Duplicates in the positions.");
+    }
+  }
+  return registry().classify(bbox_size, copy, key, rotation);
+}
+
+shared_ptr<Shape> ShapeCatalog::create(ShapeKind kind, shared_ptr<Block> block,
+                                       int rotation) {
+  if (block == nullptr) {
+    throw invalid_argument("A null block is not allowed.");
+  }
+  vector<shared_ptr<Block>> blocks;
+  for (size_t i = 0; i < get(kind).getBlockCount(); ++i) {
+    blocks.push_back(block->clone());
+  }
+  return make_shared<BasicShape>(get(kind), blocks, rotation);
+}
+
+} // namespace tetris.
@@ -0,0 +1,473 @@
+/*
+ * Copyright (C) 2016 Daniel Becker <beckerdaniel.dani@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "SpectatorStream.h"
+
+#include <stdexcept>
+
+#include "BasicBlock.h"
+#include "BasicBoard.h"
+#include "Board.h"
+#include "Game.h"
+#include "GameBoard.h"
+#include "Shape.h"
+
+using namespace std;
+
+namespace tetris {
+
+namespace {
+
+enum Op : uint8_t {
+  MOVE = 1,
+  SHAPE = 2,
+  NO_SHAPE = 3,
+  LOCK = 4,
+  CELLS = 5,
+  CLEAR = 6,
+  GAME_OVER = 7
+};
+
+void putU16(vector<uint8_t>& out, uint16_t value) {
+  out.push_back(value & 0xFFu);
+  out.push_back(value >> 8);
+}
+
+void putVarint(vector<uint8_t>& out, uint32_t value) {
+  while (value >= 0x80u) {
+    out.push_back((value & 0x7Fu) | 0x80u);
+    value >>= 7;
+  }
+  out.push_back(value);
+}
+
+void putSigned(vector<uint8_t>& out, int value) {
+  // Zigzag encoding, so that small negative numbers stay short.
+  putVarint(out, (static_cast<uint32_t>(value) << 1) ^ (value < 0 ? ~0u : 0u));
+}
+
+// Reads the numbers written by the functions above, remembering whether it
+// ran past the end.
+class Reader
+{
+public:
+  explicit Reader(const vector<uint8_t>& data)
+    : m_data(data), m_offset(0), m_ok(true) {}
+
+  uint8_t u8() {
+    if (m_offset >= m_data.size()) { m_ok = false; return 0; }
+    return m_data[m_offset++];
+  }
+
+  uint16_t u16() {
+    uint16_t low = u8();
+    return low | (static_cast<uint16_t>(u8()) << 8);
+  }
+
+  uint32_t u32() {
+    uint32_t low = u16();
+    return low | (static_cast<uint32_t>(u16()) << 16);
+  }
+
+  uint32_t varint() {
+    uint32_t res = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+      uint8_t byte = u8();
+      res |= static_cast<uint32_t>(byte & 0x7Fu) << shift;
+      if (!(byte & 0x80u)) { return res; }
+    }
+    m_ok = false;
+    return 0;
+  }
+
+  int signedVarint() {
+    uint32_t value = varint();
+    return static_cast<int>(value >> 1) ^ -static_cast<int>(value & 1u);
+  }
+
+  bool atEnd() const { return m_offset == m_data.size(); }
+  size_t remaining() const { return m_data.size() - m_offset; }
+  const uint8_t* current() const { return m_data.data() + m_offset; }
+  void skip(size_t size) { m_offset += size; }
+  bool ok() const { return m_ok; }
+
+private:
+  const vector<uint8_t>& m_data;
+  size_t m_offset;
+  bool m_ok;
+};
+
+} // anonymous namespace.
+
+SpectatorEncoder::SpectatorEncoder(const Game& game, int player,
+                                   int keyframe_interval)
+  : GameEventListener(),
+    m_game(game),
+    m_player(player),
+    m_keyframe_interval(keyframe_interval),
+    m_tick(0),
+    m_ticks_since_keyframe(0),
+    m_keyframe_needed(true),
+    m_modifications(0),
+    m_ops(),
+    m_has_shape(false),
+    m_shape_pos(),
+    m_shape(),
+    m_scratch()
+{
+  if (m_keyframe_interval < 1) {
+    throw invalid_argument("The keyframe interval must be positive.");
+  }
+}
+
+SpectatorEncoder::~SpectatorEncoder()
+{
+
+}
+
+bool SpectatorEncoder::encodeTick(vector<uint8_t>& out) {
+  ++m_tick;
+  syncShape();
+
+  const Board& board = *m_game.getGameBoard()->getBoard();
+  if (board.getModificationCount() != m_modifications) {
+    m_keyframe_needed = true;
+  }
+
+  // A keyframe is no larger than this, so longer deltas are not worth it.
+  size_t keyframe_size = board.getHeight() * ((board.getWidth() + 7) / 8);
+  bool keyframe = m_keyframe_needed
+                  || ++m_ticks_since_keyframe >= m_keyframe_interval
+                  || m_ops.size() > keyframe_size;
+
+  if (keyframe) {
+    encodeKeyframe(out);
+  } else {
+    size_t start = beginFrame(out, MessageType::DELTA);
+    out.push_back(m_player);
+    putU16(out, m_tick & 0xFFFFu);
+    out.insert(out.end(), m_ops.begin(), m_ops.end());
+    endFrame(out, start);
+  }
+  m_ops.clear();
+  return keyframe;
+}
+
+void SpectatorEncoder::requestKeyframe() {
+  m_keyframe_needed = true;
+}
+
+uint32_t SpectatorEncoder::getTick() const {
+  return m_tick;
+}
+
+void SpectatorEncoder::onShapeLocked(const PackedCoords* positions,
+                                     size_t count) {
+  syncShape();
+
+  const Board& board = *m_game.getGameBoard()->getBoard();
+  bool same = m_has_shape && count == m_shape.size();
+  uint64_t valid = 0;
+  for (size_t i = 0; i < count; ++i) {
+    same = same && positions[i] == m_shape_pos + m_shape[i];
+    if (board.isValid(positions[i])) { ++valid; }
+  }
+
+  if (same) {
+    m_ops.push_back(LOCK);
+  } else {
+    m_ops.push_back(CELLS);
+    putVarint(m_ops, count);
+    for (size_t i = 0; i < count; ++i) {
+      putSigned(m_ops, positions[i].vertical);
+      putSigned(m_ops, positions[i].horizontal);
+    }
+  }
+  m_has_shape = false;
+  checkModifications(valid);
+}
+
+void SpectatorEncoder::onRowsCleared(const int* rows, size_t count) {
+  m_ops.push_back(CLEAR);
+  putVarint(m_ops, count);
+  for (size_t i = 0; i < count; ++i) {
+    putVarint(m_ops, rows[i]);
+  }
+  checkModifications(count);
+}
+
+void SpectatorEncoder::onGameOver() {
+  m_ops.push_back(GAME_OVER);
+}
+
+// Helpers.
+void SpectatorEncoder::encodeKeyframe(vector<uint8_t>& out) {
+  const GameBoard& game_board = *m_game.getGameBoard();
+  const Board& board = *game_board.getBoard();
+
+  size_t start = beginFrame(out, MessageType::KEYFRAME);
+  out.push_back(m_player);
+  putU16(out, m_tick & 0xFFFFu);
+  putU16(out, m_tick >> 16);
+  out.push_back(m_game.isGameOver() ? 1 : 0);
+  putU16(out, board.getHeight());
+  putU16(out, board.getWidth());
+
+  out.push_back(m_has_shape ? m_shape.size() : 0);
+  if (m_has_shape) {
+    putU16(out, static_cast<uint16_t>(m_shape_pos.vertical));
+    putU16(out, static_cast<uint16_t>(m_shape_pos.horizontal));
+    for (PackedCoords c : m_shape) {
+      out.push_back(static_cast<uint8_t>(c.vertical));
+      out.push_back(static_cast<uint8_t>(c.horizontal));
+    }
+  }
+  encodeCells(out, board);
+  endFrame(out, start);
+
+  m_modifications = board.getModificationCount();
+  m_ticks_since_keyframe = 0;
+  m_keyframe_needed = false;
+}
+
+void SpectatorEncoder::syncShape() {
+  const GameBoard& game_board = *m_game.getGameBoard();
+  shared_ptr<const Shape> shape = game_board.getCurrentShape();
+  if (shape == nullptr) {
+    if (m_has_shape) {
+      m_ops.push_back(NO_SHAPE);
+      m_has_shape = false;
+    }
+    return;
+  }
+
+  m_scratch.resize(shape->getBlockCount());
+  shape->getPackedBlockPositions(m_scratch.data());
+  PackedCoords pos = game_board.getCurrentShapePosition();
+
+  if (!m_has_shape || m_scratch != m_shape) {
+    m_ops.push_back(SHAPE);
+    putSigned(m_ops, pos.vertical);
+    putSigned(m_ops, pos.horizontal);
+    m_ops.push_back(m_scratch.size());
+    for (PackedCoords c : m_scratch) {
+      m_ops.push_back(static_cast<uint8_t>(c.vertical));
+      m_ops.push_back(static_cast<uint8_t>(c.horizontal));
+    }
+    m_shape.swap(m_scratch);
+  } else if (pos != m_shape_pos) {
+    m_ops.push_back(MOVE);
+    putSigned(m_ops, pos.vertical - m_shape_pos.vertical);
+    putSigned(m_ops, pos.horizontal - m_shape_pos.horizontal);
+  }
+  m_has_shape = true;
+  m_shape_pos = pos;
+}
+
+void SpectatorEncoder::checkModifications(uint64_t expected) {
+  // The boards count one modification per cell set and per row removed, so
+  // anything beyond that was not reported by an event.
+  uint64_t current = m_game.getGameBoard()->getBoard()
+                                           ->getModificationCount();
+  if (current - m_modifications != expected) {
+    m_keyframe_needed = true;
+  }
+  m_modifications = current;
+}
+
+SpectatorDecoder::SpectatorDecoder()
+  : m_board(nullptr),
+    m_block(make_shared<BasicBlock>()),
+    m_player(0),
+    m_tick(0),
+    m_game_over(false),
+    m_has_shape(false),
+    m_shape_pos(),
+    m_shape()
+{
+
+}
+
+SpectatorDecoder::~SpectatorDecoder()
+{
+
+}
+
+bool SpectatorDecoder::apply(MessageType type, const vector<uint8_t>& payload)
+{
+  bool ok = true;
+  if (type == MessageType::KEYFRAME) {
+    ok = applyKeyframe(payload);
+  } else if (type == MessageType::DELTA) {
+    ok = m_board != nullptr && applyDelta(payload);
+  }
+
+  if (!ok) {
+    m_board = nullptr;
+  }
+  return ok;
+}
+
+bool SpectatorDecoder::hasState() const {
+  return m_board != nullptr;
+}
+
+int SpectatorDecoder::getPlayer() const {
+  return m_player;
+}
+
+uint32_t SpectatorDecoder::getTick() const {
+  return m_tick;
+}
+
+bool SpectatorDecoder::isGameOver() const {
+  return m_game_over;
+}
+
+shared_ptr<const Board> SpectatorDecoder::getBoard() const {
+  return m_board;
+}
+
+vector<PackedCoords> SpectatorDecoder::getShapePositions() const {
+  vector<PackedCoords> res;
+  if (m_board != nullptr && m_has_shape) {
+    for (PackedCoords c : m_shape) {
+      res.push_back(m_shape_pos + c);
+    }
+  }
+  return res;
+}
+
+// Helpers.
+bool SpectatorDecoder::applyKeyframe(const vector<uint8_t>& payload) {
+  Reader reader(payload);
+  m_player = reader.u8();
+  m_tick = reader.u32();
+  m_game_over = reader.u8() != 0;
+  int height = reader.u16();
+  int width = reader.u16();
+
+  int count = reader.u8();
+  m_has_shape = count > 0;
+  m_shape.clear();
+  if (m_has_shape) {
+    int16_t vertical = reader.u16();
+    int16_t horizontal = reader.u16();
+    m_shape_pos = PackedCoords(vertical, horizontal);
+    for (int i = 0; i < count; ++i) {
+      int8_t v = reader.u8();
+      int8_t h = reader.u8();
+      m_shape.emplace_back(v, h);
+    }
+  }
+
+  int row_bytes = (width + 7) / 8;
+  if (!reader.ok() || height < 1 || width < 1
+      || reader.remaining() != static_cast<size_t>(height) * row_bytes) {
+    return false;
+  }
+
+  if (m_board == nullptr || m_board->getHeight() != height
+      || m_board->getWidth() != width) {
+    m_board = make_shared<BasicBoard>(height, width);
+  } else {
+    m_board->clear();
+  }
+  const uint8_t* cells = reader.current();
+  for (int v = 0; v < height; ++v) {
+    for (int h = 0; h < width; ++h) {
+      if ((cells[v * row_bytes + h / 8] >> (h % 8)) & 1u) {
+        m_board->set(v, h, m_block);
+      }
+    }
+  }
+  return true;
+}
+
+bool SpectatorDecoder::applyDelta(const vector<uint8_t>& payload) {
+  Reader reader(payload);
+  int player = reader.u8();
+  uint16_t tick = reader.u16();
+  if (!reader.ok() || player != m_player
+      || tick != ((m_tick + 1) & 0xFFFFu)) {
+    return false;
+  }
+  ++m_tick;
+
+  while (!reader.atEnd()) {
+    switch (reader.u8()) {
+    case MOVE: {
+      int vertical = reader.signedVarint();
+      int horizontal = reader.signedVarint();
+      m_shape_pos = m_shape_pos + PackedCoords(vertical, horizontal);
+      break;
+    }
+    case SHAPE: {
+      int vertical = reader.signedVarint();
+      int horizontal = reader.signedVarint();
+      m_shape_pos = PackedCoords(vertical, horizontal);
+      int count = reader.u8();
+      m_shape.clear();
+      for (int i = 0; i < count; ++i) {
+        int8_t v = reader.u8();
+        int8_t h = reader.u8();
+        m_shape.emplace_back(v, h);
+      }
+      m_has_shape = true;
+      break;
+    }
+    case NO_SHAPE:
+      m_has_shape = false;
+      break;
+    case LOCK:
+      if (!m_has_shape) { return false; }
+      for (PackedCoords c : m_shape) {
+        m_board->set(m_shape_pos + c, m_block);
+      }
+      m_has_shape = false;
+      break;
+    case CELLS: {
+      uint32_t count = reader.varint();
+      for (uint32_t i = 0; i < count && reader.ok(); ++i) {
+        int vertical = reader.signedVarint();
+        int horizontal = reader.signedVarint();
+        m_board->set(vertical, horizontal, m_block);
+      }
+      m_has_shape = false;
+      break;
+    }
+    case CLEAR: {
+      uint32_t count = reader.varint();
+      for (uint32_t i = 0; i < count && reader.ok(); ++i) {
+        m_board->removeRow(reader.varint());
+      }
+      break;
+    }
+    case GAME_OVER:
+      m_game_over = true;
+      break;
+    default:
+      return false;
+    }
+
+    if (!reader.ok()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+} // namespace tetris.
@@ -16,14 +16,15 @@
 
 #include "TetrominoI.h"
 
+#include <typeinfo>
+
 #include "Block.h"
+#include "ShapeCatalog.h"
 
 namespace tetris {
 
 TetrominoI::TetrominoI(std::vector<std::shared_ptr<Block>> blocks)
-  : BasicShape(4,
-               {Coords(0, 1), Coords(1, 1), Coords(2, 1), Coords(3, 1)},
-               blocks)
+  : BasicShape(ShapeCatalog::get(ShapeCatalog::I), blocks)
 {
   //ctor
 }
@@ -48,6 +49,13 @@ TetrominoI::TetrominoI(const TetrominoI& other) : BasicShape(other)
   //copy ctor
 }
 
+TetrominoI::TetrominoI(const TetrominoI& other,
+                       const PoolAllocator<char>& allocator)
+  : BasicShape(other, allocator)
+{
+
+}
+
 TetrominoI::TetrominoI(TetrominoI&& other) : BasicShape(other)
 {
 
@@ -57,4 +65,12 @@ std::shared_ptr<Shape> TetrominoI::clone() const {
   return std::make_shared<TetrominoI>(*this);
 }
 
+std::shared_ptr<Shape> TetrominoI::clone(const PoolAllocator<char>& allocator)
+const {
+  if (typeid(*this) != typeid(TetrominoI)) {
+    return clone();
+  }
+  return std::allocate_shared<TetrominoI>(allocator, *this, allocator);
+}
+
 } // namespace tetris.
@@ -16,14 +16,15 @@
 
 #include "TetrominoJ.h"
 
+#include <typeinfo>
+
 #include "Block.h"
+#include "ShapeCatalog.h"
 
 namespace tetris {
 
 TetrominoJ::TetrominoJ(std::vector<std::shared_ptr<Block>> blocks)
-  : BasicShape(3,
-               {Coords(0, 1), Coords(1, 1), Coords(2, 1), Coords(2, 0)},
-               blocks)
+  : BasicShape(ShapeCatalog::get(ShapeCatalog::J), blocks)
 {
   //ctor
 }
@@ -48,6 +49,13 @@ TetrominoJ::TetrominoJ(const TetrominoJ& other) : BasicShape(other)
   //copy ctor
 }
 
+TetrominoJ::TetrominoJ(const TetrominoJ& other,
+                       const PoolAllocator<char>& allocator)
+  : BasicShape(other, allocator)
+{
+
+}
+
 TetrominoJ::TetrominoJ(TetrominoJ&& other) : BasicShape(other)
 {
 
@@ -57,4 +65,12 @@ std::shared_ptr<Shape> TetrominoJ::clone() const {
   return std::make_shared<TetrominoJ>(*this);
 }
 
+std::shared_ptr<Shape> TetrominoJ::clone(const PoolAllocator<char>& allocator)
+const {
+  if (typeid(*this) != typeid(TetrominoJ)) {
+    return clone();
+  }
+  return std::allocate_shared<TetrominoJ>(allocator, *this, allocator);
+}
+
 } // namespace tetris.
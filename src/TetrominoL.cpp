@@ -16,14 +16,15 @@
 
 #include "TetrominoL.h"
 
+#include <typeinfo>
+
 #include "Block.h"
+#include "ShapeCatalog.h"
 
 namespace tetris {
 
 TetrominoL::TetrominoL(std::vector<std::shared_ptr<Block>> blocks)
-  : BasicShape(3,
-               {Coords(0, 1), Coords(1, 1), Coords(2, 1), Coords(2, 2)},
-               blocks)
+  : BasicShape(ShapeCatalog::get(ShapeCatalog::L), blocks)
 {
   //ctor
 }
@@ -48,6 +49,13 @@ TetrominoL::TetrominoL(const TetrominoL& other) : BasicShape(other)
   //copy ctor
 }
 
+TetrominoL::TetrominoL(const TetrominoL& other,
+                       const PoolAllocator<char>& allocator)
+  : BasicShape(other, allocator)
+{
+
+}
+
 TetrominoL::TetrominoL(TetrominoL&& other) : BasicShape(other)
 {
 
@@ -57,4 +65,12 @@ std::shared_ptr<Shape> TetrominoL::clone() const {
   return std::make_shared<TetrominoL>(*this);
 }
 
+std::shared_ptr<Shape> TetrominoL::clone(const PoolAllocator<char>& allocator)
+const {
+  if (typeid(*this) != typeid(TetrominoL)) {
+    return clone();
+  }
+  return std::allocate_shared<TetrominoL>(allocator, *this, allocator);
+}
+
 } // namespace tetris.
@@ -16,14 +16,15 @@
 
 #include "TetrominoO.h"
 
+#include <typeinfo>
+
 #include "Block.h"
+#include "ShapeCatalog.h"
 
 namespace tetris {
 
 TetrominoO::TetrominoO(std::vector<std::shared_ptr<Block>> blocks)
-  : BasicShape(2,
-               {Coords(0, 0), Coords(0, 1), Coords(1, 0), Coords(1, 1)},
-               blocks)
+  : BasicShape(ShapeCatalog::get(ShapeCatalog::O), blocks)
 {
   //ctor
 }
@@ -48,6 +49,13 @@ TetrominoO::TetrominoO(const TetrominoO& other) : BasicShape(other)
   //copy ctor
 }
 
+TetrominoO::TetrominoO(const TetrominoO& other,
+                       const PoolAllocator<char>& allocator)
+  : BasicShape(other, allocator)
+{
+
+}
+
 TetrominoO::TetrominoO(TetrominoO&& other) : BasicShape(other)
 {
 
@@ -57,4 +65,12 @@ std::shared_ptr<Shape> TetrominoO::clone() const {
   return std::make_shared<TetrominoO>(*this);
 }
 
+std::shared_ptr<Shape> TetrominoO::clone(const PoolAllocator<char>& allocator)
+const {
+  if (typeid(*this) != typeid(TetrominoO)) {
+    return clone();
+  }
+  return std::allocate_shared<TetrominoO>(allocator, *this, allocator);
+}
+
 } // namespace tetris.
@@ -16,14 +16,15 @@
 
 #include "TetrominoS.h"
 
+#include <typeinfo>
+
 #include "Block.h"
+#include "ShapeCatalog.h"
 
 namespace tetris {
 
 TetrominoS::TetrominoS(std::vector<std::shared_ptr<Block>> blocks)
-  : BasicShape(3,
-               {Coords(0, 1), Coords(0, 2), Coords(1, 0), Coords(1, 1)},
-               blocks)
+  : BasicShape(ShapeCatalog::get(ShapeCatalog::S), blocks)
 {
   //ctor
 }
@@ -48,6 +49,13 @@ TetrominoS::TetrominoS(const TetrominoS& other) : BasicShape(other)
   //copy ctor
 }
 
+TetrominoS::TetrominoS(const TetrominoS& other,
+                       const PoolAllocator<char>& allocator)
+  : BasicShape(other, allocator)
+{
+
+}
+
 TetrominoS::TetrominoS(TetrominoS&& other) : BasicShape(other)
 {
 
@@ -57,4 +65,12 @@ std::shared_ptr<Shape> TetrominoS::clone() const {
   return std::make_shared<TetrominoS>(*this);
 }
 
+std::shared_ptr<Shape> TetrominoS::clone(const PoolAllocator<char>& allocator)
+const {
+  if (typeid(*this) != typeid(TetrominoS)) {
+    return clone();
+  }
+  return std::allocate_shared<TetrominoS>(allocator, *this, allocator);
+}
+
 } // namespace tetris.
@@ -16,14 +16,15 @@
 
 #include "TetrominoT.h"
 
+#include <typeinfo>
+
 #include "Block.h"
+#include "ShapeCatalog.h"
 
 namespace tetris {
 
 TetrominoT::TetrominoT(std::vector<std::shared_ptr<Block>> blocks)
-  : BasicShape(3,
-               {Coords(1, 0), Coords(1, 1), Coords(1, 2), Coords(2, 1)},
-               blocks)
+  : BasicShape(ShapeCatalog::get(ShapeCatalog::T), blocks)
 {
   //ctor
 }
@@ -48,6 +49,13 @@ TetrominoT::TetrominoT(const TetrominoT& other) : BasicShape(other)
   //copy ctor
 }
 
+TetrominoT::TetrominoT(const TetrominoT& other,
+                       const PoolAllocator<char>& allocator)
+  : BasicShape(other, allocator)
+{
+
+}
+
 TetrominoT::TetrominoT(TetrominoT&& other) : BasicShape(other)
 {
 
@@ -57,4 +65,12 @@ std::shared_ptr<Shape> TetrominoT::clone() const {
   return std::make_shared<TetrominoT>(*this);
 }
 
+std::shared_ptr<Shape> TetrominoT::clone(const PoolAllocator<char>& allocator)
+const {
+  if (typeid(*this) != typeid(TetrominoT)) {
+    return clone();
+  }
+  return std::allocate_shared<TetrominoT>(allocator, *this, allocator);
+}
+
 } // namespace tetris.
@@ -16,14 +16,15 @@
 
 #include "TetrominoZ.h"
 
+#include <typeinfo>
+
 #include "Block.h"
+#include "ShapeCatalog.h"
 
 namespace tetris {
 
 TetrominoZ::TetrominoZ(std::vector<std::shared_ptr<Block>> blocks)
-  : BasicShape(3,
-               {Coords(0, 0), Coords(0, 1), Coords(1, 1), Coords(1, 2)},
-               blocks)
+  : BasicShape(ShapeCatalog::get(ShapeCatalog::Z), blocks)
 {
   //ctor
 }
@@ -48,6 +49,13 @@ TetrominoZ::TetrominoZ(const TetrominoZ& other) : BasicShape(other)
   //copy ctor
 }
 
+TetrominoZ::TetrominoZ(const TetrominoZ& other,
+                       const PoolAllocator<char>& allocator)
+  : BasicShape(other, allocator)
+{
+
+}
+
 TetrominoZ::TetrominoZ(TetrominoZ&& other) : BasicShape(other)
 {
 
@@ -57,4 +65,12 @@ std::shared_ptr<Shape> TetrominoZ::clone() const {
   return std::make_shared<TetrominoZ>(*this);
 }
 
+std::shared_ptr<Shape> TetrominoZ::clone(const PoolAllocator<char>& allocator)
+const {
+  if (typeid(*this) != typeid(TetrominoZ)) {
+    return clone();
+  }
+  return std::allocate_shared<TetrominoZ>(allocator, *this, allocator);
+}
+
 } // namespace tetris.
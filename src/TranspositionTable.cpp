@@ -0,0 +1,247 @@
+/*
+ * Copyright (C) 2016 Daniel Becker <beckerdaniel.dani@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "TranspositionTable.h"
+
+#include <cstring>
+#include <limits>
+#include <new>
+
+#include "Board.h"
+
+using namespace std;
+
+namespace tetris {
+
+namespace {
+
+// The layout of the data word of an entry.
+const int MOVE_SHIFT = 32;
+const int DEPTH_SHIFT = 48;
+const int GENERATION_SHIFT = 56;
+const int BOUND_SHIFT = 62;
+const uint64_t GENERATION_MASK = 0x3Fu;
+
+uint64_t pack(const TranspositionTable::Entry& entry, uint8_t generation) {
+  uint32_t value_bits;
+  memcpy(&value_bits, &entry.value, sizeof(value_bits));
+  return static_cast<uint64_t>(value_bits)
+         | static_cast<uint64_t>(entry.move) << MOVE_SHIFT
+         | static_cast<uint64_t>(entry.depth) << DEPTH_SHIFT
+         | (generation & GENERATION_MASK) << GENERATION_SHIFT
+         | static_cast<uint64_t>(entry.bound) << BOUND_SHIFT;
+}
+
+TranspositionTable::Entry unpack(uint64_t data) {
+  TranspositionTable::Entry entry;
+  uint32_t value_bits = static_cast<uint32_t>(data);
+  memcpy(&entry.value, &value_bits, sizeof(value_bits));
+  entry.move = static_cast<uint16_t>(data >> MOVE_SHIFT);
+  entry.depth = static_cast<uint8_t>(data >> DEPTH_SHIFT);
+  entry.bound = static_cast<TranspositionTable::Bound>(data >> BOUND_SHIFT);
+  return entry;
+}
+
+// Empty slots have no bound, as every stored entry has one.
+bool isUsed(uint64_t data) {
+  return (data >> BOUND_SHIFT) != 0;
+}
+
+int getDepth(uint64_t data) {
+  return static_cast<uint8_t>(data >> DEPTH_SHIFT);
+}
+
+int getGeneration(uint64_t data) {
+  return (data >> GENERATION_SHIFT) & GENERATION_MASK;
+}
+
+// Numbers the threads in the order they first count, to spread them over
+// the stripes of the counters.
+unsigned int getThreadIndex() {
+  static atomic<unsigned int> next_index(0);
+  static thread_local unsigned int index
+    = next_index.fetch_add(1, memory_order_relaxed);
+  return index;
+}
+
+} // anonymous namespace.
+
+const int TranspositionTable::BUCKET_SIZE;
+const size_t TranspositionTable::CACHE_LINE;
+const int TranspositionTable::STRIPE_COUNT;
+
+TranspositionTable::TranspositionTable(size_t memory_budget)
+  : m_storage(), m_buckets(nullptr), m_mask(0), m_generation(0),
+    m_counters(nullptr)
+{
+  static_assert(sizeof(Bucket) == CACHE_LINE,
+                "A bucket must fill a cache line.");
+  static_assert(sizeof(Counters) == CACHE_LINE,
+                "The counters of a stripe must fill a cache line.");
+
+  size_t bucket_count = 1;
+  while (bucket_count * 2 * sizeof(Bucket) <= memory_budget) {
+    bucket_count *= 2;
+  }
+  m_mask = bucket_count - 1;
+
+  m_storage.reset(new char[bucket_count * sizeof(Bucket)
+                           + STRIPE_COUNT * sizeof(Counters) + CACHE_LINE]);
+  uintptr_t address = reinterpret_cast<uintptr_t>(m_storage.get());
+  address = (address + CACHE_LINE - 1) & ~(uintptr_t(CACHE_LINE) - 1);
+  m_buckets = reinterpret_cast<Bucket*>(address);
+  for (size_t i = 0; i < bucket_count; ++i) {
+    new (&m_buckets[i]) Bucket();
+  }
+  m_counters = reinterpret_cast<Counters*>(m_buckets + bucket_count);
+  for (int i = 0; i < STRIPE_COUNT; ++i) {
+    new (&m_counters[i]) Counters();
+  }
+  clear();
+}
+
+TranspositionTable::~TranspositionTable()
+{
+
+}
+
+bool TranspositionTable::probe(uint64_t key, Entry& entry) const {
+  Counters& counters = getCounters();
+  counters.probes.fetch_add(1, memory_order_relaxed);
+
+  const Bucket& bucket = m_buckets[key & m_mask];
+  for (const Slot& slot : bucket.slots) {
+    uint64_t data = slot.data.load(memory_order_relaxed);
+    uint64_t check = slot.check.load(memory_order_relaxed);
+    if (isUsed(data) && (check ^ data) == key) {
+      entry = unpack(data);
+      counters.hits.fetch_add(1, memory_order_relaxed);
+      return true;
+    }
+  }
+  return false;
+}
+
+void TranspositionTable::store(uint64_t key, const Entry& entry) {
+  int generation = m_generation.load(memory_order_relaxed) & GENERATION_MASK;
+  Bucket& bucket = m_buckets[key & m_mask];
+
+  // Taking the slot of the same state if there is one, otherwise the one
+  // that is worth the least: empty, or searched shallow long ago.
+  Slot* victim = nullptr;
+  int victim_worth = numeric_limits<int>::max();
+  bool same_state = false;
+  for (Slot& slot : bucket.slots) {
+    uint64_t data = slot.data.load(memory_order_relaxed);
+    uint64_t check = slot.check.load(memory_order_relaxed);
+    if (!isUsed(data)) {
+      if (victim_worth > numeric_limits<int>::min()) {
+        victim = &slot;
+        victim_worth = numeric_limits<int>::min();
+      }
+      continue;
+    }
+
+    if ((check ^ data) == key) {
+      if (getGeneration(data) == generation
+          && getDepth(data) > entry.depth) {
+        return;
+      }
+      victim = &slot;
+      same_state = true;
+      break;
+    }
+
+    int age = (generation - getGeneration(data)) & GENERATION_MASK;
+    int worth = getDepth(data) - 8 * age;
+    if (worth < victim_worth) {
+      victim = &slot;
+      victim_worth = worth;
+    }
+  }
+
+  Counters& counters = getCounters();
+  if (!same_state && victim_worth != numeric_limits<int>::min()) {
+    counters.collisions.fetch_add(1, memory_order_relaxed);
+  }
+  counters.stores.fetch_add(1, memory_order_relaxed);
+
+  uint64_t data = pack(entry, generation);
+  victim->data.store(data, memory_order_relaxed);
+  victim->check.store(key ^ data, memory_order_relaxed);
+}
+
+void TranspositionTable::newSearch() {
+  m_generation.fetch_add(1, memory_order_relaxed);
+}
+
+void TranspositionTable::clear() {
+  for (size_t i = 0; i <= m_mask; ++i) {
+    for (Slot& slot : m_buckets[i].slots) {
+      slot.data.store(0, memory_order_relaxed);
+      slot.check.store(0, memory_order_relaxed);
+    }
+  }
+  m_generation.store(0);
+  for (int i = 0; i < STRIPE_COUNT; ++i) {
+    m_counters[i].probes.store(0);
+    m_counters[i].hits.store(0);
+    m_counters[i].stores.store(0);
+    m_counters[i].collisions.store(0);
+  }
+}
+
+size_t TranspositionTable::getCapacity() const {
+  return (m_mask + 1) * BUCKET_SIZE;
+}
+
+TranspositionTable::Stats TranspositionTable::getStats() const {
+  Stats stats;
+  for (int i = 0; i < STRIPE_COUNT; ++i) {
+    stats.probes += m_counters[i].probes.load(memory_order_relaxed);
+    stats.hits += m_counters[i].hits.load(memory_order_relaxed);
+    stats.stores += m_counters[i].stores.load(memory_order_relaxed);
+    stats.collisions += m_counters[i].collisions.load(memory_order_relaxed);
+  }
+  return stats;
+}
+
+TranspositionTable::Counters& TranspositionTable::getCounters() const {
+  return m_counters[getThreadIndex() % STRIPE_COUNT];
+}
+
+uint64_t TranspositionTable::combine(uint64_t hash, uint64_t value) {
+  // The finalizer of SplitMix64 over the two words.
+  uint64_t x = hash ^ (value + 0x9E3779B97F4A7C15ull + (hash << 6)
+                       + (hash >> 2));
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+  return x ^ (x >> 31);
+}
+
+uint64_t TranspositionTable::hash(const Board& board) {
+  uint64_t res = combine(board.getHeight(), board.getWidth());
+  for (int v = 0; v < board.getHeight(); ++v) {
+    // A whole word of the row at a time.
+    for (int h = 0; h < board.getWidth(); h += 64) {
+      uint64_t bits = board.getRowBits(v, h, ~uint64_t(0));
+      res = combine(res, bits & ~board.getWallBits(h));
+    }
+  }
+  return res;
+}
+
+} // namespace tetris.
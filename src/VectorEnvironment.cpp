@@ -0,0 +1,301 @@
+/*
+ * Copyright (C) 2016 Daniel Becker <beckerdaniel.dani@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "VectorEnvironment.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+#include "BasicBoard.h"
+#include "Board.h"
+#include "DefaultGame.h"
+#include "DefaultGameBoard.h"
+#include "PoolAllocator.h"
+#include "Shape.h"
+
+using namespace std;
+
+namespace tetris {
+
+namespace {
+
+// Returns the cells of the current shape on the board. They are kept in a
+// buffer of the calling thread, so that observing does not allocate once
+// the buffer has grown to the size of the shapes.
+const vector<PackedCoords>& getShapeCells(const GameBoard& game_board) {
+  static thread_local vector<PackedCoords> cells;
+  shared_ptr<const Shape> shape = game_board.getCurrentShape();
+  if (shape == nullptr) {
+    cells.clear();
+    return cells;
+  }
+
+  cells.resize(shape->getBlockCount());
+  shape->getPackedBlockPositions(cells.data());
+  PackedCoords position = game_board.getCurrentShapePosition();
+  for (PackedCoords& c : cells) {
+    c = c + position;
+  }
+  return cells;
+}
+
+} // anonymous namespace.
+
+/** \cond PIMPL */
+
+class VectorEnvironment::PIMPL
+{
+public:
+  PIMPL(int count, int height, int width, vector<shared_ptr<Shape>> shapes,
+        unsigned int seed, unsigned int threads)
+   : m_height(height), m_width(width)
+  {
+    if (count < 1) {
+      throw invalid_argument("At least one environment is required.");
+    }
+
+    for (int i = 0; i < count; ++i) {
+      shared_ptr<Board> board = make_shared<BasicBoard>(height, width);
+      shared_ptr<GameBoard> game_board = make_shared<DefaultGameBoard>(board);
+      m_game_boards.push_back(game_board);
+      m_games.push_back(make_shared<DefaultGame>(game_board, shapes,
+                                                 seed + i));
+      m_games.back()->setAllocationPool(make_shared<PoolResource>());
+      m_games.back()->newGame();
+    }
+
+    if (threads == 0u) {
+      threads = max(1u, thread::hardware_concurrency());
+    }
+    m_chunk_count = min<unsigned int>(threads, count);
+
+    // The calling thread processes the first chunk itself.
+    for (unsigned int i = 1; i < m_chunk_count; ++i) {
+      m_workers.emplace_back([this, i]() { workerLoop(i); });
+    }
+  }
+
+  ~PIMPL() {
+    {
+      lock_guard<mutex> lock(m_mutex);
+      m_stopping = true;
+    }
+    m_work_cv.notify_all();
+    for (thread& t : m_workers) {
+      t.join();
+    }
+  }
+
+  int m_height;
+  int m_width;
+  vector<shared_ptr<GameBoard>> m_game_boards {};
+  vector<shared_ptr<DefaultGame>> m_games {};
+
+  // Runs job on every environment in parallel and returns when all of them
+  // are done.
+  void runAll(function<void(int)> job) {
+    {
+      lock_guard<mutex> lock(m_mutex);
+      m_job = job;
+      m_pending = m_chunk_count - 1;
+      ++m_generation;
+    }
+    m_work_cv.notify_all();
+
+    runChunk(0);
+
+    unique_lock<mutex> lock(m_mutex);
+    m_done_cv.wait(lock, [this]() { return m_pending == 0; });
+  }
+
+  // Applies the action and auto-resets, returning the reward.
+  float stepOne(int index, Action action, uint8_t& done) {
+    DefaultGame& game = *m_games[index];
+    int rows = 0;
+    switch (action) {
+    case Action::MOVE_LEFT: game.moveLeft(); break;
+    case Action::MOVE_RIGHT: game.moveRight(); break;
+    case Action::ROTATE_LEFT: game.rotateLeft(); break;
+    case Action::ROTATE_RIGHT: game.rotateRight(); break;
+    default: break;
+    }
+
+    if (action == Action::DROP) {
+      rows = game.drop();
+    } else {
+      rows = game.advance();
+    }
+
+    done = game.isGameOver() ? 1 : 0;
+    if (done) {
+      game.newGame();
+    }
+    return static_cast<float>(rows);
+  }
+
+  void observe(int index, uint8_t* out) const {
+    const GameBoard& game_board = *m_game_boards[index];
+    const Board& board = *game_board.getBoard();
+    for (int v = 0; v < m_height; ++v) {
+      // Whole words of the row at a time where the board stores its rows as
+      // bits.
+      for (int h = 0; h < m_width; h += 64) {
+        uint64_t bits = board.getRowBits(v, h, ~uint64_t(0));
+        bits &= ~board.getWallBits(h);
+        int end = min(m_width - h, 64);
+        for (int i = 0; i < end; ++i) {
+          out[v * m_width + h + i] = (bits >> i) & 1u;
+        }
+      }
+    }
+    for (PackedCoords c : getShapeCells(game_board)) {
+      if (board.isValid(c.vertical, c.horizontal)) {
+        out[c.vertical * m_width + c.horizontal] = 2;
+      }
+    }
+  }
+
+  void observePacked(int index, uint8_t* out) const {
+    const GameBoard& game_board = *m_game_boards[index];
+    const Board& board = *game_board.getBoard();
+    int row_bytes = (m_width + 7) / 8;
+    for (int v = 0; v < m_height; ++v) {
+      for (int h = 0; h < m_width; h += 8) {
+        uint64_t bits = board.getRowBits(v, h, 0xFFu);
+        bits &= ~board.getWallBits(h);
+        out[v * row_bytes + h / 8] = static_cast<uint8_t>(bits);
+      }
+    }
+    for (PackedCoords c : getShapeCells(game_board)) {
+      if (board.isValid(c.vertical, c.horizontal)) {
+        int h = c.horizontal;
+        out[c.vertical * row_bytes + h / 8] |= 1u << (h % 8);
+      }
+    }
+  }
+
+private:
+  void runChunk(unsigned int chunk) {
+    int count = m_games.size();
+    int begin = count * chunk / m_chunk_count;
+    int end = count * (chunk + 1) / m_chunk_count;
+    for (int i = begin; i < end; ++i) {
+      m_job(i);
+    }
+  }
+
+  void workerLoop(unsigned int chunk) {
+    unsigned long seen_generation = 0;
+    while (true) {
+      {
+        unique_lock<mutex> lock(m_mutex);
+        m_work_cv.wait(lock, [&]() {
+          return m_stopping || m_generation != seen_generation;
+        });
+        if (m_stopping) { return; }
+        seen_generation = m_generation;
+      }
+
+      runChunk(chunk);
+
+      {
+        lock_guard<mutex> lock(m_mutex);
+        --m_pending;
+      }
+      m_done_cv.notify_one();
+    }
+  }
+
+  unsigned int m_chunk_count = 1u;
+  vector<thread> m_workers {};
+
+  mutex m_mutex {}; // Protects the members below.
+  condition_variable m_work_cv {};
+  condition_variable m_done_cv {};
+  function<void(int)> m_job {};
+  unsigned long m_generation = 0;
+  unsigned int m_pending = 0;
+  bool m_stopping = false;
+}; // PIMPL
+
+/** \endcond */
+
+VectorEnvironment::VectorEnvironment(int count, int height, int width,
+                                     vector<shared_ptr<Shape>> shapes,
+                                     unsigned int seed, unsigned int threads)
+  : m_pimpl(new PIMPL(count, height, width, shapes, seed, threads))
+{
+
+}
+
+VectorEnvironment::~VectorEnvironment()
+{
+  delete m_pimpl;
+  m_pimpl = nullptr;
+}
+
+int VectorEnvironment::getCount() const {
+  return m_pimpl->m_games.size();
+}
+
+int VectorEnvironment::getObservationSize() const {
+  return m_pimpl->m_height * m_pimpl->m_width;
+}
+
+int VectorEnvironment::getPackedObservationSize() const {
+  return m_pimpl->m_height * ((m_pimpl->m_width + 7) / 8);
+}
+
+shared_ptr<const Game> VectorEnvironment::getGame(int index) const {
+  return m_pimpl->m_games.at(index);
+}
+
+void VectorEnvironment::reset(uint8_t* observations) {
+  int obs_size = getObservationSize();
+  PIMPL* pimpl = m_pimpl;
+  m_pimpl->runAll([=](int i) {
+    pimpl->m_games[i]->newGame();
+    pimpl->observe(i, observations + i * obs_size);
+  });
+}
+
+void VectorEnvironment::step(const Action* actions, uint8_t* observations,
+                             float* rewards, uint8_t* dones) {
+  int obs_size = getObservationSize();
+  PIMPL* pimpl = m_pimpl;
+  m_pimpl->runAll([=](int i) {
+    rewards[i] = pimpl->stepOne(i, actions[i], dones[i]);
+    pimpl->observe(i, observations + i * obs_size);
+  });
+}
+
+void VectorEnvironment::stepPacked(const Action* actions,
+                                   uint8_t* observations,
+                                   float* rewards, uint8_t* dones) {
+  int obs_size = getPackedObservationSize();
+  PIMPL* pimpl = m_pimpl;
+  m_pimpl->runAll([=](int i) {
+    rewards[i] = pimpl->stepOne(i, actions[i], dones[i]);
+    pimpl->observePacked(i, observations + i * obs_size);
+  });
+}
+
+} // namespace tetris.
@@ -0,0 +1,367 @@
+/*
+ * Copyright (C) 2016 Daniel Becker <beckerdaniel.dani@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "WeightTuner.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <thread>
+
+#include "BasicBoard.h"
+#include "DefaultGame.h"
+#include "DefaultGameBoard.h"
+#include "PoolAllocator.h"
+#include "Shape.h"
+
+using namespace std;
+
+namespace tetris {
+
+namespace {
+
+const char* const CHECKPOINT_HEADER = "WeightTuner 1";
+
+typedef array<double, 4> Weights;
+
+Weights toArray(const SearchWeights& weights) {
+  return Weights {{weights.height, weights.lines, weights.holes,
+                   weights.bumpiness}};
+}
+
+SearchWeights fromArray(const Weights& weights) {
+  SearchWeights res;
+  res.height = weights[0];
+  res.lines = weights[1];
+  res.holes = weights[2];
+  res.bumpiness = weights[3];
+  return res;
+}
+
+// The seed of the first game of a generation, spread so that the games of
+// neighbouring generations do not overlap.
+unsigned int generationSeed(unsigned int seed, int generation) {
+  uint64_t x = (static_cast<uint64_t>(seed) << 32) + generation;
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+  return static_cast<unsigned int>(x ^ (x >> 31));
+}
+
+// What a thread plays with; it is reused for all the games of the thread.
+struct Worker
+{
+  Worker(int height, int width, const vector<shared_ptr<Shape>>& shapes)
+    : game_board(make_shared<DefaultGameBoard>(
+                                  make_shared<BasicBoard>(height, width))),
+      game(game_board, shapes, 0u)
+  {
+    game.setAllocationPool(make_shared<PoolResource>());
+  }
+
+  shared_ptr<DefaultGameBoard> game_board;
+  DefaultGame game;
+  PlacementSearch search {};
+  uint64_t pieces = 0;
+};
+
+} // anonymous namespace.
+
+/** \cond PIMPL */
+
+class WeightTuner::PIMPL
+{
+public:
+  PIMPL(TunerConfig config, vector<shared_ptr<Shape>> shapes)
+    : m_config(config), m_shapes(shapes), m_engine(config.seed)
+  {
+    if (m_config.height < 1 || m_config.width < 1) {
+      throw invalid_argument("The board must have at least one cell.");
+    }
+    if (m_config.population < 1 || m_config.elite < 1
+        || m_config.elite > m_config.population) {
+      throw invalid_argument(
+                      "The elite must be a non-empty part of the population.");
+    }
+    if (m_config.games < 1 || m_config.max_pieces < 1) {
+      throw invalid_argument("At least one game of one piece is required.");
+    }
+    if (m_shapes.empty()) {
+      throw invalid_argument("At least one shape must be specified.");
+    }
+
+    if (m_config.threads == 0u) {
+      m_config.threads = max(1u, thread::hardware_concurrency());
+    }
+    m_mean = toArray(SearchWeights());
+    m_deviation.fill(m_config.initial_deviation);
+  }
+
+  GenerationReport runGeneration() {
+    Clock::time_point start = Clock::now();
+    uint64_t pieces = countPieces();
+    ++m_generation;
+
+    // A new distribution every generation, so that no cached value has to
+    // be saved in the checkpoints.
+    normal_distribution<double> normal;
+    m_candidates.resize(m_config.population);
+    for (Weights& candidate : m_candidates) {
+      for (size_t d = 0; d < candidate.size(); ++d) {
+        candidate[d] = m_mean[d] + m_deviation[d] * normal(m_engine);
+      }
+    }
+
+    playAll(generationSeed(m_config.seed, m_generation), m_config.games);
+
+    vector<int> order(m_candidates.size());
+    iota(order.begin(), order.end(), 0);
+    stable_sort(order.begin(), order.end(), [this](int lhs, int rhs) {
+      return m_scores[lhs] > m_scores[rhs];
+    });
+
+    // Moving the distribution to the elite.
+    for (size_t d = 0; d < m_mean.size(); ++d) {
+      double sum = 0.0;
+      for (int e = 0; e < m_config.elite; ++e) {
+        sum += m_candidates[order[e]][d];
+      }
+      double mean = sum / m_config.elite;
+      double variance = 0.0;
+      for (int e = 0; e < m_config.elite; ++e) {
+        double diff = m_candidates[order[e]][d] - mean;
+        variance += diff * diff;
+      }
+      m_mean[d] = mean;
+      m_deviation[d] = sqrt(variance / m_config.elite) + m_config.noise;
+    }
+
+    GenerationReport report;
+    report.generation = m_generation;
+    report.best = fromArray(m_candidates[order[0]]);
+    report.best_score = m_scores[order[0]];
+    report.mean_score = accumulate(m_scores.begin(), m_scores.end(), 0.0)
+                        / m_scores.size();
+    report.games = static_cast<uint64_t>(m_config.population)
+                   * m_config.games;
+    report.pieces = countPieces() - pieces;
+    report.seconds = chrono::duration<double>(Clock::now() - start).count();
+    return report;
+  }
+
+  double evaluate(const SearchWeights& weights, unsigned int first_seed,
+                  int games) {
+    if (games < 1) {
+      throw invalid_argument("At least one game is required.");
+    }
+    m_candidates.assign(1, toArray(weights));
+    playAll(first_seed, games);
+    return m_scores[0];
+  }
+
+  TunerConfig m_config;
+  vector<shared_ptr<Shape>> m_shapes;
+  mt19937 m_engine;
+  int m_generation = 0;
+  Weights m_mean {};
+  Weights m_deviation {};
+
+private:
+  typedef chrono::steady_clock Clock;
+
+  // Plays the games of every candidate, setting m_scores to their mean
+  // lines. The games are taken one at a time from a shared counter, so the
+  // threads that get short games are not left idle.
+  void playAll(unsigned int first_seed, int games) {
+    size_t task_count = m_candidates.size() * games;
+    m_lines.assign(task_count, 0);
+
+    unsigned int thread_count = min<size_t>(m_config.threads, task_count);
+    while (m_workers.size() < thread_count) {
+      m_workers.emplace_back(new Worker(m_config.height, m_config.width,
+                                        m_shapes));
+    }
+
+    atomic<size_t> next(0);
+    function<void(Worker&)> work = [&](Worker& worker) {
+      size_t task;
+      while ((task = next.fetch_add(1, memory_order_relaxed)) < task_count) {
+        const Weights& candidate = m_candidates[task / games];
+        m_lines[task] = playGame(worker, fromArray(candidate),
+                                 first_seed + task % games);
+      }
+    };
+
+    // The calling thread plays too.
+    vector<thread> threads;
+    for (unsigned int i = 1; i < thread_count; ++i) {
+      threads.emplace_back(work, ref(*m_workers[i]));
+    }
+    work(*m_workers[0]);
+    for (thread& t : threads) {
+      t.join();
+    }
+
+    m_scores.assign(m_candidates.size(), 0.0);
+    for (size_t task = 0; task < task_count; ++task) {
+      m_scores[task / games] += m_lines[task];
+    }
+    for (double& score : m_scores) {
+      score /= games;
+    }
+  }
+
+  // Plays a game with the greedy search the bots use, returning the number
+  // of lines cleared.
+  int playGame(Worker& worker, const SearchWeights& weights,
+               unsigned int seed) {
+    DefaultGame& game = worker.game;
+    const GameBoard& game_board = *worker.game_board;
+    worker.search.setWeights(weights);
+    game.newGame(seed);
+
+    int lines = 0;
+    for (int piece = 0; piece < m_config.max_pieces && !game.isGameOver();
+         ++piece) {
+      Placement placement = worker.search.search(game_board, m_no_preview,
+                                                 nullptr,
+                                                 chrono::microseconds(0));
+      int cleared = playPlacement(game, placement);
+      if (cleared < 0) {
+        break;
+      }
+      lines += cleared;
+      ++worker.pieces;
+    }
+    return lines;
+  }
+
+  uint64_t countPieces() const {
+    uint64_t res = 0;
+    for (const unique_ptr<Worker>& worker : m_workers) {
+      res += worker->pieces;
+    }
+    return res;
+  }
+
+  const vector<shared_ptr<const Shape>> m_no_preview {};
+  vector<unique_ptr<Worker>> m_workers {};
+  vector<Weights> m_candidates {};
+  vector<int> m_lines {};
+  vector<double> m_scores {};
+}; // PIMPL
+
+/** \endcond */
+
+WeightTuner::WeightTuner(TunerConfig config, vector<shared_ptr<Shape>> shapes)
+  : m_pimpl(new PIMPL(config, shapes))
+{
+
+}
+
+WeightTuner::~WeightTuner()
+{
+  delete m_pimpl;
+  m_pimpl = nullptr;
+}
+
+GenerationReport WeightTuner::runGeneration() {
+  return m_pimpl->runGeneration();
+}
+
+double WeightTuner::evaluate(const SearchWeights& weights,
+                             unsigned int first_seed, int games) {
+  return m_pimpl->evaluate(weights, first_seed, games);
+}
+
+int WeightTuner::getGeneration() const {
+  return m_pimpl->m_generation;
+}
+
+SearchWeights WeightTuner::getMean() const {
+  return fromArray(m_pimpl->m_mean);
+}
+
+SearchWeights WeightTuner::getDeviation() const {
+  return fromArray(m_pimpl->m_deviation);
+}
+
+void WeightTuner::saveCheckpoint(const string& path) const {
+  string temp_path = path + ".tmp";
+  {
+    ofstream out(temp_path);
+    out.precision(numeric_limits<double>::max_digits10);
+    out << CHECKPOINT_HEADER << '\n'
+        << m_pimpl->m_generation << '\n';
+    for (double value : m_pimpl->m_mean) {
+      out << value << ' ';
+    }
+    out << '\n';
+    for (double value : m_pimpl->m_deviation) {
+      out << value << ' ';
+    }
+    out << '\n' << m_pimpl->m_engine << '\n';
+    out.flush();
+    if (!out) {
+      throw runtime_error("Could not write the checkpoint " + temp_path + ".");
+    }
+  }
+
+  if (rename(temp_path.c_str(), path.c_str()) != 0) {
+    throw runtime_error("Could not replace the checkpoint " + path + ".");
+  }
+}
+
+bool WeightTuner::loadCheckpoint(const string& path) {
+  ifstream in(path);
+  if (!in) {
+    return false;
+  }
+
+  string header;
+  getline(in, header);
+  int generation = 0;
+  Weights mean {};
+  Weights deviation {};
+  mt19937 engine;
+  in >> generation;
+  for (double& value : mean) {
+    in >> value;
+  }
+  for (double& value : deviation) {
+    in >> value;
+  }
+  in >> engine;
+  if (header != CHECKPOINT_HEADER || !in || generation < 0) {
+    throw invalid_argument(path + " is not a checkpoint of the tuner.");
+  }
+
+  m_pimpl->m_generation = generation;
+  m_pimpl->m_mean = mean;
+  m_pimpl->m_deviation = deviation;
+  m_pimpl->m_engine = engine;
+  return true;
+}
+
+} // namespace tetris.